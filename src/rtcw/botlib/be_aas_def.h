@@ -14,6 +14,8 @@ SPDX-License-Identifier: GPL-3.0
  *
  *****************************************************************************/
 
+#include "SDL_atomic.h"
+
 //debugging on
 #define AAS_DEBUG
 
@@ -133,7 +135,11 @@ struct AasRoutingCache32 {
 typedef struct aas_routingcache_s
 {
 	int size;                                   //size of the routing cache
-	float time;                                 //last time accessed or updated
+	union
+	{
+		float time;                             //last time accessed or updated
+		SDL_atomic_t lastused;                  //the bits of time, stored by concurrent route queries
+	};
 	int cluster;                                //cluster the cache is for
 	int areanum;                                //area the cache is created for
 	vec3_t origin;                              //origin within the area
@@ -169,6 +175,34 @@ typedef struct aas_routingupdate_s
 	struct aas_routingupdate_s *prev;
 } aas_routingupdate_t;
 
+//reachability state of the goal directed route search
+typedef struct aas_routenode_s
+{
+	int search;                                 //search the fields belong to
+	int traveltime;                             //travel time to arrive through the reachability
+	int estimate;                               //travel time plus the estimate to the goal
+	int prev;                                   //reachability the route came through
+	int heapindex;                              //index in the open heap, -1 if closed
+} aas_routenode_t;
+
+//fields for the goal directed route search
+typedef struct aas_routesearch_s
+{
+	int search;                                 //number of the current search
+	aas_routenode_t *nodes;                     //node for every reachability
+	int *heap;                                  //open reachabilities ordered by estimate
+	int heapsize;
+} aas_routesearch_t;
+
+//routing update fields of one routing cache update at a time
+typedef struct aas_routingscratch_s
+{
+	aas_routingupdate_t *areaupdate;
+	aas_routingupdate_t *portalupdate;
+	aas_routesearch_t *routesearch;             //allocated by the first goal directed route
+	struct aas_routingscratch_s *next;          //next free routing update fields
+} aas_routingscratch_t;
+
 //reversed reachability link
 typedef struct aas_reversedlink_s
 {
@@ -188,6 +222,27 @@ typedef struct aas_reversedreachability_s
 #include "be_aas_routetable.h"
 // done.
 
+#define AAS_MAX_ROUTINGTABLES       4
+
+//precomputed routing tables, one table per set of travel flags
+typedef struct aas_routingtables_s
+{
+	void *mapping;                              //read-only mapping of the routing table file
+	const unsigned char *data;                  //start of the first table
+	int tablesize;                              //size of every table
+	int numtables;                              //number of tables
+	int travelflags[AAS_MAX_ROUTINGTABLES];     //travel flags every table is computed with
+	int *clusteroffsets;                        //offset of the area tables of every cluster
+	int portaloffset;                           //offset of the portal tables
+	unsigned short int *emptytraveltimes;       //travel times towards areas without reachabilities
+	unsigned char *emptyreachabilities;
+	int *areaflags;                             //area flags the tables are computed with
+	byte *areachanged;                          //true if the area flags differ from areaflags
+	int *clusterchanges;                        //number of changed areas in every cluster
+	int numchanges;                             //number of changed areas
+	int numteamclusters;                        //clusters with team travel flags
+} aas_routingtables_t;
+
 typedef struct aas_s
 {
 	int loaded;                                 //true when an AAS file is loaded
@@ -263,18 +318,29 @@ typedef struct aas_s
 	aas_routingupdate_t *areaupdate;
 	aas_routingupdate_t *portalupdate;
 	//number of routing updates during a frame (reset every frame)
-	int frameroutingupdates;
+	SDL_atomic_t frameroutingupdates;
+	//free routing update fields for the routing cache updates
+	aas_routingscratch_t *routingscratch;
 	//reversed reachability links
 	aas_reversedreachability_t *reversedreachability;
 	//travel times within the areas
 	unsigned short ***areatraveltimes;
+	//index of every reachability in the reversed links of the area it leads to
+	int *reversedlinkindex;
+	//lowest travel time per unit of distance of every travel type
+	float routeestimatescale[MAX_TRAVELTYPES];
 	//array of size numclusters with cluster cache
 	aas_routingcache_t ***clusterareacache;
 	aas_routingcache_t **portalcache;
+	//locks for adding area and portal cache, one of both for every cluster
+	SDL_SpinLock *areacachelocks;
+	SDL_SpinLock *portalcachelocks;
 	//maximum travel time through portals
 	int *portalmaxtraveltimes;
 	// Ridah, pointer to Route-Table information
 	aas_rt_t    *routetable;
+	//precomputed routing tables
+	aas_routingtables_t *routingtables;
 	//hide travel times
 	unsigned short int *hidetraveltimes;
 
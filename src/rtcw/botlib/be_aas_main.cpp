@@ -270,7 +270,9 @@ int AAS_StartFrame( float time ) {
 #endif // RTCW_XX
 
 		//
-		( *aasworld ).frameroutingupdates = 0;
+		SDL_AtomicSet( &( *aasworld ).frameroutingupdates, 0 );
+		//free the least recently used routing caches
+		AAS_FreeOldestCaches();
 		//
 		/* Ridah, disabled for speed
 		if (LibVarGetValue("showcacheupdates"))
@@ -20,6 +20,7 @@ SPDX-License-Identifier: GPL-3.0
 
 // BBi
 #include <algorithm>
+#include <climits>
 #include <memory>
 
 #include "rtcw_endian.h"
@@ -218,24 +219,35 @@ extern aas_t aasworlds[MAX_AAS_WORLDS];
 #endif // RTCW_XX
 
 #ifdef ROUTING_DEBUG
-int numareacacheupdates;
-int numportalcacheupdates;
+SDL_atomic_t numareacacheupdates;
+SDL_atomic_t numportalcacheupdates;
 #endif //ROUTING_DEBUG
 
-int routingcachesize;
+SDL_atomic_t routingcachesize;
 int max_routingcachesize;
 
+//the routing memory and the free routing update fields are shared by
+//concurrent route queries
+static SDL_SpinLock routingmemorylock;
+
 #if defined RTCW_ET
 int max_frameroutingupdates;
 #endif // RTCW_XX
 
 // Ridah, routing memory calls go here, so we can change between Hunk/Zone easily
 void *AAS_RoutingGetMemory( int size ) {
-	return GetClearedMemory( size );
+	void *ptr;
+
+	SDL_AtomicLock( &routingmemorylock );
+	ptr = GetClearedMemory( size );
+	SDL_AtomicUnlock( &routingmemorylock );
+	return ptr;
 }
 
 void AAS_RoutingFreeMemory( void *ptr ) {
+	SDL_AtomicLock( &routingmemorylock );
 	FreeMemory( ptr );
+	SDL_AtomicUnlock( &routingmemorylock );
 }
 // done.
 
@@ -247,9 +259,9 @@ void AAS_RoutingFreeMemory( void *ptr ) {
 //===========================================================================
 #ifdef ROUTING_DEBUG
 void AAS_RoutingInfo( void ) {
-	botimport.Print( PRT_MESSAGE, "%d area cache updates\n", numareacacheupdates );
-	botimport.Print( PRT_MESSAGE, "%d portal cache updates\n", numportalcacheupdates );
-	botimport.Print( PRT_MESSAGE, "%d bytes routing cache\n", routingcachesize );
+	botimport.Print( PRT_MESSAGE, "%d area cache updates\n", SDL_AtomicGet( &numareacacheupdates ) );
+	botimport.Print( PRT_MESSAGE, "%d portal cache updates\n", SDL_AtomicGet( &numportalcacheupdates ) );
+	botimport.Print( PRT_MESSAGE, "%d bytes routing cache\n", SDL_AtomicGet( &routingcachesize ) );
 } //end of the function AAS_RoutingInfo
 #endif //ROUTING_DEBUG
 //===========================================================================
@@ -392,7 +404,7 @@ float AAS_RoutingTime( void ) {
 // Changes Globals:		-
 //===========================================================================
 void AAS_FreeRoutingCache( aas_routingcache_t *cache ) {
-	routingcachesize -= cache->size;
+	SDL_AtomicAdd( &routingcachesize, -cache->size );
 	AAS_RoutingFreeMemory( cache );
 } //end of the function AAS_FreeRoutingCache
 //===========================================================================
@@ -446,6 +458,9 @@ void AAS_RemoveRoutingCacheUsingArea( int areanum ) {
 	int i, clusternum;
 	aas_routingcache_t *cache, *nextcache;
 
+	//the precomputed routing tables through the area are stale as well
+	AAS_RoutingTablesAreaChanged( areanum );
+
 #if !defined RTCW_ET
 	clusternum = ( *aasworld ).areasettings[areanum].cluster;
 #else
@@ -540,6 +555,10 @@ void AAS_ClearClusterTeamFlags( int areanum ) {
 	//
 	clusternum = aasworld->areasettings[areanum].cluster;
 	if ( clusternum > 0 ) {
+		// the precomputed portal routing tables assume there are no team flags
+		if ( aasworld->routingtables && aasworld->clusterTeamTravelFlags[clusternum] != -1 ) {
+			aasworld->routingtables->numteamclusters++;
+		}
 		aasworld->clusterTeamTravelFlags[clusternum] = -1;  // recalculate
 	}
 }
@@ -1044,156 +1063,225 @@ void AAS_InitPortalMaxTravelTimes( void ) {
 
 	} //end for
 } //end of the function AAS_InitPortalMaxTravelTimes
-/*
 //===========================================================================
+// routing cache lists
+//
+// The routing cache lists are read without locking. A routing cache is
+// completely updated before it's added to the front of a list and only its
+// atomic last use changes afterwards, adding a cache takes the lock of the
+// cluster and publishes the new list head with a memory barrier.
+// Routing caches are only removed when there are no route queries running,
+// at the start of a frame or when areas are enabled or disabled.
 //
 // Parameter:			-
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-void AAS_UnlinkCache(aas_routingcache_t *cache)
-{
-	if (cache->time_next) cache->time_next->time_prev = cache->time_prev;
-	else newestcache = cache->time_prev;
-	if (cache->time_prev) cache->time_prev->time_next = cache->time_next;
-	else oldestcache = cache->time_next;
-	cache->time_next = NULL;
-	cache->time_prev = NULL;
-} //end of the function AAS_UnlinkCache
+static aas_routingcache_t *AAS_FindRoutingCache( aas_routingcache_t **list, int travelflags ) {
+	aas_routingcache_t *cache;
+
+	for ( cache = (aas_routingcache_t *) SDL_AtomicGetPtr( (void **) list ); cache; cache = cache->next )
+	{
+		if ( cache->travelflags == travelflags ) {
+			break;
+		}
+	} //end for
+	return cache;
+} //end of the function AAS_FindRoutingCache
 //===========================================================================
+// adds the cache to the list unless another thread added a cache with the
+// same travel flags in the meantime
 //
 // Parameter:			-
-// Returns:				-
+// Returns:				the cache in the list
 // Changes Globals:		-
 //===========================================================================
-void AAS_LinkCache(aas_routingcache_t *cache)
-{
-	if (newestcache)
+static aas_routingcache_t *AAS_LinkRoutingCache( aas_routingcache_t **list, aas_routingcache_t *cache, SDL_SpinLock *lock ) {
+	aas_routingcache_t *listcache;
+
+	SDL_AtomicLock( lock );
+	for ( listcache = *list; listcache; listcache = listcache->next )
 	{
-		newestcache->time_next = cache;
-		cache->time_prev = cache;
+		if ( listcache->travelflags == cache->travelflags ) {
+			break;
+		}
+	} //end for
+	if ( !listcache ) {
+		cache->prev = NULL;
+		cache->next = *list;
+		if ( *list ) {
+			( *list )->prev = cache;
+		}
+		SDL_AtomicSetPtr( (void **) list, cache );
 	} //end if
-	else
-	{
-		oldestcache = cache;
-		cache->time_prev = NULL;
-	} //end else
-	cache->time_next = NULL;
-	newestcache = cache;
-} //end of the function AAS_LinkCache*/
+	SDL_AtomicUnlock( lock );
+	if ( listcache ) {
+		AAS_FreeRoutingCache( cache );
+		return listcache;
+	} //end if
+	return cache;
+} //end of the function AAS_LinkRoutingCache
 //===========================================================================
+// stores the routing time as the last use of the cache, concurrent queries
+// store the bits of the same time so the last use is never torn
 //
 // Parameter:			-
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-int AAS_FreeOldestCache( void ) {
-	int i, j, bestcluster, bestarea, freed;
-	float besttime;
-	aas_routingcache_t *cache, *bestcache;
+static void AAS_TouchRoutingCache( aas_routingcache_t *cache ) {
+	union
+	{
+		float time;
+		int bits;
+	} lastused;
 
-	freed = qfalse;
-	besttime = static_cast<float>(999999999);
-	bestcache = NULL;
-	bestcluster = 0;
-	bestarea = 0;
-	//refresh cluster cache
+	lastused.time = AAS_RoutingTime();
+	if ( SDL_AtomicGet( &cache->lastused ) != lastused.bits ) {
+		SDL_AtomicSet( &cache->lastused, lastused.bits );
+	}
+} //end of the function AAS_TouchRoutingCache
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				routing update fields not used by any other thread
+// Changes Globals:		-
+//===========================================================================
+static aas_routingscratch_t *AAS_GetRoutingScratch( void ) {
+	aas_routingscratch_t *scratch;
+	char *ptr;
 
-#if !defined RTCW_ET
-	for ( i = 0; i < ( *aasworld ).numclusters; i++ )
+	SDL_AtomicLock( &routingmemorylock );
+	scratch = aasworld->routingscratch;
+	if ( scratch ) {
+		aasworld->routingscratch = scratch->next;
+	}
+	SDL_AtomicUnlock( &routingmemorylock );
+	if ( scratch ) {
+		return scratch;
+	}
+	//the routing update fields start cleared and are left cleared by the updates
+	ptr = (char *) AAS_RoutingGetMemory( sizeof( aas_routingscratch_t ) +
+										 aasworld->numareas * sizeof( aas_routingupdate_t ) +
+										 ( aasworld->numportals + 1 ) * sizeof( aas_routingupdate_t ) );
+	scratch = (aas_routingscratch_t *) ptr;
+	ptr += sizeof( aas_routingscratch_t );
+	scratch->areaupdate = (aas_routingupdate_t *) ptr;
+	ptr += aasworld->numareas * sizeof( aas_routingupdate_t );
+	scratch->portalupdate = (aas_routingupdate_t *) ptr;
+	return scratch;
+} //end of the function AAS_GetRoutingScratch
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_ReleaseRoutingScratch( aas_routingscratch_t *scratch ) {
+	SDL_AtomicLock( &routingmemorylock );
+	scratch->next = aasworld->routingscratch;
+	aasworld->routingscratch = scratch;
+	SDL_AtomicUnlock( &routingmemorylock );
+} //end of the function AAS_ReleaseRoutingScratch
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_FreeRoutingScratch( void ) {
+	aas_routingscratch_t *scratch;
+
+	while ( aasworld->routingscratch )
 	{
-		for ( j = 0; j < ( *aasworld ).clusters[i].numareas; j++ )
-		{
-			for ( cache = ( *aasworld ).clusterareacache[i][j]; cache; cache = cache->next )
-			{
-				//never remove cache leading towards a portal
-				if ( ( *aasworld ).areasettings[cache->areanum].cluster < 0 ) {
-#else
+		scratch = aasworld->routingscratch;
+		aasworld->routingscratch = scratch->next;
+		if ( scratch->routesearch ) {
+			AAS_RoutingFreeMemory( scratch->routesearch );
+		}
+		AAS_RoutingFreeMemory( scratch );
+	} //end while
+} //end of the function AAS_FreeRoutingScratch
+
+typedef struct aas_cacheref_s
+{
+	int lastused;                               //bits of the last time the cache was used
+	aas_routingcache_t **list;                  //list the cache is in
+	aas_routingcache_t *cache;
+} aas_cacheref_t;
+
+//the routing time is never negative, so its bits sort in the same order
+static bool AAS_CacheRefOlder( const aas_cacheref_t &a, const aas_cacheref_t &b ) {
+	return a.lastused < b.lastused;
+}
+//===========================================================================
+// frees the least recently used routing caches until there's a quarter of
+// the maximum routing cache size left, one pass over all caches instead of
+// a search for the oldest cache per removed cache
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_FreeOldestCaches( void ) {
+	int i, j, freesize;
+	aas_routingcache_t *cache, **list;
+	rtcw::VectorTrivial<aas_cacheref_t> refs;
+	aas_cacheref_t ref;
+
+	if ( SDL_AtomicGet( &routingcachesize ) <= max_routingcachesize ) {
+		return;
+	}
+	if ( !aasworld->clusterareacache || !aasworld->portalcache ) {
+		return;
+	}
+
 	for ( i = 0; i < aasworld->numclusters; i++ )
 	{
 		for ( j = 0; j < aasworld->clusters[i].numareas; j++ )
 		{
-			for ( cache = aasworld->clusterareacache[i][j]; cache; cache = cache->next )
+			list = &aasworld->clusterareacache[i][j];
+			for ( cache = *list; cache; cache = cache->next )
 			{
 				//never remove cache leading towards a portal
 				if ( aasworld->areasettings[cache->areanum].cluster < 0 ) {
-#endif // RTCW_XX
-
 					continue;
 				}
-				//if this cache is older than the cache we found so far
-				if ( cache->time < besttime ) {
-					bestcache = cache;
-					bestcluster = i;
-					bestarea = j;
-					besttime = cache->time;
-				} //end if
+				ref.lastused = SDL_AtomicGet( &cache->lastused );
+				ref.list = list;
+				ref.cache = cache;
+				refs.insert_range( refs.get_size(), &ref, 1 );
 			} //end for
 		} //end for
 	} //end for
-	if ( bestcache ) {
-		cache = bestcache;
-		if ( cache->prev ) {
-			cache->prev->next = cache->next;
-
-#if !defined RTCW_ET
-		} else { ( *aasworld ).clusterareacache[bestcluster][bestarea] = cache->next;}
-#else
-		} else { aasworld->clusterareacache[bestcluster][bestarea] = cache->next;}
-#endif // RTCW_XX
-
-		if ( cache->next ) {
-			cache->next->prev = cache->prev;
-		}
-		AAS_FreeRoutingCache( cache );
-		freed = qtrue;
-	} //end if
-	besttime = static_cast<float>(999999999);
-	bestcache = NULL;
-	bestarea = 0;
-
-#if !defined RTCW_ET
-	for ( i = 0; i < ( *aasworld ).numareas; i++ )
-#else
 	for ( i = 0; i < aasworld->numareas; i++ )
-#endif // RTCW_XX
-
 	{
-		//refresh portal cache
-
-#if !defined RTCW_ET
-		for ( cache = ( *aasworld ).portalcache[i]; cache; cache = cache->next )
-#else
-		for ( cache = aasworld->portalcache[i]; cache; cache = cache->next )
-#endif // RTCW_XX
-
+		list = &aasworld->portalcache[i];
+		for ( cache = *list; cache; cache = cache->next )
 		{
-			if ( cache->time < besttime ) {
-				bestcache = cache;
-				bestarea = i;
-				besttime = cache->time;
-			} //end if
+			ref.lastused = SDL_AtomicGet( &cache->lastused );
+			ref.list = list;
+			ref.cache = cache;
+			refs.insert_range( refs.get_size(), &ref, 1 );
 		} //end for
 	} //end for
-	if ( bestcache ) {
-		cache = bestcache;
-		if ( cache->prev ) {
-			cache->prev->next = cache->next;
 
-#if !defined RTCW_ET
-		} else { ( *aasworld ).portalcache[bestarea] = cache->next;}
-#else
-		} else { aasworld->portalcache[bestarea] = cache->next;}
-#endif // RTCW_XX
+	std::stable_sort( refs.get_data(), refs.get_data() + refs.get_size(), AAS_CacheRefOlder );
 
+	freesize = SDL_AtomicGet( &routingcachesize ) - ( max_routingcachesize - max_routingcachesize / 4 );
+	for ( i = 0; i < refs.get_size() && freesize > 0; i++ )
+	{
+		cache = refs[i].cache;
+		if ( cache->prev ) {
+			cache->prev->next = cache->next;
+		} else { *refs[i].list = cache->next;}
 		if ( cache->next ) {
 			cache->next->prev = cache->prev;
 		}
+		freesize -= cache->size;
 		AAS_FreeRoutingCache( cache );
-		freed = qtrue;
-	} //end if
-	return freed;
-} //end of the function AAS_FreeOldestCache
+	} //end for
+} //end of the function AAS_FreeOldestCaches
 //===========================================================================
 //
 // Parameter:			-
@@ -1210,7 +1298,7 @@ aas_routingcache_t *AAS_AllocRoutingCache( int numtraveltimes ) {
 		   + numtraveltimes * sizeof( unsigned short int )
 		   + numtraveltimes * sizeof( unsigned char );
 	//
-	routingcachesize += size;
+	SDL_AtomicAdd( &routingcachesize, size );
 	//
 	cache = (aas_routingcache_t *) AAS_RoutingGetMemory( size );
 
@@ -1224,7 +1312,7 @@ aas_routingcache_t *AAS_AllocRoutingCache( int numtraveltimes ) {
 #else
 	size = sizeof( aas_routingcache_t ) + numtraveltimes * sizeof( unsigned short int ) + numtraveltimes * sizeof( unsigned char );
 
-	routingcachesize += size;
+	SDL_AtomicAdd( &routingcachesize, size );
 
 	cache = (aas_routingcache_t *) AAS_RoutingGetMemory( size );
 	cache->reachabilities = (unsigned char *) cache + sizeof( aas_routingcache_t ) + numtraveltimes * sizeof( unsigned short int );
@@ -1290,6 +1378,8 @@ void AAS_FreeAllClusterAreaCache( void ) {
 	aasworld->clusterareacache = NULL;
 #endif // RTCW_XX
 
+	AAS_RoutingFreeMemory( aasworld->areacachelocks );
+	aasworld->areacachelocks = NULL;
 } //end of the function AAS_FreeAllClusterAreaCache
 //===========================================================================
 //
@@ -1338,6 +1428,7 @@ void AAS_InitClusterAreaCache( void ) {
 #endif // RTCW_XX
 
 	} //end for
+	aasworld->areacachelocks = (SDL_SpinLock *) AAS_RoutingGetMemory( aasworld->numclusters * sizeof( SDL_SpinLock ) );
 } //end of the function AAS_InitClusterAreaCache
 //===========================================================================
 //
@@ -1385,6 +1476,8 @@ void AAS_FreeAllPortalCache( void ) {
 	aasworld->portalcache = NULL;
 #endif // RTCW_XX
 
+	AAS_RoutingFreeMemory( aasworld->portalcachelocks );
+	aasworld->portalcachelocks = NULL;
 } //end of the function AAS_FreeAllPortalCache
 //===========================================================================
 //
@@ -1403,6 +1496,7 @@ void AAS_InitPortalCache( void ) {
 		aasworld->numareas * sizeof( aas_routingcache_t * ) );
 #endif // RTCW_XX
 
+	aasworld->portalcachelocks = (SDL_SpinLock *) AAS_RoutingGetMemory( aasworld->numclusters * sizeof( SDL_SpinLock ) );
 } //end of the function AAS_InitPortalCache
 //
 //===========================================================================
@@ -1559,8 +1653,9 @@ void AAS_CreateAllRoutingCache( void ) {
 			t = AAS_AreaTravelTimeToGoalArea( j, ( *aasworld ).areawaypoints[j], i, tfl );
 
 #if defined RTCW_SP
-			( *aasworld ).frameroutingupdates = 0;
+			SDL_AtomicSet( &( *aasworld ).frameroutingupdates, 0 );
 #endif // RTCW_XX
+			AAS_FreeOldestCaches();
 #else
 	for ( i = 1; i < aasworld->numareas; i++ )
 	{
@@ -1595,7 +1690,8 @@ void AAS_CreateAllRoutingCache( void ) {
 				continue;
 			}
 			t = AAS_AreaTravelTimeToGoalArea( j, aasworld->areawaypoints[j], i, tfl );
-			aasworld->frameroutingupdates = 0;
+			SDL_AtomicSet( &aasworld->frameroutingupdates, 0 );
+			AAS_FreeOldestCaches();
 #endif // RTCW_XX
 
 			//if (t) break;
@@ -2288,13 +2384,15 @@ void AAS_InitRouting( void ) {
 	AAS_CalculateAreaTravelTimes();
 	//calculate the maximum travel times through portals
 	AAS_InitPortalMaxTravelTimes();
+	//index the reversed links and scale the estimates of the goal directed routes
+	AAS_InitGoalDirectedRouting();
 	//
 #ifdef ROUTING_DEBUG
-	numareacacheupdates = 0;
-	numportalcacheupdates = 0;
+	SDL_AtomicSet( &numareacacheupdates, 0 );
+	SDL_AtomicSet( &numportalcacheupdates, 0 );
 #endif //ROUTING_DEBUG
 	   //
-	routingcachesize = 0;
+	SDL_AtomicSet( &routingcachesize, 0 );
 
 #if !defined RTCW_ET
 	max_routingcachesize = 1024 * (int) LibVarValue( "max_routingcache", "4096" );
@@ -2332,6 +2430,8 @@ void AAS_InitRouting( void ) {
 	}
 #endif // RTCW_XX
 
+	// load the precomputed routing tables
+	AAS_InitRoutingTables();
 } //end of the function AAS_InitRouting
 //===========================================================================
 //
@@ -2340,10 +2440,14 @@ void AAS_InitRouting( void ) {
 // Changes Globals:		-
 //===========================================================================
 void AAS_FreeRoutingCaches( void ) {
+	// free the precomputed routing tables
+	AAS_FreeRoutingTables();
 	// free all the existing cluster area cache
 	AAS_FreeAllClusterAreaCache();
 	// free all the existing portal cache
 	AAS_FreeAllPortalCache();
+	// free the routing update fields of the routing cache updates
+	AAS_FreeRoutingScratch();
 	// free all the existing area visibility data
 	AAS_FreeAreaVisibility();
 	// free cached travel times within areas
@@ -2363,6 +2467,10 @@ void AAS_FreeRoutingCaches( void ) {
 		AAS_RoutingFreeMemory( ( *aasworld ).reversedreachability );
 	}
 	( *aasworld ).reversedreachability = NULL;
+	if ( ( *aasworld ).reversedlinkindex ) {
+		AAS_RoutingFreeMemory( ( *aasworld ).reversedlinkindex );
+	}
+	( *aasworld ).reversedlinkindex = NULL;
 	// free routing algorithm memory
 	if ( ( *aasworld ).areaupdate ) {
 		AAS_RoutingFreeMemory( ( *aasworld ).areaupdate );
@@ -2392,6 +2500,10 @@ void AAS_FreeRoutingCaches( void ) {
 		AAS_RoutingFreeMemory( aasworld->reversedreachability );
 	}
 	aasworld->reversedreachability = NULL;
+	if ( aasworld->reversedlinkindex ) {
+		AAS_RoutingFreeMemory( aasworld->reversedlinkindex );
+	}
+	aasworld->reversedlinkindex = NULL;
 	// free routing algorithm memory
 	if ( aasworld->areaupdate ) {
 		AAS_RoutingFreeMemory( aasworld->areaupdate );
@@ -2461,15 +2573,113 @@ int AAS_AreaContentsTravelFlag( int areanum ) {
 	}
 	return tfl;
 } //end of the function AAS_AreaContentsTravelFlag
+//travel times and reachabilities towards a goal, from a routing cache or a routing table
+typedef struct aas_routeview_s
+{
+	const unsigned short int *traveltimes;
+	const unsigned char *reachabilities;
+} aas_routeview_t;
 //===========================================================================
-// update the given routing cache
 //
-// Parameter:			areacache		: routing cache to update
-// Returns:				-
+// Parameter:			-
+// Returns:				index of the routing table for the travel flags or -1
 // Changes Globals:		-
 //===========================================================================
-void AAS_UpdateAreaRoutingCache( aas_routingcache_t *areacache ) {
-	int i, nextareanum, cluster, badtravelflags, clusterareanum, linknum;
+static int AAS_RoutingTableNum( const aas_routingtables_t *tables, int travelflags ) {
+	int i;
+
+	for ( i = 0; i < tables->numtables; i++ )
+	{
+		if ( tables->travelflags[i] == travelflags ) {
+			return i;
+		}
+	} //end for
+	return -1;
+} //end of the function AAS_RoutingTableNum
+//===========================================================================
+// area routing table of a goal area within a cluster
+//
+// Parameter:			-
+// Returns:				qfalse if there is no valid table
+// Changes Globals:		-
+//===========================================================================
+static qboolean AAS_RoutingTableAreaView( const aas_routingtables_t *tables, int clusternum, int areanum, int travelflags, aas_routeview_t *view ) {
+	int tablenum, clusterareanum, numreachabilityareas;
+	const unsigned char *table;
+
+	if ( clusternum <= 0 || tables->clusterchanges[clusternum] ) {
+		return qfalse;
+	}
+
+#if defined RTCW_ET
+	travelflags &= ~TFL_TEAM_FLAGS | aasworld->clusterTeamTravelFlags[clusternum];
+#endif // RTCW_XX
+
+	tablenum = AAS_RoutingTableNum( tables, travelflags );
+	if ( tablenum < 0 ) {
+		return qfalse;
+	}
+
+	numreachabilityareas = aasworld->clusters[clusternum].numreachabilityareas;
+	clusterareanum = AAS_ClusterAreaNum( clusternum, areanum );
+	//there is no route towards areas without reachabilities
+	if ( clusterareanum >= numreachabilityareas ) {
+		view->traveltimes = tables->emptytraveltimes;
+		view->reachabilities = tables->emptyreachabilities;
+		return qtrue;
+	}
+
+	table = tables->data + tablenum * tables->tablesize + tables->clusteroffsets[clusternum];
+	view->traveltimes = (const unsigned short int *) table + clusterareanum * numreachabilityareas;
+	view->reachabilities = table + numreachabilityareas * numreachabilityareas * sizeof( unsigned short int ) +
+						   clusterareanum * numreachabilityareas;
+	return qtrue;
+} //end of the function AAS_RoutingTableAreaView
+//===========================================================================
+// portal routing table of a goal area
+//
+// Parameter:			-
+// Returns:				qfalse if there is no valid table
+// Changes Globals:		-
+//===========================================================================
+static qboolean AAS_RoutingTablePortalView( const aas_routingtables_t *tables, int areanum, int travelflags, aas_routeview_t *view ) {
+	int tablenum;
+	const unsigned char *table;
+
+	//any changed area may be on the route through the portals
+	if ( tables->numchanges || !aasworld->areasettings[areanum].cluster ) {
+		return qfalse;
+	}
+
+#if defined RTCW_ET
+	if ( tables->numteamclusters ) {
+		return qfalse;
+	}
+	travelflags &= ~TFL_TEAM_FLAGS;
+#endif // RTCW_XX
+
+	tablenum = AAS_RoutingTableNum( tables, travelflags );
+	if ( tablenum < 0 ) {
+		return qfalse;
+	}
+
+	table = tables->data + tablenum * tables->tablesize + tables->portaloffset;
+	view->traveltimes = (const unsigned short int *) table + areanum * aasworld->numportals;
+	view->reachabilities = table + aasworld->numareas * aasworld->numportals * sizeof( unsigned short int ) +
+						   areanum * aasworld->numportals;
+	return qtrue;
+} //end of the function AAS_RoutingTablePortalView
+//===========================================================================
+// fills the travel times and reachabilities towards the given area of a
+// cluster, only touches the given routing update fields and the output
+//
+// Parameter:			-
+// Returns:				number of routing updates
+// Changes Globals:		-
+//===========================================================================
+static int AAS_UpdateAreaRoutingTable( int clusternum, int areanum, int travelflags, float starttraveltime,
+									   unsigned short int *traveltimes, unsigned char *reachabilities, aas_routingupdate_t *areaupdate ) {
+	int numupdates, i, nextareanum, cluster, badtravelflags, clusterareanum, linknum;
 	int numreachabilityareas;
 	unsigned short int t, startareatraveltimes[128];
 	aas_routingupdate_t *updateliststart, *updatelistend, *curupdate, *nextupdate;
@@ -2477,15 +2687,13 @@ void AAS_UpdateAreaRoutingCache( aas_routingcache_t *areacache ) {
 	aas_reversedreachability_t *revreach;
 	aas_reversedlink_t *revlink;
 
-#ifdef ROUTING_DEBUG
-	numareacacheupdates++;
-#endif //ROUTING_DEBUG
-	   //number of reachability areas within this cluster
+	numupdates = 0;
+	//number of reachability areas within this cluster
 
 #if !defined RTCW_ET
-	numreachabilityareas = ( *aasworld ).clusters[areacache->cluster].numreachabilityareas;
+	numreachabilityareas = ( *aasworld ).clusters[clusternum].numreachabilityareas;
 #else
-	numreachabilityareas = aasworld->clusters[areacache->cluster].numreachabilityareas;
+	numreachabilityareas = aasworld->clusters[clusternum].numreachabilityareas;
 #endif // RTCW_XX
 
 	//
@@ -2498,34 +2706,34 @@ void AAS_UpdateAreaRoutingCache( aas_routingcache_t *areacache ) {
 #endif // RTCW_XX
 
 	//
-	badtravelflags = ~areacache->travelflags;
+	badtravelflags = ~travelflags;
 	//
-	clusterareanum = AAS_ClusterAreaNum( areacache->cluster, areacache->areanum );
+	clusterareanum = AAS_ClusterAreaNum( clusternum, areanum );
 	if ( clusterareanum >= numreachabilityareas ) {
-		return;
+		return numupdates;
 	}
 	//
 	memset( startareatraveltimes, 0, sizeof( startareatraveltimes ) );
 	//
 
 #if !defined RTCW_ET
-	curupdate = &( *aasworld ).areaupdate[clusterareanum];
+	curupdate = &areaupdate[clusterareanum];
 #else
-	curupdate = &aasworld->areaupdate[clusterareanum];
+	curupdate = &areaupdate[clusterareanum];
 #endif // RTCW_XX
 
-	curupdate->areanum = areacache->areanum;
+	curupdate->areanum = areanum;
 	//VectorCopy(areacache->origin, curupdate->start);
 
 #if !defined RTCW_ET
-	curupdate->areatraveltimes = ( *aasworld ).areatraveltimes[areacache->areanum][0];
+	curupdate->areatraveltimes = ( *aasworld ).areatraveltimes[areanum][0];
 #else
-	curupdate->areatraveltimes = aasworld->areatraveltimes[areacache->areanum][0];
+	curupdate->areatraveltimes = aasworld->areatraveltimes[areanum][0];
 #endif // RTCW_XX
 
-	curupdate->tmptraveltime = areacache->starttraveltime;
+	curupdate->tmptraveltime = starttraveltime;
 	//
-	areacache->traveltimes[clusterareanum] = areacache->starttraveltime;
+	traveltimes[clusterareanum] = starttraveltime;
 	//put the area to start with in the current read list
 	curupdate->next = NULL;
 	curupdate->prev = NULL;
@@ -2596,11 +2804,11 @@ void AAS_UpdateAreaRoutingCache( aas_routingcache_t *areacache ) {
 #endif // RTCW_XX
 
 			//don't leave the cluster
-			if ( cluster > 0 && cluster != areacache->cluster ) {
+			if ( cluster > 0 && cluster != clusternum ) {
 				continue;
 			}
 			//get the number of the area in the cluster
-			clusterareanum = AAS_ClusterAreaNum( areacache->cluster, nextareanum );
+			clusterareanum = AAS_ClusterAreaNum( clusternum, nextareanum );
 			if ( clusterareanum >= numreachabilityareas ) {
 				continue;
 			}
@@ -2613,31 +2821,31 @@ void AAS_UpdateAreaRoutingCache( aas_routingcache_t *areacache ) {
 
 #if !defined RTCW_ET
 			//
-			( *aasworld ).frameroutingupdates++;
+			numupdates++;
 			//
-			if ( !areacache->traveltimes[clusterareanum] ||
-				 areacache->traveltimes[clusterareanum] > t ) {
-				areacache->traveltimes[clusterareanum] = t;
-				areacache->reachabilities[clusterareanum] = linknum - ( *aasworld ).areasettings[nextareanum].firstreachablearea;
-				nextupdate = &( *aasworld ).areaupdate[clusterareanum];
+			if ( !traveltimes[clusterareanum] ||
+				 traveltimes[clusterareanum] > t ) {
+				traveltimes[clusterareanum] = t;
+				reachabilities[clusterareanum] = linknum - ( *aasworld ).areasettings[nextareanum].firstreachablearea;
+				nextupdate = &areaupdate[clusterareanum];
 #else
 			//if trying to avoid this area
 			if ( aasworld->areasettings[reach->areanum].areaflags & AREA_AVOID ) {
 				t += 1000;
-			} else if ( ( aasworld->areasettings[reach->areanum].areaflags & AREA_AVOID_AXIS ) && ( areacache->travelflags & TFL_TEAM_AXIS ) ) {
+			} else if ( ( aasworld->areasettings[reach->areanum].areaflags & AREA_AVOID_AXIS ) && ( travelflags & TFL_TEAM_AXIS ) ) {
 				t += 200; // + (curupdate->areatraveltimes[i] + reach->traveltime) * 30;
-			} else if ( ( aasworld->areasettings[reach->areanum].areaflags & AREA_AVOID_ALLIES ) && ( areacache->travelflags & TFL_TEAM_ALLIES ) ) {
+			} else if ( ( aasworld->areasettings[reach->areanum].areaflags & AREA_AVOID_ALLIES ) && ( travelflags & TFL_TEAM_ALLIES ) ) {
 				t += 200; // + (curupdate->areatraveltimes[i] + reach->traveltime) * 30;
 			}
 			//
-			aasworld->frameroutingupdates++;
+			numupdates++;
 			//
 			if ( aasworld->areatraveltimes[nextareanum] &&
-				 ( !areacache->traveltimes[clusterareanum] ||
-				   areacache->traveltimes[clusterareanum] > t ) ) {
-				areacache->traveltimes[clusterareanum] = t;
-				areacache->reachabilities[clusterareanum] = linknum - aasworld->areasettings[nextareanum].firstreachablearea;
-				nextupdate = &aasworld->areaupdate[clusterareanum];
+				 ( !traveltimes[clusterareanum] ||
+				   traveltimes[clusterareanum] > t ) ) {
+				traveltimes[clusterareanum] = t;
+				reachabilities[clusterareanum] = linknum - aasworld->areasettings[nextareanum].firstreachablearea;
+				nextupdate = &areaupdate[clusterareanum];
 #endif // RTCW_XX
 
 				nextupdate->areanum = nextareanum;
@@ -2664,6 +2872,30 @@ void AAS_UpdateAreaRoutingCache( aas_routingcache_t *areacache ) {
 			} //end if
 		} //end for
 	} //end while
+	return numupdates;
+} //end of the function AAS_UpdateAreaRoutingTable
+//===========================================================================
+// update the given routing cache
+//
+// Parameter:			areacache		: routing cache to update
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_UpdateAreaRoutingCache( aas_routingcache_t *areacache ) {
+	int numupdates;
+	aas_routingscratch_t *scratch;
+
+#ifdef ROUTING_DEBUG
+	SDL_AtomicIncRef( &numareacacheupdates );
+#endif //ROUTING_DEBUG
+
+	scratch = AAS_GetRoutingScratch();
+	numupdates = AAS_UpdateAreaRoutingTable( areacache->cluster, areacache->areanum,
+		areacache->travelflags, areacache->starttraveltime, areacache->traveltimes, areacache->reachabilities,
+		scratch->areaupdate );
+	AAS_ReleaseRoutingScratch( scratch );
+
+	SDL_AtomicAdd( &aasworld->frameroutingupdates, numupdates );
 } //end of the function AAS_UpdateAreaRoutingCache
 //===========================================================================
 //
@@ -2673,35 +2905,29 @@ void AAS_UpdateAreaRoutingCache( aas_routingcache_t *areacache ) {
 //===========================================================================
 aas_routingcache_t *AAS_GetAreaRoutingCache( int clusternum, int areanum, int travelflags, qboolean forceUpdate ) {
 	int clusterareanum;
-	aas_routingcache_t *cache, *clustercache;
+	aas_routingcache_t *cache, **clustercache;
 
 	//number of the area in the cluster
 	clusterareanum = AAS_ClusterAreaNum( clusternum, areanum );
 	//pointer to the cache for the area in the cluster
 
 #if !defined RTCW_ET
-	clustercache = ( *aasworld ).clusterareacache[clusternum][clusterareanum];
+	clustercache = &( *aasworld ).clusterareacache[clusternum][clusterareanum];
 #else
-	clustercache = aasworld->clusterareacache[clusternum][clusterareanum];
+	clustercache = &aasworld->clusterareacache[clusternum][clusterareanum];
 
 	// RF, remove team-specific flags which don't exist in this cluster
 	travelflags &= ~TFL_TEAM_FLAGS | aasworld->clusterTeamTravelFlags[clusternum];
 #endif // RTCW_XX
 
 	//find the cache without undesired travel flags
-	for ( cache = clustercache; cache; cache = cache->next )
-	{
-		//if there aren't used any undesired travel types for the cache
-		if ( cache->travelflags == travelflags ) {
-			break;
-		}
-	} //end for
+	cache = AAS_FindRoutingCache( clustercache, travelflags );
 
 #if !defined RTCW_ET
 	  //if there was no cache
 	if ( !cache ) {
 		//NOTE: the number of routing updates is limited per frame
-		if ( !forceUpdate && ( ( *aasworld ).frameroutingupdates > MAX_FRAMEROUTINGUPDATES ) ) {
+		if ( !forceUpdate && ( SDL_AtomicGet( &( *aasworld ).frameroutingupdates ) > MAX_FRAMEROUTINGUPDATES ) ) {
 			return NULL;
 		} //end if
 
@@ -2713,7 +2939,7 @@ aas_routingcache_t *AAS_GetAreaRoutingCache( int clusternum, int areanum, int tr
 	//if there was no cache
 	if ( !cache ) {
 		//NOTE: the number of routing updates is limited per frame
-		if ( !forceUpdate && ( aasworld->frameroutingupdates > max_frameroutingupdates ) ) {
+		if ( !forceUpdate && ( SDL_AtomicGet( &aasworld->frameroutingupdates ) > max_frameroutingupdates ) ) {
 			return NULL;
 		} //end if
 		cache = AAS_AllocRoutingCache( aasworld->clusters[clusternum].numreachabilityareas );
@@ -2724,68 +2950,76 @@ aas_routingcache_t *AAS_GetAreaRoutingCache( int clusternum, int areanum, int tr
 
 		cache->starttraveltime = 1;
 		cache->travelflags = travelflags;
-		cache->prev = NULL;
-		cache->next = clustercache;
-		if ( clustercache ) {
-			clustercache->prev = cache;
-		}
-
-#if !defined RTCW_ET
-		( *aasworld ).clusterareacache[clusternum][clusterareanum] = cache;
-#else
-		aasworld->clusterareacache[clusternum][clusterareanum] = cache;
-#endif // RTCW_XX
-
 		AAS_UpdateAreaRoutingCache( cache );
+		//another thread may have added the same cache meanwhile
+		cache = AAS_LinkRoutingCache( clustercache, cache, &aasworld->areacachelocks[clusternum] );
 	} //end if
 	  //the cache has been accessed
-	cache->time = AAS_RoutingTime();
+	AAS_TouchRoutingCache( cache );
 	return cache;
 } //end of the function AAS_GetAreaRoutingCache
 //===========================================================================
+// routing towards a goal area within a cluster, from the precomputed
+// routing tables when possible
 //
 // Parameter:			-
-// Returns:				-
+// Returns:				qfalse if the routing cache can't be updated this frame
 // Changes Globals:		-
 //===========================================================================
-void AAS_UpdatePortalRoutingCache( aas_routingcache_t *portalcache ) {
+static qboolean AAS_AreaRoutingView( int clusternum, int areanum, int travelflags, qboolean forceUpdate, aas_routeview_t *view ) {
+	aas_routingcache_t *cache;
 
-#if !defined RTCW_ET
-	int i, portalnum, clusterareanum, clusternum;
-#else
-	int i, portalnum, clusterareanum; //, clusternum;
-#endif // RTCW_XX
+	if ( aasworld->routingtables &&
+		 AAS_RoutingTableAreaView( aasworld->routingtables, clusternum, areanum, travelflags, view ) ) {
+		return qtrue;
+	}
 
+	cache = AAS_GetAreaRoutingCache( clusternum, areanum, travelflags, forceUpdate );
+	if ( !cache ) {
+		return qfalse;
+	}
+	view->traveltimes = cache->traveltimes;
+	view->reachabilities = cache->reachabilities;
+	return qtrue;
+} //end of the function AAS_AreaRoutingView
+//===========================================================================
+// fills the travel times and reachabilities from every portal towards the
+// given goal area, the area routing comes from the given routing tables if any
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_UpdatePortalRoutingTable( int clusternum, int areanum, int travelflags, float starttraveltime,
+										  unsigned short int *traveltimes, unsigned char *reachabilities, aas_routingupdate_t *portalupdate,
+										  const aas_routingtables_t *tables ) {
+	int i, portalnum, clusterareanum;
 	unsigned short int t;
 	aas_portal_t *portal;
 	aas_cluster_t *cluster;
-	aas_routingcache_t *cache;
+	aas_routeview_t areaview;
 	aas_routingupdate_t *updateliststart, *updatelistend, *curupdate, *nextupdate;
 
-#ifdef ROUTING_DEBUG
-	numportalcacheupdates++;
-#endif //ROUTING_DEBUG
-	   //clear the routing update fields
+	//clear the routing update fields
 
 #if !defined RTCW_ET
 //	memset((*aasworld).portalupdate, 0, ((*aasworld).numportals+1) * sizeof(aas_routingupdate_t));
 	//
-	curupdate = &( *aasworld ).portalupdate[( *aasworld ).numportals];
+	curupdate = &portalupdate[( *aasworld ).numportals];
 #else
 //	memset(aasworld->portalupdate, 0, (aasworld->numportals+1) * sizeof(aas_routingupdate_t));
 	//
-	curupdate = &aasworld->portalupdate[aasworld->numportals];
+	curupdate = &portalupdate[aasworld->numportals];
 #endif // RTCW_XX
 
-	curupdate->cluster = portalcache->cluster;
-	curupdate->areanum = portalcache->areanum;
-	curupdate->tmptraveltime = portalcache->starttraveltime;
+	curupdate->cluster = clusternum;
+	curupdate->areanum = areanum;
+	curupdate->tmptraveltime = starttraveltime;
 
 #if !defined RTCW_ET
 	//if the start area is a cluster portal, store the travel time for that portal
-	clusternum = ( *aasworld ).areasettings[portalcache->areanum].cluster;
-	if ( clusternum < 0 ) {
-		portalcache->traveltimes[-clusternum] = portalcache->starttraveltime;
+	if ( ( *aasworld ).areasettings[areanum].cluster < 0 ) {
+		traveltimes[-( *aasworld ).areasettings[areanum].cluster] = starttraveltime;
 	} //end if
 	  //put the area to start with in the current read list
 #else
@@ -2816,8 +3050,11 @@ void AAS_UpdatePortalRoutingCache( aas_routingcache_t *portalcache ) {
 #endif // RTCW_XX
 
 		//
-		cache = AAS_GetAreaRoutingCache( curupdate->cluster,
-										 curupdate->areanum, portalcache->travelflags, qtrue );
+		if ( tables ) {
+			AAS_RoutingTableAreaView( tables, curupdate->cluster, curupdate->areanum, travelflags, &areaview );
+		} else {
+			AAS_AreaRoutingView( curupdate->cluster, curupdate->areanum, travelflags, qtrue, &areaview );
+		}
 		//take all portals of the cluster
 		for ( i = 0; i < cluster->numportals; i++ )
 		{
@@ -2840,23 +3077,17 @@ void AAS_UpdatePortalRoutingCache( aas_routingcache_t *portalcache ) {
 				continue;
 			}
 			//
-			t = cache->traveltimes[clusterareanum];
+			t = areaview.traveltimes[clusterareanum];
 			if ( !t ) {
 				continue;
 			}
 			t += curupdate->tmptraveltime;
 			//
-			if ( !portalcache->traveltimes[portalnum] ||
-				 portalcache->traveltimes[portalnum] > t ) {
-				portalcache->traveltimes[portalnum] = t;
-				portalcache->reachabilities[portalnum] = cache->reachabilities[clusterareanum];
-
-#if !defined RTCW_ET
-				nextupdate = &( *aasworld ).portalupdate[portalnum];
-#else
-				nextupdate = &aasworld->portalupdate[portalnum];
-#endif // RTCW_XX
-
+			if ( !traveltimes[portalnum] ||
+				 traveltimes[portalnum] > t ) {
+				traveltimes[portalnum] = t;
+				reachabilities[portalnum] = areaview.reachabilities[clusterareanum];
+				nextupdate = &portalupdate[portalnum];
 				if ( portal->frontcluster == curupdate->cluster ) {
 					nextupdate->cluster = portal->backcluster;
 				} //end if
@@ -2885,6 +3116,25 @@ void AAS_UpdatePortalRoutingCache( aas_routingcache_t *portalcache ) {
 			} //end if
 		} //end for
 	} //end while
+} //end of the function AAS_UpdatePortalRoutingTable
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_UpdatePortalRoutingCache( aas_routingcache_t *portalcache ) {
+	aas_routingscratch_t *scratch;
+
+#ifdef ROUTING_DEBUG
+	SDL_AtomicIncRef( &numportalcacheupdates );
+#endif //ROUTING_DEBUG
+
+	scratch = AAS_GetRoutingScratch();
+	AAS_UpdatePortalRoutingTable( portalcache->cluster, portalcache->areanum, portalcache->travelflags,
+								  portalcache->starttraveltime, portalcache->traveltimes, portalcache->reachabilities,
+								  scratch->portalupdate, NULL );
+	AAS_ReleaseRoutingScratch( scratch );
 } //end of the function AAS_UpdatePortalRoutingCache
 //===========================================================================
 //
@@ -2896,59 +3146,55 @@ aas_routingcache_t *AAS_GetPortalRoutingCache( int clusternum, int areanum, int
 	aas_routingcache_t *cache;
 
 	//find the cached portal routing if existing
+	cache = AAS_FindRoutingCache( &aasworld->portalcache[areanum], travelflags );
+	  //if the portal routing isn't cached
+	if ( !cache ) {
 
 #if !defined RTCW_ET
-	for ( cache = ( *aasworld ).portalcache[areanum]; cache; cache = cache->next )
-#else
-	for ( cache = aasworld->portalcache[areanum]; cache; cache = cache->next )
-#endif // RTCW_XX
-
-	{
-		if ( cache->travelflags == travelflags ) {
-			break;
-		}
-	} //end for
-	  //if the portal routing isn't cached
-	if ( !cache ) {
-
-#if !defined RTCW_ET
-		cache = AAS_AllocRoutingCache( ( *aasworld ).numportals );
-		cache->cluster = clusternum;
-		cache->areanum = areanum;
-		VectorCopy( ( *aasworld ).areas[areanum].center, cache->origin );
-		cache->starttraveltime = 1;
-		cache->travelflags = travelflags;
-		//add the cache to the cache list
-		cache->prev = NULL;
-		cache->next = ( *aasworld ).portalcache[areanum];
-		if ( ( *aasworld ).portalcache[areanum] ) {
-			( *aasworld ).portalcache[areanum]->prev = cache;
-		}
-		( *aasworld ).portalcache[areanum] = cache;
+		cache = AAS_AllocRoutingCache( ( *aasworld ).numportals );
+		cache->cluster = clusternum;
+		cache->areanum = areanum;
+		VectorCopy( ( *aasworld ).areas[areanum].center, cache->origin );
 #else
 		cache = AAS_AllocRoutingCache( aasworld->numportals );
 		cache->cluster = clusternum;
 		cache->areanum = areanum;
 		VectorCopy( aasworld->areas[areanum].center, cache->origin );
-		cache->starttraveltime = 1;
-		cache->travelflags = travelflags;
-		//add the cache to the cache list
-		cache->prev = NULL;
-		cache->next = aasworld->portalcache[areanum];
-		if ( aasworld->portalcache[areanum] ) {
-			aasworld->portalcache[areanum]->prev = cache;
-		}
-		aasworld->portalcache[areanum] = cache;
 #endif // RTCW_XX
 
+		cache->starttraveltime = 1;
+		cache->travelflags = travelflags;
 		//update the cache
 		AAS_UpdatePortalRoutingCache( cache );
+		//add the cache to the cache list, the portal caches of an area are
+		//always requested with the same cluster
+		cache = AAS_LinkRoutingCache( &aasworld->portalcache[areanum], cache, &aasworld->portalcachelocks[clusternum] );
 	} //end if
 	  //the cache has been accessed
-	cache->time = AAS_RoutingTime();
+	AAS_TouchRoutingCache( cache );
 	return cache;
 } //end of the function AAS_GetPortalRoutingCache
 //===========================================================================
+// routing from the portals towards a goal area, from the precomputed
+// routing tables when possible
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_PortalRoutingView( int clusternum, int areanum, int travelflags, aas_routeview_t *view ) {
+	aas_routingcache_t *cache;
+
+	if ( aasworld->routingtables &&
+		 AAS_RoutingTablePortalView( aasworld->routingtables, areanum, travelflags, view ) ) {
+		return;
+	}
+
+	cache = AAS_GetPortalRoutingCache( clusternum, areanum, travelflags );
+	view->traveltimes = cache->traveltimes;
+	view->reachabilities = cache->reachabilities;
+} //end of the function AAS_PortalRoutingView
+//===========================================================================
 //
 // Parameter:			-
 // Returns:				-
@@ -2959,7 +3205,7 @@ int AAS_AreaRouteToGoalArea( int areanum, vec3_t origin, int goalareanum, int tr
 	unsigned short int t, besttime;
 	aas_portal_t *portal;
 	aas_cluster_t *cluster;
-	aas_routingcache_t *areacache, *portalcache;
+	aas_routeview_t areaview, portalview;
 	aas_reachability_t *reach;
 	aas_portalindex_t *pPortalnum;
 
@@ -3003,12 +3249,8 @@ int AAS_AreaRouteToGoalArea( int areanum, vec3_t origin, int goalareanum, int tr
 		return qfalse;
 	} //end if
 
-	//make sure the routing cache doesn't grow to large
-	while ( routingcachesize > max_routingcachesize ) {
-		if ( !AAS_FreeOldestCache() ) {
-			break;
-		}
-	}
+	//NOTE: the routing cache size is kept in check by AAS_FreeOldestCaches
+	//      every frame, route queries may run concurrently
 	//
 	if ( AAS_AreaDoNotEnter( areanum ) || AAS_AreaDoNotEnter( goalareanum ) ) {
 		travelflags |= TFL_DONOTENTER;
@@ -3074,11 +3316,10 @@ int AAS_AreaRouteToGoalArea( int areanum, vec3_t origin, int goalareanum, int tr
 	if ( clusternum > 0 && goalclusternum > 0 && clusternum == goalclusternum ) {
 #endif // RTCW_XX
 
-		areacache = AAS_GetAreaRoutingCache( clusternum, goalareanum, travelflags, qfalse );
 		// RF, note that the routing cache might be NULL now since we are restricting
 		// the updates per frame, hopefully rejected cache's will be requested again
 		// when things have settled down
-		if ( !areacache ) {
+		if ( !AAS_AreaRoutingView( clusternum, goalareanum, travelflags, qfalse, &areaview ) ) {
 			return qfalse;
 		}
 		//the number of the area in the cluster
@@ -3096,7 +3337,7 @@ int AAS_AreaRouteToGoalArea( int areanum, vec3_t origin, int goalareanum, int tr
 			return qfalse;
 		}
 		//if it is possible to travel to the goal area through this cluster
-		if ( areacache->traveltimes[clusterareanum] != 0 ) {
+		if ( areaview.traveltimes[clusterareanum] != 0 ) {
 
 #if !defined RTCW_ET
 			*reachnum = ( *aasworld ).areasettings[areanum].firstreachablearea +
@@ -3104,10 +3345,10 @@ int AAS_AreaRouteToGoalArea( int areanum, vec3_t origin, int goalareanum, int tr
 			*reachnum = aasworld->areasettings[areanum].firstreachablearea +
 #endif // RTCW_XX
 
-						areacache->reachabilities[clusterareanum];
+						areaview.reachabilities[clusterareanum];
 			//
 			if ( !origin ) {
-				*traveltime = areacache->traveltimes[clusterareanum];
+				*traveltime = areaview.traveltimes[clusterareanum];
 				return qtrue;
 			}
 			//
@@ -3118,7 +3359,7 @@ int AAS_AreaRouteToGoalArea( int areanum, vec3_t origin, int goalareanum, int tr
 			reach = &aasworld->reachability[*reachnum];
 #endif // RTCW_XX
 
-			*traveltime = areacache->traveltimes[clusterareanum] +
+			*traveltime = areaview.traveltimes[clusterareanum] +
 						  AAS_AreaTravelTime( areanum, origin, reach->start );
 			return qtrue;
 		} //end if
@@ -3146,10 +3387,10 @@ int AAS_AreaRouteToGoalArea( int areanum, vec3_t origin, int goalareanum, int tr
 		goalclusternum = portal->frontcluster;
 	} //end if
 	  //get the portal routing cache
-	portalcache = AAS_GetPortalRoutingCache( goalclusternum, goalareanum, travelflags );
+	AAS_PortalRoutingView( goalclusternum, goalareanum, travelflags, &portalview );
 	//if the area is a cluster portal, read directly from the portal cache
 	if ( clusternum < 0 ) {
-		*traveltime = portalcache->traveltimes[-clusternum];
+		*traveltime = portalview.traveltimes[-clusternum];
 
 #if !defined RTCW_ET
 		*reachnum = ( *aasworld ).areasettings[areanum].firstreachablearea +
@@ -3157,7 +3398,7 @@ int AAS_AreaRouteToGoalArea( int areanum, vec3_t origin, int goalareanum, int tr
 		*reachnum = aasworld->areasettings[areanum].firstreachablearea +
 #endif // RTCW_XX
 
-					portalcache->reachabilities[-clusternum];
+					portalview.reachabilities[-clusternum];
 		return qtrue;
 	}
 	//
@@ -3190,7 +3431,7 @@ int AAS_AreaRouteToGoalArea( int areanum, vec3_t origin, int goalareanum, int tr
 	{
 		portalnum = *pPortalnum;
 		//if the goal area isn't reachable from the portal
-		if ( !portalcache->traveltimes[portalnum] ) {
+		if ( !portalview.traveltimes[portalnum] ) {
 			continue;
 		}
 		//
@@ -3212,18 +3453,17 @@ int AAS_AreaRouteToGoalArea( int areanum, vec3_t origin, int goalareanum, int tr
 			continue;
 		}
 		//get the cache of the portal area
-		areacache = AAS_GetAreaRoutingCache( clusternum, portal->areanum, travelflags, qfalse );
 		// RF, this may be NULL if we were unable to calculate the cache this frame
-		if ( !areacache ) {
+		if ( !AAS_AreaRoutingView( clusternum, portal->areanum, travelflags, qfalse, &areaview ) ) {
 			return qfalse;
 		}
 		//if the portal is NOT reachable from this area
-		if ( !areacache->traveltimes[clusterareanum] ) {
+		if ( !areaview.traveltimes[clusterareanum] ) {
 			continue;
 		}
 		//total travel time is the travel time the portal area is from
 		//the goal area plus the travel time towards the portal area
-		t = portalcache->traveltimes[portalnum] + areacache->traveltimes[clusterareanum];
+		t = portalview.traveltimes[portalnum] + areaview.traveltimes[clusterareanum];
 		//FIXME: add the exact travel time through the actual portal area
 		//NOTE: for now we just add the largest travel time through the area portal
 		//		because we can't directly calculate the exact travel time
@@ -3245,9 +3485,9 @@ int AAS_AreaRouteToGoalArea( int areanum, vec3_t origin, int goalareanum, int tr
 		*reachnum = aasworld->areasettings[areanum].firstreachablearea +
 #endif // RTCW_XX
 
-					areacache->reachabilities[clusterareanum];
+					areaview.reachabilities[clusterareanum];
 
-//botimport.Print(PRT_MESSAGE, "portal reachability: %i\n", (int)areacache->reachabilities[clusterareanum] );
+//botimport.Print(PRT_MESSAGE, "portal reachability: %i\n", (int)areaview.reachabilities[clusterareanum] );
 
 		if ( origin ) {
 
@@ -3331,6 +3571,1145 @@ int AAS_AreaReachabilityToGoalArea( int areanum, vec3_t origin, int goalareanum,
 	return 0;
 } //end of the function AAS_AreaReachabilityToGoalArea
 //===========================================================================
+// goal directed routes
+//
+// A goal directed route is an A* search over the reachabilities from the
+// start area towards the goal area. It answers a single query without
+// filling the routing cache of the goal area, which is mostly wasted on
+// goals that keep moving like enemies. The search state is the reachability
+// an area was entered through, so the travel times through the areas are
+// the ones the routing caches are filled with. The estimate of the
+// remaining travel time is the distance to the bounds of the goal area times
+// the lowest travel time per unit of distance of the allowed travel types.
+//===========================================================================
+
+//the goal area bounds are expanded for reachabilities ending on their edge
+#define ROUTE_GOALBOUNDSEPSILON     8
+//the node has not been put in the open heap yet
+#define ROUTENODE_NEW               -2
+//the node has been taken from the open heap
+#define ROUTENODE_CLOSED            -1
+//maximum number of reachabilities of a route checked by the route test
+#define ROUTETEST_MAXREACH          256
+//===========================================================================
+// indexes the reversed links and calculates the lowest travel time per unit
+// of distance of every travel type
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_InitGoalDirectedRouting( void ) {
+	int i, l, n, traveltype;
+	float dist, scale;
+	aas_areasettings_t *settings;
+	aas_reversedlink_t *revlink;
+	aas_reachability_t *reach, *inreach;
+
+	if ( aasworld->reversedlinkindex ) {
+		AAS_RoutingFreeMemory( aasworld->reversedlinkindex );
+	}
+	aasworld->reversedlinkindex = (int *) AAS_RoutingGetMemory( aasworld->reachabilitysize * sizeof( int ) );
+	for ( i = 0; i < aasworld->reachabilitysize; i++ )
+	{
+		aasworld->reversedlinkindex[i] = -1;
+	} //end for
+	  //a negative scale means there's no reachability of the travel type
+	for ( i = 0; i < MAX_TRAVELTYPES; i++ )
+	{
+		aasworld->routeestimatescale[i] = -1;
+	} //end for
+	  //
+	for ( i = 1; i < aasworld->numareas; i++ )
+	{
+		settings = &aasworld->areasettings[i];
+		//
+		for ( n = 0, revlink = aasworld->reversedreachability[i].first; revlink; revlink = revlink->next, n++ )
+		{
+			aasworld->reversedlinkindex[revlink->linknum] = n;
+			//
+			if ( !settings->numreachableareas || !aasworld->areatraveltimes[i] ) {
+				continue;
+			}
+			inreach = &aasworld->reachability[revlink->linknum];
+			//
+			for ( l = 0; l < settings->numreachableareas; l++ )
+			{
+				reach = &aasworld->reachability[settings->firstreachablearea + l];
+				traveltype = reach->traveltype;
+				if ( traveltype < 0 || traveltype >= MAX_TRAVELTYPES ) {
+					continue;
+				}
+				//the estimate is measured between the reachability end points
+				dist = VectorDistance( inreach->end, reach->end );
+				if ( dist <= 0 ) {
+					continue;
+				}
+				scale = (float) ( aasworld->areatraveltimes[i][l][n] + reach->traveltime ) / dist;
+				if ( aasworld->routeestimatescale[traveltype] < 0 || scale < aasworld->routeestimatescale[traveltype] ) {
+					aasworld->routeestimatescale[traveltype] = scale;
+				} //end if
+			} //end for
+		} //end for
+	} //end for
+} //end of the function AAS_InitGoalDirectedRouting
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				lowest travel time per unit of distance with the travel flags
+// Changes Globals:		-
+//===========================================================================
+static float AAS_RouteEstimateScale( int travelflags ) {
+	int i;
+	float scale;
+
+	scale = -1;
+	for ( i = 0; i < MAX_TRAVELTYPES; i++ )
+	{
+		if ( aasworld->routeestimatescale[i] < 0 ) {
+			continue;
+		}
+		if ( aasworld->travelflagfortype[i] & ~travelflags ) {
+			continue;
+		}
+		if ( scale < 0 || aasworld->routeestimatescale[i] < scale ) {
+			scale = aasworld->routeestimatescale[i];
+		} //end if
+	} //end for
+	if ( scale < 0 ) {
+		return 0;
+	}
+	return scale;
+} //end of the function AAS_RouteEstimateScale
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				estimated travel time from the point to the goal bounds
+// Changes Globals:		-
+//===========================================================================
+static int AAS_RouteEstimate( const vec3_t point, const vec3_t goalmins, const vec3_t goalmaxs, float scale ) {
+	int i;
+	vec3_t dir;
+
+	for ( i = 0; i < 3; i++ )
+	{
+		if ( point[i] < goalmins[i] ) {
+			dir[i] = goalmins[i] - point[i];
+		} else if ( point[i] > goalmaxs[i] ) {
+			dir[i] = point[i] - goalmaxs[i];
+		} else {
+			dir[i] = 0;
+		}
+	} //end for
+	return (int) ( scale * VectorLength( dir ) );
+} //end of the function AAS_RouteEstimate
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				bounds the estimates are measured to
+// Changes Globals:		-
+//===========================================================================
+static void AAS_RouteGoalBounds( int goalareanum, vec3_t goalmins, vec3_t goalmaxs ) {
+	int i;
+
+	for ( i = 0; i < 3; i++ )
+	{
+		goalmins[i] = aasworld->areas[goalareanum].mins[i] - ROUTE_GOALBOUNDSEPSILON;
+		goalmaxs[i] = aasworld->areas[goalareanum].maxs[i] + ROUTE_GOALBOUNDSEPSILON;
+	} //end for
+} //end of the function AAS_RouteGoalBounds
+//===========================================================================
+// the same checks as the routing cache updates
+//
+// Parameter:			-
+// Returns:				true if the reachability may be used
+// Changes Globals:		-
+//===========================================================================
+static qboolean AAS_RouteReachabilityAllowed( aas_reachability_t *reach, int badtravelflags ) {
+	//if there is used an undesired travel type
+	if ( aasworld->travelflagfortype[reach->traveltype] & badtravelflags ) {
+		return qfalse;
+	}
+	//if not allowed to enter the next area
+	if ( aasworld->areasettings[reach->areanum].areaflags & AREA_DISABLED ) {
+		return qfalse;
+	}
+	//if the next area has a not allowed travel flag
+	if ( AAS_AreaContentsTravelFlag( reach->areanum ) & badtravelflags ) {
+		return qfalse;
+	}
+	return qtrue;
+} //end of the function AAS_RouteReachabilityAllowed
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				extra travel time for entering an area to avoid
+// Changes Globals:		-
+//===========================================================================
+static int AAS_RouteAvoidTime( int areanum, int travelflags ) {
+#if defined RTCW_ET
+	if ( aasworld->areasettings[areanum].areaflags & AREA_AVOID ) {
+		return 1000;
+	} else if ( ( aasworld->areasettings[areanum].areaflags & AREA_AVOID_AXIS ) && ( travelflags & TFL_TEAM_AXIS ) ) {
+		return 200;
+	} else if ( ( aasworld->areasettings[areanum].areaflags & AREA_AVOID_ALLIES ) && ( travelflags & TFL_TEAM_ALLIES ) ) {
+		return 200;
+	}
+#endif // RTCW_XX
+	return 0;
+} //end of the function AAS_RouteAvoidTime
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				search fields of the routing update fields
+// Changes Globals:		-
+//===========================================================================
+static aas_routesearch_t *AAS_GetRouteSearch( aas_routingscratch_t *scratch ) {
+	aas_routesearch_t *search;
+	char *ptr;
+
+	if ( !scratch->routesearch ) {
+		ptr = (char *) AAS_RoutingGetMemory( sizeof( aas_routesearch_t ) +
+											 aasworld->reachabilitysize * sizeof( aas_routenode_t ) +
+											 aasworld->reachabilitysize * sizeof( int ) );
+		search = (aas_routesearch_t *) ptr;
+		ptr += sizeof( aas_routesearch_t );
+		search->nodes = (aas_routenode_t *) ptr;
+		ptr += aasworld->reachabilitysize * sizeof( aas_routenode_t );
+		search->heap = (int *) ptr;
+		scratch->routesearch = search;
+	} //end if
+	search = scratch->routesearch;
+	//the nodes of older searches are reset when they're reached
+	search->search++;
+	if ( search->search <= 0 ) {
+		memset( search->nodes, 0, aasworld->reachabilitysize * sizeof( aas_routenode_t ) );
+		search->search = 1;
+	} //end if
+	search->heapsize = 0;
+	return search;
+} //end of the function AAS_GetRouteSearch
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_RouteHeapUp( aas_routesearch_t *search, int index ) {
+	int parent, reachnum, estimate;
+
+	reachnum = search->heap[index];
+	estimate = search->nodes[reachnum].estimate;
+	while ( index > 0 )
+	{
+		parent = ( index - 1 ) >> 1;
+		if ( search->nodes[search->heap[parent]].estimate <= estimate ) {
+			break;
+		}
+		search->heap[index] = search->heap[parent];
+		search->nodes[search->heap[index]].heapindex = index;
+		index = parent;
+	} //end while
+	search->heap[index] = reachnum;
+	search->nodes[reachnum].heapindex = index;
+} //end of the function AAS_RouteHeapUp
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				open reachability with the lowest estimate
+// Changes Globals:		-
+//===========================================================================
+static int AAS_RouteHeapPop( aas_routesearch_t *search ) {
+	int index, child, reachnum, last, estimate;
+
+	reachnum = search->heap[0];
+	search->nodes[reachnum].heapindex = ROUTENODE_CLOSED;
+	search->heapsize--;
+	if ( !search->heapsize ) {
+		return reachnum;
+	}
+	last = search->heap[search->heapsize];
+	estimate = search->nodes[last].estimate;
+	index = 0;
+	while ( 1 )
+	{
+		child = index * 2 + 1;
+		if ( child >= search->heapsize ) {
+			break;
+		}
+		if ( child + 1 < search->heapsize &&
+			 search->nodes[search->heap[child + 1]].estimate < search->nodes[search->heap[child]].estimate ) {
+			child++;
+		}
+		if ( search->nodes[search->heap[child]].estimate >= estimate ) {
+			break;
+		}
+		search->heap[index] = search->heap[child];
+		search->nodes[search->heap[index]].heapindex = index;
+		index = child;
+	} //end while
+	search->heap[index] = last;
+	search->nodes[last].heapindex = index;
+	return reachnum;
+} //end of the function AAS_RouteHeapPop
+//===========================================================================
+// opens or improves the node of the reachability
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_RouteSearchReachability( aas_routesearch_t *search, int reachnum, int prev, int traveltime,
+										 int goalareanum, const vec3_t goalmins, const vec3_t goalmaxs, float scale ) {
+	int n, estimate;
+	aas_reachability_t *reach;
+	aas_areasettings_t *goalsettings;
+	aas_routenode_t *node;
+
+	reach = &aasworld->reachability[reachnum];
+	if ( reach->areanum == goalareanum ) {
+		//finish the route the way the routing caches start at the goal area
+		traveltime += 1;
+		goalsettings = &aasworld->areasettings[goalareanum];
+		n = aasworld->reversedlinkindex[reachnum];
+		if ( goalsettings->numreachableareas && aasworld->areatraveltimes[goalareanum] && n >= 0 ) {
+			traveltime += aasworld->areatraveltimes[goalareanum][0][n];
+		} //end if
+		estimate = 0;
+	} else {
+		estimate = AAS_RouteEstimate( reach->end, goalmins, goalmaxs, scale );
+	}
+	//
+	node = &search->nodes[reachnum];
+	if ( node->search != search->search ) {
+		node->search = search->search;
+		node->heapindex = ROUTENODE_NEW;
+	} else if ( node->heapindex == ROUTENODE_CLOSED || node->traveltime <= traveltime ) {
+		return;
+	}
+	node->traveltime = traveltime;
+	node->estimate = traveltime + estimate;
+	node->prev = prev;
+	if ( node->heapindex == ROUTENODE_NEW ) {
+		node->heapindex = search->heapsize++;
+		search->heap[node->heapindex] = reachnum;
+	} //end if
+	AAS_RouteHeapUp( search, node->heapindex );
+} //end of the function AAS_RouteSearchReachability
+//===========================================================================
+// searches the route from the area to the goal area without routing cache
+//
+// Parameter:			route			: first reachabilities of the route, may be NULL
+//						maxroute		: maximum number of reachabilities stored in route
+// Returns:				number of reachabilities of the route, -1 if there's no route
+// Changes Globals:		-
+//===========================================================================
+int AAS_GoalDirectedRoute( int areanum, vec3_t origin, int goalareanum, int travelflags, int *traveltime, int *route, int maxroute ) {
+	int i, n, t, reachnum, nextreachnum, nextareanum, badtravelflags, numroute;
+	float scale;
+	vec3_t goalmins, goalmaxs;
+	aas_areasettings_t *settings;
+	aas_reachability_t *reach, *nextreach;
+	aas_routingscratch_t *scratch;
+	aas_routesearch_t *search;
+
+	if ( !aasworld->initialized ) {
+		return -1;
+	}
+	if ( areanum == goalareanum ) {
+		*traveltime = 1;
+		return 0;
+	} //end if
+	if ( areanum <= 0 || areanum >= aasworld->numareas ) {
+		if ( bot_developer ) {
+			botimport.Print( PRT_ERROR, "AAS_GoalDirectedRoute: areanum %d out of range\n", areanum );
+		} //end if
+		return -1;
+	} //end if
+	if ( goalareanum <= 0 || goalareanum >= aasworld->numareas ) {
+		if ( bot_developer ) {
+			botimport.Print( PRT_ERROR, "AAS_GoalDirectedRoute: goalareanum %d out of range\n", goalareanum );
+		} //end if
+		return -1;
+	} //end if
+	  //
+	if ( AAS_AreaDoNotEnter( areanum ) || AAS_AreaDoNotEnter( goalareanum ) ) {
+		travelflags |= TFL_DONOTENTER;
+	} //end if
+	if ( AAS_AreaDoNotEnterLarge( areanum ) || AAS_AreaDoNotEnterLarge( goalareanum ) ) {
+		travelflags |= TFL_DONOTENTER_LARGE;
+	} //end if
+	badtravelflags = ~travelflags;
+	scale = AAS_RouteEstimateScale( travelflags );
+	AAS_RouteGoalBounds( goalareanum, goalmins, goalmaxs );
+	//
+	scratch = AAS_GetRoutingScratch();
+	search = AAS_GetRouteSearch( scratch );
+	//open the reachabilities leaving the start area
+	settings = &aasworld->areasettings[areanum];
+	for ( i = 0; i < settings->numreachableareas; i++ )
+	{
+		reachnum = settings->firstreachablearea + i;
+		reach = &aasworld->reachability[reachnum];
+		if ( !AAS_RouteReachabilityAllowed( reach, badtravelflags ) ) {
+			continue;
+		}
+		t = reach->traveltime + AAS_RouteAvoidTime( reach->areanum, travelflags );
+		if ( origin ) {
+			t += AAS_AreaTravelTime( areanum, origin, reach->start );
+		}
+		AAS_RouteSearchReachability( search, reachnum, -1, t, goalareanum, goalmins, goalmaxs, scale );
+	} //end for
+	  //
+	reachnum = -1;
+	while ( search->heapsize )
+	{
+		reachnum = AAS_RouteHeapPop( search );
+		reach = &aasworld->reachability[reachnum];
+		if ( reach->areanum == goalareanum ) {
+			break;
+		}
+		//continue through the reachabilities leaving the area the reachability leads to
+		nextareanum = reach->areanum;
+		settings = &aasworld->areasettings[nextareanum];
+		n = aasworld->reversedlinkindex[reachnum];
+		for ( i = 0; i < settings->numreachableareas; i++ )
+		{
+			nextreachnum = settings->firstreachablearea + i;
+			nextreach = &aasworld->reachability[nextreachnum];
+			if ( !AAS_RouteReachabilityAllowed( nextreach, badtravelflags ) ) {
+				continue;
+			}
+			t = search->nodes[reachnum].traveltime + nextreach->traveltime +
+				AAS_RouteAvoidTime( nextreach->areanum, travelflags );
+			if ( n >= 0 && aasworld->areatraveltimes[nextareanum] ) {
+				t += aasworld->areatraveltimes[nextareanum][i][n];
+			} else {
+				t += AAS_AreaTravelTime( nextareanum, reach->end, nextreach->start );
+			}
+			AAS_RouteSearchReachability( search, nextreachnum, reachnum, t, goalareanum, goalmins, goalmaxs, scale );
+		} //end for
+		reachnum = -1;
+	} //end while
+	  //
+	numroute = -1;
+	if ( reachnum >= 0 ) {
+		*traveltime = search->nodes[reachnum].traveltime;
+		//count the reachabilities and store the first ones
+		numroute = 0;
+		for ( n = reachnum; n >= 0; n = search->nodes[n].prev )
+		{
+			numroute++;
+		} //end for
+		for ( i = numroute - 1, n = reachnum; n >= 0; i--, n = search->nodes[n].prev )
+		{
+			if ( route && i < maxroute ) {
+				route[i] = n;
+			}
+		} //end for
+	} //end if
+	AAS_ReleaseRoutingScratch( scratch );
+	return numroute;
+} //end of the function AAS_GoalDirectedRoute
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				travel time of the goal directed route, 0 if there's no route
+// Changes Globals:		-
+//===========================================================================
+int AAS_GoalDirectedTravelTime( int areanum, vec3_t origin, int goalareanum, int travelflags ) {
+	int traveltime;
+
+	if ( AAS_GoalDirectedRoute( areanum, origin, goalareanum, travelflags, &traveltime, NULL, 0 ) >= 0 ) {
+		return traveltime;
+	}
+	return 0;
+} //end of the function AAS_GoalDirectedTravelTime
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				random reachability area
+// Changes Globals:		-
+//===========================================================================
+static int AAS_RouteTestArea( const rtcw::VectorTrivial<int> &areas, int numareas, unsigned int *seed ) {
+	*seed = *seed * 1103515245 + 12345;
+	return areas[( *seed >> 8 ) % numareas];
+} //end of the function AAS_RouteTestArea
+#define ROUTETEST_MAXJOBS		64
+
+typedef struct aas_routetestjob_s
+{
+	const int *pairs;                           //start and goal area of every query
+	int *traveltimes;                           //travel time found by every query
+	int numpairs;
+} aas_routetestjob_t;
+//===========================================================================
+// routing cache queries of one job, every ROUTETEST_MAXJOBS'th pair
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_RouteTestJob( void *data, int index ) {
+	int i, areanum;
+	const aas_routetestjob_t *job;
+
+	job = (const aas_routetestjob_t *) data;
+	for ( i = index; i < job->numpairs; i += ROUTETEST_MAXJOBS )
+	{
+		areanum = job->pairs[i * 2];
+		job->traveltimes[i] = AAS_AreaTravelTimeToGoalArea( areanum, aasworld->areas[areanum].center, job->pairs[i * 2 + 1], TFL_DEFAULT );
+	} //end for
+} //end of the function AAS_RouteTestJob
+//===========================================================================
+// runs the routing cache queries on the job workers, starting without any
+// routing cache so the workers create and link the caches concurrently,
+// and compares the travel times with those of serial queries
+//
+// Parameter:			pairs			: start and goal area of every query
+//						numpairs		: number of queries
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_TestConcurrentRoutes( const int *pairs, int numpairs ) {
+	int i, areanum, start, time, differ, failed;
+	rtcw::VectorTrivial<int> serialtimes, traveltimes;
+	aas_routetestjob_t job;
+	aas_routingtables_t *routingtables;
+
+	serialtimes.resize( numpairs );
+	for ( i = 0; i < numpairs; i++ )
+	{
+		areanum = pairs[i * 2];
+		SDL_AtomicSet( &aasworld->frameroutingupdates, 0 );
+		serialtimes[i] = AAS_AreaTravelTimeToGoalArea( areanum, aasworld->areas[areanum].center, pairs[i * 2 + 1], TFL_DEFAULT );
+	} //end for
+	  //no routing cache and no precomputed tables, every query goes through
+	  //the routing cache lists
+	AAS_FreeAllClusterAreaCache();
+	AAS_FreeAllPortalCache();
+	AAS_InitClusterAreaCache();
+	AAS_InitPortalCache();
+	routingtables = aasworld->routingtables;
+	aasworld->routingtables = NULL;
+	//the workers share the frame routing update counter, start it far enough
+	//below the limit that none of the queries gives up
+	SDL_AtomicSet( &aasworld->frameroutingupdates, INT_MIN / 2 );
+	//
+	traveltimes.resize( numpairs );
+	job.pairs = pairs;
+	job.traveltimes = traveltimes.get_data();
+	job.numpairs = numpairs;
+	start = Sys_MilliSeconds();
+	botimport.RunJobs( AAS_RouteTestJob, &job, numpairs < ROUTETEST_MAXJOBS ? numpairs : ROUTETEST_MAXJOBS );
+	time = Sys_MilliSeconds() - start;
+	//
+	SDL_AtomicSet( &aasworld->frameroutingupdates, 0 );
+	aasworld->routingtables = routingtables;
+	//
+	differ = failed = 0;
+	for ( i = 0; i < numpairs; i++ )
+	{
+		if ( traveltimes[i] != serialtimes[i] ) {
+			differ++;
+			if ( !traveltimes[i] ) {
+				failed++;
+			}
+		} //end if
+	} //end for
+	botimport.Print( PRT_MESSAGE, "routing cache on the job workers: %d msec, %.2f usec per query\n", time, time * 1000.0f / numpairs );
+	botimport.Print( PRT_MESSAGE, "%d concurrent queries differ from the serial queries (%d without a route)\n", differ, failed );
+} //end of the function AAS_TestConcurrentRoutes
+//===========================================================================
+// checks the goal directed routes and their estimates against the routing
+// cache for random area pairs, or times both of them, then runs the routing
+// cache queries concurrently
+//
+// Parameter:			numqueries		: number of random area pairs
+//						benchmark		: time the routes instead of checking them
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_TestGoalDirectedRoutes( int numqueries, int benchmark ) {
+	int i, j, areanum, goalareanum, numareas, numroute, numpairs, start, time, reachnum;
+	int routed, cacheonly, directedonly, longer, shorter, checked, overestimates, maxoverestimate;
+	int traveltime, cachetraveltime, remaining, estimate, passtime[3];
+	int route[ROUTETEST_MAXREACH];
+	unsigned int seed;
+	float scale;
+	vec3_t goalmins, goalmaxs;
+	aas_reachability_t *reach;
+	rtcw::VectorTrivial<int> areas, pairs;
+
+	if ( !aasworld->loaded || !aasworld->initialized ) {
+		botimport.Print( PRT_MESSAGE, "AAS not initialized\n" );
+		return;
+	} //end if
+	  //
+	areas.resize( aasworld->numareas );
+	numareas = 0;
+	for ( i = 1; i < aasworld->numareas; i++ )
+	{
+		if ( aasworld->areasettings[i].numreachableareas ) {
+			areas[numareas++] = i;
+		}
+	} //end for
+	if ( numareas < 2 ) {
+		botimport.Print( PRT_MESSAGE, "not enough reachability areas\n" );
+		return;
+	} //end if
+	  //the same area pairs every time
+	seed = 1;
+	pairs.resize( numqueries * 2 );
+	for ( numpairs = 0; numpairs < numqueries; numpairs++ )
+	{
+		pairs[numpairs * 2] = AAS_RouteTestArea( areas, numareas, &seed );
+		pairs[numpairs * 2 + 1] = AAS_RouteTestArea( areas, numareas, &seed );
+	} //end for
+	scale = AAS_RouteEstimateScale( TFL_DEFAULT );
+	//the routing cache answers from the precomputed tables where it can
+	botimport.Print( PRT_MESSAGE, "precomputed routing tables %s\n", aasworld->routingtables ? "loaded" : "not loaded" );
+	//
+	if ( benchmark ) {
+		//goal directed routes, routing cache as it is and routing cache again
+		for ( j = 0; j < 3; j++ )
+		{
+			start = Sys_MilliSeconds();
+			for ( i = 0; i < numpairs; i++ )
+			{
+				areanum = pairs[i * 2];
+				goalareanum = pairs[i * 2 + 1];
+				if ( !j ) {
+					AAS_GoalDirectedRoute( areanum, aasworld->areas[areanum].center, goalareanum, TFL_DEFAULT, &traveltime, NULL, 0 );
+				} else {
+					//don't let the frame routing update limit fail the query
+					SDL_AtomicSet( &aasworld->frameroutingupdates, 0 );
+					AAS_AreaRouteToGoalArea( areanum, aasworld->areas[areanum].center, goalareanum, TFL_DEFAULT, &traveltime, &reachnum );
+				}
+			} //end for
+			passtime[j] = Sys_MilliSeconds() - start;
+		} //end for
+		botimport.Print( PRT_MESSAGE, "%d route queries\n", numpairs );
+		botimport.Print( PRT_MESSAGE, "goal directed: %d msec, %.2f usec per query\n", passtime[0], passtime[0] * 1000.0f / numpairs );
+		botimport.Print( PRT_MESSAGE, "routing cache: %d msec, %.2f usec per query\n", passtime[1], passtime[1] * 1000.0f / numpairs );
+		botimport.Print( PRT_MESSAGE, "routing cache again: %d msec, %.2f usec per query\n", passtime[2], passtime[2] * 1000.0f / numpairs );
+	} else {
+		routed = cacheonly = directedonly = longer = shorter = 0;
+		checked = overestimates = maxoverestimate = 0;
+		for ( i = 0; i < numpairs; i++ )
+		{
+			areanum = pairs[i * 2];
+			goalareanum = pairs[i * 2 + 1];
+			numroute = AAS_GoalDirectedRoute( areanum, aasworld->areas[areanum].center, goalareanum, TFL_DEFAULT,
+											  &traveltime, route, ROUTETEST_MAXREACH );
+			//don't let the frame routing update limit fail the query
+			SDL_AtomicSet( &aasworld->frameroutingupdates, 0 );
+			if ( !AAS_AreaRouteToGoalArea( areanum, aasworld->areas[areanum].center, goalareanum, TFL_DEFAULT,
+										   &cachetraveltime, &reachnum ) ) {
+				cachetraveltime = 0;
+			}
+			if ( numroute < 0 ) {
+				if ( cachetraveltime ) {
+					cacheonly++;
+				}
+				continue;
+			} //end if
+			if ( !cachetraveltime ) {
+				directedonly++;
+				continue;
+			} //end if
+			routed++;
+			if ( traveltime > cachetraveltime ) {
+				longer++;
+			} else if ( traveltime < cachetraveltime ) {
+				shorter++;
+			}
+			//the estimate from every area along the route may not exceed
+			//the travel time of the route nor that of the routing cache
+			AAS_RouteGoalBounds( goalareanum, goalmins, goalmaxs );
+			for ( j = 0; j < numroute && j < ROUTETEST_MAXREACH; j++ )
+			{
+				reach = &aasworld->reachability[route[j]];
+				if ( reach->areanum == goalareanum ) {
+					break;
+				}
+				estimate = AAS_RouteEstimate( reach->end, goalmins, goalmaxs, scale );
+				remaining = AAS_GoalDirectedTravelTime( reach->areanum, reach->end, goalareanum, TFL_DEFAULT );
+				SDL_AtomicSet( &aasworld->frameroutingupdates, 0 );
+				time = AAS_AreaTravelTimeToGoalArea( reach->areanum, reach->end, goalareanum, TFL_DEFAULT );
+				if ( time && ( !remaining || time < remaining ) ) {
+					remaining = time;
+				}
+				if ( !remaining ) {
+					continue;
+				}
+				checked++;
+				if ( estimate > remaining ) {
+					overestimates++;
+					if ( estimate - remaining > maxoverestimate ) {
+						maxoverestimate = estimate - remaining;
+					}
+				} //end if
+			} //end for
+		} //end for
+		botimport.Print( PRT_MESSAGE, "%d route queries, estimate scale %f\n", numpairs, scale );
+		botimport.Print( PRT_MESSAGE, "%d routed both ways, %d only by the routing cache, %d only goal directed\n",
+						 routed, cacheonly, directedonly );
+		botimport.Print( PRT_MESSAGE, "%d goal directed routes shorter than the routing cache, %d longer\n", shorter, longer );
+		botimport.Print( PRT_MESSAGE, "%d estimates checked, %d overestimated (max %d)\n", checked, overestimates, maxoverestimate );
+	}
+	//
+	AAS_TestConcurrentRoutes( pairs.get_data(), numpairs );
+} //end of the function AAS_TestGoalDirectedRoutes
+//===========================================================================
+// precomputed routing tables
+//
+// The routing tables hold the area routing cache of every goal area within
+// every cluster and the portal routing cache of every goal area for a few
+// sets of travel flags. They're computed in parallel and stored in a file
+// that is mapped read-only, so route queries on such a map don't have to
+// update routing caches unless areas are enabled or disabled.
+//
+// file layout: a header page followed by one page aligned table per set of
+// travel flags, every table holds
+//   - for every cluster the travel times and then the reachabilities from all
+//     reachability areas towards every reachability area of the cluster
+//   - the travel times and then the reachabilities from all portals towards
+//     every area
+//===========================================================================
+
+#define RTID                        ( ( 'T' << 24 ) + ( 'R' << 16 ) + ( 'S' << 8 ) + 'A' )
+#define RTVERSION                   1
+#define RT_PAGESIZE                 4096
+//number of goal areas computed by one job
+#define RT_JOBAREAS                 16
+
+typedef struct routingtablesheader_s
+{
+	int ident;
+	int version;
+	int numareas;
+	int numclusters;
+	int numportals;
+	int areacrc;
+	int clustercrc;
+	int reachcrc;
+	int numtables;
+	int tablesize;
+	int travelflags[AAS_MAX_ROUTINGTABLES];
+} routingtablesheader_t;
+
+//travel flags the routing tables are computed with
+static const int aas_routingtableflags[] =
+{
+	TFL_DEFAULT,
+#if !defined RTCW_ET
+	//travel flags of the AI characters
+	TFL_DEFAULT & ~( TFL_JUMPPAD | TFL_ROCKETJUMP | TFL_BFGJUMP | TFL_GRAPPLEHOOK | TFL_DOUBLEJUMP | TFL_RAMPJUMP | TFL_STRAFEJUMP | TFL_LAVA ),
+#endif // RTCW_XX
+};
+
+typedef struct aas_routingtablejob_s
+{
+	int tablenum;
+	int clusternum;                             //cluster of the area tables
+	int firstarea;                              //first goal area
+	int lastarea;                               //last goal area + 1
+} aas_routingtablejob_t;
+
+typedef struct aas_routingtablebuild_s
+{
+	const aas_routingtables_t *tables;
+	unsigned char *data;                        //start of the first table
+	const aas_routingtablejob_t *jobs;
+	const int *clusterareas;                    //area number of every cluster area
+	const int *firstclusterarea;                //index in clusterareas of every cluster
+} aas_routingtablebuild_t;
+//===========================================================================
+// allocates the routing tables and calculates the table layout
+//
+// Parameter:			-
+// Returns:				NULL if the tables would be too large
+// Changes Globals:		-
+//===========================================================================
+static aas_routingtables_t *AAS_AllocRoutingTables( void ) {
+	int i, n, maxreachabilityareas;
+	int64_t offset;
+	char *ptr;
+	aas_routingtables_t *tables;
+
+	maxreachabilityareas = 0;
+	for ( i = 0; i < aasworld->numclusters; i++ )
+	{
+		maxreachabilityareas = std::max( maxreachabilityareas, aasworld->clusters[i].numreachabilityareas );
+	} //end for
+
+	ptr = (char *) GetClearedMemory( sizeof( aas_routingtables_t ) +
+									 aasworld->numclusters * 2 * sizeof( int ) +
+									 aasworld->numareas * sizeof( int ) +
+									 maxreachabilityareas * sizeof( unsigned short int ) +
+									 maxreachabilityareas * sizeof( unsigned char ) +
+									 aasworld->numareas * sizeof( byte ) );
+	tables = (aas_routingtables_t *) ptr;
+	ptr += sizeof( aas_routingtables_t );
+	tables->clusteroffsets = (int *) ptr;
+	ptr += aasworld->numclusters * sizeof( int );
+	tables->clusterchanges = (int *) ptr;
+	ptr += aasworld->numclusters * sizeof( int );
+	tables->areaflags = (int *) ptr;
+	ptr += aasworld->numareas * sizeof( int );
+	tables->emptytraveltimes = (unsigned short int *) ptr;
+	ptr += maxreachabilityareas * sizeof( unsigned short int );
+	tables->emptyreachabilities = (unsigned char *) ptr;
+	ptr += maxreachabilityareas * sizeof( unsigned char );
+	tables->areachanged = (byte *) ptr;
+
+	offset = 0;
+	for ( i = 0; i < aasworld->numclusters; i++ )
+	{
+		n = aasworld->clusters[i].numreachabilityareas;
+		tables->clusteroffsets[i] = (int) offset;
+		offset += ( (int64_t) n * n * 3 + 3 ) & ~3;
+		if ( offset > INT_MAX ) {
+			break;
+		}
+	} //end for
+	tables->portaloffset = (int) offset;
+	offset += (int64_t) aasworld->numareas * aasworld->numportals * 3;
+	offset = ( offset + RT_PAGESIZE - 1 ) & ~( RT_PAGESIZE - 1 );
+	if ( offset > ( INT_MAX - RT_PAGESIZE ) / AAS_MAX_ROUTINGTABLES ) {
+		FreeMemory( tables );
+		return NULL;
+	} //end if
+	tables->tablesize = (int) offset;
+	return tables;
+} //end of the function AAS_AllocRoutingTables
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_RoutingTablesHeader( routingtablesheader_t *header ) {
+	memset( header, 0, sizeof( routingtablesheader_t ) );
+	header->ident = RTID;
+	header->version = RTVERSION;
+	header->numareas = aasworld->numareas;
+	header->numclusters = aasworld->numclusters;
+	header->numportals = aasworld->numportals;
+	header->areacrc = CRC_ProcessString( (unsigned char *) aasworld->areas, sizeof( aas_area_t ) * aasworld->numareas );
+	header->clustercrc = CRC_ProcessString( (unsigned char *) aasworld->clusters, sizeof( aas_cluster_t ) * aasworld->numclusters );
+	header->reachcrc = CRC_ProcessString( (unsigned char *) aasworld->reachability, sizeof( aas_reachability_t ) * aasworld->reachabilitysize );
+} //end of the function AAS_RoutingTablesHeader
+//===========================================================================
+// computes the area routing tables of a range of goal areas in a cluster
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_RoutingTablesAreaJob( void *data, int index ) {
+	int i, travelflags, numreachabilityareas;
+	unsigned char *table;
+	const aas_routingtablebuild_t *build;
+	const aas_routingtablejob_t *job;
+	rtcw::VectorTrivial<aas_routingupdate_t> areaupdate;
+
+	build = (const aas_routingtablebuild_t *) data;
+	job = &build->jobs[index];
+	numreachabilityareas = aasworld->clusters[job->clusternum].numreachabilityareas;
+	table = build->data + job->tablenum * build->tables->tablesize + build->tables->clusteroffsets[job->clusternum];
+	travelflags = build->tables->travelflags[job->tablenum];
+
+#if defined RTCW_ET
+	travelflags &= ~TFL_TEAM_FLAGS | aasworld->clusterTeamTravelFlags[job->clusternum];
+#endif // RTCW_XX
+
+	//the routing update fields are indexed by cluster area number
+	areaupdate.resize( numreachabilityareas );
+	for ( i = job->firstarea; i < job->lastarea; i++ )
+	{
+		AAS_UpdateAreaRoutingTable( job->clusternum, build->clusterareas[build->firstclusterarea[job->clusternum] + i],
+									travelflags, 1,
+									(unsigned short int *) table + i * numreachabilityareas,
+									table + numreachabilityareas * numreachabilityareas * sizeof( unsigned short int ) + i * numreachabilityareas,
+									areaupdate.get_data() );
+	} //end for
+} //end of the function AAS_RoutingTablesAreaJob
+//===========================================================================
+// computes the portal routing tables of a range of goal areas
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_RoutingTablesPortalJob( void *data, int index ) {
+	int areanum, clusternum, travelflags;
+	unsigned char *table;
+	const aas_routingtablebuild_t *build;
+	const aas_routingtablejob_t *job;
+	rtcw::VectorTrivial<aas_routingupdate_t> portalupdate;
+
+	build = (const aas_routingtablebuild_t *) data;
+	job = &build->jobs[index];
+	table = build->data + job->tablenum * build->tables->tablesize + build->tables->portaloffset;
+	travelflags = build->tables->travelflags[job->tablenum];
+
+	portalupdate.resize( aasworld->numportals + 1 );
+	for ( areanum = job->firstarea; areanum < job->lastarea; areanum++ )
+	{
+		//just assume a portal goal area is part of the front cluster
+		clusternum = aasworld->areasettings[areanum].cluster;
+		if ( clusternum < 0 ) {
+			clusternum = aasworld->portals[-clusternum].frontcluster;
+		} //end if
+		if ( !clusternum ) {
+			continue;
+		} //end if
+		AAS_UpdatePortalRoutingTable( clusternum, areanum, travelflags, 1,
+									  (unsigned short int *) table + areanum * aasworld->numportals,
+									  table + aasworld->numareas * aasworld->numportals * sizeof( unsigned short int ) + areanum * aasworld->numportals,
+									  portalupdate.get_data(), build->tables );
+	} //end for
+} //end of the function AAS_RoutingTablesPortalJob
+//===========================================================================
+// computes all routing tables on the worker threads and writes them
+//
+// Parameter:			-
+// Returns:				qtrue if the routing table file was written
+// Changes Globals:		-
+//===========================================================================
+static qboolean AAS_BuildRoutingTables( void ) {
+	int i, j, numtables, numclusterareas, starttime;
+	fileHandle_t fp;
+	char filename[MAX_QPATH];
+	aas_portal_t *portal;
+	aas_routingtables_t *tables;
+	aas_routingtablejob_t job;
+	aas_routingtablebuild_t build;
+	routingtablesheader_t header;
+	rtcw::VectorTrivial<unsigned char> buffer;
+	rtcw::VectorTrivial<aas_routingtablejob_t> areajobs, portaljobs;
+	rtcw::VectorTrivial<int> clusterareas, firstclusterarea;
+
+	starttime = Sys_MilliSeconds();
+
+	tables = AAS_AllocRoutingTables();
+	if ( !tables ) {
+		botimport.Print( PRT_WARNING, "routing tables of %s are too large\n", aasworld->mapname );
+		return qfalse;
+	} //end if
+	for ( i = 0; i < (int) ( sizeof( aas_routingtableflags ) / sizeof( aas_routingtableflags[0] ) ); i++ )
+	{
+		if ( AAS_RoutingTableNum( tables, aas_routingtableflags[i] ) < 0 ) {
+			tables->travelflags[tables->numtables++] = aas_routingtableflags[i];
+		} //end if
+	} //end for
+	numtables = tables->numtables;
+
+	buffer.resize( RT_PAGESIZE + numtables * tables->tablesize );
+	AAS_RoutingTablesHeader( &header );
+	header.numtables = numtables;
+	header.tablesize = tables->tablesize;
+	memcpy( header.travelflags, tables->travelflags, sizeof( header.travelflags ) );
+	memcpy( buffer.get_data(), &header, sizeof( header ) );
+	tables->data = buffer.get_data() + RT_PAGESIZE;
+
+	//area number of every area in every cluster
+	firstclusterarea.resize( aasworld->numclusters );
+	numclusterareas = 0;
+	for ( i = 0; i < aasworld->numclusters; i++ )
+	{
+		firstclusterarea[i] = numclusterareas;
+		numclusterareas += aasworld->clusters[i].numareas;
+	} //end for
+	clusterareas.resize( numclusterareas );
+	for ( i = 1; i < aasworld->numareas; i++ )
+	{
+		j = aasworld->areasettings[i].cluster;
+		if ( j > 0 ) {
+			clusterareas[firstclusterarea[j] + aasworld->areasettings[i].clusterareanum] = i;
+		} //end if
+		else if ( j < 0 ) {
+			portal = &aasworld->portals[-j];
+			clusterareas[firstclusterarea[portal->frontcluster] + portal->clusterareanum[0]] = i;
+			clusterareas[firstclusterarea[portal->backcluster] + portal->clusterareanum[1]] = i;
+		} //end else if
+	} //end for
+
+	//split the goal areas into jobs
+	for ( job.tablenum = 0; job.tablenum < numtables; job.tablenum++ )
+	{
+		for ( job.clusternum = 1; job.clusternum < aasworld->numclusters; job.clusternum++ )
+		{
+			for ( i = 0; i < aasworld->clusters[job.clusternum].numreachabilityareas; i += RT_JOBAREAS )
+			{
+				job.firstarea = i;
+				job.lastarea = std::min( i + RT_JOBAREAS, aasworld->clusters[job.clusternum].numreachabilityareas );
+				areajobs.insert_range( areajobs.get_size(), &job, 1 );
+			} //end for
+		} //end for
+		job.clusternum = 0;
+		for ( i = 1; i < aasworld->numareas; i += RT_JOBAREAS )
+		{
+			job.firstarea = i;
+			job.lastarea = std::min( i + RT_JOBAREAS, aasworld->numareas );
+			portaljobs.insert_range( portaljobs.get_size(), &job, 1 );
+		} //end for
+	} //end for
+
+	build.tables = tables;
+	build.data = buffer.get_data() + RT_PAGESIZE;
+	build.clusterareas = clusterareas.get_data();
+	build.firstclusterarea = firstclusterarea.get_data();
+	//the portal tables are computed from the area tables
+	build.jobs = areajobs.get_data();
+	botimport.RunJobs( AAS_RoutingTablesAreaJob, &build, areajobs.get_size() );
+	build.jobs = portaljobs.get_data();
+	botimport.RunJobs( AAS_RoutingTablesPortalJob, &build, portaljobs.get_size() );
+
+	FreeMemory( tables );
+
+	Com_sprintf( filename, MAX_QPATH, "maps/%s.rtb", aasworld->mapname );
+	botimport.FS_FOpenFile( filename, &fp, FS_WRITE );
+	if ( !fp ) {
+		botimport.Print( PRT_ERROR, "Unable to open file: %s\n", filename );
+		return qfalse;
+	} //end if
+	botimport.FS_Write( buffer.get_data(), buffer.get_size(), fp );
+	botimport.FS_FCloseFile( fp );
+	botimport.Print( PRT_MESSAGE, "%d routing tables written to %s, %d KB in %d msec\n",
+					 numtables, filename, buffer.get_size() >> 10, Sys_MilliSeconds() - starttime );
+	return qtrue;
+} //end of the function AAS_BuildRoutingTables
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				qtrue if the routing table file was mapped
+// Changes Globals:		-
+//===========================================================================
+static qboolean AAS_LoadRoutingTables( void ) {
+	int i, length;
+	char filename[MAX_QPATH];
+	const unsigned char *data;
+	void *mapping;
+	aas_routingtables_t *tables;
+	routingtablesheader_t header, fileheader;
+
+	Com_sprintf( filename, MAX_QPATH, "maps/%s.rtb", aasworld->mapname );
+	data = (const unsigned char *) botimport.FS_MapFile( filename, &length, &mapping );
+	if ( !data ) {
+		return qfalse;
+	} //end if
+
+	tables = NULL;
+	memset( &fileheader, 0, sizeof( fileheader ) );
+	if ( length >= RT_PAGESIZE ) {
+		memcpy( &fileheader, data, sizeof( fileheader ) );
+		AAS_RoutingTablesHeader( &header );
+		header.numtables = fileheader.numtables;
+		header.tablesize = fileheader.tablesize;
+		memcpy( header.travelflags, fileheader.travelflags, sizeof( header.travelflags ) );
+		if ( !memcmp( &header, &fileheader, sizeof( header ) ) &&
+			 header.numtables > 0 && header.numtables <= AAS_MAX_ROUTINGTABLES ) {
+			tables = AAS_AllocRoutingTables();
+		} //end if
+	} //end if
+	if ( !tables || tables->tablesize != fileheader.tablesize ||
+		 length < RT_PAGESIZE + fileheader.numtables * fileheader.tablesize ) {
+		if ( tables ) {
+			FreeMemory( tables );
+		} //end if
+		botimport.FS_UnmapFile( mapping );
+		botimport.Print( PRT_WARNING, "%s is out of date\n", filename );
+		return qfalse;
+	} //end if
+
+	tables->mapping = mapping;
+	tables->data = data + RT_PAGESIZE;
+	tables->numtables = fileheader.numtables;
+	memcpy( tables->travelflags, fileheader.travelflags, sizeof( tables->travelflags ) );
+	//the tables are only valid for the current area flags
+	for ( i = 0; i < aasworld->numareas; i++ )
+	{
+		tables->areaflags[i] = aasworld->areasettings[i].areaflags;
+	} //end for
+	aasworld->routingtables = tables;
+	botimport.Print( PRT_MESSAGE, "mapped %d routing tables from %s\n", tables->numtables, filename );
+	return qtrue;
+} //end of the function AAS_LoadRoutingTables
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_FreeRoutingTables( void ) {
+	if ( !aasworld->routingtables ) {
+		return;
+	} //end if
+	if ( aasworld->routingtables->mapping ) {
+		botimport.FS_UnmapFile( aasworld->routingtables->mapping );
+	} //end if
+	FreeMemory( aasworld->routingtables );
+	aasworld->routingtables = NULL;
+} //end of the function AAS_FreeRoutingTables
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_InitRoutingTables( void ) {
+	AAS_FreeRoutingTables();
+	//the tables are stored in little endian byte order and used in place
+	if ( !rtcw::Endian::is_little() ) {
+		return;
+	} //end if
+	if ( AAS_LoadRoutingTables() ) {
+		return;
+	} //end if
+	if ( !LibVarGetValue( "bot_routeprecompute" ) ) {
+		return;
+	} //end if
+	if ( AAS_BuildRoutingTables() ) {
+		AAS_LoadRoutingTables();
+	} //end if
+} //end of the function AAS_InitRoutingTables
+//===========================================================================
+// keeps track of the areas with other flags than the routing tables were
+// computed with, the same caches become invalid as in
+// AAS_RemoveRoutingCacheUsingArea
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_RoutingTablesAreaChanged( int areanum ) {
+	int clusternum, changed, delta;
+	aas_routingtables_t *tables;
+
+	tables = aasworld->routingtables;
+	if ( !tables ) {
+		return;
+	} //end if
+	changed = aasworld->areasettings[areanum].areaflags != tables->areaflags[areanum];
+	if ( changed == tables->areachanged[areanum] ) {
+		return;
+	} //end if
+	tables->areachanged[areanum] = changed;
+	delta = changed ? 1 : -1;
+	tables->numchanges += delta;
+	clusternum = aasworld->areasettings[areanum].cluster;
+	if ( clusternum > 0 ) {
+		tables->clusterchanges[clusternum] += delta;
+	} //end if
+	else if ( clusternum < 0 ) {
+		tables->clusterchanges[aasworld->portals[-clusternum].frontcluster] += delta;
+		tables->clusterchanges[aasworld->portals[-clusternum].backcluster] += delta;
+	} //end else if
+} //end of the function AAS_RoutingTablesAreaChanged
+//===========================================================================
 //
 // Parameter:			-
 // Returns:				-
@@ -3978,7 +5357,7 @@ int AAS_NearestHideArea( int srcnum, vec3_t origin, int areanum, int enemynum, v
 #endif // RTCW_XX
 
 	int i, j, nextareanum, badtravelflags, numreach, bestarea;
-	unsigned short int t, besttraveltime, enemytraveltime;
+	unsigned short int t, besttraveltime;
 	aas_routingupdate_t *updateliststart, *updatelistend, *curupdate, *nextupdate;
 	aas_reachability_t *reach;
 	float dist1, dist2;
@@ -4063,9 +5442,6 @@ int AAS_NearestHideArea( int srcnum, vec3_t origin, int areanum, int enemynum, v
 	} //end else
 	besttraveltime = 0;
 	bestarea = 0;
-	if ( enemyareanum ) {
-		enemytraveltime = AAS_AreaTravelTimeToGoalArea( areanum, origin, enemyareanum, travelflags );
-	}
 	VectorSubtract( enemyorigin, origin, enemyVec );
 	enemytraveldist = VectorNormalize( enemyVec );
 
@@ -4346,7 +5722,7 @@ int BotFuzzyPointReachabilityArea( vec3_t origin );
 //===========================================================================
 int AAS_FindAttackSpotWithinRange( int srcnum, int rangenum, int enemynum, float rangedist, int travelflags, float *outpos ) {
 	int i, nextareanum, badtravelflags, numreach, bestarea;
-	unsigned short int t, besttraveltime, enemytraveltime;
+	unsigned short int t, besttraveltime;
 	aas_routingupdate_t *updateliststart, *updatelistend, *curupdate, *nextupdate;
 	aas_reachability_t *reach;
 	vec3_t srcorg, rangeorg, enemyorg;
@@ -4422,7 +5798,6 @@ int AAS_FindAttackSpotWithinRange( int srcnum, int rangenum, int enemynum, float
 	//
 	besttraveltime = 0;
 	bestarea = 0;
-	enemytraveltime = AAS_AreaTravelTimeToGoalArea( srcarea, srcorg, enemyarea, travelflags );
 	//
 	badtravelflags = ~travelflags;
 	//
@@ -4641,12 +6016,11 @@ int AAS_FindAttackSpotWithinRange( int srcnum, int rangenum, int enemynum, float
 // Changes Globals:		-
 //===========================================================================
 qboolean AAS_GetRouteFirstVisPos( vec3_t srcpos, vec3_t destpos, int travelflags, vec3_t retpos ) {
-	int srcarea, destarea, travarea;
+	int srcarea, destarea, i, numroute, traveltime;
 	vec3_t travpos;
-	int ftraveltime, freachnum, lasttraveltime;
 	aas_reachability_t reach;
-	int loops = 0;
 #define MAX_GETROUTE_VISPOS_LOOPS   200
+	int route[MAX_GETROUTE_VISPOS_LOOPS];
 	//
 	// SRCPOS: enemy
 	// DESTPOS: self
@@ -4680,16 +6054,13 @@ qboolean AAS_GetRouteFirstVisPos( vec3_t srcpos, vec3_t destpos, int travelflags
 		return qfalse;
 	}
 	//
-	travarea = srcarea;
+	// the whole route at once instead of a routing cache of the goal area
+	// and a route query from every area along the way
+	numroute = AAS_GoalDirectedRoute( srcarea, srcpos, destarea, travelflags, &traveltime, route, MAX_GETROUTE_VISPOS_LOOPS );
 	VectorCopy( srcpos, travpos );
-	lasttraveltime = -1;
-	while ( ( loops++ < MAX_GETROUTE_VISPOS_LOOPS ) && AAS_AreaRouteToGoalArea( travarea, travpos, destarea, travelflags, &ftraveltime, &freachnum ) ) {
-		if ( lasttraveltime >= 0 && ftraveltime >= lasttraveltime ) {
-			return qfalse;  // we may be in a loop
-		}
-		lasttraveltime = ftraveltime;
-		//
-		AAS_ReachabilityFromNum( freachnum, &reach );
+	for ( i = 0; i < numroute && i < MAX_GETROUTE_VISPOS_LOOPS; i++ )
+	{
+		AAS_ReachabilityFromNum( route[i], &reach );
 		if ( reach.areanum == destarea ) {
 			VectorCopy( travpos, retpos );
 			return qtrue;
@@ -4700,7 +6071,6 @@ qboolean AAS_GetRouteFirstVisPos( vec3_t srcpos, vec3_t destpos, int travelflags
 			return qtrue;
 		}
 		//
-		travarea = reach.areanum;
 		VectorCopy( reach.end, travpos );
 	}
 	//
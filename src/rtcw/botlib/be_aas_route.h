@@ -25,6 +25,16 @@ unsigned short int AAS_AreaTravelTime( int areanum, vec3_t start, vec3_t end );
 void AAS_CreateAllRoutingCache( void );
 //
 void AAS_RoutingInfo( void );
+//free the least recently used routing caches when there's too much routing cache
+void AAS_FreeOldestCaches( void );
+//load the precomputed routing tables, build them first when asked to
+void AAS_InitRoutingTables( void );
+//free the precomputed routing tables
+void AAS_FreeRoutingTables( void );
+//stop using the routing tables that route through the area when its flags changed
+void AAS_RoutingTablesAreaChanged( int areanum );
+//index the reversed links and scale the estimates of the goal directed routes
+void AAS_InitGoalDirectedRouting( void );
 #endif //AASINTERN
 
 //returns the travel flag for the given travel type
@@ -40,7 +50,17 @@ int AAS_RandomGoalArea( int areanum, int travelflags, int *goalareanum, vec3_t g
 //returns the travel time within the given area from start to end
 unsigned short int AAS_AreaTravelTime( int areanum, vec3_t start, vec3_t end );
 //returns the travel time from the area to the goal area using the given travel flags
+//NOTE: the routing queries may run on several threads at once as long as
+//      nothing else changes the AAS world meanwhile (frames, area flags)
 int AAS_AreaTravelTimeToGoalArea( int areanum, vec3_t origin, int goalareanum, int travelflags );
+//searches the route from the area to the goal area without routing cache, stores
+//the first reachabilities of the route and returns their total number, -1 if
+//there's no route
+int AAS_GoalDirectedRoute( int areanum, vec3_t origin, int goalareanum, int travelflags, int *traveltime, int *route, int maxroute );
+//returns the travel time of the goal directed route, 0 if there's no route
+int AAS_GoalDirectedTravelTime( int areanum, vec3_t origin, int goalareanum, int travelflags );
+//checks the goal directed routes against the routing cache or times both
+void AAS_TestGoalDirectedRoutes( int numqueries, int benchmark );
 
 #if defined RTCW_SP
 //returns the travel time from the area to the goal area using the given travel flags
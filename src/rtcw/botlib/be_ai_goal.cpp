@@ -1117,65 +1117,33 @@ int BotGetSecondGoal( int goalstate, bot_goal_t *goal ) {
 	return qtrue;
 } //end of the function BotGetSecondGoal
 //===========================================================================
-// pops a new long term goal on the goal stack in the goalstate
+// gathers the level items that may become a goal item, starting at *li
 //
-// Parameter:				-
-// Returns:					-
+// Parameter:			li				: first level item to check, the next one on return
+// Returns:				number of items gathered
 // Changes Globals:		-
 //===========================================================================
-int BotChooseLTGItem( int goalstate, vec3_t origin, int *inventory, int travelflags ) {
-	int areanum, t, weightnum;
-	float weight, bestweight, avoidtime;
+static int BotGoalItemCandidates( int goalstate, bot_goalstate_t *gs, levelitem_t **li,
+								  levelitem_t **items, int *weightnums, int maxitems ) {
+	int numitems, weightnum;
 	iteminfo_t *iteminfo;
-	itemconfig_t *ic;
-	levelitem_t *li, *bestitem;
-	bot_goal_t goal;
-	bot_goalstate_t *gs;
+	levelitem_t *item;
 
-	gs = BotGoalStateFromHandle( goalstate );
-	if ( !gs ) {
-		return qfalse;
-	}
-	if ( !gs->itemweightconfig ) {
-		return qfalse;
-	}
-	//get the area the bot is in
-	areanum = BotReachabilityArea( origin, gs->client );
-	//if the bot is in solid or if the area the bot is in has no reachability links
-	if ( !areanum || !AAS_AreaReachability( areanum ) ) {
-		//use the last valid area the bot was in
-		areanum = gs->lastreachabilityarea;
-	} //end if
-	  //remember the last area with reachabilities the bot was in
-	gs->lastreachabilityarea = areanum;
-	//if still in solid
-	if ( !areanum ) {
-		return qfalse;
-	}
-	//the item configuration
-	ic = itemconfig;
-	if ( !itemconfig ) {
-		return qfalse;
-	}
-	//best weight and item so far
-	bestweight = 0;
-	bestitem = NULL;
-	memset( &goal, 0, sizeof( bot_goal_t ) );
-	//go through the items in the level
-	for ( li = levelitems; li; li = li->next )
+	numitems = 0;
+	for ( item = *li; item && numitems < maxitems; item = item->next )
 	{
 
 #if !defined RTCW_ET
 		if ( g_gametype == GT_SINGLE_PLAYER ) {
-			if ( li->notsingle ) {
+			if ( item->notsingle ) {
 				continue;
 			}
 		} else if ( g_gametype >= GT_TEAM )     {
-			if ( li->notteam ) {
+			if ( item->notteam ) {
 				continue;
 			}
 		} else {
-			if ( li->notfree ) {
+			if ( item->notfree ) {
 				continue;
 			}
 		}
@@ -1184,61 +1152,124 @@ int BotChooseLTGItem( int goalstate, vec3_t origin, int *inventory, int travelfl
 // removed gametype, added single player
 		//if (g_gametype == GT_SINGLE_PLAYER) {
 		if ( g_singleplayer ) {
-			if ( li->notsingle ) {
+			if ( item->notsingle ) {
 				continue;
 			}
 		}
 		// Gordon: GT_TEAM no longer exists, switching for GT_WOLF
 /*		else
 		if (g_gametype >= GT_WOLF) {
-			if (li->notteam) continue;
+			if (item->notteam) continue;
 		}
 		else {
-			if (li->notfree) continue;
+			if (item->notfree) continue;
 		}*/
 // END	Arnout changes, 28-08-2002.
 #endif // RTCW_XX
 
 		//if the item is not in a possible goal area
-		if ( !li->goalareanum ) {
+		if ( !item->goalareanum ) {
 			continue;
 		}
 		//get the fuzzy weight function for this item
-		iteminfo = &ic->iteminfo[li->iteminfo];
+		iteminfo = &itemconfig->iteminfo[item->iteminfo];
 		weightnum = gs->itemweightindex[iteminfo->number];
 		if ( weightnum < 0 ) {
 			continue;
 		}
 		//if this goal is in the avoid goals
-		if ( BotAvoidGoalTime( goalstate, li->number ) > 0 ) {
+		if ( BotAvoidGoalTime( goalstate, item->number ) > 0 ) {
 			continue;
 		}
+		items[numitems] = item;
+		weightnums[numitems] = weightnum;
+		numitems++;
+	} //end for
+	*li = item;
+	return numitems;
+} //end of the function BotGoalItemCandidates
+//===========================================================================
+// pops a new long term goal on the goal stack in the goalstate
+//
+// Parameter:				-
+// Returns:					-
+// Changes Globals:		-
+//===========================================================================
+int BotChooseLTGItem( int goalstate, vec3_t origin, int *inventory, int travelflags ) {
+	int areanum, t, i, numitems;
+	int weightnums[MAX_WEIGHTS];
+	float weight, weights[MAX_WEIGHTS], bestweight, avoidtime;
+	iteminfo_t *iteminfo;
+	itemconfig_t *ic;
+	levelitem_t *li, *nextitem, *bestitem, *items[MAX_WEIGHTS];
+	bot_goal_t goal;
+	bot_goalstate_t *gs;
 
+	gs = BotGoalStateFromHandle( goalstate );
+	if ( !gs ) {
+		return qfalse;
+	}
+	if ( !gs->itemweightconfig ) {
+		return qfalse;
+	}
+	//get the area the bot is in
+	areanum = BotReachabilityArea( origin, gs->client );
+	//if the bot is in solid or if the area the bot is in has no reachability links
+	if ( !areanum || !AAS_AreaReachability( areanum ) ) {
+		//use the last valid area the bot was in
+		areanum = gs->lastreachabilityarea;
+	} //end if
+	  //remember the last area with reachabilities the bot was in
+	gs->lastreachabilityarea = areanum;
+	//if still in solid
+	if ( !areanum ) {
+		return qfalse;
+	}
+	//the item configuration
+	ic = itemconfig;
+	if ( !itemconfig ) {
+		return qfalse;
+	}
+	//best weight and item so far
+	bestweight = 0;
+	bestitem = NULL;
+	memset( &goal, 0, sizeof( bot_goal_t ) );
+	//go through the items in the level
+	nextitem = levelitems;
+	while ( nextitem )
+	{
+		numitems = BotGoalItemCandidates( goalstate, gs, &nextitem, items, weightnums, MAX_WEIGHTS );
+		//weigh the gathered items at once
 #ifdef UNDECIDEDFUZZY
-		weight = FuzzyWeightUndecided( inventory, gs->itemweightconfig, weightnum );
+		FuzzyWeightsUndecided( inventory, gs->itemweightconfig, weightnums, numitems, weights );
 #else
-		weight = FuzzyWeight( inventory, gs->itemweightconfig, weightnum );
+		FuzzyWeights( inventory, gs->itemweightconfig, weightnums, numitems, weights );
 #endif //UNDECIDEDFUZZY
+		for ( i = 0; i < numitems; i++ )
+		{
+			li = items[i];
+			weight = weights[i];
 #ifdef DROPPEDWEIGHT
-		//HACK: to make dropped items more attractive
-		if ( li->timeout ) {
-			weight += 1000;
-		}
+			//HACK: to make dropped items more attractive
+			if ( li->timeout ) {
+				weight += 1000;
+			}
 #endif //DROPPEDWEIGHT
-		if ( weight > 0 ) {
-			//get the travel time towards the goal area
-			t = AAS_AreaTravelTimeToGoalArea( areanum, origin, li->goalareanum, travelflags );
-			//if the goal is reachable
-			if ( t > 0 ) {
-				weight /= (float) t * TRAVELTIME_SCALE;
-				//
-				if ( weight > bestweight ) {
-					bestweight = weight;
-					bestitem = li;
+			if ( weight > 0 ) {
+				//get the travel time towards the goal area
+				t = AAS_AreaTravelTimeToGoalArea( areanum, origin, li->goalareanum, travelflags );
+				//if the goal is reachable
+				if ( t > 0 ) {
+					weight /= (float) t * TRAVELTIME_SCALE;
+					//
+					if ( weight > bestweight ) {
+						bestweight = weight;
+						bestitem = li;
+					} //end if
 				} //end if
 			} //end if
-		} //end if
-	} //end for
+		} //end for
+	} //end while
 	  //if no goal item found
 	if ( !bestitem ) {
 		/*
@@ -1305,11 +1336,12 @@ int BotChooseLTGItem( int goalstate, vec3_t origin, int *inventory, int travelfl
 //===========================================================================
 int BotChooseNBGItem( int goalstate, vec3_t origin, int *inventory, int travelflags,
 					  bot_goal_t *ltg, float maxtime ) {
-	int areanum, t, weightnum, ltg_time;
-	float weight, bestweight, avoidtime;
+	int areanum, t, i, numitems, ltg_time;
+	int weightnums[MAX_WEIGHTS];
+	float weight, weights[MAX_WEIGHTS], bestweight, avoidtime;
 	iteminfo_t *iteminfo;
 	itemconfig_t *ic;
-	levelitem_t *li, *bestitem;
+	levelitem_t *li, *nextitem, *bestitem, *items[MAX_WEIGHTS];
 	bot_goal_t goal;
 	bot_goalstate_t *gs;
 
@@ -1347,90 +1379,49 @@ int BotChooseNBGItem( int goalstate, vec3_t origin, int *inventory, int travelfl
 	bestitem = NULL;
 	memset( &goal, 0, sizeof( bot_goal_t ) );
 	//go through the items in the level
-	for ( li = levelitems; li; li = li->next )
+	nextitem = levelitems;
+	while ( nextitem )
 	{
-
-#if !defined RTCW_ET
-		if ( g_gametype == GT_SINGLE_PLAYER ) {
-			if ( li->notsingle ) {
-				continue;
-			}
-		} else if ( g_gametype >= GT_TEAM )     {
-			if ( li->notteam ) {
-				continue;
-			}
-		} else {
-			if ( li->notfree ) {
-				continue;
-			}
-		}
-#else
-// START	Arnout changes, 28-08-2002.
-// removed gametype, added single player
-		if ( g_singleplayer ) {
-			if ( li->notsingle ) {
-				continue;
-			}
-		}
-		// Gordon: GT_TEAM no longer exists, switching for GT_WOLF
-/*		else
-		if (g_gametype >= GT_WOLF) {
-			if (li->notteam) continue;
-		}
-		else {
-			if (li->notfree) continue;
-		}*/
-// END	Arnout changes, 28-08-2002.
-#endif // RTCW_XX
-
-		//if the item is in a possible goal area
-		if ( !li->goalareanum ) {
-			continue;
-		}
-		//get the fuzzy weight function for this item
-		iteminfo = &ic->iteminfo[li->iteminfo];
-		weightnum = gs->itemweightindex[iteminfo->number];
-		if ( weightnum < 0 ) {
-			continue;
-		}
-		//if this goal is in the avoid goals
-		if ( BotAvoidGoalTime( goalstate, li->number ) > 0 ) {
-			continue;
-		}
-		//
+		numitems = BotGoalItemCandidates( goalstate, gs, &nextitem, items, weightnums, MAX_WEIGHTS );
+		//weigh the gathered items at once
 #ifdef UNDECIDEDFUZZY
-		weight = FuzzyWeightUndecided( inventory, gs->itemweightconfig, weightnum );
+		FuzzyWeightsUndecided( inventory, gs->itemweightconfig, weightnums, numitems, weights );
 #else
-		weight = FuzzyWeight( inventory, gs->itemweightconfig, weightnum );
+		FuzzyWeights( inventory, gs->itemweightconfig, weightnums, numitems, weights );
 #endif //UNDECIDEDFUZZY
+		for ( i = 0; i < numitems; i++ )
+		{
+			li = items[i];
+			weight = weights[i];
 #ifdef DROPPEDWEIGHT
-		//HACK: to make dropped items more attractive
-		if ( li->timeout ) {
-			weight += 1000;
-		}
+			//HACK: to make dropped items more attractive
+			if ( li->timeout ) {
+				weight += 1000;
+			}
 #endif //DROPPEDWEIGHT
-		if ( weight > 0 ) {
-			//get the travel time towards the goal area
-			t = AAS_AreaTravelTimeToGoalArea( areanum, origin, li->goalareanum, travelflags );
-			//if the goal is reachable
-			if ( t > 0 && t < maxtime ) {
-				weight /= (float) t * TRAVELTIME_SCALE;
-				//
-				if ( weight > bestweight ) {
-					t = 0;
-					if ( ltg && !li->timeout ) {
-						//get the travel time from the goal to the long term goal
-						t = AAS_AreaTravelTimeToGoalArea( li->goalareanum, li->goalorigin, ltg->areanum, travelflags );
-					} //end if
-					  //if the travel back is possible and doesn't take too long
-					if ( t <= ltg_time ) {
-						bestweight = weight;
-						bestitem = li;
+			if ( weight > 0 ) {
+				//get the travel time towards the goal area
+				t = AAS_AreaTravelTimeToGoalArea( areanum, origin, li->goalareanum, travelflags );
+				//if the goal is reachable
+				if ( t > 0 && t < maxtime ) {
+					weight /= (float) t * TRAVELTIME_SCALE;
+					//
+					if ( weight > bestweight ) {
+						t = 0;
+						if ( ltg && !li->timeout ) {
+							//get the travel time from the goal to the long term goal
+							t = AAS_AreaTravelTimeToGoalArea( li->goalareanum, li->goalorigin, ltg->areanum, travelflags );
+						} //end if
+						  //if the travel back is possible and doesn't take too long
+						if ( t <= ltg_time ) {
+							bestweight = weight;
+							bestitem = li;
+						} //end if
 					} //end if
 				} //end if
 			} //end if
-		} //end if
-	} //end for
+		} //end for
+	} //end while
 	  //if no goal item found
 	if ( !bestitem ) {
 		return qfalse;
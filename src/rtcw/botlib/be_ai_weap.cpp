@@ -421,8 +421,9 @@ void BotGetWeaponInfo( int weaponstate, int weapon, weaponinfo_t *weaponinfo ) {
 // Changes Globals:		-
 //===========================================================================
 int BotChooseBestFightWeapon( int weaponstate, int *inventory ) {
-	int i, index, bestweapon;
-	float weight, bestweight;
+	int i, n, index, bestweapon, numweights;
+	int weapons[MAX_WEIGHTS], weightnums[MAX_WEIGHTS];
+	float weights[MAX_WEIGHTS], bestweight;
 	weaponconfig_t *wc;
 	bot_weaponstate_t *ws;
 
@@ -442,20 +443,31 @@ int BotChooseBestFightWeapon( int weaponstate, int *inventory ) {
 
 	bestweight = 0;
 	bestweapon = 0;
-	for ( i = 0; i < wc->numweapons; i++ )
+	for ( i = 0; i < wc->numweapons; )
 	{
-		if ( !wc->weaponinfo[i].valid ) {
-			continue;
-		}
-		index = ws->weaponweightindex[i];
-		if ( index < 0 ) {
-			continue;
-		}
-		weight = FuzzyWeight( inventory, ws->weaponweightconfig, index );
-		if ( weight > bestweight ) {
-			bestweight = weight;
-			bestweapon = i;
-		} //end if
+		//gather the weapons with a weight
+		for ( numweights = 0; i < wc->numweapons && numweights < MAX_WEIGHTS; i++ )
+		{
+			if ( !wc->weaponinfo[i].valid ) {
+				continue;
+			}
+			index = ws->weaponweightindex[i];
+			if ( index < 0 ) {
+				continue;
+			}
+			weapons[numweights] = i;
+			weightnums[numweights] = index;
+			numweights++;
+		} //end for
+		  //weigh them all at once
+		FuzzyWeights( inventory, ws->weaponweightconfig, weightnums, numweights, weights );
+		for ( n = 0; n < numweights; n++ )
+		{
+			if ( weights[n] > bestweight ) {
+				bestweight = weights[n];
+				bestweapon = weapons[n];
+			} //end if
+		} //end for
 	} //end for
 	return bestweapon;
 } //end of the function BotChooseBestFightWeapon
@@ -35,6 +35,11 @@ SPDX-License-Identifier: GPL-3.0
 #define MAX_WEIGHT_FILES            128
 weightconfig_t  *weightFileList[MAX_WEIGHT_FILES];
 
+//number of inventories the compiled fuzzy weights are verified with
+#define FUZZYTEST_ROUNDS            64
+
+static void CompileWeightConfig( weightconfig_t *config );
+
 //===========================================================================
 //
 // Parameter:				-
@@ -129,6 +134,18 @@ void FreeFuzzySeperators_r( fuzzyseperator_t *fs ) {
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
+static void FreeCompiledWeights( weightconfig_t *config ) {
+	if ( config->compiled ) {
+		FreeMemory( config->compiled );
+		config->compiled = NULL;
+	} //end if
+} //end of the function FreeCompiledWeights
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
 void FreeWeightConfig2( weightconfig_t *config ) {
 	int i;
 
@@ -139,6 +156,7 @@ void FreeWeightConfig2( weightconfig_t *config ) {
 			FreeMemory( config->weights[i].name );
 		}
 	} //end for
+	FreeCompiledWeights( config );
 	FreeMemory( config );
 } //end of the function FreeWeightConfig2
 //===========================================================================
@@ -404,6 +422,8 @@ weightconfig_t *ReadWeightConfig( char *filename ) {
 	} //end while
 	  //free the source at the end of a pass
 	FreeSource( source );
+	//compile the fuzzy weights for the evaluation
+	CompileWeightConfig( config );
 	//if the file was located in a pak file
 
 #if !defined RTCW_ET
@@ -653,45 +673,368 @@ float FuzzyWeight_r( int *inventory, fuzzyseperator_t *fs ) {
 	return fs->weight;
 } //end of the function FuzzyWeight_r
 //===========================================================================
+// random number between 0 and 1 for the undecided weights, taken from the
+// given seed or from the global random numbers when there's no seed
+//
+// Parameter:			seed		: NULL or the state of a local generator
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static float FuzzyRandom( unsigned int *seed ) {
+	if ( !seed ) {
+		return random();
+	}
+	*seed = *seed * 1103515245 + 12345;
+	return ( ( *seed >> 16 ) & 0x7fff ) / ( (float)0x7fff );
+} //end of the function FuzzyRandom
+//===========================================================================
 //
 // Parameter:				-
 // Returns:					-
 // Changes Globals:		-
 //===========================================================================
-float FuzzyWeightUndecided_r( int *inventory, fuzzyseperator_t *fs ) {
+float FuzzyWeightUndecided_r( int *inventory, fuzzyseperator_t *fs, unsigned int *seed ) {
 	float scale, w1, w2;
 
 	if ( inventory[fs->index] < fs->value ) {
 		if ( fs->child ) {
-			return FuzzyWeightUndecided_r( inventory, fs->child );
-		} else { return fs->minweight + random() * ( fs->maxweight - fs->minweight );}
+			return FuzzyWeightUndecided_r( inventory, fs->child, seed );
+		} else { return fs->minweight + FuzzyRandom( seed ) * ( fs->maxweight - fs->minweight );}
 	} //end if
 	else if ( fs->next ) {
 		if ( inventory[fs->index] < fs->next->value ) {
 			//first weight
 			if ( fs->child ) {
-				w1 = FuzzyWeightUndecided_r( inventory, fs->child );
-			} else { w1 = fs->minweight + random() * ( fs->maxweight - fs->minweight );}
+				w1 = FuzzyWeightUndecided_r( inventory, fs->child, seed );
+			} else { w1 = fs->minweight + FuzzyRandom( seed ) * ( fs->maxweight - fs->minweight );}
 			//second weight
 			if ( fs->next->child ) {
 				w2 = FuzzyWeight_r( inventory, fs->next->child );
-			} else { w2 = fs->next->minweight + random() * ( fs->next->maxweight - fs->next->minweight );}
+			} else { w2 = fs->next->minweight + FuzzyRandom( seed ) * ( fs->next->maxweight - fs->next->minweight );}
 			//the scale factor
 			scale = ( inventory[fs->index] - fs->value ) / ( fs->next->value - fs->value );
 			//scale between the two weights
 			return scale * w1 + ( 1 - scale ) * w2;
 		} //end if
-		return FuzzyWeightUndecided_r( inventory, fs->next );
+		return FuzzyWeightUndecided_r( inventory, fs->next, seed );
 	} //end else if
 	return fs->weight;
 } //end of the function FuzzyWeightUndecided_r
 //===========================================================================
+// counts the switches and cases of the fuzzy seperators
+//
+// Parameter:			-
+// Returns:				false if the cases of a switch use different indexes
+// Changes Globals:		-
+//===========================================================================
+static qboolean CountFuzzySeperators_r( fuzzyseperator_t *fs, int *numswitches, int *numcases ) {
+	fuzzyseperator_t *s;
+
+	( *numswitches )++;
+	for ( s = fs; s; s = s->next )
+	{
+		if ( s->index != fs->index ) {
+			return qfalse;
+		}
+		( *numcases )++;
+		if ( s->child && !CountFuzzySeperators_r( s->child, numswitches, numcases ) ) {
+			return qfalse;
+		}
+	} //end for
+	return qtrue;
+} //end of the function CountFuzzySeperators_r
+//===========================================================================
+// stores the fuzzy seperators as a switch with contiguous cases
+//
+// Parameter:			-
+// Returns:				number of the switch
+// Changes Globals:		-
+//===========================================================================
+static int CompileFuzzySeperators_r( fuzzyweights_t *fw, fuzzyseperator_t *fs ) {
+	int switchnum, casenum, numcases;
+	fuzzyseperator_t *s;
+
+	switchnum = fw->numswitches++;
+	for ( numcases = 0, s = fs; s; s = s->next )
+	{
+		numcases++;
+	} //end for
+	fw->switches[switchnum].index = fs->index;
+	fw->switches[switchnum].firstcase = fw->numcases;
+	fw->switches[switchnum].numcases = numcases;
+	//the cases of the child switches come after the cases of this switch
+	casenum = fw->numcases;
+	fw->numcases += numcases;
+	for ( s = fs; s; s = s->next, casenum++ )
+	{
+		fw->values[casenum] = s->value;
+		fw->weights[casenum] = s->weight;
+		fw->minweights[casenum] = s->minweight;
+		fw->maxweights[casenum] = s->maxweight;
+		if ( s->child ) {
+			fw->children[casenum] = CompileFuzzySeperators_r( fw, s->child );
+		} else {
+			fw->children[casenum] = -1;
+		}
+	} //end for
+	return switchnum;
+} //end of the function CompileFuzzySeperators_r
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static float FuzzySwitchWeight( const fuzzyweights_t *fw, const int *inventory, int switchnum );
+static float FuzzySwitchWeightUndecided( const fuzzyweights_t *fw, const int *inventory, int switchnum, unsigned int *seed );
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static float FuzzyCaseWeight( const fuzzyweights_t *fw, const int *inventory, int casenum ) {
+	if ( fw->children[casenum] >= 0 ) {
+		return FuzzySwitchWeight( fw, inventory, fw->children[casenum] );
+	}
+	return fw->weights[casenum];
+} //end of the function FuzzyCaseWeight
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static float FuzzyCaseWeightUndecided( const fuzzyweights_t *fw, const int *inventory, int casenum, unsigned int *seed ) {
+	if ( fw->children[casenum] >= 0 ) {
+		return FuzzySwitchWeightUndecided( fw, inventory, fw->children[casenum], seed );
+	}
+	return fw->minweights[casenum] + FuzzyRandom( seed ) * ( fw->maxweights[casenum] - fw->minweights[casenum] );
+} //end of the function FuzzyCaseWeightUndecided
+//===========================================================================
+// evaluates the switch the way FuzzyWeight_r walks the seperators
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static float FuzzySwitchWeight( const fuzzyweights_t *fw, const int *inventory, int switchnum ) {
+	int i, value, last;
+	const int *values;
+	const fuzzyswitch_t *sw;
+	float scale, w1, w2;
+
+	sw = &fw->switches[switchnum];
+	value = inventory[sw->index];
+	values = fw->values + sw->firstcase;
+	if ( value < values[0] ) {
+		return FuzzyCaseWeight( fw, inventory, sw->firstcase );
+	}
+	//find the first case the inventory value is below
+	last = sw->numcases - 1;
+	for ( i = 1; i <= last; i++ )
+	{
+		if ( value < values[i] ) {
+			break;
+		}
+	} //end for
+	if ( i > last ) {
+		return fw->weights[sw->firstcase + last];
+	}
+	//first weight
+	w1 = FuzzyCaseWeight( fw, inventory, sw->firstcase + i - 1 );
+	//second weight
+	w2 = FuzzyCaseWeight( fw, inventory, sw->firstcase + i );
+	//the scale factor
+	scale = ( value - values[i - 1] ) / ( values[i] - values[i - 1] );
+	//scale between the two weights
+	return scale * w1 + ( 1 - scale ) * w2;
+} //end of the function FuzzySwitchWeight
+//===========================================================================
+// evaluates the switch the way FuzzyWeightUndecided_r walks the seperators
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static float FuzzySwitchWeightUndecided( const fuzzyweights_t *fw, const int *inventory, int switchnum, unsigned int *seed ) {
+	int i, value, last, casenum;
+	const int *values;
+	const fuzzyswitch_t *sw;
+	float scale, w1, w2;
+
+	sw = &fw->switches[switchnum];
+	value = inventory[sw->index];
+	values = fw->values + sw->firstcase;
+	if ( value < values[0] ) {
+		return FuzzyCaseWeightUndecided( fw, inventory, sw->firstcase, seed );
+	}
+	//find the first case the inventory value is below
+	last = sw->numcases - 1;
+	for ( i = 1; i <= last; i++ )
+	{
+		if ( value < values[i] ) {
+			break;
+		}
+	} //end for
+	if ( i > last ) {
+		return fw->weights[sw->firstcase + last];
+	}
+	//first weight
+	w1 = FuzzyCaseWeightUndecided( fw, inventory, sw->firstcase + i - 1, seed );
+	//second weight, a child switch is decided like FuzzyWeightUndecided_r does
+	casenum = sw->firstcase + i;
+	if ( fw->children[casenum] >= 0 ) {
+		w2 = FuzzySwitchWeight( fw, inventory, fw->children[casenum] );
+	} else {
+		w2 = fw->minweights[casenum] + FuzzyRandom( seed ) * ( fw->maxweights[casenum] - fw->minweights[casenum] );
+	}
+	//the scale factor
+	scale = ( value - values[i - 1] ) / ( values[i] - values[i - 1] );
+	//scale between the two weights
+	return scale * w1 + ( 1 - scale ) * w2;
+} //end of the function FuzzySwitchWeightUndecided
+//===========================================================================
+// returns a random inventory value close to one of the case values
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static int FuzzyTestInventoryValue( const fuzzyweights_t *fw, unsigned int *seed ) {
+	*seed = *seed * 1103515245 + 12345;
+	if ( !( ( *seed >> 8 ) & 7 ) ) {
+		return 0;
+	}
+	return fw->values[( *seed >> 11 ) % fw->numcases] + (int) ( ( *seed >> 4 ) % 3 ) - 1;
+} //end of the function FuzzyTestInventoryValue
+//===========================================================================
+// compares the compiled fuzzy weights bit for bit with the seperator trees
+// for inventories around the case values
+//
+// Parameter:			-
+// Returns:				true if all the weights are the same
+// Changes Globals:		-
+//===========================================================================
+static qboolean VerifyCompiledWeights( weightconfig_t *config ) {
+	int i, j, round, maxindex, *inventory;
+	unsigned int seed, randseed1, randseed2;
+	float w1, w2;
+	qboolean same;
+	fuzzyweights_t *fw;
+
+	fw = config->compiled;
+	maxindex = 0;
+	for ( i = 0; i < fw->numswitches; i++ )
+	{
+		if ( fw->switches[i].index > maxindex ) {
+			maxindex = fw->switches[i].index;
+		}
+	} //end for
+	inventory = (int *) GetClearedMemory( ( maxindex + 1 ) * sizeof( int ) );
+	seed = 1;
+	same = qtrue;
+	for ( round = 0; round < FUZZYTEST_ROUNDS && same; round++ )
+	{
+		for ( j = 0; j <= maxindex; j++ )
+		{
+			inventory[j] = FuzzyTestInventoryValue( fw, &seed );
+		} //end for
+		for ( i = 0; i < config->numweights && same; i++ )
+		{
+			if ( fw->firstswitch[i] < 0 ) {
+				continue;
+			}
+			w1 = FuzzyWeight_r( inventory, config->weights[i].firstseperator );
+			w2 = FuzzySwitchWeight( fw, inventory, fw->firstswitch[i] );
+			if ( memcmp( &w1, &w2, sizeof( float ) ) ) {
+				same = qfalse;
+			}
+			//the undecided weights are compared with the same random numbers
+			randseed1 = randseed2 = round * MAX_WEIGHTS + i;
+			w1 = FuzzyWeightUndecided_r( inventory, config->weights[i].firstseperator, &randseed1 );
+			w2 = FuzzySwitchWeightUndecided( fw, inventory, fw->firstswitch[i], &randseed2 );
+			if ( memcmp( &w1, &w2, sizeof( float ) ) ) {
+				same = qfalse;
+			}
+			if ( !same ) {
+				botimport.Print( PRT_ERROR, "%s: compiled fuzzy weight \"%s\" differs from the seperators\n",
+								 config->filename, config->weights[i].name );
+			} //end if
+		} //end for
+	} //end for
+	FreeMemory( inventory );
+	return same;
+} //end of the function VerifyCompiledWeights
+//===========================================================================
+// compiles the fuzzy seperators of all the weights into flat arrays, the
+// seperators are used instead when they can't be compiled
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void CompileWeightConfig( weightconfig_t *config ) {
+	int i, numswitches, numcases;
+	char *ptr;
+	fuzzyweights_t *fw;
+
+	FreeCompiledWeights( config );
+	//
+	numswitches = numcases = 0;
+	for ( i = 0; i < config->numweights; i++ )
+	{
+		if ( config->weights[i].firstseperator &&
+			 !CountFuzzySeperators_r( config->weights[i].firstseperator, &numswitches, &numcases ) ) {
+			return;
+		} //end if
+	} //end for
+	if ( !numcases ) {
+		return;
+	}
+	//
+	ptr = (char *) GetClearedMemory( sizeof( fuzzyweights_t ) + numswitches * sizeof( fuzzyswitch_t ) +
+									 numcases * ( 2 * sizeof( int ) + 3 * sizeof( float ) ) );
+	fw = (fuzzyweights_t *) ptr;
+	ptr += sizeof( fuzzyweights_t );
+	fw->switches = (fuzzyswitch_t *) ptr;
+	ptr += numswitches * sizeof( fuzzyswitch_t );
+	fw->values = (int *) ptr;
+	ptr += numcases * sizeof( int );
+	fw->children = (int *) ptr;
+	ptr += numcases * sizeof( int );
+	fw->weights = (float *) ptr;
+	ptr += numcases * sizeof( float );
+	fw->minweights = (float *) ptr;
+	ptr += numcases * sizeof( float );
+	fw->maxweights = (float *) ptr;
+	//
+	for ( i = 0; i < MAX_WEIGHTS; i++ )
+	{
+		fw->firstswitch[i] = -1;
+		if ( i < config->numweights && config->weights[i].firstseperator ) {
+			fw->firstswitch[i] = CompileFuzzySeperators_r( fw, config->weights[i].firstseperator );
+		} //end if
+	} //end for
+	config->compiled = fw;
+	//
+	if ( !VerifyCompiledWeights( config ) ) {
+		FreeCompiledWeights( config );
+	} //end if
+} //end of the function CompileWeightConfig
+//===========================================================================
 //
 // Parameter:				-
 // Returns:					-
 // Changes Globals:		-
 //===========================================================================
 float FuzzyWeight( int *inventory, weightconfig_t *wc, int weightnum ) {
+	if ( wc->compiled ) {
+		if ( wc->compiled->firstswitch[weightnum] < 0 ) {
+			return 0;
+		}
+		return FuzzySwitchWeight( wc->compiled, inventory, wc->compiled->firstswitch[weightnum] );
+	} //end if
 #ifdef EVALUATERECURSIVELY
 	return FuzzyWeight_r( inventory, wc->weights[weightnum].firstseperator );
 #else
@@ -725,8 +1068,14 @@ float FuzzyWeight( int *inventory, weightconfig_t *wc, int weightnum ) {
 // Changes Globals:		-
 //===========================================================================
 float FuzzyWeightUndecided( int *inventory, weightconfig_t *wc, int weightnum ) {
+	if ( wc->compiled ) {
+		if ( wc->compiled->firstswitch[weightnum] < 0 ) {
+			return 0;
+		}
+		return FuzzySwitchWeightUndecided( wc->compiled, inventory, wc->compiled->firstswitch[weightnum], NULL );
+	} //end if
 #ifdef EVALUATERECURSIVELY
-	return FuzzyWeightUndecided_r( inventory, wc->weights[weightnum].firstseperator );
+	return FuzzyWeightUndecided_r( inventory, wc->weights[weightnum].firstseperator, NULL );
 #else
 	fuzzyseperator_t *s;
 
@@ -752,6 +1101,63 @@ float FuzzyWeightUndecided( int *inventory, weightconfig_t *wc, int weightnum )
 #endif
 } //end of the function FuzzyWeightUndecided
 //===========================================================================
+// evaluates the given weights one after the other with the same compiled
+// arrays, the undecided weights draw their random numbers in that order
+//
+// Parameter:			weightnums		: weights to evaluate
+//						weights			: the fuzzy weight of every one of them
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void FuzzyWeights( int *inventory, weightconfig_t *wc, int *weightnums, int numweights, float *weights ) {
+	int i;
+	const fuzzyweights_t *fw;
+
+	fw = wc->compiled;
+	if ( !fw ) {
+		for ( i = 0; i < numweights; i++ )
+		{
+			weights[i] = FuzzyWeight( inventory, wc, weightnums[i] );
+		} //end for
+		return;
+	} //end if
+	for ( i = 0; i < numweights; i++ )
+	{
+		if ( fw->firstswitch[weightnums[i]] < 0 ) {
+			weights[i] = 0;
+		} else {
+			weights[i] = FuzzySwitchWeight( fw, inventory, fw->firstswitch[weightnums[i]] );
+		}
+	} //end for
+} //end of the function FuzzyWeights
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void FuzzyWeightsUndecided( int *inventory, weightconfig_t *wc, int *weightnums, int numweights, float *weights ) {
+	int i;
+	const fuzzyweights_t *fw;
+
+	fw = wc->compiled;
+	if ( !fw ) {
+		for ( i = 0; i < numweights; i++ )
+		{
+			weights[i] = FuzzyWeightUndecided( inventory, wc, weightnums[i] );
+		} //end for
+		return;
+	} //end if
+	for ( i = 0; i < numweights; i++ )
+	{
+		if ( fw->firstswitch[weightnums[i]] < 0 ) {
+			weights[i] = 0;
+		} else {
+			weights[i] = FuzzySwitchWeightUndecided( fw, inventory, fw->firstswitch[weightnums[i]], NULL );
+		}
+	} //end for
+} //end of the function FuzzyWeightsUndecided
+//===========================================================================
 //
 // Parameter:				-
 // Returns:					-
@@ -790,6 +1196,7 @@ void EvolveWeightConfig( weightconfig_t *config ) {
 	{
 		EvolveFuzzySeperator_r( config->weights[i].firstseperator );
 	} //end for
+	CompileWeightConfig( config );
 } //end of the function EvolveWeightConfig
 //===========================================================================
 //
@@ -836,6 +1243,7 @@ void ScaleWeight( weightconfig_t *config, char *name, float scale ) {
 			break;
 		} //end if
 	} //end for
+	CompileWeightConfig( config );
 } //end of the function ScaleWeight
 //===========================================================================
 //
@@ -878,6 +1286,7 @@ void ScaleFuzzyBalanceRange( weightconfig_t *config, float scale ) {
 	{
 		ScaleFuzzySeperatorBalanceRange_r( config->weights[i].firstseperator, scale );
 	} //end for
+	CompileWeightConfig( config );
 } //end of the function ScaleFuzzyBalanceRange
 //===========================================================================
 //
@@ -942,6 +1351,7 @@ void InterbreedWeightConfigs( weightconfig_t *config1, weightconfig_t *config2,
 									config2->weights[i].firstseperator,
 									configout->weights[i].firstseperator );
 	} //end for
+	CompileWeightConfig( configout );
 } //end of the function InterbreedWeightConfigs
 //===========================================================================
 //
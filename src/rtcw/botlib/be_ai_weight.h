@@ -37,12 +37,35 @@ typedef struct weight_s
 	struct fuzzyseperator_s *firstseperator;
 } weight_t;
 
+//switch of the compiled fuzzy weights
+typedef struct fuzzyswitch_s
+{
+	int index;                                  //inventory index
+	int firstcase;                              //first case of the switch
+	int numcases;                               //number of cases of the switch
+} fuzzyswitch_t;
+
+//fuzzy weights compiled into flat arrays, the cases of every switch are contiguous
+typedef struct fuzzyweights_s
+{
+	int numswitches;
+	fuzzyswitch_t *switches;
+	int numcases;
+	int *values;                                //inventory value of every case
+	int *children;                              //switch of every case, -1 to return the weight
+	float *weights;
+	float *minweights;
+	float *maxweights;
+	int firstswitch[MAX_WEIGHTS];               //switch of every weight, -1 if none
+} fuzzyweights_t;
+
 //weight configuration
 typedef struct weightconfig_s
 {
 	int numweights;
 	weight_t weights[MAX_WEIGHTS];
 	char filename[MAX_QPATH];
+	fuzzyweights_t *compiled;                   //compiled fuzzy weights
 } weightconfig_t;
 
 //reads a weight configuration
@@ -56,6 +79,9 @@ int FindFuzzyWeight( weightconfig_t *wc, char *name );
 //returns the fuzzy weight for the given inventory and weight
 float FuzzyWeight( int *inventory, weightconfig_t *wc, int weightnum );
 float FuzzyWeightUndecided( int *inventory, weightconfig_t *wc, int weightnum );
+//returns the fuzzy weights of the given weights for the given inventory in one pass
+void FuzzyWeights( int *inventory, weightconfig_t *wc, int *weightnums, int numweights, float *weights );
+void FuzzyWeightsUndecided( int *inventory, weightconfig_t *wc, int *weightnums, int numweights, float *weights );
 //scales the weight with the given name
 void ScaleWeight( weightconfig_t *config, char *name, float scale );
 //scale the balance range
@@ -1072,6 +1072,7 @@ static void Init_AAS_Export( aas_export_t *aas ) {
 	// be_aas_route.c
 	//--------------------------------------------
 	aas->AAS_AreaTravelTimeToGoalArea = AAS_AreaTravelTimeToGoalArea;
+	aas->AAS_TestGoalDirectedRoutes = AAS_TestGoalDirectedRoutes;
 	//--------------------------------------------
 	// be_aas_move.c
 	//--------------------------------------------
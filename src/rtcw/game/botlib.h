@@ -227,6 +227,11 @@ typedef struct botlib_import_s
 	int ( *FS_Write )( const void *buffer, int len, fileHandle_t f );
 	void ( *FS_FCloseFile )( fileHandle_t f );
 	int ( *FS_Seek )( fileHandle_t f, int32_t offset, int origin );
+	//read-only mapping of a loose file, NULL if the file can't be mapped
+	const void  *( *FS_MapFile )( const char *qpath, int *length, void **mapping );
+	void ( *FS_UnmapFile )( void *mapping );
+	//calls func( data, index ) for every index in [0, count) on the worker threads
+	void ( *RunJobs )( void ( *func )( void *data, int index ), void *data, int count );
 	//debug visualisation stuff
 	int ( *DebugLineCreate )( void );
 	void ( *DebugLineDelete )( int line );
@@ -316,6 +321,7 @@ typedef struct aas_export_s
 	// be_aas_route.c
 	//--------------------------------------------
 	int ( *AAS_AreaTravelTimeToGoalArea )( int areanum, vec3_t origin, int goalareanum, int travelflags );
+	void ( *AAS_TestGoalDirectedRoutes )( int numqueries, int benchmark );
 	//--------------------------------------------
 	// be_aas_move.c
 	//--------------------------------------------
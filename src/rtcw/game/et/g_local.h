@@ -1814,6 +1814,7 @@ int     trap_FS_GetFileList( const char *path, const char *extension, char *list
 void    trap_SendConsoleCommand( int exec_when, const char *text );
 void    trap_Cvar_Register( vmCvar_t *cvar, const char *var_name, const char *value, int flags );
 void    trap_Cvar_Update( vmCvar_t *cvar );
+int     trap_Cvar_ModificationCount( void );
 void    trap_Cvar_Set( const char *var_name, const char *value );
 int     trap_Cvar_VariableIntegerValue( const char *var_name );
 float   trap_Cvar_VariableValue( const char *var_name );
@@ -1832,6 +1833,7 @@ void    trap_Trace( trace_t *results, const vec3_t start, const vec3_t mins, con
 void    trap_TraceCapsule( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask );
 void    trap_TraceCapsuleNoEnts( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask );
 void    trap_TraceNoEnts( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask );
+void    trap_TraceBatch( trace_t *results, const traceRay_t *rays, int numRays, const vec3_t mins, const vec3_t maxs, int passEntityNum, int contentmask );
 int     trap_PointContents( const vec3_t point, int passEntityNum );
 qboolean trap_InPVS( const vec3_t p1, const vec3_t p2 );
 qboolean trap_InPVSIgnorePortals( const vec3_t p1, const vec3_t p2 );
@@ -149,6 +149,10 @@ void    trap_Cvar_Update( vmCvar_t *cvar ) {
 	);
 }
 
+int     trap_Cvar_ModificationCount( void ) {
+	return syscall(G_CVAR_MODIFICATION_COUNT);
+}
+
 void trap_Cvar_Set( const char *var_name, const char *value ) {
 	syscall(
 		G_CVAR_SET,
@@ -320,6 +324,19 @@ void trap_TraceCapsuleNoEnts( trace_t *results, const vec3_t start, const vec3_t
 	);
 }
 
+void trap_TraceBatch( trace_t *results, const traceRay_t *rays, int numRays, const vec3_t mins, const vec3_t maxs, int passEntityNum, int contentmask ) {
+	syscall(
+		G_TRACEBATCH,
+		rtcw::to_vm_arg(results),
+		rtcw::to_vm_arg(rays),
+		rtcw::to_vm_arg(numRays),
+		rtcw::to_vm_arg(mins),
+		rtcw::to_vm_arg(maxs),
+		rtcw::to_vm_arg(passEntityNum),
+		rtcw::to_vm_arg(contentmask)
+	);
+}
+
 int trap_PointContents( const vec3_t point, int passEntityNum ) {
 	return syscall(
 		G_POINT_CONTENTS,
@@ -288,6 +288,9 @@ typedef enum {
 
 	G_REGISTERSOUND,    // xkan, 10/28/2002 - register the sound
 	G_GET_SOUND_LENGTH, // xkan, 10/28/2002 - get the length of the sound
+
+	G_TRACEBATCH,   // ( trace_t *results, const traceRay_t *rays, int numRays, const vec3_t mins, const vec3_t maxs, int passEntityNum, int contentmask );
+	// several traces of the same volume against all linked entities
 #endif // RTCW_XX
 
 	BOTLIB_SETUP = 200,             // ( void );
@@ -513,9 +516,7 @@ typedef enum {
 #if defined RTCW_SP
 	BOTLIB_PC_SOURCE_FILE_AND_LINE,
 
-	G_FS_COPY_FILE  //DAJ
-#elif defined RTCW_MP
-	BOTLIB_PC_SOURCE_FILE_AND_LINE
+	G_FS_COPY_FILE, //DAJ
 #else
 	BOTLIB_PC_SOURCE_FILE_AND_LINE,
 #endif // RTCW_XX
@@ -531,6 +532,10 @@ typedef enum {
 	// -zinx
 #endif // RTCW_XX
 
+	G_CVAR_MODIFICATION_COUNT,  // ( void );
+	// changes whenever any cvar does, so the cvar table only
+	// needs to be walked when it's different from the last time
+
 } gameImport_t;
 
 
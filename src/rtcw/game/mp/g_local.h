@@ -1218,6 +1218,7 @@ int     trap_FS_GetFileList( const char *path, const char *extension, char *list
 void    trap_SendConsoleCommand( int exec_when, const char *text );
 void    trap_Cvar_Register( vmCvar_t *cvar, const char *var_name, const char *value, int flags );
 void    trap_Cvar_Update( vmCvar_t *cvar );
+int     trap_Cvar_ModificationCount( void );
 void    trap_Cvar_Set( const char *var_name, const char *value );
 int     trap_Cvar_VariableIntegerValue( const char *var_name );
 float   trap_Cvar_VariableValue( const char *var_name );
@@ -141,6 +141,10 @@ void    trap_Cvar_Update( vmCvar_t *cvar ) {
 	);
 }
 
+int     trap_Cvar_ModificationCount( void ) {
+	return syscall(G_CVAR_MODIFICATION_COUNT);
+}
+
 void trap_Cvar_Set( const char *var_name, const char *value ) {
 	syscall(
 		G_CVAR_SET,
@@ -1144,7 +1144,6 @@ typedef struct cvar_s {
 	float value;                    // atof( string )
 	int integer;                    // atoi( string )
 	struct cvar_s *next;
-	struct cvar_s *hashNext;
 } cvar_t;
 
 #define MAX_CVAR_VALUE_STRING   256
@@ -1221,6 +1220,12 @@ typedef struct {
 	int entityNum;          // entity the contacted sirface is a part of
 } trace_t;
 
+// one move of a batched trace, all of them share the size and content mask
+typedef struct {
+	vec3_t start;
+	vec3_t end;
+} traceRay_t;
+
 // trace->entityNum can also be 0 to (MAX_GENTITIES-1)
 // or ENTITYNUM_NONE, ENTITYNUM_WORLD
 
@@ -1002,10 +1002,18 @@ G_UpdateCvars
 =================
 */
 void G_UpdateCvars( void ) {
+	static int modificationCount = -1;
 	int i;
 	cvarTable_t *cv;
 	qboolean remapped = qfalse;
 
+	// nothing to do if no cvar changed since the last pass
+	i = trap_Cvar_ModificationCount();
+	if ( i == modificationCount ) {
+		return;
+	}
+	modificationCount = i;
+
 	for ( i = 0, cv = gameCvarTable ; i < gameCvarTableSize ; i++, cv++ ) {
 		if ( cv->vmCvar ) {
 			trap_Cvar_Update( cv->vmCvar );
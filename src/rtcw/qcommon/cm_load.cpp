@@ -59,6 +59,7 @@ cvar_t      *cm_playerCurveClip;
 cvar_t      *cm_optimize;
 #endif // RTCW_XX
 
+cvar_t      *cm_broadphase;
 #endif
 
 cmodel_t box_model;
@@ -268,6 +269,48 @@ void CMod_LoadBrushes( lump_t *l ) {
 
 }
 
+/*
+=================
+CMod_SetupLeafBrushBounds
+
+Copies the bounds and contents of the leaf brushes into arrays, so a
+trace can reject several brushes of a leaf at once. The arrays are
+padded for reading four entries past the end, with bounds and contents
+that never pass.
+=================
+*/
+void CMod_SetupLeafBrushBounds( void ) {
+	int i, j;
+	int count;
+	cbrush_t    *brush;
+
+	count = cm.numLeafBrushes + 3;
+
+	for ( j = 0 ; j < 6 ; j++ ) {
+		cm.leafBrushBounds[j] = static_cast<float*> (Hunk_Alloc( count * sizeof( float ), h_high ));
+	}
+	cm.leafBrushContents = static_cast<int*> (Hunk_Alloc( count * sizeof( int ), h_high ));
+
+	for ( i = 0 ; i < count ; i++ ) {
+		if ( i >= cm.numLeafBrushes ) {
+			for ( j = 0 ; j < 3 ; j++ ) {
+				cm.leafBrushBounds[j][i] = 1.0e30f;
+				cm.leafBrushBounds[3 + j][i] = -1.0e30f;
+			}
+			cm.leafBrushContents[i] = 0;
+			continue;
+		}
+
+		brush = &cm.brushes[cm.leafbrushes[i]];
+
+		for ( j = 0 ; j < 3 ; j++ ) {
+			cm.leafBrushBounds[j][i] = brush->bounds[0][j];
+			cm.leafBrushBounds[3 + j][i] = brush->bounds[1][j];
+		}
+		cm.leafBrushContents[i] = brush->numsides ? brush->contents : 0;
+	}
+}
+
 /*
 =================
 CMod_LoadLeafs
@@ -646,6 +689,7 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	cm_optimize = Cvar_Get( "cm_optimize", "1", CVAR_CHEAT );
 #endif // RTCW_XX
 
+	cm_broadphase = Cvar_Get( "cm_broadphase", "1", CVAR_CHEAT );
 #endif
 	Com_DPrintf( "CM_LoadMap( %s, %i )\n", name, clientload );
 
@@ -711,6 +755,7 @@ void CM_LoadMap( const char *name, qboolean clientload, int *checksum ) {
 	CMod_LoadPlanes( &header.lumps[LUMP_PLANES] );
 	CMod_LoadBrushSides( &header.lumps[LUMP_BRUSHSIDES] );
 	CMod_LoadBrushes( &header.lumps[LUMP_BRUSHES] );
+	CMod_SetupLeafBrushBounds();
 	CMod_LoadSubmodels( &header.lumps[LUMP_MODELS] );
 	CMod_LoadNodes( &header.lumps[LUMP_NODES] );
 	CMod_LoadEntityString( &header.lumps[LUMP_ENTITIES] );
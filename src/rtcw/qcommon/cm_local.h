@@ -94,6 +94,8 @@ typedef struct {
 
 	int numLeafBrushes;
 	int         *leafbrushes;
+	float       *leafBrushBounds[6];    // bounds of the brush of each leafbrushes entry, mins xyz then maxs xyz
+	int         *leafBrushContents;     // contents of the brush of each leafbrushes entry
 
 	int numLeafSurfaces;
 	int         *leafsurfaces;
@@ -138,6 +140,7 @@ extern cvar_t      *cm_playerCurveClip;
 #if defined RTCW_ET
 extern cvar_t      *cm_optimize;
 #endif // RTCW_XX
+extern cvar_t      *cm_broadphase;
 
 // cm_test.c
 
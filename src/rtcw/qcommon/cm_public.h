@@ -36,6 +36,9 @@ int         CM_TransformedPointContents( const vec3_t p, clipHandle_t model, con
 void        CM_BoxTrace( trace_t *results, const vec3_t start, const vec3_t end,
 						 const vec3_t mins, const vec3_t maxs,
 						 clipHandle_t model, int brushmask, int capsule );
+void        CM_TraceBatch( trace_t *results, const traceRay_t *rays, int numRays,
+						   const vec3_t mins, const vec3_t maxs,
+						   clipHandle_t model, int brushmask, int capsule );
 void        CM_TransformedBoxTrace( trace_t *results, const vec3_t start, const vec3_t end,
 									const vec3_t mins, const vec3_t maxs,
 									clipHandle_t model, int brushmask,
@@ -58,6 +61,9 @@ qboolean    CM_AreasConnected( int area1, int area2 );
 
 int         CM_WriteAreaBits( byte *buffer, int area );
 
+void        CM_TraceRecord_f( void );
+void        CM_TraceReplay_f( void );
+
 // cm_tag.c
 int         CM_LerpTag( orientation_t *tag, const refEntity_t *refent, const char *tagName, int startIndex );
 
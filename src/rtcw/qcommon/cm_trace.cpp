@@ -11,6 +11,14 @@ SPDX-License-Identifier: GPL-3.0
 #include "cm_patch.h"
 #endif // RTCW_XX
 
+#if defined __SSE2__ || defined _M_X64 || ( defined _M_IX86_FP && _M_IX86_FP >= 2 )
+#define CM_SSE2
+#include <emmintrin.h>
+#elif defined __ARM_NEON
+#define CM_NEON
+#include <arm_neon.h>
+#endif
+
 // always use bbox vs. bbox collision and never capsule vs. bbox or vice versa
 
 #if !defined RTCW_MP
@@ -815,6 +823,102 @@ static void CM_TraceThroughBrush( traceWork_t *tw, cbrush_t *brush ) {
 	}
 }
 
+/*
+================
+CM_LeafBrushBroadphase
+
+Returns qtrue if the brushes of the leaf can be rejected through
+the bounds arrays of CMod_SetupLeafBrushBounds. The leafs of inline
+models and the box model keep their brush lists elsewhere.
+================
+*/
+static qboolean CM_LeafBrushBroadphase( const cLeaf_t *leaf ) {
+#ifndef BSPC
+	if ( !cm_broadphase->integer ) {
+		return qfalse;
+	}
+#endif
+
+	return (qboolean)( cm.leafBrushContents && leaf->firstLeafBrush >= 0 &&
+					   leaf->firstLeafBrush + leaf->numLeafBrushes <= cm.numLeafBrushes );
+}
+
+/*
+================
+CM_LeafBrushMask
+
+Returns a bit for each of the four leaf brushes starting at first
+that the trace may touch, going by their bounds and contents.
+The trace bounds are expanded by an epsilon like CM_CalcTraceBounds
+does, so a brush is only rejected if CM_TraceThroughBrush couldn't
+clip against it.
+================
+*/
+static int CM_LeafBrushMask( const traceWork_t *tw, int first ) {
+	const float *mins[3], *maxs[3];
+	const int *contents;
+	int i;
+
+	for ( i = 0 ; i < 3 ; i++ ) {
+		mins[i] = &cm.leafBrushBounds[i][first];
+		maxs[i] = &cm.leafBrushBounds[3 + i][first];
+	}
+	contents = &cm.leafBrushContents[first];
+
+#if defined CM_SSE2
+	{
+		__m128 in;
+		__m128i hit;
+
+		in = _mm_and_ps( _mm_cmple_ps( _mm_loadu_ps( mins[0] ), _mm_set1_ps( tw->bounds[1][0] + 1.0f ) ),
+						 _mm_cmpge_ps( _mm_loadu_ps( maxs[0] ), _mm_set1_ps( tw->bounds[0][0] - 1.0f ) ) );
+		in = _mm_and_ps( in, _mm_cmple_ps( _mm_loadu_ps( mins[1] ), _mm_set1_ps( tw->bounds[1][1] + 1.0f ) ) );
+		in = _mm_and_ps( in, _mm_cmpge_ps( _mm_loadu_ps( maxs[1] ), _mm_set1_ps( tw->bounds[0][1] - 1.0f ) ) );
+		in = _mm_and_ps( in, _mm_cmple_ps( _mm_loadu_ps( mins[2] ), _mm_set1_ps( tw->bounds[1][2] + 1.0f ) ) );
+		in = _mm_and_ps( in, _mm_cmpge_ps( _mm_loadu_ps( maxs[2] ), _mm_set1_ps( tw->bounds[0][2] - 1.0f ) ) );
+
+		hit = _mm_and_si128( _mm_loadu_si128( (const __m128i *)contents ), _mm_set1_epi32( tw->contents ) );
+		hit = _mm_cmpeq_epi32( hit, _mm_setzero_si128() );
+
+		return _mm_movemask_ps( _mm_andnot_ps( _mm_castsi128_ps( hit ), in ) );
+	}
+#elif defined CM_NEON
+	{
+		uint32x4_t in;
+
+		in = vandq_u32( vcleq_f32( vld1q_f32( mins[0] ), vdupq_n_f32( tw->bounds[1][0] + 1.0f ) ),
+						vcgeq_f32( vld1q_f32( maxs[0] ), vdupq_n_f32( tw->bounds[0][0] - 1.0f ) ) );
+		in = vandq_u32( in, vcleq_f32( vld1q_f32( mins[1] ), vdupq_n_f32( tw->bounds[1][1] + 1.0f ) ) );
+		in = vandq_u32( in, vcgeq_f32( vld1q_f32( maxs[1] ), vdupq_n_f32( tw->bounds[0][1] - 1.0f ) ) );
+		in = vandq_u32( in, vcleq_f32( vld1q_f32( mins[2] ), vdupq_n_f32( tw->bounds[1][2] + 1.0f ) ) );
+		in = vandq_u32( in, vcgeq_f32( vld1q_f32( maxs[2] ), vdupq_n_f32( tw->bounds[0][2] - 1.0f ) ) );
+		in = vandq_u32( in, vtstq_u32( vld1q_u32( (const uint32_t *)contents ), vdupq_n_u32( tw->contents ) ) );
+
+		return ( vgetq_lane_u32( in, 0 ) & 1 ) | ( vgetq_lane_u32( in, 1 ) & 2 ) |
+			   ( vgetq_lane_u32( in, 2 ) & 4 ) | ( vgetq_lane_u32( in, 3 ) & 8 );
+	}
+#else
+	{
+		int mask;
+
+		mask = 0;
+		for ( i = 0 ; i < 4 ; i++ ) {
+			if ( !( contents[i] & tw->contents ) ) {
+				continue;
+			}
+			if ( mins[0][i] > tw->bounds[1][0] + 1.0f || maxs[0][i] < tw->bounds[0][0] - 1.0f
+				 || mins[1][i] > tw->bounds[1][1] + 1.0f || maxs[1][i] < tw->bounds[0][1] - 1.0f
+				 || mins[2][i] > tw->bounds[1][2] + 1.0f || maxs[2][i] < tw->bounds[0][2] - 1.0f ) {
+				continue;
+			}
+			mask |= 1 << i;
+		}
+
+		return mask;
+	}
+#endif
+}
+
 /*
 ================
 CM_TraceThroughLeaf
@@ -827,9 +931,27 @@ void CM_TraceThroughLeaf( traceWork_t *tw, cLeaf_t *leaf ) {
 	int brushnum;
 	cbrush_t    *b;
 	cPatch_t    *patch;
+	qboolean broadphase;
+	int mask = 0;
+
+	broadphase = CM_LeafBrushBroadphase( leaf );
 
 	// trace line against all brushes in the leaf
 	for ( k = 0 ; k < leaf->numLeafBrushes ; k++ ) {
+		if ( broadphase ) {
+			// reject the brushes four at a time
+			if ( !( k & 3 ) ) {
+				mask = CM_LeafBrushMask( tw, leaf->firstLeafBrush + k );
+				if ( !mask ) {
+					k += 3;
+					continue;
+				}
+			}
+			if ( !( mask & ( 1 << ( k & 3 ) ) ) ) {
+				continue;
+			}
+		}
+
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
 
 		b = &cm.brushes[brushnum];
@@ -881,13 +1003,31 @@ static void CM_TraceThroughLeaf( traceWork_t *tw, cLeaf_t *leaf ) {
 	int brushnum;
 	cbrush_t    *brush;
 	cPatch_t    *patch;
+	qboolean broadphase;
+	int mask = 0;
 
 #ifdef MRE_OPTIMIZE
 	float fraction;
 #endif
 
+	broadphase = CM_LeafBrushBroadphase( leaf );
+
 	// trace line against all brushes in the leaf
 	for ( k = 0 ; k < leaf->numLeafBrushes ; k++ ) {
+		if ( broadphase ) {
+			// reject the brushes four at a time
+			if ( !( k & 3 ) ) {
+				mask = CM_LeafBrushMask( tw, leaf->firstLeafBrush + k );
+				if ( !mask ) {
+					k += 3;
+					continue;
+				}
+			}
+			if ( !( mask & ( 1 << ( k & 3 ) ) ) ) {
+				continue;
+			}
+		}
+
 		brushnum = cm.leafbrushes[leaf->firstLeafBrush + k];
 
 		brush = &cm.brushes[brushnum];
@@ -1438,55 +1578,101 @@ static void CM_TraceThroughTree( traceWork_t *tw, int num, float p1f, float p2f,
 //======================================================================
 
 
+#ifndef BSPC
+/*
+===============================================================================
+
+TRACE RECORDING
+
+===============================================================================
+*/
+
+typedef struct {
+	vec3_t start, end;
+	vec3_t mins, maxs;
+	vec3_t origin;
+	clipHandle_t model;
+	int brushmask;
+	int capsule;
+} recordedTrace_t;
+
+typedef struct {
+	char mapName[MAX_QPATH];
+	recordedTrace_t *traces;
+	int maxTraces;
+	int numTraces;
+	qboolean recording;
+} traceRecording_t;
+
+static traceRecording_t cm_traceRecording;
+
 /*
 ==================
-CM_Trace
+CM_RecordTrace
 ==================
 */
-void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end,
-			   const vec3_t mins, const vec3_t maxs,
-			   clipHandle_t model, const vec3_t origin, int brushmask, int capsule, sphere_t *sphere ) {
-	int i;
-	traceWork_t tw;
-	vec3_t offset;
-	cmodel_t    *cmod;
+static void CM_RecordTrace( const vec3_t start, const vec3_t end, const vec3_t mins, const vec3_t maxs,
+							clipHandle_t model, const vec3_t origin, int brushmask, int capsule ) {
+	recordedTrace_t *rt;
 
-#if defined RTCW_ET
-	qboolean positionTest;
+	// box and capsule models change with every call, so they can't be replayed
+	if ( model < 0 || model >= cm.numSubModels ) {
+		return;
+	}
 
-#ifdef MRE_OPTIMIZE
-	vec3_t dir;
-	float dist;
-#endif
-#endif // RTCW_XX
+	rt = &cm_traceRecording.traces[cm_traceRecording.numTraces++];
 
-	cmod = CM_ClipHandleToModel( model );
+	VectorCopy( start, rt->start );
+	VectorCopy( end, rt->end );
+	if ( mins ) {
+		VectorCopy( mins, rt->mins );
+	} else {
+		VectorClear( rt->mins );
+	}
+	if ( maxs ) {
+		VectorCopy( maxs, rt->maxs );
+	} else {
+		VectorClear( rt->maxs );
+	}
+	VectorCopy( origin, rt->origin );
+	rt->model = model;
+	rt->brushmask = brushmask;
+	rt->capsule = capsule;
 
-	cm.checkcount++;        // for multi-check avoidance
+	if ( cm_traceRecording.numTraces == cm_traceRecording.maxTraces ) {
+		cm_traceRecording.recording = qfalse;
+		Com_Printf( "traceRecord: recorded %i traces\n", cm_traceRecording.numTraces );
+	}
+}
+#endif
 
-	c_traces++;             // for statistics, may be zeroed
+/*
+==================
+CM_InitTraceWork
+
+Sets up the parts of a trace that only depend on the moved volume,
+so traces of the same volume can share them.
+==================
+*/
+static void CM_InitTraceWork( traceWork_t *tw, vec3_t offset, const vec3_t mins, const vec3_t maxs,
+							  const vec3_t origin, int brushmask, int capsule, sphere_t *sphere ) {
+	int i;
 
 	// fill in a default trace
 
 #if defined RTCW_SP
-	Com_Memset( &tw, 0, sizeof( tw ) );
+	Com_Memset( tw, 0, sizeof( *tw ) );
 #else
-	memset( &tw, 0, sizeof( tw ) );
+	memset( tw, 0, sizeof( *tw ) );
 #endif // RTCW_XX
 
 #if !defined RTCW_ET
-	tw.trace.fraction = 1;  // assume it goes the entire distance until shown otherwise
+	tw->trace.fraction = 1;  // assume it goes the entire distance until shown otherwise
 #else
-	tw.trace.fraction = 1.0f;   // assume it goes the entire distance until shown otherwise
+	tw->trace.fraction = 1.0f;   // assume it goes the entire distance until shown otherwise
 #endif // RTCW_XX
 
-	VectorCopy( origin, tw.modelOrigin );
-
-	if ( !cm.numNodes ) {
-		*results = tw.trace;
-
-		return; // map not loaded, shouldn't happen
-	}
+	VectorCopy( origin, tw->modelOrigin );
 
 	// allow NULL to be passed in for 0,0,0
 	if ( !mins ) {
@@ -1497,160 +1683,188 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end,
 	}
 
 	// set basic parms
-	tw.contents = brushmask;
+	tw->contents = brushmask;
 
 	// adjust so that mins and maxs are always symetric, which
 	// avoids some complications with plane expanding of rotated
 	// bmodels
 	for ( i = 0 ; i < 3 ; i++ ) {
 		offset[i] = ( mins[i] + maxs[i] ) * 0.5;
-		tw.size[0][i] = mins[i] - offset[i];
-		tw.size[1][i] = maxs[i] - offset[i];
-		tw.start[i] = start[i] + offset[i];
-		tw.end[i] = end[i] + offset[i];
+		tw->size[0][i] = mins[i] - offset[i];
+		tw->size[1][i] = maxs[i] - offset[i];
 	}
 
 	// if a sphere is already specified
 	if ( sphere ) {
-		tw.sphere = *sphere;
+		tw->sphere = *sphere;
 	} else {
-		tw.sphere.use = capsule;
-		tw.sphere.radius = ( tw.size[1][0] > tw.size[1][2] ) ? tw.size[1][2] : tw.size[1][0];
-		tw.sphere.halfheight = tw.size[1][2];
-		VectorSet( tw.sphere.offset, 0, 0, tw.size[1][2] - tw.sphere.radius );
+		tw->sphere.use = capsule;
+		tw->sphere.radius = ( tw->size[1][0] > tw->size[1][2] ) ? tw->size[1][2] : tw->size[1][0];
+		tw->sphere.halfheight = tw->size[1][2];
+		VectorSet( tw->sphere.offset, 0, 0, tw->size[1][2] - tw->sphere.radius );
 	}
 
-#if defined RTCW_ET
-	positionTest = ( start[0] == end[0] && start[1] == end[1] && start[2] == end[2] );
-#endif // RTCW_XX
+	tw->maxOffset = tw->size[1][0] + tw->size[1][1] + tw->size[1][2];
 
-	tw.maxOffset = tw.size[1][0] + tw.size[1][1] + tw.size[1][2];
+	// tw->offsets[signbits] = vector to apropriate corner from origin
+	tw->offsets[0][0] = tw->size[0][0];
+	tw->offsets[0][1] = tw->size[0][1];
+	tw->offsets[0][2] = tw->size[0][2];
 
-	// tw.offsets[signbits] = vector to apropriate corner from origin
-	tw.offsets[0][0] = tw.size[0][0];
-	tw.offsets[0][1] = tw.size[0][1];
-	tw.offsets[0][2] = tw.size[0][2];
+	tw->offsets[1][0] = tw->size[1][0];
+	tw->offsets[1][1] = tw->size[0][1];
+	tw->offsets[1][2] = tw->size[0][2];
 
-	tw.offsets[1][0] = tw.size[1][0];
-	tw.offsets[1][1] = tw.size[0][1];
-	tw.offsets[1][2] = tw.size[0][2];
+	tw->offsets[2][0] = tw->size[0][0];
+	tw->offsets[2][1] = tw->size[1][1];
+	tw->offsets[2][2] = tw->size[0][2];
 
-	tw.offsets[2][0] = tw.size[0][0];
-	tw.offsets[2][1] = tw.size[1][1];
-	tw.offsets[2][2] = tw.size[0][2];
+	tw->offsets[3][0] = tw->size[1][0];
+	tw->offsets[3][1] = tw->size[1][1];
+	tw->offsets[3][2] = tw->size[0][2];
 
-	tw.offsets[3][0] = tw.size[1][0];
-	tw.offsets[3][1] = tw.size[1][1];
-	tw.offsets[3][2] = tw.size[0][2];
+	tw->offsets[4][0] = tw->size[0][0];
+	tw->offsets[4][1] = tw->size[0][1];
+	tw->offsets[4][2] = tw->size[1][2];
 
-	tw.offsets[4][0] = tw.size[0][0];
-	tw.offsets[4][1] = tw.size[0][1];
-	tw.offsets[4][2] = tw.size[1][2];
+	tw->offsets[5][0] = tw->size[1][0];
+	tw->offsets[5][1] = tw->size[0][1];
+	tw->offsets[5][2] = tw->size[1][2];
 
-	tw.offsets[5][0] = tw.size[1][0];
-	tw.offsets[5][1] = tw.size[0][1];
-	tw.offsets[5][2] = tw.size[1][2];
+	tw->offsets[6][0] = tw->size[0][0];
+	tw->offsets[6][1] = tw->size[1][1];
+	tw->offsets[6][2] = tw->size[1][2];
 
-	tw.offsets[6][0] = tw.size[0][0];
-	tw.offsets[6][1] = tw.size[1][1];
-	tw.offsets[6][2] = tw.size[1][2];
+	tw->offsets[7][0] = tw->size[1][0];
+	tw->offsets[7][1] = tw->size[1][1];
+	tw->offsets[7][2] = tw->size[1][2];
+}
 
-	tw.offsets[7][0] = tw.size[1][0];
-	tw.offsets[7][1] = tw.size[1][1];
-	tw.offsets[7][2] = tw.size[1][2];
+/*
+==================
+CM_TraceWork
+
+Sweeps a trace set up by CM_InitTraceWork from start to end.
+==================
+*/
+static void CM_TraceWork( trace_t *results, traceWork_t *tw, const vec3_t start, const vec3_t end,
+						  const vec3_t offset, clipHandle_t model, cmodel_t *cmod ) {
+	int i;
+
+#if defined RTCW_ET
+	qboolean positionTest;
+
+#ifdef MRE_OPTIMIZE
+	vec3_t dir;
+	float dist;
+#endif
+#endif // RTCW_XX
+
+	cm.checkcount++;        // for multi-check avoidance
+
+	c_traces++;             // for statistics, may be zeroed
+
+	for ( i = 0 ; i < 3 ; i++ ) {
+		tw->start[i] = start[i] + offset[i];
+		tw->end[i] = end[i] + offset[i];
+	}
+
+#if defined RTCW_ET
+	positionTest = ( start[0] == end[0] && start[1] == end[1] && start[2] == end[2] );
+#endif // RTCW_XX
 
 #if !defined RTCW_ET
 	//
 	// calculate bounds
 	//
-	if ( tw.sphere.use ) {
+	if ( tw->sphere.use ) {
 		for ( i = 0 ; i < 3 ; i++ ) {
-			if ( tw.start[i] < tw.end[i] ) {
-				tw.bounds[0][i] = tw.start[i] - c::fabs( tw.sphere.offset[i] ) - tw.sphere.radius;
-				tw.bounds[1][i] = tw.end[i] + c::fabs( tw.sphere.offset[i] ) + tw.sphere.radius;
+			if ( tw->start[i] < tw->end[i] ) {
+				tw->bounds[0][i] = tw->start[i] - c::fabs( tw->sphere.offset[i] ) - tw->sphere.radius;
+				tw->bounds[1][i] = tw->end[i] + c::fabs( tw->sphere.offset[i] ) + tw->sphere.radius;
 			} else {
-				tw.bounds[0][i] = tw.end[i] - c::fabs( tw.sphere.offset[i] ) - tw.sphere.radius;
-				tw.bounds[1][i] = tw.start[i] + c::fabs( tw.sphere.offset[i] ) + tw.sphere.radius;
+				tw->bounds[0][i] = tw->end[i] - c::fabs( tw->sphere.offset[i] ) - tw->sphere.radius;
+				tw->bounds[1][i] = tw->start[i] + c::fabs( tw->sphere.offset[i] ) + tw->sphere.radius;
 			}
 		}
 	} else {
 		for ( i = 0 ; i < 3 ; i++ ) {
-			if ( tw.start[i] < tw.end[i] ) {
-				tw.bounds[0][i] = tw.start[i] + tw.size[0][i];
-				tw.bounds[1][i] = tw.end[i] + tw.size[1][i];
+			if ( tw->start[i] < tw->end[i] ) {
+				tw->bounds[0][i] = tw->start[i] + tw->size[0][i];
+				tw->bounds[1][i] = tw->end[i] + tw->size[1][i];
 			} else {
-				tw.bounds[0][i] = tw.end[i] + tw.size[0][i];
-				tw.bounds[1][i] = tw.start[i] + tw.size[1][i];
+				tw->bounds[0][i] = tw->end[i] + tw->size[0][i];
+				tw->bounds[1][i] = tw->start[i] + tw->size[1][i];
 			}
 		}
 	}
 
 #else
 	// check for point special case
-	if ( tw.size[0][0] == 0.0f && tw.size[0][1] == 0.0f && tw.size[0][2] == 0.0f ) {
-		tw.isPoint = qtrue;
-		VectorClear( tw.extents );
+	if ( tw->size[0][0] == 0.0f && tw->size[0][1] == 0.0f && tw->size[0][2] == 0.0f ) {
+		tw->isPoint = qtrue;
+		VectorClear( tw->extents );
 	} else {
-		tw.isPoint = qfalse;
-		tw.extents[0] = tw.size[1][0];
-		tw.extents[1] = tw.size[1][1];
-		tw.extents[2] = tw.size[1][2];
+		tw->isPoint = qfalse;
+		tw->extents[0] = tw->size[1][0];
+		tw->extents[1] = tw->size[1][1];
+		tw->extents[2] = tw->size[1][2];
 	}
 
 #ifdef MRE_OPTIMIZE
 
 	if ( positionTest ) {
-		CM_CalcTraceBounds( &tw, qfalse );
+		CM_CalcTraceBounds( tw, qfalse );
 	} else {
-		VectorSubtract( tw.end, tw.start, dir );
-		VectorCopy( dir, tw.dir );
+		VectorSubtract( tw->end, tw->start, dir );
+		VectorCopy( dir, tw->dir );
 		VectorNormalize( dir );
-		MakeNormalVectors( dir, tw.tracePlane1.normal, tw.tracePlane2.normal );
-		tw.tracePlane1.dist = DotProduct( tw.tracePlane1.normal, tw.start );
-		tw.tracePlane2.dist = DotProduct( tw.tracePlane2.normal, tw.start );
-		if ( tw.isPoint ) {
-			tw.traceDist1 = tw.traceDist2 = 1.0f;
+		MakeNormalVectors( dir, tw->tracePlane1.normal, tw->tracePlane2.normal );
+		tw->tracePlane1.dist = DotProduct( tw->tracePlane1.normal, tw->start );
+		tw->tracePlane2.dist = DotProduct( tw->tracePlane2.normal, tw->start );
+		if ( tw->isPoint ) {
+			tw->traceDist1 = tw->traceDist2 = 1.0f;
 		} else {
-			tw.traceDist1 = tw.traceDist2 = 0.0f;
+			tw->traceDist1 = tw->traceDist2 = 0.0f;
 			for ( i = 0; i < 8; i++ ) {
-				dist = Q_fabs( DotProduct( tw.tracePlane1.normal, tw.offsets[i] ) - tw.tracePlane1.dist );
-				if ( dist > tw.traceDist1 ) {
-					tw.traceDist1 = dist;
+				dist = Q_fabs( DotProduct( tw->tracePlane1.normal, tw->offsets[i] ) - tw->tracePlane1.dist );
+				if ( dist > tw->traceDist1 ) {
+					tw->traceDist1 = dist;
 				}
-				dist = Q_fabs( DotProduct( tw.tracePlane2.normal, tw.offsets[i] ) - tw.tracePlane2.dist );
-				if ( dist > tw.traceDist2 ) {
-					tw.traceDist2 = dist;
+				dist = Q_fabs( DotProduct( tw->tracePlane2.normal, tw->offsets[i] ) - tw->tracePlane2.dist );
+				if ( dist > tw->traceDist2 ) {
+					tw->traceDist2 = dist;
 				}
 			}
 			// expand for epsilon
-			tw.traceDist1 += 1.0f;
-			tw.traceDist2 += 1.0f;
+			tw->traceDist1 += 1.0f;
+			tw->traceDist2 += 1.0f;
 		}
 
-		CM_CalcTraceBounds( &tw, qtrue );
+		CM_CalcTraceBounds( tw, qtrue );
 	}
 
 #else
 
 	// calculate bounds
-	if ( tw.sphere.use ) {
+	if ( tw->sphere.use ) {
 		for ( i = 0; i < 3; i++ ) {
-			if ( tw.start[i] < tw.end[i] ) {
-				tw.bounds[0][i] = tw.start[i] - Q_fabs( tw.sphere.offset[i] ) - tw.sphere.radius;
-				tw.bounds[1][i] = tw.end[i] + Q_fabs( tw.sphere.offset[i] ) + tw.sphere.radius;
+			if ( tw->start[i] < tw->end[i] ) {
+				tw->bounds[0][i] = tw->start[i] - Q_fabs( tw->sphere.offset[i] ) - tw->sphere.radius;
+				tw->bounds[1][i] = tw->end[i] + Q_fabs( tw->sphere.offset[i] ) + tw->sphere.radius;
 			} else {
-				tw.bounds[0][i] = tw.end[i] - Q_fabs( tw.sphere.offset[i] ) - tw.sphere.radius;
-				tw.bounds[1][i] = tw.start[i] + Q_fabs( tw.sphere.offset[i] ) + tw.sphere.radius;
+				tw->bounds[0][i] = tw->end[i] - Q_fabs( tw->sphere.offset[i] ) - tw->sphere.radius;
+				tw->bounds[1][i] = tw->start[i] + Q_fabs( tw->sphere.offset[i] ) + tw->sphere.radius;
 			}
 		}
 	} else {
 		for ( i = 0 ; i < 3 ; i++ ) {
-			if ( tw.start[i] < tw.end[i] ) {
-				tw.bounds[0][i] = tw.start[i] + tw.size[0][i];
-				tw.bounds[1][i] = tw.end[i] + tw.size[1][i];
+			if ( tw->start[i] < tw->end[i] ) {
+				tw->bounds[0][i] = tw->start[i] + tw->size[0][i];
+				tw->bounds[1][i] = tw->end[i] + tw->size[1][i];
 			} else {
-				tw.bounds[0][i] = tw.end[i] + tw.size[0][i];
-				tw.bounds[1][i] = tw.start[i] + tw.size[1][i];
+				tw->bounds[0][i] = tw->end[i] + tw->size[0][i];
+				tw->bounds[1][i] = tw->start[i] + tw->size[1][i];
 			}
 		}
 	}
@@ -1671,21 +1885,21 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end,
 		if ( model ) {
 #ifdef ALWAYS_BBOX_VS_BBOX
 			if ( model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE ) {
-				tw.sphere.use = qfalse;
-				CM_TestInLeaf( &tw, &cmod->leaf );
+				tw->sphere.use = qfalse;
+				CM_TestInLeaf( tw, &cmod->leaf );
 			} else
 #elif defined( ALWAYS_CAPSULE_VS_CAPSULE )
 			if ( model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE ) {
-				CM_TestCapsuleInCapsule( &tw, model );
+				CM_TestCapsuleInCapsule( tw, model );
 			} else
 #else
 
 #if defined RTCW_SP
 			if ( model == CAPSULE_MODEL_HANDLE ) {
-				if ( tw.sphere.use ) {
-					CM_TestCapsuleInCapsule( &tw, model );
+				if ( tw->sphere.use ) {
+					CM_TestCapsuleInCapsule( tw, model );
 				} else {
-					CM_TestBoundingBoxInCapsule( &tw, model );
+					CM_TestBoundingBoxInCapsule( tw, model );
 				}
 			} else
 #endif // RTCW_XX
@@ -1694,10 +1908,10 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end,
 
 #if !defined RTCW_SP
 			if ( model == CAPSULE_MODEL_HANDLE ) {
-				if ( tw.sphere.use ) {
-					CM_TestCapsuleInCapsule( &tw, model );
+				if ( tw->sphere.use ) {
+					CM_TestCapsuleInCapsule( tw, model );
 				} else {
-					CM_TestBoundingBoxInCapsule( &tw, model );
+					CM_TestBoundingBoxInCapsule( tw, model );
 				}
 
 #if !defined RTCW_ET
@@ -1712,10 +1926,10 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end,
 			{
 #endif // RTCW_XX
 
-				CM_TestInLeaf( &tw, &cmod->leaf );
+				CM_TestInLeaf( tw, &cmod->leaf );
 			}
 		} else {
-			CM_PositionTest( &tw );
+			CM_PositionTest( tw );
 		}
 	} else {
 
@@ -1723,14 +1937,14 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end,
 		//
 		// check for point special case
 		//
-		if ( tw.size[0][0] == 0 && tw.size[0][1] == 0 && tw.size[0][2] == 0 ) {
-			tw.isPoint = qtrue;
-			VectorClear( tw.extents );
+		if ( tw->size[0][0] == 0 && tw->size[0][1] == 0 && tw->size[0][2] == 0 ) {
+			tw->isPoint = qtrue;
+			VectorClear( tw->extents );
 		} else {
-			tw.isPoint = qfalse;
-			tw.extents[0] = tw.size[1][0];
-			tw.extents[1] = tw.size[1][1];
-			tw.extents[2] = tw.size[1][2];
+			tw->isPoint = qfalse;
+			tw->extents[0] = tw->size[1][0];
+			tw->extents[1] = tw->size[1][1];
+			tw->extents[2] = tw->size[1][2];
 		}
 #endif // RTCW_XX
 
@@ -1740,21 +1954,21 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end,
 		if ( model ) {
 #ifdef ALWAYS_BBOX_VS_BBOX
 			if ( model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE ) {
-				tw.sphere.use = qfalse;
-				CM_TraceThroughLeaf( &tw, &cmod->leaf );
+				tw->sphere.use = qfalse;
+				CM_TraceThroughLeaf( tw, &cmod->leaf );
 			} else
 #elif defined( ALWAYS_CAPSULE_VS_CAPSULE )
 			if ( model == BOX_MODEL_HANDLE || model == CAPSULE_MODEL_HANDLE ) {
-				CM_TraceCapsuleThroughCapsule( &tw, model );
+				CM_TraceCapsuleThroughCapsule( tw, model );
 			} else
 #else
 
 #if defined RTCW_SP
 			if ( model == CAPSULE_MODEL_HANDLE ) {
-				if ( tw.sphere.use ) {
-					CM_TraceCapsuleThroughCapsule( &tw, model );
+				if ( tw->sphere.use ) {
+					CM_TraceCapsuleThroughCapsule( tw, model );
 				} else {
-					CM_TraceBoundingBoxThroughCapsule( &tw, model );
+					CM_TraceBoundingBoxThroughCapsule( tw, model );
 				}
 			} else
 #endif // RTCW_XX
@@ -1763,10 +1977,10 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end,
 
 #if !defined RTCW_SP
 			if ( model == CAPSULE_MODEL_HANDLE ) {
-				if ( tw.sphere.use ) {
-					CM_TraceCapsuleThroughCapsule( &tw, model );
+				if ( tw->sphere.use ) {
+					CM_TraceCapsuleThroughCapsule( tw, model );
 				} else {
-					CM_TraceBoundingBoxThroughCapsule( &tw, model );
+					CM_TraceBoundingBoxThroughCapsule( tw, model );
 				}
 
 #if !defined RTCW_ET
@@ -1781,23 +1995,100 @@ void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end,
 			{
 #endif // RTCW_XX
 
-				CM_TraceThroughLeaf( &tw, &cmod->leaf );
+				CM_TraceThroughLeaf( tw, &cmod->leaf );
 			}
 		} else {
-			CM_TraceThroughTree( &tw, 0, 0, 1, tw.start, tw.end );
+			CM_TraceThroughTree( tw, 0, 0, 1, tw->start, tw->end );
 		}
 	}
 
 	// generate endpos from the original, unmodified start/end
-	if ( tw.trace.fraction == 1 ) {
-		VectorCopy( end, tw.trace.endpos );
+	if ( tw->trace.fraction == 1 ) {
+		VectorCopy( end, tw->trace.endpos );
 	} else {
 		for ( i = 0 ; i < 3 ; i++ ) {
-			tw.trace.endpos[i] = start[i] + tw.trace.fraction * ( end[i] - start[i] );
+			tw->trace.endpos[i] = start[i] + tw->trace.fraction * ( end[i] - start[i] );
+		}
+	}
+
+	*results = tw->trace;
+}
+
+/*
+==================
+CM_Trace
+==================
+*/
+void CM_Trace( trace_t *results, const vec3_t start, const vec3_t end,
+			   const vec3_t mins, const vec3_t maxs,
+			   clipHandle_t model, const vec3_t origin, int brushmask, int capsule, sphere_t *sphere ) {
+	traceWork_t tw;
+	vec3_t offset;
+	cmodel_t    *cmod;
+
+#ifndef BSPC
+	if ( cm_traceRecording.recording && !sphere ) {
+		CM_RecordTrace( start, end, mins, maxs, model, origin, brushmask, capsule );
+	}
+#endif
+
+	cmod = CM_ClipHandleToModel( model );
+
+	CM_InitTraceWork( &tw, offset, mins, maxs, origin, brushmask, capsule, sphere );
+
+	if ( !cm.numNodes ) {
+		*results = tw.trace;
+
+		return; // map not loaded, shouldn't happen
+	}
+
+	CM_TraceWork( results, &tw, start, end, offset, model, cmod );
+}
+
+/*
+==================
+CM_TraceBatch
+
+Traces several moves of the same volume through a model, sharing
+the setup of the trace between them.
+==================
+*/
+void CM_TraceBatch( trace_t *results, const traceRay_t *rays, int numRays,
+					const vec3_t mins, const vec3_t maxs,
+					clipHandle_t model, int brushmask, int capsule ) {
+	traceWork_t base, tw;
+	vec3_t offset;
+	cmodel_t    *cmod;
+	int i;
+
+	if ( numRays <= 0 ) {
+		return;
+	}
+
+#ifndef BSPC
+	if ( cm_traceRecording.recording ) {
+		for ( i = 0 ; i < numRays ; i++ ) {
+			CM_Trace( &results[i], rays[i].start, rays[i].end, mins, maxs, model, vec3_origin, brushmask, capsule, NULL );
+		}
+		return;
+	}
+#endif
+
+	cmod = CM_ClipHandleToModel( model );
+
+	CM_InitTraceWork( &base, offset, mins, maxs, vec3_origin, brushmask, capsule, NULL );
+
+	if ( !cm.numNodes ) {
+		for ( i = 0 ; i < numRays ; i++ ) {
+			results[i] = base.trace;
 		}
+		return; // map not loaded, shouldn't happen
 	}
 
-	*results = tw.trace;
+	for ( i = 0 ; i < numRays ; i++ ) {
+		tw = base;
+		CM_TraceWork( &results[i], &tw, rays[i].start, rays[i].end, offset, model, cmod );
+	}
 }
 
 /*
@@ -1924,3 +2215,137 @@ void CM_TransformedBoxTrace( trace_t *results, const vec3_t start, const vec3_t
 
 	*results = trace;
 }
+
+#ifndef BSPC
+/*
+==================
+CM_TraceRecord_f
+
+Records the next traces through the collision map for traceReplay.
+==================
+*/
+void CM_TraceRecord_f( void ) {
+	int count;
+
+	if ( !cm.numNodes ) {
+		Com_Printf( "No map loaded.\n" );
+		return;
+	}
+
+	count = 10000;
+	if ( Cmd_Argc() > 1 ) {
+		count = atoi( Cmd_Argv( 1 ) );
+	}
+	if ( count <= 0 ) {
+		Com_Printf( "usage: traceRecord [count]\n" );
+		return;
+	}
+
+	if ( cm_traceRecording.traces ) {
+		Z_Free( cm_traceRecording.traces );
+	}
+
+	Q_strncpyz( cm_traceRecording.mapName, cm.name, sizeof( cm_traceRecording.mapName ) );
+	cm_traceRecording.traces = static_cast<recordedTrace_t*>( Z_Malloc( count * sizeof( *cm_traceRecording.traces ) ) );
+	cm_traceRecording.maxTraces = count;
+	cm_traceRecording.numTraces = 0;
+	cm_traceRecording.recording = qtrue;
+
+	Com_Printf( "traceRecord: recording %i traces on %s\n", count, cm.name );
+}
+
+/*
+==================
+CM_ReplayTraces
+==================
+*/
+static long long CM_ReplayTraces( trace_t *results, int passes ) {
+	recordedTrace_t *rt;
+	long long start;
+	int i, pass;
+
+	start = Sys_Microseconds();
+
+	for ( pass = 0 ; pass < passes ; pass++ ) {
+		for ( i = 0, rt = cm_traceRecording.traces ; i < cm_traceRecording.numTraces ; i++, rt++ ) {
+			CM_Trace( &results[i], rt->start, rt->end, rt->mins, rt->maxs,
+					  rt->model, rt->origin, rt->brushmask, rt->capsule, NULL );
+		}
+	}
+
+	return Sys_Microseconds() - start;
+}
+
+/*
+==================
+CM_TraceReplay_f
+
+Runs the recorded traces without and with the leaf brush broadphase,
+reports the time of each and any trace that came out different.
+==================
+*/
+void CM_TraceReplay_f( void ) {
+	trace_t *reference, *results;
+	char broadphase[MAX_CVAR_VALUE_STRING];
+	long long scalarTime, broadphaseTime;
+	int passes;
+	int i, mismatches;
+
+	if ( cm_traceRecording.recording ) {
+		Com_Printf( "traceReplay: still recording (%i of %i traces)\n",
+					cm_traceRecording.numTraces, cm_traceRecording.maxTraces );
+		return;
+	}
+	if ( !cm_traceRecording.numTraces ) {
+		Com_Printf( "traceReplay: no traces recorded\n" );
+		return;
+	}
+	if ( Q_stricmp( cm_traceRecording.mapName, cm.name ) ) {
+		Com_Printf( "traceReplay: traces were recorded on %s\n", cm_traceRecording.mapName );
+		return;
+	}
+
+	passes = 1;
+	if ( Cmd_Argc() > 1 ) {
+		passes = atoi( Cmd_Argv( 1 ) );
+		if ( passes < 1 ) {
+			passes = 1;
+		}
+	}
+
+	reference = static_cast<trace_t*>( Z_Malloc( cm_traceRecording.numTraces * sizeof( *reference ) ) );
+	results = static_cast<trace_t*>( Z_Malloc( cm_traceRecording.numTraces * sizeof( *results ) ) );
+
+	Q_strncpyz( broadphase, cm_broadphase->string, sizeof( broadphase ) );
+
+	Cvar_Set( "cm_broadphase", "0" );
+	scalarTime = CM_ReplayTraces( reference, passes );
+
+	Cvar_Set( "cm_broadphase", "1" );
+	broadphaseTime = CM_ReplayTraces( results, passes );
+
+	Cvar_Set( "cm_broadphase", broadphase );
+
+	mismatches = 0;
+	for ( i = 0 ; i < cm_traceRecording.numTraces ; i++ ) {
+		if ( reference[i].fraction != results[i].fraction
+			 || !VectorCompare( reference[i].endpos, results[i].endpos )
+			 || !VectorCompare( reference[i].plane.normal, results[i].plane.normal )
+			 || reference[i].plane.dist != results[i].plane.dist
+			 || reference[i].startsolid != results[i].startsolid
+			 || reference[i].allsolid != results[i].allsolid
+			 || reference[i].surfaceFlags != results[i].surfaceFlags
+			 || reference[i].contents != results[i].contents ) {
+			mismatches++;
+		}
+	}
+
+	Z_Free( results );
+	Z_Free( reference );
+
+	Com_Printf( "%i traces, %i passes\n", cm_traceRecording.numTraces, passes );
+	Com_Printf( "scalar:     %8lld usec\n", scalarTime );
+	Com_Printf( "broadphase: %8lld usec\n", broadphaseTime );
+	Com_Printf( "%i mismatches\n", mismatches );
+}
+#endif
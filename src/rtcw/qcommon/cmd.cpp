@@ -34,6 +34,29 @@ int cmd_wait;
 cmd_t cmd_text;
 byte cmd_text_buf[MAX_CMD_BUFFER];
 
+// Cbuf_Execute timing, reported by cmdstats
+typedef struct {
+	int frame;
+	int frames;
+	int commands;
+	int programCommands;
+	long long usec;
+	long long frameUsec;
+	long long peakUsec;
+	int compiles;
+	int reuses;
+} cmdStats_t;
+
+static cmdStats_t cmd_stats;
+static int cmd_executeDepth;
+
+// exec of a config inserts a line starting with this instead of the text,
+// see Cmd_InsertProgram
+#define CMD_PROGRAM_MARKER  '\x01'
+
+static void Cmd_ExecuteProgramLine( const char *line );
+static void Cmd_ReleasePrograms( void );
+
 
 //=============================================================================
 
@@ -189,6 +212,43 @@ void Cbuf_ExecuteText( int exec_when, const char *text ) {
 	}
 }
 
+/*
+============
+Cbuf_NextLine
+
+Copies the first command of the text to line, and returns how much
+of the text it takes up
+============
+*/
+static int Cbuf_NextLine( const char *text, int size, char *line ) {
+	int i;
+	int quotes;
+
+	// find a \n or ; line break
+	quotes = 0;
+	for ( i = 0 ; i < size ; i++ )
+	{
+		if ( text[i] == '"' ) {
+			quotes++;
+		}
+		if ( !( quotes & 1 ) &&  text[i] == ';' ) {
+			break;  // don't break if inside a quoted string
+		}
+		if ( text[i] == '\n' || text[i] == '\r' ) {
+			break;
+		}
+	}
+
+	if ( i >= ( MAX_CMD_LINE - 1 ) ) {
+		i = MAX_CMD_LINE - 1;
+	}
+
+	memcpy( line, text, i );
+	line[i] = 0;
+
+	return i == size ? size : i + 1;
+}
+
 /*
 ============
 Cbuf_Execute
@@ -198,7 +258,20 @@ void Cbuf_Execute( void ) {
 	int i;
 	char    *text;
 	char line[MAX_CMD_LINE];
-	int quotes;
+	long long start;
+
+	if ( cmd_stats.frame != com_frameNumber ) {
+		cmd_stats.frame = com_frameNumber;
+		cmd_stats.frames++;
+		cmd_stats.frameUsec = 0;
+		cmd_executeDepth = 0;   // an error may have left the last frame's count
+	}
+
+	start = 0;
+	if ( !cmd_executeDepth ) {
+		start = Sys_Microseconds();
+	}
+	cmd_executeDepth++;
 
 #if defined RTCW_SP
 	while ( cmd_text.cmdsize )
@@ -214,36 +287,14 @@ void Cbuf_Execute( void ) {
 			break;
 		}
 
-		// find a \n or ; line break
 		text = (char *)cmd_text.data;
 
-		quotes = 0;
-
 #if defined RTCW_SP
-		for ( i = 0 ; i < cmd_text.cmdsize ; i++ )
+		i = Cbuf_NextLine( text, cmd_text.cmdsize, line );
 #else
-		for ( i = 0 ; i < cmd_text.cursize ; i++ )
+		i = Cbuf_NextLine( text, cmd_text.cursize, line );
 #endif // RTCW_XX
 
-		{
-			if ( text[i] == '"' ) {
-				quotes++;
-			}
-			if ( !( quotes & 1 ) &&  text[i] == ';' ) {
-				break;  // don't break if inside a quoted string
-			}
-			if ( text[i] == '\n' || text[i] == '\r' ) {
-				break;
-			}
-		}
-
-		if ( i >= ( MAX_CMD_LINE - 1 ) ) {
-			i = MAX_CMD_LINE - 1;
-		}
-
-		memcpy( line, text, i );
-		line[i] = 0;
-
 // delete the text from the command buffer and move remaining commands down
 // this is necessary because commands (exec) can insert data at the
 // beginning of the text buffer
@@ -258,8 +309,6 @@ void Cbuf_Execute( void ) {
 
 		} else
 		{
-			i++;
-
 #if defined RTCW_SP
 			cmd_text.cmdsize -= i;
 			memmove( text, text + i, cmd_text.cmdsize );
@@ -272,7 +321,32 @@ void Cbuf_Execute( void ) {
 
 // execute the command line
 
-		Cmd_ExecuteString( line );
+		cmd_stats.commands++;
+
+		if ( line[0] == CMD_PROGRAM_MARKER ) {
+			Cmd_ExecuteProgramLine( line + 1 );
+		} else {
+			Cmd_ExecuteString( line );
+		}
+	}
+
+	cmd_executeDepth--;
+	if ( !cmd_executeDepth ) {
+#if defined RTCW_SP
+		if ( !cmd_text.cmdsize ) {
+#else
+		if ( !cmd_text.cursize ) {
+#endif // RTCW_XX
+			// no markers left, including any an overflow or an error lost
+			Cmd_ReleasePrograms();
+		}
+
+		start = Sys_Microseconds() - start;
+		cmd_stats.usec += start;
+		cmd_stats.frameUsec += start;
+		if ( cmd_stats.frameUsec > cmd_stats.peakUsec ) {
+			cmd_stats.peakUsec = cmd_stats.frameUsec;
+		}
 	}
 }
 
@@ -291,6 +365,8 @@ void Cbuf_Execute( void ) {
 Cmd_Exec_f
 ===============
 */
+static qboolean Cmd_InsertProgram( const char *name, const char *text );
+
 void Cmd_Exec_f( void ) {
 	char    *f;
 	int len;
@@ -310,7 +386,9 @@ void Cmd_Exec_f( void ) {
 	}
 	Com_Printf( "execing %s\n",Cmd_Argv( 1 ) );
 
-	Cbuf_InsertText( f );
+	if ( !Cmd_InsertProgram( filename, f ) ) {
+		Cbuf_InsertText( f );
+	}
 
 	FS_FreeFile( f );
 }
@@ -372,10 +450,13 @@ void Cmd_Echo_f( void ) {
 typedef struct cmd_function_s
 {
 	struct cmd_function_s   *next;
+	struct cmd_function_s   *hashNext;
 	char                    *name;
 	xcommand_t function;
 } cmd_function_t;
 
+#define CMD_HASH_SIZE   512
+
 
 static int cmd_argc;
 static char        *cmd_argv[MAX_STRING_TOKENS];        // points into cmd_tokenized
@@ -386,6 +467,7 @@ static char cmd_cmd[BIG_INFO_STRING];         // the original command we receive
 #endif // RTCW_XX
 
 static cmd_function_t  *cmd_functions;      // possible commands to execute
+static cmd_function_t  *cmd_hashTable[CMD_HASH_SIZE];
 
 /*
 ============
@@ -622,6 +704,24 @@ void Cmd_TokenizeString( const char *text_in ) {
 }
 
 
+/*
+============
+Cmd_HashName
+
+Ignores case, as command lookups do
+============
+*/
+static int Cmd_HashName( const char *name ) {
+	unsigned int hash;
+
+	hash = 0;
+	for ( ; *name ; name++ ) {
+		hash = hash * 31 + tolower( (unsigned char)*name );
+	}
+
+	return hash & ( CMD_HASH_SIZE - 1 );
+}
+
 /*
 ============
 Cmd_AddCommand
@@ -629,9 +729,12 @@ Cmd_AddCommand
 */
 void    Cmd_AddCommand( const char *cmd_name, xcommand_t function ) {
 	cmd_function_t  *cmd;
+	int hash;
+
+	hash = Cmd_HashName( cmd_name );
 
 	// fail if the command already exists
-	for ( cmd = cmd_functions ; cmd ; cmd = cmd->next ) {
+	for ( cmd = cmd_hashTable[hash] ; cmd ; cmd = cmd->hashNext ) {
 		if ( !strcmp( cmd_name, cmd->name ) ) {
 			// allow completion-only commands to be silently doubled
 			if ( function != NULL ) {
@@ -653,6 +756,8 @@ void    Cmd_AddCommand( const char *cmd_name, xcommand_t function ) {
 	cmd->function = function;
 	cmd->next = cmd_functions;
 	cmd_functions = cmd;
+	cmd->hashNext = cmd_hashTable[hash];
+	cmd_hashTable[hash] = cmd;
 }
 
 /*
@@ -663,7 +768,7 @@ Cmd_RemoveCommand
 void    Cmd_RemoveCommand( const char *cmd_name ) {
 	cmd_function_t  *cmd, **back;
 
-	back = &cmd_functions;
+	back = &cmd_hashTable[Cmd_HashName( cmd_name )];
 	while ( 1 ) {
 		cmd = *back;
 		if ( !cmd ) {
@@ -671,15 +776,22 @@ void    Cmd_RemoveCommand( const char *cmd_name ) {
 			return;
 		}
 		if ( !strcmp( cmd_name, cmd->name ) ) {
-			*back = cmd->next;
-			if ( cmd->name ) {
-				Z_Free( cmd->name );
-			}
-			Z_Free( cmd );
-			return;
+			*back = cmd->hashNext;
+			break;
 		}
-		back = &cmd->next;
+		back = &cmd->hashNext;
 	}
+
+	back = &cmd_functions;
+	while ( *back != cmd ) {
+		back = &( *back )->next;
+	}
+	*back = cmd->next;
+
+	if ( cmd->name ) {
+		Z_Free( cmd->name );
+	}
+	Z_Free( cmd );
 }
 
 
@@ -699,30 +811,21 @@ void    Cmd_CommandCompletion( void ( *callback )(const char *s) ) {
 
 /*
 ============
-Cmd_ExecuteString
+Cmd_ExecuteTokenized
 
 A complete command line has been parsed, so try to execute it
 ============
 */
-void    Cmd_ExecuteString( const char *text ) {
-	cmd_function_t  *cmd, **prev;
+static void Cmd_ExecuteTokenized( const char *text ) {
+	cmd_function_t  *cmd;
 
-	// execute the command line
-	Cmd_TokenizeString( text );
 	if ( !Cmd_Argc() ) {
 		return;     // no tokens
 	}
 
 	// check registered command functions
-	for ( prev = &cmd_functions ; *prev ; prev = &cmd->next ) {
-		cmd = *prev;
+	for ( cmd = cmd_hashTable[Cmd_HashName( cmd_argv[0] )] ; cmd ; cmd = cmd->hashNext ) {
 		if ( !Q_stricmp( cmd_argv[0],cmd->name ) ) {
-			// rearrange the links so that the command will be
-			// near the head of the list next time it is used
-			*prev = cmd->next;
-			cmd->next = cmd_functions;
-			cmd_functions = cmd;
-
 			// perform the action
 			if ( !cmd->function ) {
 				// let the cgame or game handle it
@@ -759,6 +862,359 @@ void    Cmd_ExecuteString( const char *text ) {
 	CL_ForwardCommandToServer( text );
 }
 
+/*
+============
+Cmd_ExecuteString
+============
+*/
+void    Cmd_ExecuteString( const char *text ) {
+	// execute the command line
+	Cmd_TokenizeString( text );
+	Cmd_ExecuteTokenized( text );
+}
+
+
+/*
+==============================================================================
+
+						CONFIG PROGRAMS
+
+An exec'd config is split into commands and tokenized once.  The command
+buffer gets a marker line for the next command instead of the text, so waits,
+nested execs and inserted text behave as before, and exec of an unchanged
+file reuses the work.
+
+A program with markers in the buffer is never recompiled or evicted, so a
+marker always finds what it was made for.  When every slot is held the config
+is inserted as text.
+
+==============================================================================
+*/
+
+#define MAX_CMD_PROGRAMS        32
+#define MAX_CMD_PROGRAM_TEXT    0x10000
+
+typedef struct {
+	int argc;
+	int line;                   // offsets into data
+	int tokens;
+	int tokensSize;
+} cmdProgramCommand_t;
+
+typedef struct {
+	char name[MAX_QPATH];
+	int generation;             // markers for an older compile are stale
+	int lastUsed;
+	int markers;                // markers in the command buffer
+
+	char                *text;  // what was compiled
+	int textLength;
+
+	cmdProgramCommand_t *commands;
+	int numCommands;
+	char                *data;
+} cmdProgram_t;
+
+static cmdProgram_t cmd_programs[MAX_CMD_PROGRAMS];
+static int cmd_programGeneration;
+static int cmd_programUse;
+
+/*
+============
+Cmd_CompileProgram
+============
+*/
+static void Cmd_CompileProgram( cmdProgram_t *program, const char *name, const char *text, int length ) {
+	char line[MAX_CMD_LINE];
+	cmdProgramCommand_t *command;
+	const char  *lastToken;
+	int pass;
+	int offset, consumed;
+	int numCommands, dataSize;
+	int lineSize, tokensSize;
+	char        *block;
+
+	if ( program->text ) {
+		Z_Free( program->text );
+	}
+	Com_Memset( program, 0, sizeof( *program ) );
+
+	// split exactly the way Cbuf_Execute does
+	numCommands = 0;
+	dataSize = 0;
+
+	for ( pass = 0 ; pass < 2 ; pass++ ) {
+		if ( pass ) {
+			block = static_cast<char*>( Z_Malloc( length + 1 + numCommands * sizeof( *command ) + dataSize ) );
+			program->text = block;
+			program->commands = reinterpret_cast<cmdProgramCommand_t*>( block + length + 1 );
+			program->data = block + length + 1 + numCommands * sizeof( *command );
+			memcpy( program->text, text, length + 1 );
+		}
+
+		numCommands = 0;
+		dataSize = 0;
+
+		for ( offset = 0 ; offset < length ; offset += consumed ) {
+			consumed = Cbuf_NextLine( text + offset, length - offset, line );
+
+			Cmd_TokenizeString( line );
+			if ( !cmd_argc ) {
+				continue;
+			}
+
+			lastToken = cmd_argv[cmd_argc - 1];
+			tokensSize = lastToken + strlen( lastToken ) + 1 - cmd_tokenized;
+			lineSize = strlen( line ) + 1;
+
+			if ( pass ) {
+				command = &program->commands[numCommands];
+				command->argc = cmd_argc;
+				command->line = dataSize;
+				command->tokens = dataSize + lineSize;
+				command->tokensSize = tokensSize;
+				memcpy( program->data + command->line, line, lineSize );
+				memcpy( program->data + command->tokens, cmd_tokenized, tokensSize );
+			}
+
+			numCommands++;
+			dataSize += lineSize + tokensSize;
+		}
+	}
+
+	Q_strncpyz( program->name, name, sizeof( program->name ) );
+	program->generation = ++cmd_programGeneration;
+	program->textLength = length;
+	program->numCommands = numCommands;
+}
+
+/*
+============
+Cmd_InsertProgram
+
+Inserts a marker for the first command of the config;
+returns qfalse if the text should be inserted as is
+============
+*/
+static qboolean Cmd_InsertProgram( const char *name, const char *text ) {
+	cmdProgram_t    *program;
+	cmdProgram_t    *recompile;
+	cmdProgram_t    *oldest;
+	int length;
+	int i;
+
+	length = strlen( text );
+	if ( length > MAX_CMD_PROGRAM_TEXT ) {
+		return qfalse;
+	}
+
+	program = NULL;
+	recompile = NULL;
+	oldest = NULL;
+
+	for ( i = 0 ; i < MAX_CMD_PROGRAMS ; i++ ) {
+		if ( cmd_programs[i].text && !Q_stricmp( cmd_programs[i].name, name ) ) {
+			if ( cmd_programs[i].textLength == length && !memcmp( cmd_programs[i].text, text, length ) ) {
+				program = &cmd_programs[i];
+				break;
+			}
+			// the file changed; an older compile still running keeps its slot
+			if ( !cmd_programs[i].markers ) {
+				recompile = &cmd_programs[i];
+			}
+		}
+		if ( !cmd_programs[i].markers && ( !oldest || cmd_programs[i].lastUsed < oldest->lastUsed ) ) {
+			oldest = &cmd_programs[i];
+		}
+	}
+
+	if ( program ) {
+		cmd_stats.reuses++;
+	} else {
+		program = recompile ? recompile : oldest;
+		if ( !program ) {
+			return qfalse;
+		}
+		Cmd_CompileProgram( program, name, text, length );
+		cmd_stats.compiles++;
+	}
+
+	program->lastUsed = ++cmd_programUse;
+
+	if ( program->numCommands ) {
+		program->markers++;
+		Cbuf_InsertText( va( "%c%i %i 0", CMD_PROGRAM_MARKER, (int)( program - cmd_programs ), program->generation ) );
+	}
+
+	return qtrue;
+}
+
+/*
+============
+Cmd_ExecuteProgramLine
+
+Runs the command a marker line refers to
+============
+*/
+static void Cmd_ExecuteProgramLine( const char *line ) {
+	cmdProgram_t                *program;
+	const cmdProgramCommand_t   *command;
+	char text[MAX_CMD_LINE];
+	char    *token;
+	char    *end;
+	int index, generation, pc;
+	int i;
+
+	index = strtol( line, &end, 10 );
+	generation = strtol( end, &end, 10 );
+	pc = strtol( end, &end, 10 );
+
+	if ( index < 0 || index >= MAX_CMD_PROGRAMS ) {
+		return;
+	}
+
+	// a program is held while it has markers, so only a marker that didn't
+	// come from Cmd_InsertProgram can miss it
+	program = &cmd_programs[index];
+	if ( !program->text || program->generation != generation || !program->markers ) {
+		return;
+	}
+
+	program->markers--;
+
+	if ( pc < 0 || pc >= program->numCommands ) {
+		return;
+	}
+
+	program->lastUsed = ++cmd_programUse;
+
+	// anything this command inserts runs before the rest of the config
+	if ( pc + 1 < program->numCommands ) {
+		program->markers++;
+		Cbuf_InsertText( va( "%c%i %i %i", CMD_PROGRAM_MARKER, index, generation, pc + 1 ) );
+	}
+
+	// the command may exec configs that take this slot once the last marker is gone
+	command = &program->commands[pc];
+	Q_strncpyz( text, program->data + command->line, sizeof( text ) );
+
+	memcpy( cmd_tokenized, program->data + command->tokens, command->tokensSize );
+	token = cmd_tokenized;
+	for ( i = 0 ; i < command->argc ; i++ ) {
+		cmd_argv[i] = token;
+		token += strlen( token ) + 1;
+	}
+	cmd_argc = command->argc;
+
+#if !defined RTCW_SP
+	Q_strncpyz( cmd_cmd, text, sizeof( cmd_cmd ) );
+#endif // RTCW_XX
+
+	cmd_stats.programCommands++;
+
+	Cmd_ExecuteTokenized( text );
+}
+
+/*
+============
+Cmd_ReleasePrograms
+
+Called when the command buffer is empty, no marker refers to any program
+============
+*/
+static void Cmd_ReleasePrograms( void ) {
+	int i;
+
+	for ( i = 0 ; i < MAX_CMD_PROGRAMS ; i++ ) {
+		cmd_programs[i].markers = 0;
+	}
+}
+
+/*
+============
+Cmd_Stats_f
+============
+*/
+void Cmd_Stats_f( void ) {
+	int i, programs;
+
+	if ( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "reset" ) ) {
+		Com_Memset( &cmd_stats, 0, sizeof( cmd_stats ) );
+		cmd_stats.frame = com_frameNumber;
+		return;
+	}
+
+	programs = 0;
+	for ( i = 0 ; i < MAX_CMD_PROGRAMS ; i++ ) {
+		if ( cmd_programs[i].text ) {
+			programs++;
+		}
+	}
+
+	Com_Printf( "%i commands in %i frames, %i from compiled configs\n",
+				cmd_stats.commands, cmd_stats.frames, cmd_stats.programCommands );
+	Com_Printf( "Cbuf_Execute: %.1f usec per frame, %i usec peak\n",
+				cmd_stats.frames ? (float)cmd_stats.usec / cmd_stats.frames : 0.0f, (int)cmd_stats.peakUsec );
+	Com_Printf( "configs: %i cached, %i compiled, %i reused\n",
+				programs, cmd_stats.compiles, cmd_stats.reuses );
+}
+
+/*
+============
+Cmd_ExecTest_f
+
+Execs a config that execs more configs than there are program slots and
+rewrites itself halfway, then checks that every line ran
+============
+*/
+#define EXECTEST_CONFIGS    ( MAX_CMD_PROGRAMS + 8 )
+
+void Cmd_ExecTest_f( void ) {
+	char text[EXECTEST_CONFIGS * 64];
+	char child[64];
+	int i, ran;
+
+	if ( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "rewrite" ) ) {
+		// the running compile keeps its slot, the new text gets another one
+		Q_strncpyz( text, "set exectest_rewritten 1\n", sizeof( text ) );
+		FS_WriteFile( "exectest/parent.cfg", text, strlen( text ) );
+		Cbuf_InsertText( "exec exectest/parent.cfg\n" );
+		return;
+	}
+
+	if ( Cmd_Argc() > 1 && !Q_stricmp( Cmd_Argv( 1 ), "check" ) ) {
+		ran = 0;
+		for ( i = 0 ; i < EXECTEST_CONFIGS ; i++ ) {
+			ran += Cvar_VariableIntegerValue( va( "exectest_parent%i", i ) );
+			ran += Cvar_VariableIntegerValue( va( "exectest_child%i", i ) );
+		}
+		ran += Cvar_VariableIntegerValue( "exectest_rewritten" );
+
+		Com_Printf( "exectest: %i of %i commands ran, %s\n", ran, EXECTEST_CONFIGS * 2 + 1,
+					ran == EXECTEST_CONFIGS * 2 + 1 ? "passed" : "FAILED" );
+		return;
+	}
+
+	text[0] = '\0';
+	for ( i = 0 ; i < EXECTEST_CONFIGS ; i++ ) {
+		Cvar_Set( va( "exectest_parent%i", i ), "0" );
+		Cvar_Set( va( "exectest_child%i", i ), "0" );
+
+		Com_sprintf( child, sizeof( child ), "set exectest_child%i 1\n", i );
+		FS_WriteFile( va( "exectest/child%i.cfg", i ), child, strlen( child ) );
+
+		Q_strcat( text, sizeof( text ), va( "exec exectest/child%i.cfg\nset exectest_parent%i 1\n", i, i ) );
+		if ( i == EXECTEST_CONFIGS / 2 ) {
+			Q_strcat( text, sizeof( text ), "exectest rewrite\n" );
+		}
+	}
+	Cvar_Set( "exectest_rewritten", "0" );
+
+	FS_WriteFile( "exectest/parent.cfg", text, strlen( text ) );
+
+	Cbuf_InsertText( "exec exectest/parent.cfg\nexectest check\n" );
+}
+
 /*
 ============
 Cmd_List_f
@@ -798,5 +1254,7 @@ void Cmd_Init( void ) {
 	Cmd_AddCommand( "vstr",Cmd_Vstr_f );
 	Cmd_AddCommand( "echo",Cmd_Echo_f );
 	Cmd_AddCommand( "wait", Cmd_Wait_f );
+	Cmd_AddCommand( "cmdstats", Cmd_Stats_f );
+	Cmd_AddCommand( "exectest", Cmd_ExecTest_f );
 }
 
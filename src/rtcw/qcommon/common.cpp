@@ -975,6 +975,406 @@ int Com_RealTime( qtime_t *qtime ) {
 }
 
 
+/*
+==============================================================================
+
+						MEMORY STATISTICS
+
+Allocation counts, bytes and peaks for every memory group, kept in all builds.
+With com_memSites set, allocations are also counted per call site: the return
+address of the allocator, or the ZONE_DEBUG / HUNK_DEBUG label if there is one.
+"memstats" prints them and com_memStatsPeriod appends samples to
+com_memStatsFile, as CSV or as JSON lines if the file name ends in ".json".
+==============================================================================
+*/
+
+#if defined( _MSC_VER )
+#include <intrin.h>
+#define MEMSTAT_CALLER()    _ReturnAddress()
+#else
+#define MEMSTAT_CALLER()    __builtin_return_address( 0 )
+#endif
+
+#define MAX_MEM_SITES   1024
+
+typedef enum {
+	MEMSTAT_ZONE,
+	MEMSTAT_SMALL_ZONE,
+	MEMSTAT_BOTLIB,
+	MEMSTAT_RENDERER,
+	MEMSTAT_HUNK_LOW,
+	MEMSTAT_HUNK_HIGH,
+	MEMSTAT_HUNK_TEMP,
+	MEMSTAT_NUM_GROUPS
+} memStatGroup_t;
+
+static const char *memStatNames[MEMSTAT_NUM_GROUPS] = {
+	"zone",
+	"smallzone",
+	"botlib",
+	"renderer",
+	"hunklow",
+	"hunkhigh",
+	"hunktemp"
+};
+
+typedef struct {
+	int allocs;
+	int frees;
+	int live;               // bytes in use, including headers
+	int peak;
+	long long total;        // bytes ever allocated
+} memStat_t;
+
+typedef struct {
+	const void  *site;
+	const char  *file;      // only with ZONE_DEBUG / HUNK_DEBUG
+	int line;
+	memStatGroup_t group;
+	int allocs;
+	long long total;
+} memSite_t;
+
+static memStat_t memStats[MEMSTAT_NUM_GROUPS];
+static memSite_t memSites[MAX_MEM_SITES];
+static int memSiteCount;
+static int memSiteOverflow;             // allocations from sites that didn't fit
+static qboolean memStatsPaused;         // set while zoneReplay runs on scratch zones
+
+static cvar_t      *com_memSites;
+static cvar_t      *com_memStatsPeriod;
+static cvar_t      *com_memStatsFile;
+static fileHandle_t memStatsFile;
+static int memStatsLastSample;
+
+static void Com_MemStatHunkLive( void );
+
+/*
+=================
+Com_MemStatAlloc
+=================
+*/
+static void Com_MemStatAlloc( memStatGroup_t group, int bytes, const void *site, const char *file, int line ) {
+	memStat_t   *stat;
+	memSite_t   *entry;
+	int hash;
+	int i;
+
+	if ( memStatsPaused ) {
+		return;
+	}
+
+	stat = &memStats[group];
+	stat->allocs++;
+	stat->total += bytes;
+	if ( group < MEMSTAT_HUNK_LOW ) {
+		stat->live += bytes;
+		if ( stat->live > stat->peak ) {
+			stat->peak = stat->live;
+		}
+	} else {
+		Com_MemStatHunkLive();
+	}
+
+	if ( !com_memSites || !com_memSites->integer ) {
+		return;
+	}
+
+	// open addressing on the call site
+	hash = static_cast<int>( ( reinterpret_cast<size_t>( site ) >> 2 ) & ( MAX_MEM_SITES - 1 ) );
+	for ( i = 0 ; i < MAX_MEM_SITES ; i++ ) {
+		entry = &memSites[( hash + i ) & ( MAX_MEM_SITES - 1 )];
+		if ( !entry->site ) {
+			if ( memSiteCount == MAX_MEM_SITES / 2 ) {
+				break;  // keep the probes short
+			}
+			entry->site = site;
+			entry->file = file;
+			entry->line = line;
+			entry->group = group;
+			memSiteCount++;
+		}
+		if ( entry->site == site ) {
+			entry->allocs++;
+			entry->total += bytes;
+			return;
+		}
+	}
+
+	memSiteOverflow++;
+}
+
+/*
+=================
+Com_MemStatFree
+=================
+*/
+static void Com_MemStatFree( memStatGroup_t group, int bytes ) {
+	if ( memStatsPaused ) {
+		return;
+	}
+
+	memStats[group].frees++;
+	if ( group < MEMSTAT_HUNK_LOW ) {
+		memStats[group].live -= bytes;
+	} else {
+		Com_MemStatHunkLive();
+	}
+}
+
+#if !defined RTCW_SP
+static memStatGroup_t Com_MemStatZoneGroup( int tag ) {
+	switch ( tag ) {
+	case TAG_SMALL:
+		return MEMSTAT_SMALL_ZONE;
+	case TAG_BOTLIB:
+		return MEMSTAT_BOTLIB;
+	case TAG_RENDERER:
+		return MEMSTAT_RENDERER;
+	default:
+		return MEMSTAT_ZONE;
+	}
+}
+#endif // RTCW_XX
+
+/*
+=================
+Com_MemStatsReset_f
+=================
+*/
+static void Com_MemStatsReset( void ) {
+	int i;
+
+	for ( i = 0 ; i < MEMSTAT_NUM_GROUPS ; i++ ) {
+		memStats[i].allocs = 0;
+		memStats[i].frees = 0;
+		memStats[i].peak = memStats[i].live;
+		memStats[i].total = 0;
+	}
+
+	Com_Memset( memSites, 0, sizeof( memSites ) );
+	memSiteCount = 0;
+	memSiteOverflow = 0;
+}
+
+static int Com_MemSiteCompare( const void *a, const void *b ) {
+	const memSite_t *sa = *static_cast<const memSite_t * const *>( a );
+	const memSite_t *sb = *static_cast<const memSite_t * const *>( b );
+
+	if ( sa->allocs != sb->allocs ) {
+		return sb->allocs - sa->allocs;
+	}
+	return ( sb->total > sa->total ) - ( sb->total < sa->total );
+}
+
+static const char *Com_MemSiteName( const memSite_t *site ) {
+	if ( site->file ) {
+		return va( "%s:%i", site->file, site->line );
+	}
+	return va( "%p", site->site );
+}
+
+/*
+=================
+Com_MemStatsWrite
+
+Writes one sample, with the call sites if withSites is set
+=================
+*/
+static void Com_MemStatsWrite( fileHandle_t f, qboolean json, qboolean withSites ) {
+	memSite_t   *sorted[MAX_MEM_SITES];
+	const char  *line;
+	int count;
+	int time;
+	int i;
+
+	Com_MemStatHunkLive();
+
+	time = Sys_Milliseconds();
+
+	count = 0;
+	if ( withSites ) {
+		for ( i = 0 ; i < MAX_MEM_SITES ; i++ ) {
+			if ( memSites[i].site ) {
+				sorted[count++] = &memSites[i];
+			}
+		}
+		qsort( sorted, count, sizeof( sorted[0] ), Com_MemSiteCompare );
+	}
+
+	if ( json ) {
+		line = va( "{\"time\":%i,\"groups\":{", time );
+		FS_Write( line, strlen( line ), f );
+		for ( i = 0 ; i < MEMSTAT_NUM_GROUPS ; i++ ) {
+			line = va( "%s\"%s\":{\"allocs\":%i,\"frees\":%i,\"live\":%i,\"peak\":%i,\"total\":%lli}",
+					   i ? "," : "", memStatNames[i], memStats[i].allocs, memStats[i].frees,
+					   memStats[i].live, memStats[i].peak, memStats[i].total );
+			FS_Write( line, strlen( line ), f );
+		}
+		FS_Write( "}", 1, f );
+		if ( withSites ) {
+			FS_Write( ",\"sites\":[", 10, f );
+			for ( i = 0 ; i < count ; i++ ) {
+				line = va( "%s{\"site\":\"%s\",\"group\":\"%s\",\"allocs\":%i,\"total\":%lli}",
+						   i ? "," : "", Com_MemSiteName( sorted[i] ), memStatNames[sorted[i]->group],
+						   sorted[i]->allocs, sorted[i]->total );
+				FS_Write( line, strlen( line ), f );
+			}
+			FS_Write( "]", 1, f );
+		}
+		FS_Write( "}\n", 2, f );
+		return;
+	}
+
+	for ( i = 0 ; i < MEMSTAT_NUM_GROUPS ; i++ ) {
+		line = va( "%i,%s,,%i,%i,%i,%i,%lli\n", time, memStatNames[i], memStats[i].allocs,
+				   memStats[i].frees, memStats[i].live, memStats[i].peak, memStats[i].total );
+		FS_Write( line, strlen( line ), f );
+	}
+	for ( i = 0 ; i < count ; i++ ) {
+		line = va( "%i,%s,%s,%i,,,,%lli\n", time, memStatNames[sorted[i]->group],
+				   Com_MemSiteName( sorted[i] ), sorted[i]->allocs, sorted[i]->total );
+		FS_Write( line, strlen( line ), f );
+	}
+}
+
+static fileHandle_t Com_MemStatsOpen( const char *name, qboolean *json ) {
+	fileHandle_t f;
+	int len;
+
+	len = strlen( name );
+	*json = ( len > 5 && !Q_stricmp( name + len - 5, ".json" ) ) ? qtrue : qfalse;
+
+	FS_FOpenFileByMode( name, &f, FS_APPEND );
+	if ( f && !*json ) {
+		FS_Write( "time,group,site,allocs,frees,live,peak,total\n", 45, f );
+	}
+	return f;
+}
+
+/*
+=================
+Com_MemStatsFrame
+
+Appends a sample to com_memStatsFile every com_memStatsPeriod msec
+=================
+*/
+static void Com_MemStatsFrame( void ) {
+	static qboolean json;
+	int now;
+
+	if ( com_memStatsFile->modified || com_memStatsPeriod->integer <= 0 ) {
+		com_memStatsFile->modified = qfalse;
+		if ( memStatsFile ) {
+			FS_FCloseFile( memStatsFile );
+			memStatsFile = 0;
+		}
+	}
+
+	if ( com_memStatsPeriod->integer <= 0 || !com_memStatsFile->string[0] ) {
+		return;
+	}
+
+	now = Sys_Milliseconds();
+	if ( memStatsFile && now - memStatsLastSample < com_memStatsPeriod->integer ) {
+		return;
+	}
+	memStatsLastSample = now;
+
+	if ( !memStatsFile ) {
+		memStatsFile = Com_MemStatsOpen( com_memStatsFile->string, &json );
+		if ( !memStatsFile ) {
+			Com_Printf( "Couldn't open %s, memory sampling stopped\n", com_memStatsFile->string );
+			Cvar_Set( "com_memStatsPeriod", "0" );
+			return;
+		}
+	}
+
+	Com_MemStatsWrite( memStatsFile, json, qfalse );
+	FS_Flush( memStatsFile );
+}
+
+/*
+=================
+Com_MemStats_f
+
+memstats [reset | sites [count] | write <file>]
+=================
+*/
+static void Com_MemStats_f( void ) {
+	memSite_t   *sorted[MAX_MEM_SITES];
+	const char  *cmd;
+	fileHandle_t f;
+	qboolean json;
+	int count, shown;
+	int i;
+
+	cmd = Cmd_Argv( 1 );
+
+	if ( !Q_stricmp( cmd, "reset" ) ) {
+		Com_MemStatsReset();
+		return;
+	}
+
+	if ( !Q_stricmp( cmd, "write" ) ) {
+		if ( Cmd_Argc() != 3 ) {
+			Com_Printf( "usage: memstats write <file>\n" );
+			return;
+		}
+		f = Com_MemStatsOpen( Cmd_Argv( 2 ), &json );
+		if ( !f ) {
+			Com_Printf( "Couldn't open %s\n", Cmd_Argv( 2 ) );
+			return;
+		}
+		Com_MemStatsWrite( f, json, qtrue );
+		FS_FCloseFile( f );
+		return;
+	}
+
+	if ( !Q_stricmp( cmd, "sites" ) ) {
+		if ( !com_memSites->integer ) {
+			Com_Printf( "set com_memSites 1 to count call sites\n" );
+		}
+
+		shown = 20;
+		if ( Cmd_Argc() > 2 ) {
+			shown = atoi( Cmd_Argv( 2 ) );
+		}
+
+		count = 0;
+		for ( i = 0 ; i < MAX_MEM_SITES ; i++ ) {
+			if ( memSites[i].site ) {
+				sorted[count++] = &memSites[i];
+			}
+		}
+		qsort( sorted, count, sizeof( sorted[0] ), Com_MemSiteCompare );
+
+		Com_Printf( "  allocs        bytes group     site\n" );
+		for ( i = 0 ; i < count && i < shown ; i++ ) {
+			Com_Printf( "%8i %12lli %-9s %s\n", sorted[i]->allocs, sorted[i]->total,
+						memStatNames[sorted[i]->group], Com_MemSiteName( sorted[i] ) );
+		}
+		Com_Printf( "%i sites, %i allocations from untracked sites\n", count, memSiteOverflow );
+		// addresses are relative to the running image
+		Com_Printf( "Com_Init is at %p\n", reinterpret_cast<void*>( Com_Init ) );
+		return;
+	}
+
+	if ( cmd[0] ) {
+		Com_Printf( "usage: memstats [reset | sites [count] | write <file>]\n" );
+		return;
+	}
+
+	Com_MemStatHunkLive();
+
+	Com_Printf( "group       allocs    frees         live         peak        total\n" );
+	for ( i = 0 ; i < MEMSTAT_NUM_GROUPS ; i++ ) {
+		Com_Printf( "%-9s %8i %8i %12i %12i %12lli\n", memStatNames[i], memStats[i].allocs,
+					memStats[i].frees, memStats[i].live, memStats[i].peak, memStats[i].total );
+	}
+}
+
+
 #if defined RTCW_SP
 /*
 ==============================================================================
@@ -999,12 +1399,23 @@ The rover can be left pointing at a non-empty block
 
 The zone calls are pretty much only used for small strings and structures,
 all big things are allocated on the hunk.
+
+Requests of up to SLAB_MAX_SIZE bytes don't go through the rover.  Each zone
+carves TAG_SLAB pages out of itself and splits them into equally sized chunks
+for a few size classes, so small allocations and frees are O(1) and don't
+fragment the block list.  Chunks keep a memblock_t header with their own tag,
+so Z_FreeTags, the trash tester and ZONE_DEBUG work the same on them.
 ==============================================================================
 */
 
 #define ZONEID  0x1d4a11
+#define SLABID  0x1d4a12
 #define MINFRAGMENT 64
 
+#define SLAB_NUM_CLASSES    8
+#define SLAB_MAX_SIZE       256
+#define SLAB_PAGE_SIZE      8192
+
 typedef struct zonedebug_s {
 	char *label;
 	char *file;
@@ -1022,13 +1433,41 @@ typedef struct memblock_s {
 #endif
 } memblock_t;
 
+typedef struct slabPage_s slabPage_t;
+
+typedef struct {
+	int size;               // largest request served by the class
+	int chunkSize;          // including the header and the trash tester
+	slabPage_t  *pages;     // all pages of the class
+	slabPage_t  *partial;   // pages with free chunks
+} slabClass_t;
+
 typedef struct {
 	int size;               // total bytes malloced, including header
 	int used;               // total bytes used
 	memblock_t blocklist;   // start / end cap for linked list
 	memblock_t  *rover;
+	slabClass_t slabs[SLAB_NUM_CLASSES];
 } memzone_t;
 
+// a free chunk links to the next one through its prev field,
+// every chunk points back to its page through its next field
+struct slabPage_s {
+	slabPage_t  *next, *prev;                   // all pages of the class
+	slabPage_t  *nextPartial, *prevPartial;     // pages with free chunks
+	memzone_t   *zone;
+	slabClass_t *cls;
+	byte        *chunks;
+	int numChunks;
+	int used;                                   // chunks in use
+	memblock_t  *freeList;
+};
+
+static const int slabSizes[SLAB_NUM_CLASSES] = { 16, 32, 48, 64, 96, 128, 192, 256 };
+
+// cleared by zoneReplay to time the rover alone
+static qboolean z_zoneSlabs = qtrue;
+
 // main zone for all "dynamic" memory allocation
 memzone_t   *mainzone;
 // we also have a small zone for small allocations that would only
@@ -1040,27 +1479,368 @@ void Z_CheckHeap( void );
 
 /*
 ========================
-Z_ClearZone
+Z_ClearZone
+========================
+*/
+void Z_ClearZone( memzone_t *zone, int size ) {
+	memblock_t  *block;
+	int i;
+
+	// set the entire zone to one free block
+
+	zone->blocklist.next = zone->blocklist.prev = block =
+													  ( memblock_t * )( (byte *)zone + sizeof( memzone_t ) );
+	zone->blocklist.tag = 1;    // in use block
+	zone->blocklist.id = 0;
+	zone->blocklist.size = 0;
+	zone->rover = block;
+	zone->size = size;
+	zone->used = 0;
+
+	block->prev = block->next = &zone->blocklist;
+	block->tag = 0;         // free block
+	block->id = ZONEID;
+	block->size = size - sizeof( memzone_t );
+
+	for ( i = 0 ; i < SLAB_NUM_CLASSES ; i++ ) {
+		zone->slabs[i].size = slabSizes[i];
+		zone->slabs[i].chunkSize = ( sizeof( memblock_t ) + slabSizes[i] + 4 + 7 ) & ~7;
+		zone->slabs[i].pages = NULL;
+		zone->slabs[i].partial = NULL;
+	}
+}
+
+/*
+========================
+Z_FreeBlock
+
+Returns a block to the zone's free list
+========================
+*/
+static void Z_FreeBlock( memzone_t *zone, memblock_t *block ) {
+	memblock_t  *other;
+
+	zone->used -= block->size;
+	// set the block to something that should cause problems
+	// if it is referenced...
+	memset( block + 1, 0xaa, block->size - sizeof( *block ) );
+
+	block->tag = 0;     // mark as free
+
+	other = block->prev;
+	if ( !other->tag ) {
+		// merge with previous free block
+		other->size += block->size;
+		other->next = block->next;
+		other->next->prev = other;
+		if ( block == zone->rover ) {
+			zone->rover = other;
+		}
+		block = other;
+	}
+
+	zone->rover = block;
+
+	other = block->next;
+	if ( !other->tag ) {
+		// merge the next free block onto the end
+		block->size += other->size;
+		block->next = other->next;
+		block->next->prev = block;
+		if ( other == zone->rover ) {
+			zone->rover = block;
+		}
+	}
+}
+
+/*
+========================
+Z_ZoneAlloc
+
+First fit from the rover, returns NULL if nothing is big enough
+========================
+*/
+static memblock_t *Z_ZoneAlloc( memzone_t *zone, int size, int tag ) {
+	int extra;
+	memblock_t  *start, *rover, *new1, *base;
+
+	//
+	// scan through the block list looking for the first free block
+	// of sufficient size
+	//
+	size += sizeof( memblock_t ); // account for size of block header
+	size += 4;                  // space for memory trash tester
+	size = ( size + 3 ) & ~3;     // align to 32 bit boundary
+
+	base = rover = zone->rover;
+	start = base->prev;
+
+	do {
+		if ( rover == start ) {
+			// scaned all the way around the list
+			return NULL;
+		}
+		if ( rover->tag ) {
+			base = rover = rover->next;
+		} else {
+			rover = rover->next;
+		}
+	} while ( base->tag || base->size < size );
+
+	//
+	// found a block big enough
+	//
+	extra = base->size - size;
+	if ( extra > MINFRAGMENT ) {
+		// there will be a free fragment after the allocated block
+		new1 = ( memblock_t * )( (byte *)base + size );
+		new1->size = extra;
+		new1->tag = 0;           // free block
+		new1->prev = base;
+		new1->id = ZONEID;
+		new1->next = base->next;
+		new1->next->prev = new1;
+		base->next = new1;
+		base->size = size;
+	}
+
+	base->tag = tag;            // no longer a free block
+
+	zone->rover = base->next;   // next allocation will start looking here
+	zone->used += base->size;   //
+
+	base->id = ZONEID;
+
+	// marker for memory trash testing
+	*( int * )( (byte *)base + base->size - 4 ) = ZONEID;
+
+	return base;
+}
+
+static void Z_LinkPartialSlab( slabClass_t *cls, slabPage_t *page ) {
+	page->prevPartial = NULL;
+	page->nextPartial = cls->partial;
+	if ( cls->partial ) {
+		cls->partial->prevPartial = page;
+	}
+	cls->partial = page;
+}
+
+static void Z_UnlinkPartialSlab( slabClass_t *cls, slabPage_t *page ) {
+	if ( page->prevPartial ) {
+		page->prevPartial->nextPartial = page->nextPartial;
+	} else {
+		cls->partial = page->nextPartial;
+	}
+	if ( page->nextPartial ) {
+		page->nextPartial->prevPartial = page->prevPartial;
+	}
+	page->nextPartial = page->prevPartial = NULL;
+}
+
+/*
+========================
+Z_NewSlabPage
+========================
+*/
+static slabPage_t *Z_NewSlabPage( memzone_t *zone, slabClass_t *cls ) {
+	memblock_t  *block;
+	memblock_t  *chunk;
+	slabPage_t  *page;
+	int headerSize;
+	int i;
+
+	block = Z_ZoneAlloc( zone, SLAB_PAGE_SIZE, TAG_SLAB );
+	if ( !block ) {
+		return NULL;
+	}
+#ifdef ZONE_DEBUG
+	block->d.label = const_cast<char*>( "slab page" );
+	block->d.file = const_cast<char*>( __FILE__ );
+	block->d.line = __LINE__;
+	block->d.allocSize = SLAB_PAGE_SIZE;
+#endif
+
+	headerSize = ( sizeof( slabPage_t ) + 7 ) & ~7;
+
+	page = reinterpret_cast<slabPage_t*>( block + 1 );
+	page->zone = zone;
+	page->cls = cls;
+	page->chunks = reinterpret_cast<byte*>( page ) + headerSize;
+	page->numChunks = ( SLAB_PAGE_SIZE - headerSize ) / cls->chunkSize;
+	page->used = 0;
+	page->freeList = NULL;
+
+	// build the free list in address order
+	for ( i = page->numChunks - 1 ; i >= 0 ; i-- ) {
+		chunk = reinterpret_cast<memblock_t*>( page->chunks + i * cls->chunkSize );
+		chunk->size = cls->chunkSize;
+		chunk->tag = 0;
+		chunk->id = SLABID;
+		chunk->next = reinterpret_cast<memblock_t*>( page );
+		chunk->prev = page->freeList;
+		page->freeList = chunk;
+	}
+
+	page->prev = NULL;
+	page->next = cls->pages;
+	if ( cls->pages ) {
+		cls->pages->prev = page;
+	}
+	cls->pages = page;
+
+	Z_LinkPartialSlab( cls, page );
+
+	return page;
+}
+
+/*
+========================
+Z_SlabAlloc
+
+Returns NULL if a new page is needed and doesn't fit
+========================
+*/
+static memblock_t *Z_SlabAlloc( memzone_t *zone, int size, int tag ) {
+	slabClass_t *cls;
+	slabPage_t  *page;
+	memblock_t  *chunk;
+
+	for ( cls = zone->slabs ; cls->size < size ; cls++ ) {
+	}
+
+	page = cls->partial;
+	if ( !page ) {
+		page = Z_NewSlabPage( zone, cls );
+		if ( !page ) {
+			return NULL;
+		}
+	}
+
+	chunk = page->freeList;
+	page->freeList = chunk->prev;
+	if ( !page->freeList ) {
+		Z_UnlinkPartialSlab( cls, page );
+	}
+	page->used++;
+
+	chunk->prev = NULL;
+	chunk->tag = tag;
+
+	// marker for memory trash testing
+	*( int * )( (byte *)chunk + chunk->size - 4 ) = ZONEID;
+
+	return chunk;
+}
+
+/*
+========================
+Z_SlabFree
+
+Returns qtrue if the page of the chunk was released
+========================
+*/
+static qboolean Z_SlabFree( memblock_t *chunk ) {
+	slabPage_t  *page;
+	slabClass_t *cls;
+
+	page = reinterpret_cast<slabPage_t*>( chunk->next );
+	cls = page->cls;
+
+	// set the chunk to something that should cause problems
+	// if it is referenced...
+	memset( chunk + 1, 0xaa, chunk->size - sizeof( *chunk ) );
+
+	chunk->tag = 0;
+
+	if ( !page->freeList ) {
+		Z_LinkPartialSlab( cls, page );
+	}
+	chunk->prev = page->freeList;
+	page->freeList = chunk;
+	page->used--;
+
+	// keep one empty page per class around so a single
+	// alloc / free pair doesn't go through the rover each time
+	if ( page->used || ( cls->partial == page && !page->nextPartial ) ) {
+		return qfalse;
+	}
+
+	Z_UnlinkPartialSlab( cls, page );
+	if ( page->prev ) {
+		page->prev->next = page->next;
+	} else {
+		cls->pages = page->next;
+	}
+	if ( page->next ) {
+		page->next->prev = page->prev;
+	}
+
+	Z_FreeBlock( page->zone, reinterpret_cast<memblock_t*>( page ) - 1 );
+	return qtrue;
+}
+
+/*
+========================
+Z_SlabFreeTags
+========================
+*/
+static void Z_SlabFreeTags( memzone_t *zone, int tag ) {
+	slabClass_t *cls;
+	slabPage_t  *page, *next;
+	memblock_t  *chunk;
+	int i, j;
+
+	for ( i = 0, cls = zone->slabs ; i < SLAB_NUM_CLASSES ; i++, cls++ ) {
+		for ( page = cls->pages ; page ; page = next ) {
+			next = page->next;
+
+			for ( j = 0 ; j < page->numChunks ; j++ ) {
+				chunk = reinterpret_cast<memblock_t*>( page->chunks + j * cls->chunkSize );
+				if ( chunk->tag != tag ) {
+					continue;
+				}
+				Com_MemStatFree( Com_MemStatZoneGroup( tag ), chunk->size );
+				if ( Z_SlabFree( chunk ) ) {
+					break;
+				}
+			}
+		}
+	}
+}
+
+/*
+========================
+Z_RecordOp
+
+Allocation trace for zoneReplay
 ========================
 */
-void Z_ClearZone( memzone_t *zone, int size ) {
-	memblock_t  *block;
-
-	// set the entire zone to one free block
-
-	zone->blocklist.next = zone->blocklist.prev = block =
-													  ( memblock_t * )( (byte *)zone + sizeof( memzone_t ) );
-	zone->blocklist.tag = 1;    // in use block
-	zone->blocklist.id = 0;
-	zone->blocklist.size = 0;
-	zone->rover = block;
-	zone->size = size;
-	zone->used = 0;
-
-	block->prev = block->next = &zone->blocklist;
-	block->tag = 0;         // free block
-	block->id = ZONEID;
-	block->size = size - sizeof( memzone_t );
+typedef struct {
+	void    *ptr;
+	int size;               // -1 for a free
+	int tag;
+	int match;              // alloc op freed by this op, or -1
+} zoneOp_t;
+
+static zoneOp_t *z_zoneOps;
+static int z_numZoneOps;
+static int z_maxZoneOps;
+static qboolean z_zoneRecording;
+
+static void Z_RecordOp( void *ptr, int size, int tag ) {
+	zoneOp_t    *op;
+
+	op = &z_zoneOps[z_numZoneOps++];
+	op->ptr = ptr;
+	op->size = size;
+	op->tag = tag;
+	op->match = -1;
+
+	if ( z_numZoneOps == z_maxZoneOps ) {
+		z_zoneRecording = qfalse;
+		Com_Printf( "zoneRecord: recorded %i operations\n", z_numZoneOps );
+	}
 }
 #endif // RTCW_XX
 
@@ -1075,7 +1855,7 @@ void Z_Free( void *ptr ) {
 #if defined RTCW_SP
 	free( ptr );
 #else
-	memblock_t  *block, *other;
+	memblock_t  *block;
 	memzone_t *zone;
 
 	if ( !ptr ) {
@@ -1083,7 +1863,7 @@ void Z_Free( void *ptr ) {
 	}
 
 	block = ( memblock_t * )( (byte *)ptr - sizeof( memblock_t ) );
-	if ( block->id != ZONEID ) {
+	if ( block->id != ZONEID && block->id != SLABID ) {
 		Com_Error( ERR_FATAL, "Z_Free: freed a pointer without ZONEID" );
 	}
 	if ( block->tag == 0 ) {
@@ -1099,43 +1879,24 @@ void Z_Free( void *ptr ) {
 		Com_Error( ERR_FATAL, "Z_Free: memory block wrote past end" );
 	}
 
-	if ( block->tag == TAG_SMALL ) {
-		zone = smallzone;
-	} else {
-		zone = mainzone;
+	if ( z_zoneRecording ) {
+		Z_RecordOp( ptr, -1, 0 );
 	}
 
-	zone->used -= block->size;
-	// set the block to something that should cause problems
-	// if it is referenced...
-	memset( ptr, 0xaa, block->size - sizeof( *block ) );
-
-	block->tag = 0;     // mark as free
+	Com_MemStatFree( Com_MemStatZoneGroup( block->tag ), block->size );
 
-	other = block->prev;
-	if ( !other->tag ) {
-		// merge with previous free block
-		other->size += block->size;
-		other->next = block->next;
-		other->next->prev = other;
-		if ( block == zone->rover ) {
-			zone->rover = other;
-		}
-		block = other;
+	if ( block->id == SLABID ) {
+		Z_SlabFree( block );
+		return;
 	}
 
-	zone->rover = block;
-
-	other = block->next;
-	if ( !other->tag ) {
-		// merge the next free block onto the end
-		block->size += other->size;
-		block->next = other->next;
-		block->next->prev = block;
-		if ( other == zone->rover ) {
-			zone->rover = block;
-		}
+	if ( block->tag == TAG_SMALL ) {
+		zone = smallzone;
+	} else {
+		zone = mainzone;
 	}
+
+	Z_FreeBlock( zone, block );
 #endif // RTCW_XX
 
 }
@@ -1211,6 +1972,10 @@ void Z_FreeTags( int tag ) {
 		zone = mainzone;
 	}
 	count = 0;
+
+	// slab chunks aren't on the block list
+	Z_SlabFreeTags( zone, tag );
+
 	// use the rover as our pointer, because
 	// Z_Free automatically adjusts it
 	zone->rover = zone->blocklist.next;
@@ -1232,14 +1997,19 @@ Z_TagMalloc
 
 memblock_t *debugblock; // RF, jusy so we can track a block to find out when it's getting trashed
 
+static const void *z_caller;    // set by the wrappers so the stats see their caller
+
 #ifdef ZONE_DEBUG
 void *Z_TagMallocDebug( int size, int tag, char *label, char *file, int line ) {
 #else
 void *Z_TagMalloc( int size, int tag ) {
 #endif
-	int extra, allocSize;
-	memblock_t  *start, *rover, *new1, *base;
+	memblock_t  *base;
 	memzone_t *zone;
+	const void  *site;
+
+	site = z_caller ? z_caller : MEMSTAT_CALLER();
+	z_caller = NULL;
 
 	if ( !tag ) {
 		Com_Error( ERR_FATAL, "Z_TagMalloc: tried to use a 0 tag" );
@@ -1251,68 +2021,35 @@ void *Z_TagMalloc( int size, int tag ) {
 		zone = mainzone;
 	}
 
-	allocSize = size;
-	//
-	// scan through the block list looking for the first free block
-	// of sufficient size
-	//
-	size += sizeof( memblock_t ); // account for size of block header
-	size += 4;                  // space for memory trash tester
-	size = ( size + 3 ) & ~3;     // align to 32 bit boundary
-
-	base = rover = zone->rover;
-	start = base->prev;
-
-	do {
-		if ( rover == start ) {
+	base = NULL;
+	if ( size <= SLAB_MAX_SIZE && z_zoneSlabs ) {
+		base = Z_SlabAlloc( zone, size, tag );
+	}
+	if ( !base ) {
+		base = Z_ZoneAlloc( zone, size, tag );
+	}
+	if ( !base ) {
 #ifdef ZONE_DEBUG
-			Z_LogHeap();
+		Z_LogHeap();
 #endif
-			// scaned all the way around the list
-			Com_Error( ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone",
-					   size, zone == smallzone ? "small" : "main" );
-			return NULL;
-		}
-		if ( rover->tag ) {
-			base = rover = rover->next;
-		} else {
-			rover = rover->next;
-		}
-	} while ( base->tag || base->size < size );
-
-	//
-	// found a block big enough
-	//
-	extra = base->size - size;
-	if ( extra > MINFRAGMENT ) {
-		// there will be a free fragment after the allocated block
-		new1 = ( memblock_t * )( (byte *)base + size );
-		new1->size = extra;
-		new1->tag = 0;           // free block
-		new1->prev = base;
-		new1->id = ZONEID;
-		new1->next = base->next;
-		new1->next->prev = new1;
-		base->next = new1;
-		base->size = size;
+		Com_Error( ERR_FATAL, "Z_Malloc: failed on allocation of %i bytes from the %s zone",
+				   size, zone == smallzone ? "small" : "main" );
+		return NULL;
 	}
 
-	base->tag = tag;            // no longer a free block
-
-	zone->rover = base->next;   // next allocation will start looking here
-	zone->used += base->size;   //
-
-	base->id = ZONEID;
-
 #ifdef ZONE_DEBUG
 	base->d.label = label;
 	base->d.file = file;
 	base->d.line = line;
-	base->d.allocSize = allocSize;
+	base->d.allocSize = size;
+	Com_MemStatAlloc( Com_MemStatZoneGroup( tag ), base->size, site, file, line );
+#else
+	Com_MemStatAlloc( Com_MemStatZoneGroup( tag ), base->size, site, NULL, 0 );
 #endif
 
-	// marker for memory trash testing
-	*( int * )( (byte *)base + base->size - 4 ) = ZONEID;
+	if ( z_zoneRecording ) {
+		Z_RecordOp( base + 1, size, tag );
+	}
 
 	return ( void * )( (byte *)base + sizeof( memblock_t ) );
 }
@@ -1331,6 +2068,10 @@ void *Z_Malloc( int size ) {
 
 	//Z_CheckHeap ();	// DEBUG
 
+	if ( !z_caller ) {
+		z_caller = MEMSTAT_CALLER();
+	}
+
 #ifdef ZONE_DEBUG
 	buf = Z_TagMallocDebug( size, TAG_GENERAL, label, file, line );
 #else
@@ -1343,10 +2084,16 @@ void *Z_Malloc( int size ) {
 
 #ifdef ZONE_DEBUG
 void *S_MallocDebug( int size, char *label, char *file, int line ) {
+	if ( !z_caller ) {
+		z_caller = MEMSTAT_CALLER();
+	}
 	return Z_TagMallocDebug( size, TAG_SMALL, label, file, line );
 }
 #else
 void *S_Malloc( int size ) {
+	if ( !z_caller ) {
+		z_caller = MEMSTAT_CALLER();
+	}
 	return Z_TagMalloc( size, TAG_SMALL );
 }
 #endif
@@ -1380,14 +2127,37 @@ void Z_CheckHeap( void ) {
 Z_LogZoneHeap
 ========================
 */
-void Z_LogZoneHeap( memzone_t *zone, const char *name ) {
+static void Z_LogBlock( memblock_t *block, int *size, int *allocSize, int *numBlocks ) {
 #ifdef ZONE_DEBUG
 	char dump[32], *ptr;
 	int i, j;
+	char buf[4096];
+
+	ptr = ( (char *) block ) + sizeof( memblock_t );
+	j = 0;
+	for ( i = 0; i < 20 && i < block->d.allocSize; i++ ) {
+		if ( ptr[i] >= 32 && ptr[i] < 127 ) {
+			dump[j++] = ptr[i];
+		} else {
+			dump[j++] = '_';
+		}
+	}
+	dump[j] = '\0';
+	Com_sprintf( buf, sizeof( buf ), "size = %8d: %s, line: %d (%s) [%s]\r\n", block->d.allocSize, block->d.file, block->d.line, block->d.label, dump );
+	FS_Write( buf, strlen( buf ), logfile );
+	*allocSize += block->d.allocSize;
 #endif
+	*size += block->size;
+	*numBlocks += 1;
+}
+
+void Z_LogZoneHeap( memzone_t *zone, const char *name ) {
 	memblock_t  *block;
+	memblock_t  *chunk;
+	slabPage_t  *page;
 	char buf[4096];
 	int size, allocSize, numBlocks;
+	int i;
 
 	if ( !logfile || !FS_Initialized() ) {
 		return;
@@ -1396,24 +2166,16 @@ void Z_LogZoneHeap( memzone_t *zone, const char *name ) {
 	Com_sprintf( buf, sizeof( buf ), "\r\n================\r\n%s log\r\n================\r\n", name );
 	FS_Write( buf, strlen( buf ), logfile );
 	for ( block = zone->blocklist.next ; block->next != &zone->blocklist; block = block->next ) {
-		if ( block->tag ) {
-#ifdef ZONE_DEBUG
-			ptr = ( (char *) block ) + sizeof( memblock_t );
-			j = 0;
-			for ( i = 0; i < 20 && i < block->d.allocSize; i++ ) {
-				if ( ptr[i] >= 32 && ptr[i] < 127 ) {
-					dump[j++] = ptr[i];
-				} else {
-					dump[j++] = '_';
+		if ( block->tag == TAG_SLAB ) {
+			page = reinterpret_cast<slabPage_t*>( block + 1 );
+			for ( i = 0 ; i < page->numChunks ; i++ ) {
+				chunk = reinterpret_cast<memblock_t*>( page->chunks + i * page->cls->chunkSize );
+				if ( chunk->tag ) {
+					Z_LogBlock( chunk, &size, &allocSize, &numBlocks );
 				}
 			}
-			dump[j] = '\0';
-			Com_sprintf( buf, sizeof( buf ), "size = %8d: %s, line: %d (%s) [%s]\r\n", block->d.allocSize, block->d.file, block->d.line, block->d.label, dump );
-			FS_Write( buf, strlen( buf ), logfile );
-			allocSize += block->d.allocSize;
-#endif
-			size += block->size;
-			numBlocks++;
+		} else if ( block->tag ) {
+			Z_LogBlock( block, &size, &allocSize, &numBlocks );
 		}
 	}
 #ifdef ZONE_DEBUG
@@ -1482,6 +2244,7 @@ char *CopyString( const char *in ) {
 			return ( (char *)&numberstring[in[0] - '0'] ) + sizeof( memblock_t );
 		}
 	}
+	z_caller = MEMSTAT_CALLER();
 	out = static_cast<char*> (S_Malloc( strlen( in ) + 1 ));
 #endif // RTCW_XX
 
@@ -1553,6 +2316,27 @@ static hunkblock_t *hunkblocks;
 static hunkUsed_t hunk_low, hunk_high;
 static hunkUsed_t  *hunk_permanent, *hunk_temp;
 
+/*
+=================
+Com_MemStatHunkLive
+
+The hunk is a pair of stacks, so live bytes come from the marks
+=================
+*/
+static void Com_MemStatHunkLive( void ) {
+	memStat_t   *stat;
+
+	memStats[MEMSTAT_HUNK_LOW].live = hunk_low.permanent;
+	memStats[MEMSTAT_HUNK_HIGH].live = hunk_high.permanent;
+	memStats[MEMSTAT_HUNK_TEMP].live = ( hunk_low.temp - hunk_low.permanent ) + ( hunk_high.temp - hunk_high.permanent );
+
+	for ( stat = &memStats[MEMSTAT_HUNK_LOW] ; stat <= &memStats[MEMSTAT_HUNK_TEMP] ; stat++ ) {
+		if ( stat->live > stat->peak ) {
+			stat->peak = stat->live;
+		}
+	}
+}
+
 static byte    *s_hunkData = NULL;
 static int s_hunkTotal;
 
@@ -1573,9 +2357,13 @@ void Com_Meminfo_f( void ) {
 
 #if !defined RTCW_SP
 	memblock_t  *block;
+	memblock_t  *chunk;
+	slabPage_t  *page;
 	int zoneBytes, zoneBlocks;
 	int smallZoneBytes, smallZoneBlocks;
 	int botlibBytes, rendererBytes;
+	int slabPages, slabFreeBytes;
+	int i;
 #endif // RTCW_XX
 
 	int unused;
@@ -1585,12 +2373,33 @@ void Com_Meminfo_f( void ) {
 	botlibBytes = 0;
 	rendererBytes = 0;
 	zoneBlocks = 0;
+	slabPages = 0;
+	slabFreeBytes = 0;
 	for ( block = mainzone->blocklist.next ; ; block = block->next ) {
 		if ( Cmd_Argc() != 1 ) {
 			Com_Printf( "block:%p    size:%7i    tag:%3i\n",
 						block, block->size, block->tag );
 		}
-		if ( block->tag ) {
+		if ( block->tag == TAG_SLAB ) {
+			// count the chunks as blocks of their own
+			page = reinterpret_cast<slabPage_t*>( block + 1 );
+			slabPages++;
+			slabFreeBytes += block->size;
+			for ( i = 0 ; i < page->numChunks ; i++ ) {
+				chunk = reinterpret_cast<memblock_t*>( page->chunks + i * page->cls->chunkSize );
+				if ( !chunk->tag ) {
+					continue;
+				}
+				zoneBytes += chunk->size;
+				zoneBlocks++;
+				slabFreeBytes -= chunk->size;
+				if ( chunk->tag == TAG_BOTLIB ) {
+					botlibBytes += chunk->size;
+				} else if ( chunk->tag == TAG_RENDERER ) {
+					rendererBytes += chunk->size;
+				}
+			}
+		} else if ( block->tag ) {
 			zoneBytes += block->size;
 			zoneBlocks++;
 			if ( block->tag == TAG_BOTLIB ) {
@@ -1617,7 +2426,19 @@ void Com_Meminfo_f( void ) {
 	smallZoneBytes = 0;
 	smallZoneBlocks = 0;
 	for ( block = smallzone->blocklist.next ; ; block = block->next ) {
-		if ( block->tag ) {
+		if ( block->tag == TAG_SLAB ) {
+			page = reinterpret_cast<slabPage_t*>( block + 1 );
+			slabPages++;
+			slabFreeBytes += block->size;
+			for ( i = 0 ; i < page->numChunks ; i++ ) {
+				chunk = reinterpret_cast<memblock_t*>( page->chunks + i * page->cls->chunkSize );
+				if ( chunk->tag ) {
+					smallZoneBytes += chunk->size;
+					smallZoneBlocks++;
+					slabFreeBytes -= chunk->size;
+				}
+			}
+		} else if ( block->tag ) {
 			smallZoneBytes += block->size;
 			smallZoneBlocks++;
 		}
@@ -1692,16 +2513,220 @@ void Com_Meminfo_f( void ) {
 	Com_Printf( "        %8i bytes in dynamic renderer\n", rendererBytes );
 	Com_Printf( "        %8i bytes in dynamic other\n", zoneBytes - ( botlibBytes + rendererBytes ) );
 	Com_Printf( "        %8i bytes in small Zone memory\n", smallZoneBytes );
+	Com_Printf( "        %8i bytes free in %i slab pages\n", slabFreeBytes, slabPages );
 #else
 	Com_Printf( "%9i bytes (%6.2f MB) in %i zone blocks\n", zoneBytes, zoneBytes / Square( 1024.f ), zoneBlocks );
 	Com_Printf( "        %9i bytes (%6.2f MB) in dynamic botlib\n", botlibBytes, botlibBytes / Square( 1024.f ) );
 	Com_Printf( "        %9i bytes (%6.2f MB) in dynamic renderer\n", rendererBytes, rendererBytes / Square( 1024.f ) );
 	Com_Printf( "        %9i bytes (%6.2f MB) in dynamic other\n", zoneBytes - ( botlibBytes + rendererBytes ), ( zoneBytes - ( botlibBytes + rendererBytes ) ) / Square( 1024.f ) );
 	Com_Printf( "        %9i bytes (%6.2f MB) in small Zone memory\n", smallZoneBytes, smallZoneBytes / Square( 1024.f ) );
+	Com_Printf( "        %9i bytes (%6.2f MB) free in %i slab pages\n", slabFreeBytes, slabFreeBytes / Square( 1024.f ), slabPages );
 #endif // RTCW_XX
 
 }
 
+#if !defined RTCW_SP
+/*
+=================
+Z_ZoneRecord_f
+
+Records the next zone allocations and frees for zoneReplay
+=================
+*/
+static void Z_ZoneRecord_f( void ) {
+	int count;
+
+	count = 100000;
+	if ( Cmd_Argc() > 1 ) {
+		count = atoi( Cmd_Argv( 1 ) );
+	}
+	if ( count <= 0 ) {
+		Com_Printf( "usage: zoneRecord [count]\n" );
+		return;
+	}
+
+	z_zoneRecording = qfalse;
+	free( z_zoneOps );
+
+	z_zoneOps = static_cast<zoneOp_t*>( malloc( count * sizeof( *z_zoneOps ) ) );
+	if ( !z_zoneOps ) {
+		z_numZoneOps = z_maxZoneOps = 0;
+		Com_Printf( "zoneRecord: couldn't allocate %i operations\n", count );
+		return;
+	}
+	z_numZoneOps = 0;
+	z_maxZoneOps = count;
+	z_zoneRecording = qtrue;
+
+	Com_Printf( "zoneRecord: recording %i operations\n", count );
+}
+
+/*
+=================
+Z_MatchZoneOps
+
+Links every recorded free to the allocation it releases
+=================
+*/
+static void Z_MatchZoneOps( void ) {
+	const int hashSize = 4096;
+	int     *heads;
+	int     *next;
+	int     *link;
+	int i;
+	int hash;
+
+	heads = static_cast<int*>( malloc( hashSize * sizeof( *heads ) ) );
+	next = static_cast<int*>( malloc( z_numZoneOps * sizeof( *next ) ) );
+
+	for ( i = 0 ; i < hashSize ; i++ ) {
+		heads[i] = -1;
+	}
+
+	for ( i = 0 ; i < z_numZoneOps ; i++ ) {
+		hash = static_cast<int>( ( reinterpret_cast<size_t>( z_zoneOps[i].ptr ) >> 3 ) & ( hashSize - 1 ) );
+
+		if ( z_zoneOps[i].size >= 0 ) {
+			next[i] = heads[hash];
+			heads[hash] = i;
+			continue;
+		}
+
+		// frees of blocks allocated before the recording have no match
+		z_zoneOps[i].match = -1;
+		for ( link = &heads[hash] ; *link >= 0 ; link = &next[*link] ) {
+			if ( z_zoneOps[*link].ptr == z_zoneOps[i].ptr ) {
+				z_zoneOps[i].match = *link;
+				*link = next[*link];
+				break;
+			}
+		}
+	}
+
+	free( next );
+	free( heads );
+}
+
+/*
+=================
+Z_ReplayZoneOps
+
+Runs the recorded operations against empty scratch zones,
+returns the time taken and the free block count left behind
+=================
+*/
+static long long Z_ReplayZoneOps( qboolean slabs, int passes, int *freeBlocks ) {
+	memzone_t   *savedMain, *savedSmall;
+	memzone_t   *scratchMain, *scratchSmall;
+	memblock_t  *block;
+	qboolean savedSlabs;
+	void        **live;
+	long long start, time;
+	int pass, i;
+
+	scratchMain = static_cast<memzone_t*>( malloc( s_zoneTotal ) );
+	scratchSmall = static_cast<memzone_t*>( malloc( s_zoneTotal ) );
+	live = static_cast<void**>( malloc( z_numZoneOps * sizeof( *live ) ) );
+	if ( !scratchMain || !scratchSmall || !live ) {
+		free( scratchMain );
+		free( scratchSmall );
+		free( live );
+		*freeBlocks = 0;
+		return -1;
+	}
+
+	savedMain = mainzone;
+	savedSmall = smallzone;
+	savedSlabs = z_zoneSlabs;
+
+	mainzone = scratchMain;
+	smallzone = scratchSmall;
+	z_zoneSlabs = slabs;
+	memStatsPaused = qtrue;
+
+	time = 0;
+	*freeBlocks = 0;
+
+	for ( pass = 0 ; pass < passes ; pass++ ) {
+		Z_ClearZone( mainzone, s_zoneTotal );
+		Z_ClearZone( smallzone, s_zoneTotal );
+		memset( live, 0, z_numZoneOps * sizeof( *live ) );
+
+		start = Sys_Microseconds();
+		for ( i = 0 ; i < z_numZoneOps ; i++ ) {
+			if ( z_zoneOps[i].size >= 0 ) {
+				live[i] = Z_TagMalloc( z_zoneOps[i].size, z_zoneOps[i].tag );
+			} else if ( z_zoneOps[i].match >= 0 && live[z_zoneOps[i].match] ) {
+				Z_Free( live[z_zoneOps[i].match] );
+				live[z_zoneOps[i].match] = NULL;
+			}
+		}
+		time += Sys_Microseconds() - start;
+
+		*freeBlocks = 0;
+		for ( block = mainzone->blocklist.next ; block != &mainzone->blocklist ; block = block->next ) {
+			if ( !block->tag ) {
+				*freeBlocks += 1;
+			}
+		}
+	}
+
+	mainzone = savedMain;
+	smallzone = savedSmall;
+	z_zoneSlabs = savedSlabs;
+	memStatsPaused = qfalse;
+
+	free( live );
+	free( scratchSmall );
+	free( scratchMain );
+
+	return time;
+}
+
+/*
+=================
+Z_ZoneReplay_f
+
+Stops the recording and replays it through the rover alone and with the slabs
+=================
+*/
+static void Z_ZoneReplay_f( void ) {
+	long long roverTime, slabTime;
+	int roverFree, slabFree;
+	int passes;
+
+	// stop a recording still in progress
+	z_zoneRecording = qfalse;
+
+	if ( !z_numZoneOps ) {
+		Com_Printf( "zoneReplay: nothing recorded, use zoneRecord first\n" );
+		return;
+	}
+
+	passes = 1;
+	if ( Cmd_Argc() > 1 ) {
+		passes = atoi( Cmd_Argv( 1 ) );
+	}
+	if ( passes <= 0 ) {
+		Com_Printf( "usage: zoneReplay [passes]\n" );
+		return;
+	}
+
+	Z_MatchZoneOps();
+
+	roverTime = Z_ReplayZoneOps( qfalse, passes, &roverFree );
+	slabTime = Z_ReplayZoneOps( qtrue, passes, &slabFree );
+	if ( roverTime < 0 || slabTime < 0 ) {
+		Com_Printf( "zoneReplay: couldn't allocate the scratch zones\n" );
+		return;
+	}
+
+	Com_Printf( "%i operations, %i passes\n", z_numZoneOps, passes );
+	Com_Printf( "rover: %8lli usec, %i free blocks\n", roverTime, roverFree );
+	Com_Printf( "slabs: %8lli usec, %i free blocks\n", slabTime, slabFree );
+}
+#endif // RTCW_XX
+
 /*
 ===============
 Com_TouchMemory
@@ -1968,8 +2993,15 @@ void Com_InitHunkMemory( void ) {
 	Hunk_Clear();
 
 	Cmd_AddCommand( "meminfo", Com_Meminfo_f );
+	Cmd_AddCommand( "memstats", Com_MemStats_f );
+
+	com_memSites = Cvar_Get( "com_memSites", "0", 0 );
+	com_memStatsPeriod = Cvar_Get( "com_memStatsPeriod", "0", 0 );
+	com_memStatsFile = Cvar_Get( "com_memStatsFile", "memstats.csv", 0 );
 
 #if !defined RTCW_SP
+	Cmd_AddCommand( "zoneRecord", Z_ZoneRecord_f );
+	Cmd_AddCommand( "zoneReplay", Z_ZoneReplay_f );
 #ifdef ZONE_DEBUG
 	Cmd_AddCommand( "zonelog", Z_LogHeap );
 #endif
@@ -2144,6 +3176,12 @@ void *Hunk_Alloc( int size, ha_pref preference ) {
 
 	hunk_permanent->temp = hunk_permanent->permanent;
 
+#ifdef HUNK_DEBUG
+	Com_MemStatAlloc( hunk_permanent == &hunk_low ? MEMSTAT_HUNK_LOW : MEMSTAT_HUNK_HIGH, size, MEMSTAT_CALLER(), file, line );
+#else
+	Com_MemStatAlloc( hunk_permanent == &hunk_low ? MEMSTAT_HUNK_LOW : MEMSTAT_HUNK_HIGH, size, MEMSTAT_CALLER(), NULL, 0 );
+#endif
+
 	memset( buf, 0, size );
 
 #ifdef HUNK_DEBUG
@@ -2233,6 +3271,8 @@ void *Hunk_AllocateTempMemory( int size ) {
 	hdr->magic = HUNK_MAGIC;
 	hdr->size = size;
 
+	Com_MemStatAlloc( MEMSTAT_HUNK_TEMP, size, MEMSTAT_CALLER(), NULL, 0 );
+
 	// don't bother clearing, because we are going to load a file over it
 	return buf;
 }
@@ -2278,6 +3318,8 @@ void Hunk_FreeTempMemory( void *buf ) {
 			Com_Printf( "Hunk_FreeTempMemory: not the final block\n" );
 		}
 	}
+
+	Com_MemStatFree( MEMSTAT_HUNK_TEMP, hdr->size );
 }
 
 
@@ -2455,7 +3497,7 @@ sysEvent_t  Com_GetRealEvent( void ) {
 			Com_Error( ERR_FATAL, "Error reading from journal file" );
 		}
 		if ( ev.evPtrLength ) {
-			ev.evPtr = Z_Malloc( ev.evPtrLength );
+			ev.evPtr = Sys_AllocEventData( ev.evPtrLength );
 			r = FS_Read( ev.evPtr, ev.evPtrLength, com_journalFile );
 			if ( r != ev.evPtrLength ) {
 				Com_Error( ERR_FATAL, "Error reading from journal file" );
@@ -2520,7 +3562,7 @@ void Com_PushEvent( sysEvent_t *event ) {
 		}
 
 		if ( ev->evPtr ) {
-			Z_Free( ev->evPtr );
+			Sys_FreeEventData( ev->evPtr );
 		}
 		com_pushedEventsTail++;
 	} else {
@@ -2688,7 +3730,7 @@ int Com_EventLoop( void ) {
 
 		// free any block data
 		if ( ev.evPtr ) {
-			Z_Free( ev.evPtr );
+			Sys_FreeEventData( ev.evPtr );
 		}
 	}
 
@@ -3165,6 +4207,9 @@ void Com_Init( char *commandLine ) {
 	// done early so bind command exists
 	CL_InitKeyCommands();
 
+	// the file system opens the pk3 files on the job workers
+	Sys_InitJobs();
+
 	FS_InitFilesystem();
 
 	Com_InitJournaling();
@@ -3378,6 +4423,9 @@ void Com_Init( char *commandLine ) {
 		Cmd_AddCommand( "error", Com_Error_f );
 		Cmd_AddCommand( "crash", Com_Crash_f );
 		Cmd_AddCommand( "freeze", Com_Freeze_f );
+		Cmd_AddCommand( "msgHuffTest", MSG_HuffTest_f );
+		Cmd_AddCommand( "traceRecord", CM_TraceRecord_f );
+		Cmd_AddCommand( "traceReplay", CM_TraceReplay_f );
 
 #if defined RTCW_ET
 		Cmd_AddCommand( "cpuspeed", Com_CPUSpeed_f );
@@ -3769,12 +4817,23 @@ void Com_Frame( void ) {
 	}
 
 	// we may want to spin here if things are going too fast
-	if ( !com_dedicated->integer && com_maxfps->integer > 0 && !com_timedemo->integer ) {
+	if ( com_dedicated->integer ) {
+		minMsec = SV_FrameMsec();
+	} else if ( com_maxfps->integer > 0 && !com_timedemo->integer ) {
 		minMsec = 1000 / com_maxfps->integer;
 	} else {
 		minMsec = 1;
 	}
 	do {
+		if ( com_dedicated->integer ) {
+			// block on the socket until a packet arrives or the next server frame is due
+			const int timeVal = minMsec - ( Sys_Milliseconds() - lastTime );
+
+			if ( timeVal > 0 ) {
+				NET_Sleep( timeVal );
+			}
+		}
+
 		com_frameTime = Com_EventLoop();
 		if ( lastTime > com_frameTime ) {
 			lastTime = com_frameTime;       // possible on first frame
@@ -3928,6 +4987,8 @@ void Com_Frame( void ) {
 	// old net chan encryption key
 	key = lastTime * 0x87243987;
 
+	Com_MemStatsFrame();
+
 	com_frameNumber++;
 }
 
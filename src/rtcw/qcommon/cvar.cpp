@@ -13,6 +13,7 @@ SPDX-License-Identifier: GPL-3.0
 cvar_t      *cvar_vars;
 cvar_t      *cvar_cheats;
 int cvar_modifiedFlags;
+int cvar_modificationCount;
 
 #if !defined RTCW_ET
 #define MAX_CVARS   1024
@@ -23,38 +24,252 @@ int cvar_modifiedFlags;
 cvar_t cvar_indexes[MAX_CVARS];
 int cvar_numIndexes;
 
-#if !defined RTCW_ET
-#define FILE_HASH_SIZE      256
+// open addressing; indexes are never reused, so at most half the slots are taken
+#define CVAR_HASH_SIZE      ( MAX_CVARS * 2 )
+#define CVAR_HASH_EMPTY     0
+#define CVAR_HASH_REMOVED   -1
+
+typedef struct {
+	int index;                      // into cvar_indexes plus one, or one of the above
+	unsigned int hash;
+} cvarHashSlot_t;
+
+static cvarHashSlot_t cvar_hashTable[CVAR_HASH_SIZE];
+
+// cvar names and values are interned, so cvars holding the same text share it,
+// and values that go out of use are kept for a while, so a cvar that flips
+// between a few values doesn't touch the zone
+#define CVAR_STRING_HASH_SIZE   1024
+#define CVAR_MAX_UNUSED_STRINGS 256
+
+typedef struct cvarString_s {
+	struct cvarString_s *next;
+	unsigned int hash;
+	int refCount;
+	char string[1];
+} cvarString_t;
+
+static cvarString_t *cvar_strings[CVAR_STRING_HASH_SIZE];
+static int cvar_numStrings;
+static int cvar_numUnusedStrings;
+
+// infostrings are rebuilt only after a cvar changes
+#define CVAR_INFO_CACHE_SIZE    4
+
+typedef struct {
+	int bit;
+	int modifications;
+	char info[MAX_INFO_STRING];
+} cvarInfoCache_t;
+
+static int cvar_flagModifications[32];  // changes to cvars with each flag bit set
+
+static cvarInfoCache_t cvar_infoCache[CVAR_INFO_CACHE_SIZE];
+static int cvar_nextInfoCache;
+
+cvar_t *Cvar_Set2( const char *var_name, const char *value, qboolean force );
+
+/*
+================
+Cvar_Hash
+
+FNV-1a, optionally ignoring case
+================
+*/
+static unsigned int Cvar_Hash( const char *s, qboolean ignoreCase ) {
+	unsigned int hash;
+	int c;
+
+	if ( !s ) {
+		Com_Error( ERR_DROP, "null name in Cvar_Hash" );
+	}
+
+	hash = 2166136261u;
+	for ( ; *s ; s++ ) {
+		c = (unsigned char)*s;
+		if ( ignoreCase ) {
+			c = tolower( c );
+		}
+		hash ^= c;
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/*
+================
+Cvar_Modified
+
+Notes a change to the value or flags of a cvar, or its creation or removal
+================
+*/
+static void Cvar_Modified( const cvar_t *var ) {
+	int i;
+
+	cvar_modificationCount++;
+
+	for ( i = 0 ; i < 32 ; i++ ) {
+		if ( var->flags & ( 1 << i ) ) {
+			cvar_flagModifications[i]++;
+		}
+	}
+}
+
+/*
+================
+Cvar_FlagModifications
+
+Changes whenever a cvar with any of the bits changes
+================
+*/
+static int Cvar_FlagModifications( int bit ) {
+	int count;
+	int i;
+
+	count = 0;
+	for ( i = 0 ; i < 32 ; i++ ) {
+		if ( bit & ( 1 << i ) ) {
+			count += cvar_flagModifications[i];
+		}
+	}
+
+	return count;
+}
+
+/*
+================
+Cvar_InternString
+================
+*/
+static char *Cvar_InternString( const char *s ) {
+	cvarString_t    *str;
+	cvarString_t    **bucket;
+	unsigned int hash;
+	int length;
+
+	hash = Cvar_Hash( s, qfalse );
+	bucket = &cvar_strings[hash & ( CVAR_STRING_HASH_SIZE - 1 )];
+
+	for ( str = *bucket ; str ; str = str->next ) {
+		if ( str->hash == hash && !strcmp( str->string, s ) ) {
+			if ( !str->refCount ) {
+				cvar_numUnusedStrings--;
+			}
+			str->refCount++;
+			return str->string;
+		}
+	}
+
+	length = strlen( s );
+	// cvars are created before the main zone is
+#if defined RTCW_SP
+	str = static_cast<cvarString_t*>( Z_Malloc( sizeof( *str ) + length ) );
 #else
-#define FILE_HASH_SIZE      512
+	str = static_cast<cvarString_t*>( S_Malloc( sizeof( *str ) + length ) );
 #endif // RTCW_XX
+	str->hash = hash;
+	str->refCount = 1;
+	memcpy( str->string, s, length + 1 );
 
-static cvar_t*     hashTable[FILE_HASH_SIZE];
+	str->next = *bucket;
+	*bucket = str;
+	cvar_numStrings++;
 
-cvar_t *Cvar_Set2( const char *var_name, const char *value, qboolean force );
+	return str->string;
+}
 
 /*
 ================
-return a hash value for the filename
+Cvar_PurgeStrings
+
+Frees the strings no cvar refers to
 ================
 */
-static int32_t generateHashValue( const char *fname ) {
+static void Cvar_PurgeStrings( void ) {
+	cvarString_t    *str;
+	cvarString_t    **prev;
 	int i;
-	int32_t hash;
-	char letter;
 
-	if ( !fname ) {
-		Com_Error( ERR_DROP, "null name in generateHashValue" );       //gjd
+	for ( i = 0 ; i < CVAR_STRING_HASH_SIZE ; i++ ) {
+		prev = &cvar_strings[i];
+		while ( ( str = *prev ) != NULL ) {
+			if ( str->refCount ) {
+				prev = &str->next;
+				continue;
+			}
+			*prev = str->next;
+			Z_Free( str );
+			cvar_numStrings--;
+		}
 	}
-	hash = 0;
-	i = 0;
-	while ( fname[i] != '\0' ) {
-		letter = tolower( fname[i] );
-		hash += (int32_t)( letter ) * ( i + 119 );
-		i++;
+
+	cvar_numUnusedStrings = 0;
+}
+
+/*
+================
+Cvar_ReleaseString
+================
+*/
+static void Cvar_ReleaseString( const char *s ) {
+	cvarString_t    *str;
+
+	if ( !s ) {
+		return;
+	}
+
+	str = reinterpret_cast<cvarString_t*>( const_cast<char*>( s ) - offsetof( cvarString_t, string ) );
+	if ( str->refCount <= 0 ) {
+		Com_Error( ERR_FATAL, "Cvar_ReleaseString: \"%s\" is not referenced", s );
+	}
+
+	if ( --str->refCount ) {
+		return;
+	}
+
+	if ( ++cvar_numUnusedStrings > CVAR_MAX_UNUSED_STRINGS ) {
+		Cvar_PurgeStrings();
+	}
+}
+
+/*
+================
+Cvar_HashVar
+================
+*/
+static void Cvar_HashVar( cvar_t *var ) {
+	unsigned int hash;
+	int i;
+
+	hash = Cvar_Hash( var->name, qtrue );
+
+	i = hash & ( CVAR_HASH_SIZE - 1 );
+	while ( cvar_hashTable[i].index > 0 ) {
+		i = ( i + 1 ) & ( CVAR_HASH_SIZE - 1 );
+	}
+
+	cvar_hashTable[i].index = var - cvar_indexes + 1;
+	cvar_hashTable[i].hash = hash;
+}
+
+/*
+================
+Cvar_UnhashVar
+================
+*/
+static void Cvar_UnhashVar( cvar_t *var ) {
+	int index;
+	int i;
+
+	index = var - cvar_indexes + 1;
+
+	for ( i = Cvar_Hash( var->name, qtrue ) & ( CVAR_HASH_SIZE - 1 ) ; cvar_hashTable[i].index != CVAR_HASH_EMPTY ; i = ( i + 1 ) & ( CVAR_HASH_SIZE - 1 ) ) {
+		if ( cvar_hashTable[i].index == index ) {
+			cvar_hashTable[i].index = CVAR_HASH_REMOVED;
+			return;
+		}
 	}
-	hash &= ( FILE_HASH_SIZE - 1 );
-	return hash;
 }
 
 /*
@@ -84,14 +299,20 @@ Cvar_FindVar
 ============
 */
 static cvar_t *Cvar_FindVar( const char *var_name ) {
+	const cvarHashSlot_t    *slot;
 	cvar_t  *var;
-	int32_t hash;
+	unsigned int hash;
+	int i;
 
-	hash = generateHashValue( var_name );
+	hash = Cvar_Hash( var_name, qtrue );
 
-	for ( var = hashTable[hash] ; var ; var = var->hashNext ) {
-		if ( !Q_stricmp( var_name, var->name ) ) {
-			return var;
+	for ( i = hash & ( CVAR_HASH_SIZE - 1 ) ; cvar_hashTable[i].index != CVAR_HASH_EMPTY ; i = ( i + 1 ) & ( CVAR_HASH_SIZE - 1 ) ) {
+		slot = &cvar_hashTable[i];
+		if ( slot->index > 0 && slot->hash == hash ) {
+			var = &cvar_indexes[slot->index - 1];
+			if ( !Q_stricmp( var_name, var->name ) ) {
+				return var;
+			}
 		}
 	}
 
@@ -239,7 +460,6 @@ The flags will be or'ed in if the variable exists.
 */
 cvar_t *Cvar_Get( const char *var_name, const char *var_value, int flags ) {
 	cvar_t  *var;
-	int32_t hash;
 
 	if ( !var_name || !var_value ) {
 		Com_Error( ERR_FATAL, "Cvar_Get: NULL parameter" );
@@ -264,20 +484,23 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, int flags ) {
 		if ( ( var->flags & CVAR_USER_CREATED ) && !( flags & CVAR_USER_CREATED )
 			 && var_value[0] ) {
 			var->flags &= ~CVAR_USER_CREATED;
-			Z_Free( var->resetString );
-			var->resetString = CopyString( var_value );
+			Cvar_ReleaseString( var->resetString );
+			var->resetString = Cvar_InternString( var_value );
 
 			// ZOID--needs to be set so that cvars the game sets as
 			// SERVERINFO get sent to clients
 			cvar_modifiedFlags |= flags;
 		}
 
-		var->flags |= flags;
+		if ( ( var->flags | flags ) != var->flags ) {
+			var->flags |= flags;
+			Cvar_Modified( var );
+		}
 		// only allow one non-empty reset string without a warning
 		if ( !var->resetString[0] ) {
 			// we don't have a reset string yet
-			Z_Free( var->resetString );
-			var->resetString = CopyString( var_value );
+			Cvar_ReleaseString( var->resetString );
+			var->resetString = Cvar_InternString( var_value );
 		} else if ( var_value[0] && strcmp( var->resetString, var_value ) ) {
 			Com_DPrintf( "Warning: cvar \"%s\" given initial values: \"%s\" and \"%s\"\n",
 						 var_name, var->resetString, var_value );
@@ -289,7 +512,7 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, int flags ) {
 			s = var->latchedString;
 			var->latchedString = NULL;  // otherwise cvar_set2 would free it
 			Cvar_Set2( var_name, s, qtrue );
-			Z_Free( s );
+			Cvar_ReleaseString( s );
 		}
 
 #if !defined RTCW_SP
@@ -328,13 +551,13 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, int flags ) {
 	}
 	var = &cvar_indexes[cvar_numIndexes];
 	cvar_numIndexes++;
-	var->name = CopyString( var_name );
-	var->string = CopyString( var_value );
+	var->name = Cvar_InternString( var_name );
+	var->string = Cvar_InternString( var_value );
 	var->modified = qtrue;
 	var->modificationCount = 1;
 	var->value = atof( var->string );
 	var->integer = atoi( var->string );
-	var->resetString = CopyString( var_value );
+	var->resetString = Cvar_InternString( var_value );
 
 	// link the variable in
 	var->next = cvar_vars;
@@ -342,9 +565,8 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, int flags ) {
 
 	var->flags = flags;
 
-	hash = generateHashValue( var_name );
-	var->hashNext = hashTable[hash];
-	hashTable[hash] = var;
+	Cvar_HashVar( var );
+	Cvar_Modified( var );
 
 	return var;
 }
@@ -364,6 +586,7 @@ const char* CL_TranslateStringBuf( const char *string );
 
 cvar_t *Cvar_Set2( const char *var_name, const char *value, qboolean force ) {
 	cvar_t  *var;
+	char    *oldString;
 
 	Com_DPrintf( "Cvar_Set2: %s %s\n", var_name, value );
 
@@ -463,7 +686,7 @@ cvar_t *Cvar_Set2( const char *var_name, const char *value, qboolean force ) {
 				if ( strcmp( value, var->latchedString ) == 0 ) {
 					return var;
 				}
-				Z_Free( var->latchedString );
+				Cvar_ReleaseString( var->latchedString );
 			} else
 			{
 				if ( strcmp( value, var->string ) == 0 ) {
@@ -472,9 +695,10 @@ cvar_t *Cvar_Set2( const char *var_name, const char *value, qboolean force ) {
 			}
 
 			Com_Printf( "%s will be changed upon restarting.\n", var_name );
-			var->latchedString = CopyString( value );
+			var->latchedString = Cvar_InternString( value );
 			var->modified = qtrue;
 			var->modificationCount++;
+			Cvar_Modified( var );
 			return var;
 		}
 
@@ -488,7 +712,7 @@ cvar_t *Cvar_Set2( const char *var_name, const char *value, qboolean force ) {
 	} else
 	{
 		if ( var->latchedString ) {
-			Z_Free( var->latchedString );
+			Cvar_ReleaseString( var->latchedString );
 			var->latchedString = NULL;
 		}
 	}
@@ -499,10 +723,12 @@ cvar_t *Cvar_Set2( const char *var_name, const char *value, qboolean force ) {
 	}
 	var->modified = qtrue;
 	var->modificationCount++;
+	Cvar_Modified( var );
 
-	Z_Free( var->string );   // free the old value string
-
-	var->string = CopyString( value );
+	// intern the new value before letting go of the old one, which it may be
+	oldString = var->string;
+	var->string = Cvar_InternString( value );
+	Cvar_ReleaseString( oldString );
 	var->value = atof( var->string );
 	var->integer = atoi( var->string );
 
@@ -749,6 +975,7 @@ void Cvar_SetU_f( void ) {
 		return;
 	}
 	v->flags |= CVAR_USERINFO;
+	Cvar_Modified( v );
 }
 
 #if defined RTCW_SP
@@ -788,6 +1015,7 @@ void Cvar_SetS_f( void ) {
 		return;
 	}
 	v->flags |= CVAR_SERVERINFO;
+	Cvar_Modified( v );
 }
 
 /*
@@ -816,6 +1044,7 @@ void Cvar_SetA_f( void ) {
 		return;
 	}
 	v->flags |= CVAR_ARCHIVE;
+	Cvar_Modified( v );
 }
 
 /*
@@ -941,6 +1170,7 @@ void Cvar_List_f( void ) {
 
 	Com_Printf( "\n%i total cvars\n", i );
 	Com_Printf( "%i cvar indexes\n", cvar_numIndexes );
+	Com_Printf( "%i interned strings, %i unused\n", cvar_numStrings, cvar_numUnusedStrings );
 }
 
 /*
@@ -971,21 +1201,15 @@ void Cvar_Restart_f( void ) {
 		// throw out any variables the user created
 		if ( var->flags & CVAR_USER_CREATED ) {
 			*prev = var->next;
-			if ( var->name ) {
-				Z_Free( var->name );
-			}
-			if ( var->string ) {
-				Z_Free( var->string );
-			}
-			if ( var->latchedString ) {
-				Z_Free( var->latchedString );
-			}
-			if ( var->resetString ) {
-				Z_Free( var->resetString );
-			}
+			Cvar_UnhashVar( var );
+			Cvar_ReleaseString( var->name );
+			Cvar_ReleaseString( var->string );
+			Cvar_ReleaseString( var->latchedString );
+			Cvar_ReleaseString( var->resetString );
 			// clear the var completely, since we
 			// can't remove the index from the list
-			memset( var, 0, sizeof( var ) );
+			Cvar_Modified( var );
+			memset( var, 0, sizeof( *var ) );
 			continue;
 		}
 
@@ -1003,17 +1227,33 @@ Cvar_InfoString
 =====================
 */
 char    *Cvar_InfoString( int bit ) {
-	static char info[MAX_INFO_STRING];
+	cvarInfoCache_t *cache;
 	cvar_t  *var;
+	int modifications;
+	int i;
 
-	info[0] = 0;
+	modifications = Cvar_FlagModifications( bit );
+
+	for ( i = 0 ; i < CVAR_INFO_CACHE_SIZE ; i++ ) {
+		cache = &cvar_infoCache[i];
+		if ( cache->bit == bit && cache->modifications == modifications ) {
+			return cache->info;
+		}
+	}
+
+	cache = &cvar_infoCache[cvar_nextInfoCache];
+	cvar_nextInfoCache = ( cvar_nextInfoCache + 1 ) % CVAR_INFO_CACHE_SIZE;
+
+	cache->bit = bit;
+	cache->modifications = modifications;
+	cache->info[0] = 0;
 
 	for ( var = cvar_vars ; var ; var = var->next ) {
 		if ( var->flags & bit ) {
-			Info_SetValueForKey( info, var->name, var->string );
+			Info_SetValueForKey( cache->info, var->name, var->string );
 		}
 	}
-	return info;
+	return cache->info;
 }
 
 /*
@@ -1025,8 +1265,18 @@ Cvar_InfoString_Big
 */
 char    *Cvar_InfoString_Big( int bit ) {
 	static char info[BIG_INFO_STRING];
+	static int infoBit;
+	static int infoModifications = -1;
 	cvar_t  *var;
+	int modifications;
 
+	modifications = Cvar_FlagModifications( bit );
+	if ( infoBit == bit && infoModifications == modifications ) {
+		return info;
+	}
+
+	infoBit = bit;
+	infoModifications = modifications;
 	info[0] = 0;
 
 	for ( var = cvar_vars ; var ; var = var->next ) {
@@ -1119,6 +1369,74 @@ void    Cvar_Update( vmCvar_t *vmCvar ) {
 }
 
 
+/*
+=====================
+Cvar_Bench_f
+
+Times the cvar traffic the modules generate through their syscalls each frame:
+lookups by name, handle updates, a value change and the infostrings
+=====================
+*/
+#define CVARBENCH_HANDLES   256
+
+void Cvar_Bench_f( void ) {
+	static vmCvar_t handles[CVARBENCH_HANDLES];
+	const char  *names[CVARBENCH_HANDLES];
+	char buffer[MAX_CVAR_VALUE_STRING];
+	cvar_t  *var;
+	int numNames;
+	int i, frame, frames;
+	long long start;
+	long long lookupUsec, updateUsec, setUsec, infoUsec;
+
+	frames = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 1000;
+	if ( frames < 1 ) {
+		frames = 1;
+	}
+
+	numNames = 0;
+	for ( var = cvar_vars ; var && numNames < CVARBENCH_HANDLES ; var = var->next ) {
+		names[numNames] = var->name;
+		Cvar_Register( &handles[numNames], var->name, "", 0 );
+		numNames++;
+	}
+
+	Cvar_Get( "cvarbench", "0", CVAR_TEMP );
+
+	lookupUsec = updateUsec = setUsec = infoUsec = 0;
+	for ( frame = 0 ; frame < frames ; frame++ ) {
+		start = Sys_Microseconds();
+		for ( i = 0 ; i < numNames ; i++ ) {
+			Cvar_VariableIntegerValue( names[i] );
+			Cvar_VariableStringBuffer( names[i], buffer, sizeof( buffer ) );
+		}
+		lookupUsec += Sys_Microseconds() - start;
+
+		start = Sys_Microseconds();
+		for ( i = 0 ; i < numNames ; i++ ) {
+			Cvar_Update( &handles[i] );
+		}
+		updateUsec += Sys_Microseconds() - start;
+
+		start = Sys_Microseconds();
+		Cvar_Set( "cvarbench", ( frame & 1 ) ? "1" : "0" );
+		setUsec += Sys_Microseconds() - start;
+
+		start = Sys_Microseconds();
+		Cvar_InfoString( CVAR_SERVERINFO );
+		Cvar_InfoString( CVAR_USERINFO );
+		infoUsec += Sys_Microseconds() - start;
+	}
+
+	Com_Printf( "%i frames, %i cvars\n", frames, numNames );
+	Com_Printf( "lookups    : %.3f usec per frame, %.3f usec per lookup\n",
+				(float)lookupUsec / frames, numNames ? (float)lookupUsec / ( frames * numNames * 2 ) : 0.0f );
+	Com_Printf( "updates    : %.3f usec per frame, %.3f usec per update\n",
+				(float)updateUsec / frames, numNames ? (float)updateUsec / ( frames * numNames ) : 0.0f );
+	Com_Printf( "sets       : %.3f usec per set\n", (float)setUsec / frames );
+	Com_Printf( "infostrings: %.3f usec per frame\n", (float)infoUsec / frames );
+}
+
 /*
 ============
 Cvar_Init
@@ -1147,6 +1465,7 @@ void Cvar_Init( void ) {
 	Cmd_AddCommand( "reset", Cvar_Reset_f );
 	Cmd_AddCommand( "cvarlist", Cvar_List_f );
 	Cmd_AddCommand( "cvar_restart", Cvar_Restart_f );
+	Cmd_AddCommand( "cvarbench", Cvar_Bench_f );
 
 #if !defined RTCW_SP
 	// NERVE - SMF - can't rely on autoexec to do this
@@ -29,6 +29,7 @@ SPDX-License-Identifier: GPL-3.0
 #include "rtcw_memory.h"
 #include "rtcw_string.h"
 #include "rtcw_unique_ptr.h"
+#include "sys_shared.h"
 
 
 /*
@@ -205,16 +206,20 @@ public:
 	MinizIo();
 	~MinizIo();
 
-	bool open(const char* file_name);
+	bool open(const char* file_name, bool map_file);
 	void close();
 
 	bool is_open() const;
 	int64_t get_file_size() const;
 
+	// The whole file, if it is mapped into memory.
+	const void* get_data() const;
+
 	size_t read(int64_t position, void* buffer, size_t count);
 
 private:
 	FILE* file_;
+	SysFileMappingHandle mapping_;
 	int64_t file_size_;
 
 private:
@@ -227,6 +232,7 @@ private:
 MinizIo::MinizIo()
 	:
 	file_(),
+	mapping_(),
 	file_size_()
 {}
 
@@ -235,10 +241,21 @@ MinizIo::~MinizIo()
 	close();
 }
 
-bool MinizIo::open(const char* file_name)
+bool MinizIo::open(const char* file_name, bool map_file)
 {
 	close();
 
+	if (map_file)
+	{
+		mapping_ = sys_map_file(file_name);
+
+		if (mapping_ != NULL)
+		{
+			file_size_ = sys_get_file_mapping_size(mapping_);
+			return true;
+		}
+	}
+
 	file_ = fopen(file_name, "rb");
 
 	if (file_ == NULL)
@@ -271,12 +288,17 @@ void MinizIo::close()
 		file_ = NULL;
 	}
 
+	if (mapping_ != NULL)
+	{
+		sys_unmap_file(mapping_);
+	}
+
 	file_size_ = 0;
 }
 
 bool MinizIo::is_open() const
 {
-	return file_ != NULL;
+	return file_ != NULL || mapping_ != NULL;
 }
 
 int64_t MinizIo::get_file_size() const
@@ -284,8 +306,27 @@ int64_t MinizIo::get_file_size() const
 	return file_size_;
 }
 
+const void* MinizIo::get_data() const
+{
+	return mapping_ != NULL ? sys_get_file_mapping_data(mapping_) : NULL;
+}
+
 size_t MinizIo::read(int64_t position, void* buffer, const size_t count)
 {
+	if (mapping_ != NULL)
+	{
+		if (position < 0 || position >= file_size_)
+		{
+			return 0;
+		}
+
+		const size_t read_count = static_cast<size_t>(file_size_ - position) < count ?
+			static_cast<size_t>(file_size_ - position) : count;
+
+		std::memcpy(buffer, static_cast<const char*>(get_data()) + position, read_count);
+		return read_count;
+	}
+
 	if (!is_open() || position > LONG_MAX)
 	{
 		return 0;
@@ -391,19 +432,31 @@ public:
 		close();
 	}
 
-	bool open(const char* file_name)
+	// A mapped archive is read straight out of memory by miniz.
+	bool open(const char* file_name, bool map_file)
 	{
 		close();
-		if (!io_.open(file_name))
+		if (!io_.open(file_name, map_file))
 		{
 			return false;
 		}
-		miniz_zip_.m_pIO_opaque = &io_;
-		miniz_zip_.m_pRead = miniz_file_read_func;
-		if (!mz_zip_reader_init(&miniz_zip_, io_.get_file_size(), MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY))
+		if (io_.get_data() != NULL)
 		{
-			close();
-			return false;
+			if (!mz_zip_reader_init_mem(&miniz_zip_, io_.get_data(), static_cast<size_t>(io_.get_file_size()), MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY))
+			{
+				close();
+				return false;
+			}
+		}
+		else
+		{
+			miniz_zip_.m_pIO_opaque = &io_;
+			miniz_zip_.m_pRead = miniz_file_read_func;
+			if (!mz_zip_reader_init(&miniz_zip_, io_.get_file_size(), MZ_ZIP_FLAG_DO_NOT_SORT_CENTRAL_DIRECTORY))
+			{
+				close();
+				return false;
+			}
 		}
 		const mz_uint miniz_file_count = mz_zip_reader_get_num_files(&miniz_zip_);
 		if (miniz_file_count > INT_MAX)
@@ -430,6 +483,23 @@ public:
 		return is_open_;
 	}
 
+	bool is_mapped() const
+	{
+		return is_open_ && io_.get_data() != NULL;
+	}
+
+	// Extracts a whole file in one call.
+	// Stored files of a mapped archive are copied straight out of the mapping.
+	bool extract(int file_index, void* buffer_ptr, int size)
+	{
+		if (!is_open() || file_index < 0 || file_index >= file_count_ || buffer_ptr == NULL || size < 0)
+		{
+			return false;
+		}
+		return mz_zip_reader_extract_to_mem_no_alloc(&miniz_zip_, static_cast<mz_uint>(file_index),
+			buffer_ptr, static_cast<size_t>(size), 0, NULL, 0) != MZ_FALSE;
+	}
+
 	File* open_file(int file_index)
 	{
 		if (!is_open() || file_index < 0 || file_index >= file_count_)
@@ -619,6 +689,7 @@ static cvar_t      *fs_cdpath;
 static cvar_t      *fs_copyfiles;
 static cvar_t      *fs_gamedirvar;
 static cvar_t      *fs_restrict;
+static cvar_t      *fs_mapPaks;
 static searchpath_t    *fs_searchpaths;
 static int fs_readCount;                    // total bytes read
 static int fs_loadCount;                    // total files read
@@ -879,6 +950,361 @@ char *FS_BuildOSPath( const char *base, const char *game, const char *qpath ) {
 	return ospath[toggle];
 }
 
+/*
+=============================================================================
+
+GLOBAL FILE INDEX
+
+Every file of every search path is hashed once into a single table that maps
+the name to the search paths able to provide it, kept in search order.
+Lookups only visit those candidates, so they don't walk every pak hash and
+don't probe the disk once per game directory.  The candidates still go through
+the usual pure and filter checks, which keeps the result the same as a full walk.
+
+Loose directories are scanned once at startup.  Files written through the
+filesystem are added as they are created, anything else dropped into a game
+directory while running needs a "fs_rescan".
+
+=============================================================================
+*/
+
+#define FS_INDEX_MIN_HASH_SIZE  1024
+#define FS_INDEX_MAX_HASH_SIZE  ( 1 << 18 )
+#define FS_INDEX_MAX_DEPTH      16
+#define FS_INDEX_MAX_DIR_FILES  ( 1 << 20 )
+#define FS_INDEX_BLOCK_SIZE     ( 64 * 1024 )
+
+typedef struct fsIndexEntry_s {
+	const char              *name;
+	searchpath_t            *search;
+	int order;                                  // position of search in fs_searchpaths
+	struct fsIndexEntry_s   *next;              // next entry in the hash, in search order
+} fsIndexEntry_t;
+
+typedef struct fsIndexBlock_s {
+	struct fsIndexBlock_s   *next;
+	size_t used;
+	char data[FS_INDEX_BLOCK_SIZE];
+} fsIndexBlock_t;
+
+typedef struct {
+	const char      *name;
+	qboolean indexed;
+	fsIndexEntry_t  *entry;                     // next candidate when indexed
+	searchpath_t    *search;                    // next search path otherwise
+} fsSearchCursor_t;
+
+static cvar_t          *fs_index;
+static fsIndexEntry_t  **fs_indexTable;
+static int fs_indexHashSize;
+static int fs_indexFiles;
+static int fs_indexDirFiles;
+static fsIndexBlock_t  *fs_indexBlocks;
+
+static void *FS_IndexAlloc( size_t size ) {
+	fsIndexBlock_t  *block;
+	void            *data;
+
+	size = ( size + sizeof( void * ) - 1 ) & ~( sizeof( void * ) - 1 );
+
+	block = fs_indexBlocks;
+	if ( !block || block->used + size > FS_INDEX_BLOCK_SIZE ) {
+		block = static_cast<fsIndexBlock_t*>( rtcw::mem::allocate( sizeof( *block ) ) );
+		if ( !block ) {
+			Com_Error( ERR_FATAL, "FS_IndexAlloc: failed on allocation of %d bytes\n", static_cast<int>( sizeof( *block ) ) );
+		}
+		block->next = fs_indexBlocks;
+		block->used = 0;
+		fs_indexBlocks = block;
+	}
+
+	data = block->data + block->used;
+	block->used += size;
+	return data;
+}
+
+/*
+================
+FS_ClearIndex
+================
+*/
+static void FS_ClearIndex( void ) {
+	fsIndexBlock_t  *block, *next;
+
+	for ( block = fs_indexBlocks ; block ; block = next ) {
+		next = block->next;
+		rtcw::mem::deallocate( block );
+	}
+	fs_indexBlocks = NULL;
+
+	rtcw::mem::deallocate( fs_indexTable );
+	fs_indexTable = NULL;
+	fs_indexHashSize = 0;
+	fs_indexFiles = 0;
+	fs_indexDirFiles = 0;
+}
+
+/*
+================
+FS_IndexInsert
+
+Keeps each hash chain sorted by search order
+================
+*/
+static void FS_IndexInsert( searchpath_t *search, int order, const char *name, qboolean copyName ) {
+	fsIndexEntry_t  **link;
+	fsIndexEntry_t  *entry;
+	char            *copy;
+
+	link = &fs_indexTable[FS_HashFileName( name, fs_indexHashSize )];
+	for ( ; *link && ( *link )->order <= order ; link = &( *link )->next ) {
+		if ( ( *link )->order == order && !FS_FilenameCompare( ( *link )->name, name ) ) {
+			return;     // already known
+		}
+	}
+
+	entry = static_cast<fsIndexEntry_t*>( FS_IndexAlloc( sizeof( *entry ) ) );
+	if ( copyName ) {
+		copy = static_cast<char*>( FS_IndexAlloc( strlen( name ) + 1 ) );
+		strcpy( copy, name );
+		name = copy;
+	}
+	entry->name = name;
+	entry->search = search;
+	entry->order = order;
+	entry->next = *link;
+	*link = entry;
+	fs_indexFiles++;
+}
+
+/*
+================
+FS_IndexDirectory_r
+
+Returns qfalse if the tree can't be indexed completely
+================
+*/
+static qboolean FS_IndexDirectory_r( searchpath_t *search, int order, const char *ospath, const char *qpath, int depth ) {
+	SysDirHandle dir;
+	const SysDirEntry   *entry;
+	char subOSPath[MAX_OSPATH];
+	char subQPath[MAX_OSPATH];
+	qboolean ok;
+
+	if ( depth > FS_INDEX_MAX_DEPTH ) {
+		return qfalse;
+	}
+
+	dir = sys_open_dir( ospath );
+	if ( !dir ) {
+		return qtrue;
+	}
+
+	ok = qtrue;
+	while ( ok && ( entry = sys_read_dir( dir ) ) != NULL ) {
+		if ( !strcmp( entry->name, "." ) || !strcmp( entry->name, ".." ) ) {
+			continue;
+		}
+
+		if ( strlen( ospath ) + strlen( entry->name ) + 2 > sizeof( subOSPath ) ) {
+			ok = qfalse;
+			break;
+		}
+		Com_sprintf( subOSPath, sizeof( subOSPath ), "%s%c%s", ospath, PATH_SEP, entry->name );
+		if ( qpath[0] ) {
+			Com_sprintf( subQPath, sizeof( subQPath ), "%s/%s", qpath, entry->name );
+		} else {
+			Q_strncpyz( subQPath, entry->name, sizeof( subQPath ) );
+		}
+
+		if ( ++fs_indexDirFiles > FS_INDEX_MAX_DIR_FILES ) {
+			ok = qfalse;
+			break;
+		}
+		FS_IndexInsert( search, order, subQPath, qtrue );
+
+		if ( entry->is_dir ) {
+			ok = FS_IndexDirectory_r( search, order, subOSPath, subQPath, depth + 1 );
+		}
+	}
+
+	sys_close_dir( dir );
+	return ok;
+}
+
+/*
+================
+FS_BuildIndex
+================
+*/
+static void FS_BuildIndex( void ) {
+	searchpath_t    *search;
+	char ospath[MAX_OSPATH];
+	int order;
+	int numFiles;
+	int i;
+	int start;
+
+	FS_ClearIndex();
+
+	if ( !fs_index->integer ) {
+		return;
+	}
+
+	start = Sys_Milliseconds();
+
+	// size the table from the pak contents, loose files are usually few
+	numFiles = 0;
+	for ( search = fs_searchpaths ; search ; search = search->next ) {
+		if ( search->pack ) {
+			numFiles += search->pack->numfiles;
+		}
+	}
+	for ( fs_indexHashSize = FS_INDEX_MIN_HASH_SIZE ; fs_indexHashSize < FS_INDEX_MAX_HASH_SIZE ; fs_indexHashSize <<= 1 ) {
+		if ( fs_indexHashSize >= numFiles ) {
+			break;
+		}
+	}
+	fs_indexTable = static_cast<fsIndexEntry_t**>( rtcw::mem::allocate( fs_indexHashSize * sizeof( *fs_indexTable ) ) );
+	if ( !fs_indexTable ) {
+		Com_Error( ERR_FATAL, "FS_BuildIndex: failed on allocation of %d bytes\n", static_cast<int>( fs_indexHashSize * sizeof( *fs_indexTable ) ) );
+	}
+	Com_Memset( fs_indexTable, 0, fs_indexHashSize * sizeof( *fs_indexTable ) );
+
+	for ( search = fs_searchpaths, order = 0 ; search ; search = search->next, order++ ) {
+		if ( search->pack ) {
+			for ( i = 0 ; i < search->pack->numfiles ; i++ ) {
+				FS_IndexInsert( search, order, search->pack->buildBuffer[i].name, qfalse );
+			}
+		} else if ( search->dir ) {
+			Q_strncpyz( ospath, FS_BuildOSPath( search->dir->path, search->dir->gamedir, "" ), sizeof( ospath ) );
+			ospath[strlen( ospath ) - 1] = '\0';   // strip the trailing slash
+
+			if ( !FS_IndexDirectory_r( search, order, ospath, "", 0 ) ) {
+				Com_Printf( S_COLOR_YELLOW "WARNING: couldn't index %s, file index disabled\n", ospath );
+				FS_ClearIndex();
+				return;
+			}
+		}
+	}
+
+	Com_DPrintf( "%d files in file index (%d loose, %d ms)\n", fs_indexFiles, fs_indexDirFiles, Sys_Milliseconds() - start );
+}
+
+/*
+================
+FS_IndexAddFile
+
+Records a file created in path/gamedir by the engine
+================
+*/
+static void FS_IndexAddFile( const char *path, const char *gamedir, const char *filename ) {
+	searchpath_t    *search;
+	int order;
+
+	if ( !fs_indexTable ) {
+		return;
+	}
+
+	while ( filename[0] == '/' || filename[0] == '\\' ) {
+		filename++;
+	}
+
+	for ( search = fs_searchpaths, order = 0 ; search ; search = search->next, order++ ) {
+		if ( search->dir && !Q_stricmp( search->dir->path, path ) && !Q_stricmp( search->dir->gamedir, gamedir ) ) {
+			FS_IndexInsert( search, order, filename, qtrue );
+		}
+	}
+}
+
+/*
+================
+FS_IndexAddHomeFile
+
+Same as FS_IndexAddFile for a "gamedir/filename" path below fs_homepath
+================
+*/
+static void FS_IndexAddHomeFile( const char *filename ) {
+	char gamedir[MAX_OSPATH];
+	int i;
+
+	for ( i = 0 ; filename[i] && filename[i] != '/' && filename[i] != '\\' ; i++ ) {
+		if ( i == sizeof( gamedir ) - 1 ) {
+			return;
+		}
+		gamedir[i] = filename[i];
+	}
+	if ( !filename[i] ) {
+		return;
+	}
+	gamedir[i] = '\0';
+
+	FS_IndexAddFile( fs_homepath->string, gamedir, filename + i + 1 );
+}
+
+/*
+================
+FS_FirstSearchPath / FS_NextSearchPath
+
+Iterates over the search paths that may contain filename, in search order
+================
+*/
+static searchpath_t *FS_NextSearchPath( fsSearchCursor_t *cursor ) {
+	searchpath_t    *search;
+	fsIndexEntry_t  *entry;
+
+	if ( !cursor->indexed ) {
+		search = cursor->search;
+		if ( search ) {
+			cursor->search = search->next;
+		}
+		return search;
+	}
+
+	for ( entry = cursor->entry ; entry ; entry = entry->next ) {
+		if ( !FS_FilenameCompare( entry->name, cursor->name ) ) {
+			cursor->entry = entry->next;
+			return entry->search;
+		}
+	}
+
+	cursor->entry = NULL;
+	return NULL;
+}
+
+static searchpath_t *FS_FirstSearchPath( const char *filename, fsSearchCursor_t *cursor ) {
+	if ( fs_indexTable ) {
+		while ( filename[0] == '/' || filename[0] == '\\' ) {
+			filename++;
+		}
+		cursor->name = filename;
+		cursor->indexed = qtrue;
+		cursor->entry = fs_indexTable[FS_HashFileName( filename, fs_indexHashSize )];
+		cursor->search = NULL;
+	} else {
+		cursor->name = filename;
+		cursor->indexed = qfalse;
+		cursor->entry = NULL;
+		cursor->search = fs_searchpaths;
+	}
+	return FS_NextSearchPath( cursor );
+}
+
+/*
+================
+FS_Rescan_f
+================
+*/
+static void FS_Rescan_f( void ) {
+	FS_BuildIndex();
+
+	if ( fs_indexTable ) {
+		Com_Printf( "%d files in file index (%d loose)\n", fs_indexFiles, fs_indexDirFiles );
+	} else {
+		Com_Printf( "file index disabled\n" );
+	}
+}
+
 
 /*
 ============
@@ -1131,6 +1557,8 @@ fileHandle_t FS_SV_FOpenFileWrite( const char *filename ) {
 	fsh[f].handleSync = qfalse;
 	if ( !fsh[f].handleFiles.file.o ) {
 		f = 0;
+	} else {
+		FS_IndexAddHomeFile( filename );
 	}
 	return f;
 }
@@ -1256,6 +1684,8 @@ void FS_SV_Rename( const char *from, const char *to ) {
 		FS_CopyFile( from_ospath, to_ospath );
 		FS_Remove( from_ospath );
 	}
+
+	FS_IndexAddHomeFile( to );
 }
 
 
@@ -1306,6 +1736,8 @@ void FS_Rename( const char *from, const char *to ) {
 #endif // RTCW_XX
 
 	}
+
+	FS_IndexAddFile( fs_homepath->string, fs_gamedir, to );
 }
 
 /*
@@ -1384,6 +1816,8 @@ fileHandle_t FS_FOpenFileWrite( const char *filename ) {
 	fsh[f].handleSync = qfalse;
 	if ( !fsh[f].handleFiles.file.o ) {
 		f = 0;
+	} else {
+		FS_IndexAddFile( fs_homepath->string, fs_gamedir, filename );
 	}
 	return f;
 }
@@ -1429,6 +1863,8 @@ fileHandle_t FS_FOpenFileAppend( const char *filename ) {
 	fsh[f].handleSync = qfalse;
 	if ( !fsh[f].handleFiles.file.o ) {
 		f = 0;
+	} else {
+		FS_IndexAddFile( fs_homepath->string, fs_gamedir, filename );
 	}
 	return f;
 }
@@ -1594,6 +2030,33 @@ char *FS_ShiftStr( const char *string, int shift ) {
 }
 #endif // RTCW_XX
 
+/*
+===========
+FS_GetPakZip
+
+Returns the archive of a pak, a pak added from the header cache
+is opened on its first read
+===========
+*/
+static MinizZip* FS_GetPakZip( pack_t *pak ) {
+	if ( !pak->miniz_zip_ptr_ ) {
+		rtcw::UniquePtr<MinizZip, MinizZipDeleter> miniz_zip_uptr(rtcw::mem::new_object<MinizZip>());
+
+		if ( !miniz_zip_uptr->open( pak->pakFilename, fs_mapPaks->integer != 0 ) ) {
+			Com_Error( ERR_FATAL, "Couldn't reopen %s", pak->pakFilename );
+		}
+
+		// the cache entry matched the size and time of the archive
+		if ( miniz_zip_uptr->get_file_count() != pak->numfiles ) {
+			Com_Error( ERR_FATAL, "%s has changed since it was added", pak->pakFilename );
+		}
+
+		pak->miniz_zip_ptr_ = miniz_zip_uptr.release();
+	}
+
+	return pak->miniz_zip_ptr_;
+}
+
 /*
 ===========
 FS_FOpenFileRead
@@ -1613,6 +2076,7 @@ static int fs_filter_flag = 0;
 
 int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean uniqueFILE ) {
 	searchpath_t    *search;
+	fsSearchCursor_t cursor;
 	char            *netpath;
 	pack_t          *pak;
 	fileInPack_t    *pakFile;
@@ -1637,7 +2101,7 @@ int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean uniqueF
 
 	if ( file == NULL ) {
 		// just wants to see if file is there
-		for ( search = fs_searchpaths ; search ; search = search->next ) {
+		for ( search = FS_FirstSearchPath( filename, &cursor ) ; search ; search = FS_NextSearchPath( &cursor ) ) {
 			//
 			if ( search->pack ) {
 				hash = FS_HashFileName( filename, search->pack->hashSize );
@@ -1722,7 +2186,7 @@ int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean uniqueF
 	*file = FS_HandleForFile();
 	fsh[*file].handleFiles.unique = uniqueFILE;
 
-	for ( search = fs_searchpaths ; search ; search = search->next ) {
+	for ( search = FS_FirstSearchPath( filename, &cursor ) ; search ; search = FS_NextSearchPath( &cursor ) ) {
 		//
 		if ( search->pack ) {
 			hash = FS_HashFileName( filename, search->pack->hashSize );
@@ -1832,7 +2296,7 @@ int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean uniqueF
 						// open a new file on the pakfile
 						rtcw::UniquePtr<MinizZip, MinizZipDeleter> miniz_zip_uptr(rtcw::mem::new_object<MinizZip>());
 
-						if (!miniz_zip_uptr->open(pak->pakFilename))
+						if (!miniz_zip_uptr->open(pak->pakFilename, fs_mapPaks->integer != 0))
 						{
 							Com_Error(ERR_FATAL, "Couldn't reopen %s", pak->pakFilename);
 						}
@@ -1841,7 +2305,7 @@ int FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean uniqueF
 					}
 					else
 					{
-						fsh[*file].handleFiles.file.miniz_zip_ptr_ = pak->miniz_zip_ptr_;
+						fsh[*file].handleFiles.file.miniz_zip_ptr_ = FS_GetPakZip( pak );
 					}
 
 					Q_strncpyz(fsh[*file].name, filename, sizeof(fsh[*file].name));
@@ -2547,6 +3011,7 @@ CONVENIENCE FUNCTIONS FOR ENTIRE FILES
 
 int FS_FileIsInPAK( const char *filename, int *pChecksum ) {
 	searchpath_t    *search;
+	fsSearchCursor_t cursor;
 	pack_t          *pak;
 	fileInPack_t    *pakFile;
 	int32_t hash = 0;
@@ -2575,7 +3040,7 @@ int FS_FileIsInPAK( const char *filename, int *pChecksum ) {
 	// search through the path, one element at a time
 	//
 
-	for ( search = fs_searchpaths ; search ; search = search->next ) {
+	for ( search = FS_FirstSearchPath( filename, &cursor ) ; search ; search = FS_NextSearchPath( &cursor ) ) {
 		//
 		if ( search->pack ) {
 			hash = FS_HashFileName( filename, search->pack->hashSize );
@@ -2718,7 +3183,13 @@ int FS_ReadFile( const char *qpath, void **buffer ) {
 	buf = static_cast<byte*> (Hunk_AllocateTempMemory( len + 1 ));
 	*buffer = buf;
 
-	FS_Read( buf, len, h );
+	// extract files of mapped packs in one go, straight out of the mapping
+	if ( fsh[h].zipFile && fsh[h].handleFiles.file.miniz_zip_ptr_->is_mapped() &&
+		 fsh[h].handleFiles.file.miniz_zip_ptr_->extract( fsh[h].zipFilePos, buf, len ) ) {
+		fs_readCount += len;
+	} else {
+		FS_Read( buf, len, h );
+	}
 
 	// guarantee that it will have a trailing 0 for string operations
 	buf[len] = 0;
@@ -2756,6 +3227,67 @@ void FS_FreeFile( void *buffer ) {
 	}
 }
 
+/*
+=============
+FS_MapFile
+
+Maps a loose file read-only into memory, files inside pk3s can't be mapped.
+Returns NULL if no loose copy of the file is found.
+=============
+*/
+const void *FS_MapFile( const char *qpath, int *length, void **mapping ) {
+	searchpath_t        *search;
+	fsSearchCursor_t cursor;
+	SysFileMappingHandle handle;
+	char                *ospath;
+
+	if ( !fs_searchpaths ) {
+		Com_Error( ERR_FATAL, "Filesystem call made without initialization\n" );
+	}
+
+	for ( search = FS_FirstSearchPath( qpath, &cursor ) ; search ; search = FS_NextSearchPath( &cursor ) ) {
+		if ( !search->dir ) {
+			continue;
+		}
+
+		ospath = FS_BuildOSPath( search->dir->path, search->dir->gamedir, qpath );
+		handle = sys_map_file( ospath );
+		if ( !handle ) {
+			continue;
+		}
+
+		if ( sys_get_file_mapping_size( handle ) > INT_MAX ) {
+			sys_unmap_file( handle );
+			continue;
+		}
+
+		if ( fs_debug->integer ) {
+			Com_Printf( "FS_MapFile: %s\n", ospath );
+		}
+
+		*length = static_cast<int>( sys_get_file_mapping_size( handle ) );
+		*mapping = handle;
+		return sys_get_file_mapping_data( handle );
+	}
+
+	*length = 0;
+	*mapping = NULL;
+	return NULL;
+}
+
+/*
+=============
+FS_UnmapFile
+=============
+*/
+void FS_UnmapFile( void *mapping ) {
+	SysFileMappingHandle handle = static_cast<SysFileMappingHandle>( mapping );
+
+	if ( handle ) {
+		sys_unmap_file( handle );
+	}
+}
+
 /*
 ============
 FS_WriteFile
@@ -2797,42 +3329,430 @@ ZIP FILE LOADING
 
 /*
 =================
-FS_LoadZipFile
+PK3 HEADER CACHE
 
-Creates a new pak_t in the search chain for the contents
-of a zip file.
+The lowercased file names and header CRCs of the pk3 files are kept in
+"pk3cache.dat" in the home path, keyed by the OS path, size and modification
+time of each archive.  An unchanged archive is added from its cache entry
+without parsing its central directory; it's opened on the first read from it.
+The file holds the pk3 files of the latest FS_Startup.
 =================
 */
-static pack_t* FS_LoadZipFile(
-	char* zipfile,
-	const char* basename)
-{
-	fileInPack_t    *buildBuffer;
-	pack_t          *pack;
+#define PAKCACHE_FILENAME   "pk3cache.dat"
+#define PAKCACHE_IDENT      ( ( 'C' << 24 ) + ( 'K' << 16 ) + ( 'P' << 8 ) + 'R' )
+#define PAKCACHE_VERSION    1
+#define PAKCACHE_HASH_SIZE  256
+
+extern bool FS_OSFileInfo( const char* path, int64_t& size, int64_t& mtime );
+
+typedef struct pakCache_s {
+	char path[MAX_OSPATH];
+	int64_t size;
+	int64_t mtime;
+	int numfiles;
+	int numHeaderLongs;
+	int             *headerLongs;               // CRCs of the non-empty files
+	char            *names;                     // lowercased file names, one after another
+	int namesSize;
+	qboolean used;                              // added by the current FS_Startup
+	struct pakCache_s *next;
+} pakCache_t;
+
+static pakCache_t   *fs_pakCacheHash[PAKCACHE_HASH_SIZE];
+static qboolean fs_pakCacheLoaded;
+static qboolean fs_pakCacheModified;
+
+static int FS_HashPakCachePath( const char *path ) {
+	unsigned int hash;
+
+	hash = 0;
+	while ( *path ) {
+		hash = hash * 31 + (unsigned char)*path++;
+	}
+	return hash & ( PAKCACHE_HASH_SIZE - 1 );
+}
+
+static void FS_FreePakCacheEntry( pakCache_t *entry ) {
+	rtcw::mem::deallocate( entry->headerLongs );
+	rtcw::mem::deallocate( entry->names );
+	rtcw::mem::deallocate( entry );
+}
+
+/*
+=================
+FS_FindPakCache
+
+Only reads the cache, so the job workers can look it up
+=================
+*/
+static pakCache_t *FS_FindPakCache( const char *path, int64_t size, int64_t mtime ) {
+	pakCache_t *entry;
+
+	for ( entry = fs_pakCacheHash[FS_HashPakCachePath( path )]; entry; entry = entry->next ) {
+		if ( !strcmp( entry->path, path ) ) {
+			return ( entry->size == size && entry->mtime == mtime ) ? entry : NULL;
+		}
+	}
+	return NULL;
+}
+
+/*
+=================
+FS_AddPakCache
+
+Replaces the entry of the archive, taking over the given arrays
+=================
+*/
+static pakCache_t *FS_AddPakCache( const char *path, int64_t size, int64_t mtime, int numfiles,
+								   int *headerLongs, int numHeaderLongs, char *names, int namesSize ) {
+	pakCache_t *entry, **prev;
+	int hash;
+
+	hash = FS_HashPakCachePath( path );
+
+	for ( prev = &fs_pakCacheHash[hash]; *prev; prev = &( *prev )->next ) {
+		if ( !strcmp( ( *prev )->path, path ) ) {
+			entry = *prev;
+			*prev = entry->next;
+			FS_FreePakCacheEntry( entry );
+			break;
+		}
+	}
+
+	entry = static_cast<pakCache_t*>( rtcw::mem::allocate( sizeof( *entry ) ) );
+	if ( !entry ) {
+		rtcw::mem::deallocate( headerLongs );
+		rtcw::mem::deallocate( names );
+		return NULL;
+	}
+
+	Q_strncpyz( entry->path, path, sizeof( entry->path ) );
+	entry->size = size;
+	entry->mtime = mtime;
+	entry->numfiles = numfiles;
+	entry->headerLongs = headerLongs;
+	entry->numHeaderLongs = numHeaderLongs;
+	entry->names = names;
+	entry->namesSize = namesSize;
+	entry->used = qfalse;
+	entry->next = fs_pakCacheHash[hash];
+	fs_pakCacheHash[hash] = entry;
+
+	fs_pakCacheModified = qtrue;
+
+	return entry;
+}
+
+static const char *FS_PakCachePath( void ) {
+	return FS_BuildOSPath( fs_homepath->string, BASEGAME, PAKCACHE_FILENAME );
+}
+
+/*
+=================
+FS_ReadPakCache
+
+Reads the cache file once, everything after that is kept in memory
+=================
+*/
+static void FS_ReadPakCache( void ) {
+	FILE *f;
+	int header[3], counts[4];
+	int64_t times[2];
+	char path[MAX_OSPATH];
+	int *headerLongs;
+	char *names;
+	int i;
+
+	if ( fs_pakCacheLoaded ) {
+		return;
+	}
+	fs_pakCacheLoaded = qtrue;
+
+	f = fopen( FS_PakCachePath(), "rb" );
+	if ( !f ) {
+		return;
+	}
+
+	if ( fread( header, sizeof( header ), 1, f ) != 1 || header[0] != PAKCACHE_IDENT || header[1] != PAKCACHE_VERSION ) {
+		fclose( f );
+		return;
+	}
+
+	// path length, file count, CRC count and names size, then the path, times, CRCs and names
+	for ( i = 0; i < header[2]; i++ ) {
+		if ( fread( counts, sizeof( counts ), 1, f ) != 1 ||
+			 counts[0] <= 0 || counts[0] >= MAX_OSPATH || counts[1] < 0 || counts[2] < 0 || counts[2] > counts[1] || counts[3] < 0 ) {
+			break;
+		}
+		if ( fread( path, counts[0], 1, f ) != 1 || fread( times, sizeof( times ), 1, f ) != 1 ) {
+			break;
+		}
+		path[counts[0]] = '\0';
+
+		headerLongs = static_cast<int*>( rtcw::mem::allocate( ( counts[2] > 0 ? counts[2] : 1 ) * sizeof( int ) ) );
+		names = static_cast<char*>( rtcw::mem::allocate( counts[3] > 0 ? counts[3] : 1 ) );
+		if ( !headerLongs || !names ||
+			 ( counts[2] > 0 && fread( headerLongs, counts[2] * sizeof( int ), 1, f ) != 1 ) ||
+			 ( counts[3] > 0 && fread( names, counts[3], 1, f ) != 1 ) ) {
+			rtcw::mem::deallocate( headerLongs );
+			rtcw::mem::deallocate( names );
+			break;
+		}
+
+		FS_AddPakCache( path, times[0], times[1], counts[1], headerLongs, counts[2], names, counts[3] );
+	}
+
+	fclose( f );
+
+	fs_pakCacheModified = qfalse;
+}
+
+/*
+=================
+FS_LoadPakCache
+
+Called at the start of FS_Startup, none of the entries are used yet
+=================
+*/
+static void FS_LoadPakCache( void ) {
+	pakCache_t *entry;
+	int i;
+
+	FS_ReadPakCache();
+
+	for ( i = 0; i < PAKCACHE_HASH_SIZE; i++ ) {
+		for ( entry = fs_pakCacheHash[i]; entry; entry = entry->next ) {
+			entry->used = qfalse;
+		}
+	}
+}
+
+/*
+=================
+FS_WritePakCache
+
+Drops the archives the current FS_Startup didn't add and writes the cache
+file if anything changed
+=================
+*/
+static void FS_WritePakCache( void ) {
+	pakCache_t *entry, **prev;
+	FILE *f;
+	const char *ospath;
+	int header[3], counts[4];
+	int64_t times[2];
+	int i;
+
+	header[0] = PAKCACHE_IDENT;
+	header[1] = PAKCACHE_VERSION;
+	header[2] = 0;
+
+	for ( i = 0; i < PAKCACHE_HASH_SIZE; i++ ) {
+		for ( prev = &fs_pakCacheHash[i]; *prev; ) {
+			entry = *prev;
+			if ( !entry->used ) {
+				*prev = entry->next;
+				FS_FreePakCacheEntry( entry );
+				fs_pakCacheModified = qtrue;
+				continue;
+			}
+			header[2]++;
+			prev = &entry->next;
+		}
+	}
+
+	if ( !fs_pakCacheModified ) {
+		return;
+	}
+	fs_pakCacheModified = qfalse;
+
+	ospath = FS_PakCachePath();
+	FS_CreatePath( const_cast<char*>( ospath ) );
+
+	f = fopen( ospath, "wb" );
+	if ( !f ) {
+		return;
+	}
+
+	fwrite( header, sizeof( header ), 1, f );
+
+	for ( i = 0; i < PAKCACHE_HASH_SIZE; i++ ) {
+		for ( entry = fs_pakCacheHash[i]; entry; entry = entry->next ) {
+			counts[0] = static_cast<int>( strlen( entry->path ) );
+			counts[1] = entry->numfiles;
+			counts[2] = entry->numHeaderLongs;
+			counts[3] = entry->namesSize;
+			times[0] = entry->size;
+			times[1] = entry->mtime;
+
+			fwrite( counts, sizeof( counts ), 1, f );
+			fwrite( entry->path, counts[0], 1, f );
+			fwrite( times, sizeof( times ), 1, f );
+			fwrite( entry->headerLongs, sizeof( int ), entry->numHeaderLongs, f );
+			fwrite( entry->names, 1, entry->namesSize, f );
+		}
+	}
+
+	fclose( f );
+}
+
+/*
+=================
+FS_ScanZipFile
+
+Opens a zip file, copies out its lowercased file names and checksums its
+headers, or takes all of that from the header cache.  Doesn't touch the zone
+or any shared state, so several archives can be scanned at once.
+=================
+*/
+typedef struct {
+	char zipfile[MAX_OSPATH];
+	const char      *basename;
+	qboolean valid;
+	MinizZip        *zip;                       // NULL when added from the cache
+	pakCache_t      *cache;
+	qboolean haveFileInfo;
+	int64_t size;
+	int64_t mtime;
+	int numfiles;
+	char            *names;                     // lowercased file names, one after another
+	int namesSize;
+	int             *headerLongs;
+	int numHeaderLongs;
+	int checksum;
+	int pure_checksum;
+} zipScan_t;
+
+static void FS_ChecksumZipHeaders( zipScan_t *scan, const int *headerLongs, int numHeaderLongs ) {
+	scan->checksum = Com_BlockChecksum( headerLongs, 4 * numHeaderLongs );
+	scan->pure_checksum = Com_BlockChecksumKey( const_cast<int*>( headerLongs ), 4 * numHeaderLongs, rtcw::Endian::le( fs_checksumFeed ) );
+
+#if defined RTCW_MP
+	// TTimo: DO_LIGHT_DEDICATED
+	// curious about the size of those
+	//Com_DPrintf("Com_BlockChecksumKey: %s %u\n", pack->pakBasename, 4 * fs_numHeaderLongs);
+	// cumulated for light dedicated: 21558 bytes
+#endif // RTCW_XX
+
+	rtcw::Endian::lei(scan->checksum);
+	rtcw::Endian::lei(scan->pure_checksum);
+}
+
+static void FS_ScanZipFile( zipScan_t *scan ) {
 	rtcw::String filename_inzip;
-	int i, len;
-	int32_t hash;
+	int i;
 	int fs_numHeaderLongs;
 	int             *fs_headerLongs;
 	char            *namePtr;
 
-	fs_numHeaderLongs = 0;
+	scan->valid = qfalse;
+	scan->zip = NULL;
+	scan->cache = NULL;
+	scan->numfiles = 0;
+	scan->names = NULL;
+	scan->namesSize = 0;
+	scan->headerLongs = NULL;
+	scan->numHeaderLongs = 0;
+
+	scan->haveFileInfo = FS_OSFileInfo( scan->zipfile, scan->size, scan->mtime ) ? qtrue : qfalse;
+
+	if ( scan->haveFileInfo ) {
+		scan->cache = FS_FindPakCache( scan->zipfile, scan->size, scan->mtime );
+	}
+
+	if ( scan->cache ) {
+		// the names are copied into the pack, they stay owned by the cache
+		scan->numfiles = scan->cache->numfiles;
+		scan->names = scan->cache->names;
+		scan->namesSize = scan->cache->namesSize;
+		FS_ChecksumZipHeaders( scan, scan->cache->headerLongs, scan->cache->numHeaderLongs );
+		scan->valid = qtrue;
+		return;
+	}
 
 	rtcw::UniquePtr<MinizZip, MinizZipDeleter> miniz_zip_uptr(rtcw::mem::new_object<MinizZip>());
 
-	if (!miniz_zip_uptr->open(zipfile))
+	if (!miniz_zip_uptr->open(scan->zipfile, fs_mapPaks->integer != 0))
 	{
-		return NULL;
+		return;
 	}
 
 	const int file_count = miniz_zip_uptr->get_file_count();
 
+	scan->namesSize = miniz_zip_uptr->calculate_file_names_size();
+	scan->names = static_cast<char*> (rtcw::mem::allocate(scan->namesSize > 0 ? scan->namesSize : 1));
+	fs_headerLongs = static_cast<int*> (rtcw::mem::allocate((file_count > 0 ? file_count : 1) * sizeof(int)));
+
+	if (scan->names == NULL || fs_headerLongs == NULL)
+	{
+		rtcw::mem::deallocate(scan->names);
+		rtcw::mem::deallocate(fs_headerLongs);
+		scan->names = NULL;
+		return;
+	}
+
+	fs_numHeaderLongs = 0;
+	namePtr = scan->names;
+
+	for (i = 0; i < file_count; ++i)
+	{
+		const MinizZip::FileStat file_info = miniz_zip_uptr->get_file_stat(i);
+
+		if (file_info.uncompressed_size > 0)
+		{
+			fs_headerLongs[fs_numHeaderLongs++] = static_cast<int>(file_info.crc);
+		}
+
+		filename_inzip = file_info.file_name;
+		Q_strlwr(&filename_inzip[0]);
+		strcpy(namePtr, filename_inzip.c_str());
+		namePtr += filename_inzip.length() + 1;
+	}
+
+	FS_ChecksumZipHeaders(scan, fs_headerLongs, fs_numHeaderLongs);
+
+	// kept for the header cache
+	scan->headerLongs = fs_headerLongs;
+	scan->numHeaderLongs = fs_numHeaderLongs;
+
+	scan->numfiles = file_count;
+	scan->zip = miniz_zip_uptr.release();
+	scan->valid = qtrue;
+}
+
+static void FS_ScanZipJob( void *data, int index ) {
+	FS_ScanZipFile( static_cast<zipScan_t*>( data ) + index );
+}
+
+/*
+=================
+FS_BuildZipPack
+
+Creates a new pak_t in the search chain for the contents
+of a scanned zip file, taking over the archive if it was opened.
+=================
+*/
+static pack_t* FS_BuildZipPack(
+	zipScan_t* scan)
+{
+	fileInPack_t    *buildBuffer;
+	pack_t          *pack;
+	int i;
+	int32_t hash;
+	char            *namePtr;
+
+	if (!scan->valid)
+	{
+		return NULL;
+	}
+
+	const int file_count = scan->numfiles;
+
 	fs_packFiles += file_count;
-	len = miniz_zip_uptr->calculate_file_names_size();
 
-	buildBuffer = static_cast<fileInPack_t*> (Z_Malloc((file_count * sizeof(fileInPack_t)) + len));
+	buildBuffer = static_cast<fileInPack_t*> (Z_Malloc((file_count * sizeof(fileInPack_t)) + scan->namesSize));
 	namePtr = ((char *)buildBuffer) + file_count * sizeof(fileInPack_t);
-	fs_headerLongs = static_cast<int*> (Z_Malloc(file_count * sizeof(int)));
+	memcpy(namePtr, scan->names, scan->namesSize);
 
 	// get the hash table size from the number of files in the zip
 	// because lots of custom pk3 files have less than 32 or 64 files
@@ -2852,8 +3772,8 @@ static pack_t* FS_LoadZipFile(
 		pack->hashTable[i] = NULL;
 	}
 
-	Q_strncpyz(pack->pakFilename, zipfile, sizeof(pack->pakFilename));
-	Q_strncpyz(pack->pakBasename, basename, sizeof(pack->pakBasename));
+	Q_strncpyz(pack->pakFilename, scan->zipfile, sizeof(pack->pakFilename));
+	Q_strncpyz(pack->pakBasename, scan->basename, sizeof(pack->pakBasename));
 
 	// strip .pk3 if needed
 	if (strlen(pack->pakBasename) > 4 && !Q_stricmp(pack->pakBasename + strlen(pack->pakBasename) - 4, ".pk3"))
@@ -2861,24 +3781,15 @@ static pack_t* FS_LoadZipFile(
 		pack->pakBasename[strlen(pack->pakBasename) - 4] = 0;
 	}
 
-	pack->miniz_zip_ptr_ = miniz_zip_uptr.release();
+	pack->miniz_zip_ptr_ = scan->zip;
+	scan->zip = NULL;
 	pack->numfiles = file_count;
 
 	for (i = 0; i < file_count; ++i)
 	{
-		const MinizZip::FileStat file_info = pack->miniz_zip_ptr_->get_file_stat(i);
-
-		if (file_info.uncompressed_size > 0)
-		{
-			fs_headerLongs[fs_numHeaderLongs++] = static_cast<int>(file_info.crc);
-		}
-
-		filename_inzip = file_info.file_name;
-		Q_strlwr(&filename_inzip[0]);
-		hash = FS_HashFileName(filename_inzip.c_str(), pack->hashSize);
+		hash = FS_HashFileName(namePtr, pack->hashSize);
 		buildBuffer[i].name = namePtr;
-		strcpy(buildBuffer[i].name, filename_inzip.c_str());
-		namePtr += filename_inzip.length() + 1;
+		namePtr += strlen(namePtr) + 1;
 		// store the file position in the zip
 
 		// BBi
@@ -2891,20 +3802,8 @@ static pack_t* FS_LoadZipFile(
 		pack->hashTable[hash] = &buildBuffer[i];
 	}
 
-	pack->checksum = Com_BlockChecksum(fs_headerLongs, 4 * fs_numHeaderLongs);
-	pack->pure_checksum = Com_BlockChecksumKey(fs_headerLongs, 4 * fs_numHeaderLongs, rtcw::Endian::le(fs_checksumFeed));
-
-#if defined RTCW_MP
-	// TTimo: DO_LIGHT_DEDICATED
-	// curious about the size of those
-	//Com_DPrintf("Com_BlockChecksumKey: %s %u\n", pack->pakBasename, 4 * fs_numHeaderLongs);
-	// cumulated for light dedicated: 21558 bytes
-#endif // RTCW_XX
-
-	rtcw::Endian::lei(pack->checksum);
-	rtcw::Endian::lei(pack->pure_checksum);
-
-	Z_Free(fs_headerLongs);
+	pack->checksum = scan->checksum;
+	pack->pure_checksum = scan->pure_checksum;
 
 	pack->buildBuffer = buildBuffer;
 	return pack;
@@ -3651,6 +4550,10 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 	int numfiles;
 	char            **pakfiles;
 	char            *sorted[MAX_PAKFILES];
+	zipScan_t       *scans;
+	zipScan_t       *scan;
+	pakCache_t      *cache;
+	int numScans;
 
 #if defined RTCW_MP
 // JPW NERVE
@@ -3729,6 +4632,12 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 
 	qsort( sorted, numfiles, sizeof (size_t), paksort );
 
+	scans = NULL;
+	numScans = 0;
+	if ( numfiles > 0 ) {
+		scans = static_cast<zipScan_t*> (Z_Malloc( numfiles * sizeof( *scans ) ));
+	}
+
 	for ( i = 0 ; i < numfiles ; i++ ) {
 
 #if !defined RTCW_ET
@@ -3761,17 +4670,9 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 */
 #endif // RTCW_XX
 
-			pakfile = FS_BuildOSPath( path, dir, sorted[i] );
-			if ( ( pak = FS_LoadZipFile( pakfile, sorted[i] ) ) == 0 ) {
-				continue;
-			}
-			// store the game name for downloading
-			strcpy( pak->pakGamename, dir );
-
-			search = static_cast<searchpath_t*> (Z_Malloc( sizeof( searchpath_t ) ));
-			search->pack = pak;
-			search->next = fs_searchpaths;
-			fs_searchpaths = search;
+			scan = &scans[numScans++];
+			Q_strncpyz( scan->zipfile, FS_BuildOSPath( path, dir, sorted[i] ), sizeof( scan->zipfile ) );
+			scan->basename = sorted[i];
 
 #if !defined RTCW_ET
 		}
@@ -3781,7 +4682,43 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 
 	}
 
+	// open the archives and checksum their headers on the job workers,
+	// then add them in sorted order
+	Sys_RunJobs( FS_ScanZipJob, scans, numScans );
+
+	for ( i = 0 ; i < numScans ; i++ ) {
+		scan = &scans[i];
+		pak = FS_BuildZipPack( scan );
+
+		if ( scan->cache ) {
+			scan->cache->used = qtrue;
+		} else if ( pak && scan->haveFileInfo ) {
+			cache = FS_AddPakCache( scan->zipfile, scan->size, scan->mtime, scan->numfiles,
+									scan->headerLongs, scan->numHeaderLongs, scan->names, scan->namesSize );
+			if ( cache ) {
+				cache->used = qtrue;
+			}
+		} else {
+			rtcw::mem::deallocate( scan->headerLongs );
+			rtcw::mem::deallocate( scan->names );
+		}
+
+		if ( !pak ) {
+			continue;
+		}
+		// store the game name for downloading
+		strcpy( pak->pakGamename, dir );
+
+		search = static_cast<searchpath_t*> (Z_Malloc( sizeof( searchpath_t ) ));
+		search->pack = pak;
+		search->next = fs_searchpaths;
+		fs_searchpaths = search;
+	}
+
 	// done
+	if ( scans ) {
+		Z_Free( scans );
+	}
 	Sys_FreeFileList( pakfiles );
 }
 
@@ -4039,6 +4976,8 @@ void FS_Shutdown( qboolean closemfp ) {
 		}
 	}
 
+	FS_ClearIndex();
+
 	// free everything
 	for ( p = fs_searchpaths ; p ; p = next ) {
 		next = p->next;
@@ -4062,6 +5001,7 @@ void FS_Shutdown( qboolean closemfp ) {
 	Cmd_RemoveCommand( "dir" );
 	Cmd_RemoveCommand( "fdir" );
 	Cmd_RemoveCommand( "touchFile" );
+	Cmd_RemoveCommand( "fs_rescan" );
 
 #ifdef FS_MISSING
 	if ( closemfp ) {
@@ -4128,6 +5068,8 @@ static void FS_Startup( const char *gameName ) {
 
 	fs_debug = Cvar_Get( "fs_debug", "0", 0 );
 	fs_copyfiles = Cvar_Get( "fs_copyfiles", "0", CVAR_INIT );
+	fs_mapPaks = Cvar_Get( "fs_mapPaks", "1", CVAR_INIT );
+	fs_index = Cvar_Get( "fs_index", "1", 0 );
 	fs_cdpath = Cvar_Get( "fs_cdpath", Sys_DefaultCDPath(), CVAR_INIT );
 	fs_basepath = Cvar_Get( "fs_basepath", Sys_DefaultInstallPath(), CVAR_INIT );
 
@@ -4145,6 +5087,8 @@ static void FS_Startup( const char *gameName ) {
 	fs_gamedirvar = Cvar_Get( "fs_game", "", CVAR_INIT | CVAR_SYSTEMINFO );
 	fs_restrict = Cvar_Get( "fs_restrict", "", CVAR_INIT );
 
+	FS_LoadPakCache();
+
 	// BBi
 	FS_AddGameDirectory (fs_basepath->string, "rtcw");
 	// BBi
@@ -4190,6 +5134,8 @@ static void FS_Startup( const char *gameName ) {
 	}
 #endif // RTCW_XX
 
+	FS_WritePakCache();
+
 	Com_ReadCDKey( BASEGAME );
 	fs = Cvar_Get( "fs_game", "", CVAR_INIT | CVAR_SYSTEMINFO );
 	if ( fs && fs->string[0] != 0 ) {
@@ -4201,6 +5147,7 @@ static void FS_Startup( const char *gameName ) {
 	Cmd_AddCommand( "dir", FS_Dir_f );
 	Cmd_AddCommand( "fdir", FS_NewDir_f );
 	Cmd_AddCommand( "touchFile", FS_TouchFile_f );
+	Cmd_AddCommand( "fs_rescan", FS_Rescan_f );
 
 #if !defined RTCW_SP
 	// show_bug.cgi?id=506
@@ -4208,6 +5155,9 @@ static void FS_Startup( const char *gameName ) {
 	FS_ReorderPurePaks();
 #endif // RTCW_XX
 
+	// index the final search order
+	FS_BuildIndex();
+
 	// print the current search paths
 	FS_Path_f();
 
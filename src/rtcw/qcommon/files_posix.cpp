@@ -7,6 +7,7 @@ SPDX-License-Identifier: GPL-3.0
 
 #ifndef _WIN32
 
+#include <stdint.h>
 #include <stdio.h>
 #include <sys/stat.h>
 
@@ -40,4 +41,20 @@ int FS_OSStatFile(const char* path)
 	return S_ISDIR(posix_stat.st_mode) != 0;
 }
 
+// ==========================================================================
+
+bool FS_OSFileInfo(const char* path, int64_t& size, int64_t& mtime)
+{
+	struct stat posix_stat;
+
+	if (::stat(path, &posix_stat) != 0)
+	{
+		return false;
+	}
+
+	size = static_cast<int64_t>(posix_stat.st_size);
+	mtime = static_cast<int64_t>(posix_stat.st_mtime);
+	return true;
+}
+
 #endif // _WIN32
@@ -8,6 +8,7 @@ SPDX-License-Identifier: GPL-3.0
 #ifdef _WIN32
 
 #include <assert.h>
+#include <stdint.h>
 #include <windows.h>
 
 // ==========================================================================
@@ -82,4 +83,31 @@ int FS_OSStatFile(const char* path)
 	return (win32_result & FILE_ATTRIBUTE_DIRECTORY) != 0;
 }
 
+// ==========================================================================
+
+bool FS_OSFileInfo(const char* path, int64_t& size, int64_t& mtime)
+{
+	const int max_path_size = 1024;
+	wchar_t u16_path[max_path_size];
+
+	int u16_path_size = ::MultiByteToWideChar(CP_UTF8, 0, path, -1, u16_path, max_path_size);
+
+	if (u16_path_size == 0)
+	{
+		assert(false && "MultiByteToWideChar");
+		return false;
+	}
+
+	WIN32_FILE_ATTRIBUTE_DATA win32_data;
+
+	if (::GetFileAttributesExW(u16_path, GetFileExInfoStandard, &win32_data) == 0)
+	{
+		return false;
+	}
+
+	size = (static_cast<int64_t>(win32_data.nFileSizeHigh) << 32) | win32_data.nFileSizeLow;
+	mtime = (static_cast<int64_t>(win32_data.ftLastWriteTime.dwHighDateTime) << 32) | win32_data.ftLastWriteTime.dwLowDateTime;
+	return true;
+}
+
 #endif // _WIN32
@@ -382,6 +382,145 @@ void Huff_offsetTransmit( huff_t *huff, int ch, byte *fout, int *offset ) {
 	*offset = bloc;
 }
 
+/*
+==================
+Huff_BuildTable
+
+Reads the codes off a tree that won't be updated anymore,
+so they can be sent and received several bits at a time
+==================
+*/
+void Huff_BuildTable( huffTable_t *table, huff_t *compressor, huff_t *decompressor ) {
+	int ch;
+	int i;
+	int length;
+	unsigned int code;
+	node_t *node;
+
+	Com_Memset( table, 0, sizeof( *table ) );
+
+	table->compressor = compressor;
+	table->tree = decompressor->tree;
+
+	for ( ch = 0 ; ch <= HMAX ; ch++ ) {
+		if ( !compressor->loc[ch] ) {
+			continue;
+		}
+
+		// the code is sent from the root down, so the
+		// bit of the deepest node ends up the highest
+		code = 0;
+		length = 0;
+		for ( node = compressor->loc[ch] ; node->parent ; node = node->parent ) {
+			if ( length == HUFF_MAX_CODE_BITS ) {
+				break;
+			}
+			code = ( code << 1 ) | ( node->parent->right == node ? 1 : 0 );
+			length++;
+		}
+
+		if ( node->parent || length == 0 ) {
+			continue;
+		}
+
+		table->code[ch] = code;
+		table->length[ch] = length;
+	}
+
+	for ( i = 0 ; i < ( 1 << HUFF_LOOKUP_BITS ) ; i++ ) {
+		node = table->tree;
+		length = 0;
+
+		while ( node && node->symbol == INTERNAL_NODE && length < HUFF_LOOKUP_BITS ) {
+			if ( ( i >> length ) & 1 ) {
+				node = node->right;
+			} else {
+				node = node->left;
+			}
+			length++;
+		}
+
+		if ( node && node->symbol != INTERNAL_NODE ) {
+			table->lookup[i].symbol = node->symbol;
+			table->lookup[i].length = length;
+		} else {
+			table->lookup[i].symbol = INTERNAL_NODE;
+			table->lookup[i].length = 0;
+		}
+	}
+}
+
+/*
+==================
+Huff_tableTransmit
+
+Same bits as Huff_offsetTransmit
+==================
+*/
+void Huff_tableTransmit( const huffTable_t *table, int ch, byte *fout, int *offset ) {
+	int x, y;
+	int numBytes;
+	int i;
+	unsigned int value;
+
+	if ( !table->length[ch] ) {
+		Huff_offsetTransmit( table->compressor, ch, fout, offset );
+		return;
+	}
+
+	x = *offset >> 3;
+	y = *offset & 7;
+	value = table->code[ch] << y;
+	numBytes = ( y + table->length[ch] + 7 ) >> 3;
+
+	// bytes are cleared as they are started, like Huff_putBit does
+	if ( y ) {
+		fout[x] |= (byte)value;
+	} else {
+		fout[x] = (byte)value;
+	}
+
+	for ( i = 1 ; i < numBytes ; i++ ) {
+		fout[x + i] = (byte)( value >> ( i * 8 ) );
+	}
+
+	*offset += table->length[ch];
+}
+
+/*
+==================
+Huff_tableReceive
+
+Same result as Huff_offsetReceive. The bits of a lookup are read
+ahead, so near the end of the buffer the tree is walked instead.
+==================
+*/
+void Huff_tableReceive( const huffTable_t *table, int *ch, byte *fin, int *offset, int size ) {
+	int x, y;
+	unsigned int bits;
+	const huffLookup_t *lookup;
+
+	x = *offset >> 3;
+	y = *offset & 7;
+
+	if ( x + 3 > size ) {
+		Huff_offsetReceive( table->tree, ch, fin, offset );
+		return;
+	}
+
+	bits = fin[x] | ( fin[x + 1] << 8 ) | ( fin[x + 2] << 16 );
+	lookup = &table->lookup[( bits >> y ) & ( ( 1 << HUFF_LOOKUP_BITS ) - 1 )];
+
+	if ( lookup->symbol == INTERNAL_NODE ) {
+		// long code
+		Huff_offsetReceive( table->tree, ch, fin, offset );
+		return;
+	}
+
+	*ch = lookup->symbol;
+	*offset += lookup->length;
+}
+
 void Huff_Decompress( msg_t *mbuf, int offset ) {
 	int ch, cch, i, j, size;
 	byte seq[65536];
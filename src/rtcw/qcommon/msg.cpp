@@ -10,6 +10,7 @@ SPDX-License-Identifier: GPL-3.0
 #include "rtcw_endian.h"
 
 static huffman_t msgHuff;
+static huffTable_t msgHuffTable;
 static qboolean msgInit = qfalse;
 
 #if !defined RTCW_SP
@@ -137,6 +138,47 @@ bit functions
 int overflows;
 #endif // RTCW_XX
 
+/*
+Raw bits and Huffman codes of a bitstream write are gathered in a word
+and stored a byte at a time. The bits already written to the first byte
+are kept, and the bits past the end of the last one are left clear,
+which is what Huff_putBit does one bit at a time.
+*/
+typedef struct {
+	byte *out;
+	unsigned long long pending;
+	int numPending;
+	int numBits;
+} msgBitWriter_t;
+
+static void MSG_BeginBitWriter( msgBitWriter_t *writer, const msg_t *msg ) {
+	writer->out = &msg->data[msg->bit >> 3];
+	writer->numPending = msg->bit & 7;
+	writer->pending = writer->numPending ? ( *writer->out & ( ( 1 << writer->numPending ) - 1 ) ) : 0;
+	writer->numBits = 0;
+}
+
+// bits must be 32 or less
+static void MSG_PutBits( msgBitWriter_t *writer, unsigned int value, int bits ) {
+	writer->pending |= (unsigned long long)value << writer->numPending;
+	writer->numPending += bits;
+	writer->numBits += bits;
+
+	while ( writer->numPending >= 8 ) {
+		*writer->out++ = (byte)writer->pending;
+		writer->pending >>= 8;
+		writer->numPending -= 8;
+	}
+}
+
+static void MSG_EndBitWriter( msgBitWriter_t *writer, msg_t *msg ) {
+	if ( writer->numPending ) {
+		*writer->out = (byte)writer->pending;
+	}
+
+	msg->bit += writer->numBits;
+}
+
 // negative bit values include signs
 void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 	int i;
@@ -210,29 +252,99 @@ void MSG_WriteBits( msg_t *msg, int value, int bits ) {
 			Com_Error( ERR_DROP, "can't read %d bits\n", bits );
 		}
 	} else {
+		msgBitWriter_t writer;
+		unsigned int uvalue;
+		int ch;
+
 //		fp = fopen("c:\\netchan.bin", "a");
-		value &= ( 0xffffffff >> ( 32 - bits ) );
+		uvalue = value & ( 0xffffffff >> ( 32 - bits ) );
+		MSG_BeginBitWriter( &writer, msg );
 		if ( bits & 7 ) {
 			int nbits;
 			nbits = bits & 7;
-			for ( i = 0; i < nbits; i++ ) {
-				Huff_putBit( ( value & 1 ), msg->data, &msg->bit );
-				value = ( value >> 1 );
-			}
+			MSG_PutBits( &writer, uvalue & ( ( 1 << nbits ) - 1 ), nbits );
+			uvalue = ( uvalue >> nbits );
 			bits = bits - nbits;
 		}
 		if ( bits ) {
 			for ( i = 0; i < bits; i += 8 ) {
 //				fwrite(bp, 1, 1, fp);
-				Huff_offsetTransmit( &msgHuff.compressor, ( value & 0xff ), msg->data, &msg->bit );
-				value = ( value >> 8 );
+				ch = uvalue & 0xff;
+				if ( msgHuffTable.length[ch] ) {
+					MSG_PutBits( &writer, msgHuffTable.code[ch], msgHuffTable.length[ch] );
+				} else {
+					// too long for the table
+					MSG_EndBitWriter( &writer, msg );
+					Huff_tableTransmit( &msgHuffTable, ch, msg->data, &msg->bit );
+					MSG_BeginBitWriter( &writer, msg );
+				}
+				uvalue = ( uvalue >> 8 );
 			}
 		}
+		MSG_EndBitWriter( &writer, msg );
 		msg->cursize = ( msg->bit >> 3 ) + 1;
 //		fclose(fp);
 	}
 }
 
+/*
+=================
+MSG_AppendBits
+
+Appends everything written to src at the current bit position of msg.
+Bitstream data is already compressed, so it's copied as is. The bits
+past the write position of both messages are always clear, which
+lets whole bytes be merged at any alignment.
+=================
+*/
+void MSG_AppendBits( msg_t *msg, const msg_t *src ) {
+	int i;
+	int numBytes;
+	int shift;
+	byte *out;
+
+	if ( msg->oob || src->oob ) {
+		Com_Error( ERR_DROP, "MSG_AppendBits: out of band message" );
+	}
+
+	if ( src->bit == 0 ) {
+		return;
+	}
+
+	numBytes = ( src->bit + 7 ) >> 3;
+
+	// same margin as MSG_WriteBits
+
+#if !defined RTCW_ET
+	if ( msg->maxsize - ( ( msg->bit + src->bit ) >> 3 ) - 1 < 4 ) {
+#else
+	if ( msg->maxsize - ( ( msg->bit + src->bit ) >> 3 ) - 1 < 32 ) {
+#endif // RTCW_XX
+
+		msg->overflowed = qtrue;
+		return;
+	}
+
+	out = &msg->data[msg->bit >> 3];
+	shift = msg->bit & 7;
+
+	if ( shift == 0 ) {
+		Com_Memcpy( out, src->data, numBytes );
+	} else {
+		for ( i = 0 ; i < numBytes ; i++ ) {
+			out[i] |= src->data[i] << shift;
+			out[i + 1] = src->data[i] >> ( 8 - shift );
+		}
+	}
+
+#if !defined RTCW_SP
+	msg->uncompsize += src->uncompsize;
+#endif // RTCW_XX
+
+	msg->bit += src->bit;
+	msg->cursize = ( msg->bit >> 3 ) + 1;
+}
+
 int MSG_ReadBits( msg_t *msg, int bits ) {
 	int value;
 	int get;
@@ -271,15 +383,22 @@ int MSG_ReadBits( msg_t *msg, int bits ) {
 		nbits = 0;
 		if ( bits & 7 ) {
 			nbits = bits & 7;
-			for ( i = 0; i < nbits; i++ ) {
-				value |= ( Huff_getBit( msg->data, &msg->bit ) << i );
+			if ( ( msg->bit >> 3 ) + 2 <= msg->maxsize ) {
+				const byte *in = &msg->data[msg->bit >> 3];
+
+				value = ( ( in[0] | ( in[1] << 8 ) ) >> ( msg->bit & 7 ) ) & ( ( 1 << nbits ) - 1 );
+				msg->bit += nbits;
+			} else {
+				for ( i = 0; i < nbits; i++ ) {
+					value |= ( Huff_getBit( msg->data, &msg->bit ) << i );
+				}
 			}
 			bits = bits - nbits;
 		}
 		if ( bits ) {
 //			fp = fopen("c:\\netchan.bin", "a");
 			for ( i = 0; i < bits; i += 8 ) {
-				Huff_offsetReceive( msgHuff.decompressor.tree, &get, msg->data, &msg->bit );
+				Huff_tableReceive( &msgHuffTable, &get, msg->data, &msg->bit, msg->maxsize );
 //				fwrite(&get, 1, 1, fp);
 				value |= ( get << ( i + nbits ) );
 			}
@@ -2846,6 +2965,125 @@ void MSG_initHuffman() {
 			Huff_addRef( &msgHuff.decompressor,  (byte)i );           /* Do update */
 		}
 	}
+
+	Huff_BuildTable( &msgHuffTable, &msgHuff.compressor, &msgHuff.decompressor );
+}
+
+/*
+=================
+MSG_HuffTest_f
+
+Checks the message code tables against the tree walk
+on random data and times both of them
+=================
+*/
+#define HUFF_TEST_BYTES 0x4000
+#define HUFF_TEST_PASSES 64
+
+void MSG_HuffTest_f( void ) {
+	static byte symbols[HUFF_TEST_BYTES];
+	static byte treeData[HUFF_TEST_BYTES * 4];
+	static byte tableData[HUFF_TEST_BYTES * 4];
+	int i, pass;
+	int startBit;
+	int treeBit, tableBit;
+	int treeCh, tableCh;
+	int errors;
+	long long start, treeTime, tableTime;
+
+	if ( !msgInit ) {
+		MSG_initHuffman();
+	}
+
+	errors = 0;
+
+	for ( pass = 0 ; pass < HUFF_TEST_PASSES ; pass++ ) {
+		// weighted like the traffic the tree was built from
+		for ( i = 0 ; i < HUFF_TEST_BYTES ; i++ ) {
+			symbols[i] = ( rand() & 3 ) ? rand() & 15 : rand() & 255;
+		}
+
+		// stale bits must not leak into either output
+		memset( treeData, 0xff, sizeof( treeData ) );
+		memset( tableData, 0xff, sizeof( tableData ) );
+
+		// start unaligned, as a message would
+		treeData[0] = tableData[0] = 0;
+		startBit = rand() & 7;
+		treeBit = tableBit = startBit;
+
+		for ( i = 0 ; i < HUFF_TEST_BYTES ; i++ ) {
+			Huff_offsetTransmit( &msgHuff.compressor, symbols[i], treeData, &treeBit );
+			Huff_tableTransmit( &msgHuffTable, symbols[i], tableData, &tableBit );
+		}
+
+		if ( treeBit != tableBit || memcmp( treeData, tableData, ( treeBit + 7 ) >> 3 ) ) {
+			Com_Printf( "pass %i: encoded bits differ\n", pass );
+			errors++;
+			continue;
+		}
+
+		// decode the stream, then random garbage
+		for ( i = 0 ; i < 2 ; i++ ) {
+			int size;
+			int n;
+
+			if ( i == 1 ) {
+				for ( n = 0 ; n < (int)sizeof( tableData ) ; n++ ) {
+					tableData[n] = rand();
+				}
+			}
+
+			size = ( tableBit + 7 ) >> 3;
+			treeBit = tableBit = startBit;
+
+			for ( n = 0 ; n < HUFF_TEST_BYTES && ( tableBit >> 3 ) < size ; n++ ) {
+				Huff_offsetReceive( msgHuff.decompressor.tree, &treeCh, tableData, &treeBit );
+				Huff_tableReceive( &msgHuffTable, &tableCh, tableData, &tableBit, sizeof( tableData ) );
+
+				if ( treeCh != tableCh || treeBit != tableBit || ( i == 0 && tableCh != symbols[n] ) ) {
+					Com_Printf( "pass %i: decoded symbol %i differs\n", pass, n );
+					errors++;
+					break;
+				}
+			}
+		}
+	}
+
+	// throughput
+	for ( i = 0 ; i < HUFF_TEST_BYTES ; i++ ) {
+		symbols[i] = ( rand() & 3 ) ? rand() & 15 : rand() & 255;
+	}
+
+	start = Sys_Microseconds();
+	for ( pass = 0 ; pass < HUFF_TEST_PASSES ; pass++ ) {
+		treeBit = 0;
+		for ( i = 0 ; i < HUFF_TEST_BYTES ; i++ ) {
+			Huff_offsetTransmit( &msgHuff.compressor, symbols[i], treeData, &treeBit );
+		}
+		treeBit = 0;
+		for ( i = 0 ; i < HUFF_TEST_BYTES ; i++ ) {
+			Huff_offsetReceive( msgHuff.decompressor.tree, &treeCh, treeData, &treeBit );
+		}
+	}
+	treeTime = Sys_Microseconds() - start;
+
+	start = Sys_Microseconds();
+	for ( pass = 0 ; pass < HUFF_TEST_PASSES ; pass++ ) {
+		tableBit = 0;
+		for ( i = 0 ; i < HUFF_TEST_BYTES ; i++ ) {
+			Huff_tableTransmit( &msgHuffTable, symbols[i], tableData, &tableBit );
+		}
+		tableBit = 0;
+		for ( i = 0 ; i < HUFF_TEST_BYTES ; i++ ) {
+			Huff_tableReceive( &msgHuffTable, &tableCh, tableData, &tableBit, sizeof( tableData ) );
+		}
+	}
+	tableTime = Sys_Microseconds() - start;
+
+	Com_Printf( "%i errors\n", errors );
+	Com_Printf( "tree:  %i usec for %i KB\n", (int)treeTime, HUFF_TEST_BYTES * HUFF_TEST_PASSES * 2 / 1024 );
+	Com_Printf( "table: %i usec for %i KB\n", (int)tableTime, HUFF_TEST_BYTES * HUFF_TEST_PASSES * 2 / 1024 );
 }
 
 /*
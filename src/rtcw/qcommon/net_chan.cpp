@@ -587,6 +587,70 @@ qboolean    NET_IsLocalAddress( netadr_t adr ) {
 	return adr.type == NA_LOOPBACK;
 }
 
+/*
+===================
+NET_RateLimit
+
+Token bucket per source address, ignoring the port. An address may send rate
+packets per second, in bursts of up to rate. Returns qtrue if this packet is
+over the limit. Addresses that hash to a full set replace the one heard from
+longest ago.
+===================
+*/
+qboolean NET_RateLimit( netRateLimit_t *limit, netadr_t adr, int rate, int now ) {
+	netRateBucket_t *set, *bucket;
+	unsigned int hash;
+	int cost;
+	int i;
+
+	if ( rate <= 0 ) {
+		return qfalse;
+	}
+
+	hash = ( adr.ip[0] << 24 ) | ( adr.ip[1] << 16 ) | ( adr.ip[2] << 8 ) | adr.ip[3];
+	hash = ( hash ^ ( hash >> 15 ) ) * 0x2c1b3c6d;
+	hash ^= hash >> 12;
+
+	set = &limit->buckets[( hash & ( NET_RATE_BUCKETS - 1 ) ) & ~( NET_RATE_SET - 1 )];
+
+	bucket = NULL;
+	for ( i = 0 ; i < NET_RATE_SET ; i++ ) {
+		if ( set[i].used && set[i].type == adr.type && !memcmp( set[i].ip, adr.ip, sizeof( adr.ip ) ) ) {
+			bucket = &set[i];
+			break;
+		}
+		if ( !bucket || !set[i].used || ( bucket->used && set[i].lastTime - bucket->lastTime < 0 ) ) {
+			bucket = &set[i];
+		}
+	}
+
+	if ( i == NET_RATE_SET ) {
+		// a new address starts with a full bucket
+		bucket->used = qtrue;
+		bucket->type = adr.type;
+		memcpy( bucket->ip, adr.ip, sizeof( bucket->ip ) );
+		bucket->credit = 1000;
+	} else {
+		bucket->credit += now - bucket->lastTime;
+		if ( bucket->credit > 1000 || bucket->credit < 0 ) {
+			bucket->credit = 1000;
+		}
+	}
+	bucket->lastTime = now;
+
+	cost = 1000 / rate;
+	if ( cost < 1 ) {
+		cost = 1;
+	}
+
+	if ( bucket->credit < cost ) {
+		return qtrue;
+	}
+
+	bucket->credit -= cost;
+	return qfalse;
+}
+
 
 /*
 =============================================================================
@@ -77,6 +77,7 @@ struct entityState_s;
 struct playerState_s;
 
 void MSG_WriteBits( msg_t *msg, int value, int bits );
+void MSG_AppendBits( msg_t *msg, const msg_t *src );
 
 void MSG_WriteChar( msg_t *sb, int c );
 void MSG_WriteByte( msg_t *sb, int c );
@@ -124,6 +125,7 @@ void MSG_ReadDeltaPlayerstate( msg_t *msg, struct playerState_s *from, struct pl
 
 
 void MSG_ReportChangeVectors_f( void );
+void MSG_HuffTest_f( void );
 
 //============================================================================
 
@@ -206,6 +208,24 @@ qboolean    NET_CompareAdr( netadr_t a, netadr_t b );
 qboolean    NET_CompareBaseAdr( netadr_t a, netadr_t b );
 qboolean    NET_IsLocalAddress( netadr_t adr );
 
+// per address token buckets for connectionless traffic
+#define NET_RATE_BUCKETS    1024
+#define NET_RATE_SET        4       // buckets an address may land in
+
+typedef struct {
+	qboolean used;
+	netadrtype_t type;
+	byte ip[4];
+	int lastTime;
+	int credit;                     // msec of allowance, up to a second
+} netRateBucket_t;
+
+typedef struct {
+	netRateBucket_t buckets[NET_RATE_BUCKETS];
+} netRateLimit_t;
+
+qboolean    NET_RateLimit( netRateLimit_t *limit, netadr_t adr, int rate, int now );
+
 const char  *NET_AdrToString( netadr_t a );
 qboolean    NET_StringToAdr( const char *s, netadr_t *a );
 qboolean    NET_GetLoopPacket( netsrc_t sock, netadr_t *net_from, msg_t *net_message );
@@ -664,6 +684,10 @@ extern int cvar_modifiedFlags;
 // etc, variables have been modified since the last check.  The bit
 // can then be cleared to allow another change detection.
 
+extern int cvar_modificationCount;
+// incremented whenever any cvar's value or flags change, or a cvar
+// is created or removed
+
 /*
 ==============================================================
 
@@ -772,6 +796,10 @@ int     FS_Read( void *buffer, int len, fileHandle_t f );
 void    FS_FCloseFile( fileHandle_t f );
 // note: you can't just fclose from another DLL, due to MS libc issues
 
+const void *FS_MapFile( const char *qpath, int *length, void **mapping );
+void    FS_UnmapFile( void *mapping );
+// read-only mapping of a loose file, returns NULL for missing files and files inside pk3s
+
 int     FS_ReadFile( const char *qpath, void **buffer );
 // returns the length of the file
 // a null buffer will just return the file length without loading
@@ -1040,6 +1068,7 @@ extern int time_backend;            // renderer backend time
 
 extern int com_frameTime;
 extern int com_frameMsec;
+extern int com_frameNumber;
 
 #if defined RTCW_ET
 extern int com_expectedhunkusage;
@@ -1057,7 +1086,8 @@ typedef enum {
 	TAG_BOTLIB,
 	TAG_RENDERER,
 	TAG_SMALL,
-	TAG_STATIC
+	TAG_STATIC,
+	TAG_SLAB                // zone pages split into small chunks
 } memtag_t;
 
 /*
@@ -1232,6 +1262,7 @@ void SCR_DebugGraph( float value, int color );   // FIXME: move logging to commo
 void SV_Init( void );
 void SV_Shutdown( const char *finalmsg );
 void SV_Frame( int msec );
+int SV_FrameMsec( void );
 void SV_PacketEvent( netadr_t from, msg_t *msg );
 qboolean SV_GameCommand( void );
 
@@ -1281,8 +1312,22 @@ typedef struct {
 
 sysEvent_t  Sys_GetEvent( void );
 
+// event payloads, safe to allocate and free on any thread
+void    *Sys_AllocEventData( int size );
+void    Sys_FreeEventData( void *ptr );
+
 void    Sys_Init( void );
 
+//
+// worker threads
+//
+typedef void ( *sysJobFunc_t )( void *data, int index );
+
+void    Sys_InitJobs( void );
+void    Sys_ShutdownJobs( void );
+int     Sys_GetJobWorkerCount( void );
+void    Sys_RunJobs( sysJobFunc_t func, void *data, int count );
+
 #if defined RTCW_ET
 bool Sys_IsNumLockDown();
 #endif // RTCW_XX
@@ -1338,6 +1383,9 @@ void    Sys_Print( const char *msg );
 // any game related timing information should come from event timestamps
 int Sys_Milliseconds();
 
+// Sys_Microseconds is for profiling only
+long long Sys_Microseconds();
+
 void    Sys_SnapVector( float *v );
 
 // the system console is shown when a dedicated server is running
@@ -1365,6 +1413,12 @@ void sys_handle_console_sdl_event(
 void sys_update_console();
 
 void    Sys_SendPacket( int length, const void *data, netadr_t to );
+void    Sys_BeginPacketBatch();
+void    Sys_EndPacketBatch();
+
+// connectionless queries answered on the network receive thread
+bool    Sys_IsNetThreadRunning();
+void    Sys_SetQueryResponse( const char *query, const char *head, const char *tail );
 
 bool    Sys_StringToAdr( const char *s, netadr_t *a );
 //Does NOT parse port numbers, only base addresses.
@@ -1442,6 +1496,23 @@ typedef struct {
 	huff_t decompressor;
 } huffman_t;
 
+// static code tables of a tree that doesn't adapt anymore
+#define HUFF_LOOKUP_BITS    11
+#define HUFF_MAX_CODE_BITS  25
+
+typedef struct {
+	unsigned short symbol;  // INTERNAL_NODE if the code is longer than HUFF_LOOKUP_BITS
+	unsigned short length;
+} huffLookup_t;
+
+typedef struct {
+	huff_t          *compressor;
+	node_t          *tree;
+	unsigned int code[HMAX + 1];        // the first bit sent is bit 0
+	int length[HMAX + 1];               // 0 if the symbol has to be sent through the tree
+	huffLookup_t lookup[1 << HUFF_LOOKUP_BITS];
+} huffTable_t;
+
 void    Huff_Compress( msg_t *buf, int offset );
 void    Huff_Decompress( msg_t *buf, int offset );
 void    Huff_Init( huffman_t *huff );
@@ -1452,6 +1523,9 @@ void    Huff_offsetReceive( node_t *node, int *ch, byte *fin, int *offset );
 void    Huff_offsetTransmit( huff_t *huff, int ch, byte *fout, int *offset );
 void    Huff_putBit( int bit, byte *fout, int *offset );
 int     Huff_getBit( byte *fout, int *offset );
+void    Huff_BuildTable( huffTable_t *table, huff_t *compressor, huff_t *decompressor );
+void    Huff_tableTransmit( const huffTable_t *table, int ch, byte *fout, int *offset );
+void    Huff_tableReceive( const huffTable_t *table, int *ch, byte *fin, int *offset, int size );
 
 extern huffman_t clientHuffTables;
 
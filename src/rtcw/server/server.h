@@ -41,7 +41,6 @@ typedef struct svEntity_s {
 	int clusternums[MAX_ENT_CLUSTERS];
 	int lastCluster;                // if all the clusters don't fit in clusternums
 	int areanum, areanum2;
-	int snapshotCounter;            // used to prevent double adding from portal views
 
 #if defined RTCW_ET
 	int originCluster;              // Gordon: calced upon linking, for origin only bmodel vis checks
@@ -70,7 +69,6 @@ typedef struct {
 	int checksumFeedServerId;
 #endif // RTCW_XX
 
-	int snapshotCounter;                // incremented for each snapshot built
 	int timeResidual;                   // <= 1000 / sv_frame->value
 	int nextFrameTime;                  // when time > nextFrameTime, process world
 	struct cmodel_s *models[MAX_MODELS];
@@ -82,6 +80,9 @@ typedef struct {
 
 	svEntity_t svEntities[MAX_GENTITIES];
 
+	int numSnapshotClusters;
+	int             *snapshotClusterFirst;  // per cluster offsets into the snapshot entity index
+
 	char            *entityParsePoint;  // used during game VM init
 
 	// the game virtual machine will update these on init and changes
@@ -426,6 +427,9 @@ extern cvar_t  *sv_gametype;
 extern cvar_t  *sv_pure;
 extern cvar_t  *sv_floodProtect;
 extern cvar_t  *sv_allowAnonymous;
+extern cvar_t  *sv_snapshotSpeeds;
+extern cvar_t  *sv_areaGrid;
+extern cvar_t  *sv_queryRate;
 
 #if !defined RTCW_SP
 extern cvar_t  *sv_lanForceRate;
@@ -494,6 +498,8 @@ void QDECL SV_SendServerCommand( client_t *cl, const char *fmt, ... );
 
 void SV_AddOperatorCommands( void );
 void SV_RemoveOperatorCommands( void );
+void SV_InvalidateQueryCache( void );
+void SV_QueryStats_f( void );
 
 
 #if defined RTCW_SP
@@ -600,6 +606,7 @@ void SV_WriteFrameToClient( client_t *client, msg_t *msg );
 void SV_SendMessageToClient( msg_t *msg, client_t *client );
 void SV_SendClientMessages( void );
 void SV_SendClientSnapshot( client_t *client );
+void SV_InitSnapshotEntityIndex( void );
 
 #if defined RTCW_ET
 //bani
@@ -657,6 +664,8 @@ int         SV_BotLibSetup( void );
 int         SV_BotLibShutdown( void );
 int         SV_BotGetSnapshotEntity( int client, int ent );
 int         SV_BotGetConsoleMessage( int client, char *buf, int size );
+void        SV_RouteTest_f( void );
+void        SV_RouteBench_f( void );
 
 int BotImport_DebugPolygonCreate( int color, int numPoints, vec3_t *points );
 void BotImport_DebugPolygonDelete( int id );
@@ -685,6 +694,7 @@ clipHandle_t SV_ClipHandleForEntity( const sharedEntity_t *ent );
 
 
 void SV_SectorList_f( void );
+void SV_AreaBench_f( void );
 
 
 int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int maxcount );
@@ -701,6 +711,7 @@ int SV_PointContents( const vec3_t p, int passEntityNum );
 
 
 void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule );
+void SV_TraceBatch( trace_t *results, const traceRay_t *rays, int numRays, const vec3_t mins, const vec3_t maxs, int passEntityNum, int contentmask, int capsule );
 // mins and maxs are relative
 
 // if the entire move stays in a solid volume, trace.allsolid will be set,
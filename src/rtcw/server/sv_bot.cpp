@@ -685,6 +685,9 @@ int SV_BotLibSetup( void ) {
 		return -1;
 	}
 
+	// build the routing tables of maps that don't have them yet
+	botlib_export->BotLibVarSet( "bot_routeprecompute", Cvar_VariableString( "bot_routeprecompute" ) );
+
 #if !defined RTCW_ET
 	return botlib_export->BotLibSetup();
 #else
@@ -725,6 +728,57 @@ int SV_BotLibShutdown( void ) {
 	return botlib_export->BotLibShutdown();
 }
 
+/*
+==================
+SV_BotRouteTest
+
+Runs the goal directed route test or benchmark on the loaded AAS
+==================
+*/
+static void SV_BotRouteTest( int benchmark ) {
+	int numqueries;
+
+	// make sure server is running
+	if ( !com_sv_running->integer ) {
+		Com_Printf( "Server is not running.\n" );
+		return;
+	}
+
+	if ( !bot_enable || !botlib_export || !botlib_export->aas.AAS_Initialized() ) {
+		Com_Printf( "AAS not initialized\n" );
+		return;
+	}
+
+	numqueries = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 1000;
+	if ( numqueries < 1 ) {
+		numqueries = 1;
+	}
+
+	botlib_export->aas.AAS_TestGoalDirectedRoutes( numqueries, benchmark );
+}
+
+/*
+==================
+SV_RouteTest_f
+
+Checks the goal directed routes and their estimates against the routing cache
+==================
+*/
+void SV_RouteTest_f( void ) {
+	SV_BotRouteTest( 0 );
+}
+
+/*
+==================
+SV_RouteBench_f
+
+Times goal directed routes against routing cache queries
+==================
+*/
+void SV_RouteBench_f( void ) {
+	SV_BotRouteTest( 1 );
+}
+
 /*
 ==================
 SV_BotInitCvars
@@ -762,6 +816,7 @@ void SV_BotInitCvars( void ) {
 #endif // RTCW_XX
 
 	Cvar_Get( "bot_grapple", "0", 0 );          //enable grapple
+	Cvar_Get( "bot_routeprecompute", "0", 0 );  //precompute the routing tables
 
 #if !defined RTCW_ET
 	Cvar_Get( "bot_rocketjump", "1", 0 );           //enable rocket jumping
@@ -883,6 +938,11 @@ void SV_BotInitBotLib( void ) {
 	botlib_import.FS_Write = FS_Write;
 	botlib_import.FS_FCloseFile = FS_FCloseFile;
 	botlib_import.FS_Seek = FS_Seek;
+	botlib_import.FS_MapFile = FS_MapFile;
+	botlib_import.FS_UnmapFile = FS_UnmapFile;
+
+	// worker threads
+	botlib_import.RunJobs = Sys_RunJobs;
 
 	//debug lines
 	botlib_import.DebugLineCreate = BotImport_DebugLineCreate;
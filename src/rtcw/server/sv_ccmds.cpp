@@ -1628,6 +1628,108 @@ static void SV_DumpUser_f( void ) {
 }
 
 
+/*
+=================
+SV_DeltaBench_f
+
+Times the delta encoding of the frames the server has recorded
+for its clients: each frame against the one before it
+=================
+*/
+static void SV_DeltaBench_f( void ) {
+	static byte msgBuffer[MAX_MSGLEN];
+	msg_t msg;
+	client_t *cl;
+	clientSnapshot_t *from, *to;
+	entityState_t *fromEnt, *toEnt;
+	int i, j, pass, passes;
+	int fromIndex, toIndex;
+	int numEntityDeltas, numPlayerDeltas;
+	int entityBits, playerBits;
+	int bit;
+	long long start, entityTime, playerTime;
+
+	// make sure server is running
+	if ( !com_sv_running->integer ) {
+		Com_Printf( "Server is not running.\n" );
+		return;
+	}
+
+	passes = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 10;
+	if ( passes < 1 ) {
+		passes = 1;
+	}
+
+	numEntityDeltas = numPlayerDeltas = 0;
+	entityBits = playerBits = 0;
+	entityTime = playerTime = 0;
+
+	MSG_Init( &msg, msgBuffer, sizeof( msgBuffer ) );
+
+	for ( pass = 0 ; pass < passes ; pass++ ) {
+		for ( i = 0, cl = svs.clients ; i < sv_maxclients->integer ; i++, cl++ ) {
+			if ( cl->state != CS_ACTIVE ) {
+				continue;
+			}
+
+			for ( j = cl->netchan.outgoingSequence - PACKET_BACKUP + 2 ; j < cl->netchan.outgoingSequence ; j++ ) {
+				from = &cl->frames[( j - 1 ) & PACKET_MASK];
+				to = &cl->frames[j & PACKET_MASK];
+
+				// the entities of old frames may have been overwritten
+				if ( from->first_entity <= svs.nextSnapshotEntities - svs.numSnapshotEntities ) {
+					continue;
+				}
+
+				if ( msg.cursize > MAX_MSGLEN / 2 ) {
+					MSG_Clear( &msg );
+				}
+
+				bit = msg.bit;
+				start = Sys_Microseconds();
+				MSG_WriteDeltaPlayerstate( &msg, &from->ps, &to->ps );
+				playerTime += Sys_Microseconds() - start;
+				playerBits += msg.bit - bit;
+				numPlayerDeltas++;
+
+				bit = msg.bit;
+				start = Sys_Microseconds();
+				fromIndex = toIndex = 0;
+				while ( toIndex < to->num_entities ) {
+					toEnt = &svs.snapshotEntities[( to->first_entity + toIndex ) % svs.numSnapshotEntities];
+					fromEnt = NULL;
+
+					while ( fromIndex < from->num_entities ) {
+						fromEnt = &svs.snapshotEntities[( from->first_entity + fromIndex ) % svs.numSnapshotEntities];
+						if ( fromEnt->number >= toEnt->number ) {
+							break;
+						}
+						fromIndex++;
+					}
+
+					if ( fromEnt && fromIndex < from->num_entities && fromEnt->number == toEnt->number ) {
+						MSG_WriteDeltaEntity( &msg, fromEnt, toEnt, qfalse );
+					} else {
+						MSG_WriteDeltaEntity( &msg, &sv.svEntities[toEnt->number].baseline, toEnt, qtrue );
+					}
+					toIndex++;
+					numEntityDeltas++;
+				}
+				entityTime += Sys_Microseconds() - start;
+				entityBits += msg.bit - bit;
+			}
+		}
+	}
+
+	if ( !numPlayerDeltas ) {
+		Com_Printf( "No recorded frames.\n" );
+		return;
+	}
+
+	Com_Printf( "%i playerstate deltas: %i usec, %i bytes\n", numPlayerDeltas, (int)playerTime, playerBits / 8 );
+	Com_Printf( "%i entity deltas: %i usec, %i bytes\n", numEntityDeltas, (int)entityTime, entityBits / 8 );
+}
+
 /*
 =================
 SV_KillServer
@@ -1700,6 +1802,11 @@ void SV_AddOperatorCommands( void ) {
 #endif // RTCW_XX
 
 	Cmd_AddCommand( "sectorlist", SV_SectorList_f );
+	Cmd_AddCommand( "deltabench", SV_DeltaBench_f );
+	Cmd_AddCommand( "areabench", SV_AreaBench_f );
+	Cmd_AddCommand( "querystats", SV_QueryStats_f );
+	Cmd_AddCommand( "routetest", SV_RouteTest_f );
+	Cmd_AddCommand( "routebench", SV_RouteBench_f );
 
 #if defined RTCW_SP
 	Cmd_AddCommand( "spmap", SV_Map_f );
@@ -1745,6 +1852,8 @@ void SV_RemoveOperatorCommands( void ) {
 	Cmd_RemoveCommand( "dumpuser" );
 	Cmd_RemoveCommand( "map_restart" );
 	Cmd_RemoveCommand( "sectorlist" );
+	Cmd_RemoveCommand( "deltabench" );
+	Cmd_RemoveCommand( "areabench" );
 	Cmd_RemoveCommand( "say" );
 #endif
 }
@@ -446,6 +446,9 @@ int32_t SV_GameSystemCalls (
 	case G_CVAR_VARIABLE_INTEGER_VALUE:
 		return Cvar_VariableIntegerValue(rtcw::from_vm_arg<const char*>(VMA(1)));
 
+	case G_CVAR_MODIFICATION_COUNT:
+		return cvar_modificationCount;
+
 	case G_CVAR_VARIABLE_STRING_BUFFER:
 		Cvar_VariableStringBuffer(
 			rtcw::from_vm_arg<const char*>(VMA(1)),
@@ -774,6 +777,19 @@ int32_t SV_GameSystemCalls (
 	case G_GET_SOUND_LENGTH:
 		return S_GetSoundLength(rtcw::from_vm_arg<sfxHandle_t>(rtcw::from_vm_arg<int>(args[1])));
 		// END		xkan, 10/28/2002
+
+	case G_TRACEBATCH:
+		SV_TraceBatch(
+			rtcw::from_vm_arg<trace_t*>(VMA(1)),
+			rtcw::from_vm_arg<const traceRay_t*>(VMA(2)),
+			rtcw::from_vm_arg<int>(args[3]),
+			rtcw::from_vm_arg<const vec_t*>(VMA(4)),
+			rtcw::from_vm_arg<const vec_t*>(VMA(5)),
+			rtcw::from_vm_arg<int>(args[6]),
+			rtcw::from_vm_arg<int>(args[7]),
+			qfalse
+		);
+		return 0;
 #endif // RTCW_XX
 
 		//====================================
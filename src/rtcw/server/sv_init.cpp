@@ -1021,6 +1021,7 @@ void SV_SpawnServer( char *server, qboolean killBots ) {
 
 	// clear physics interaction links
 	SV_ClearWorld();
+	SV_InitSnapshotEntityIndex();
 
 	// media configstring setting should be done during
 	// the loading stage, so connected clients don't have
@@ -1386,6 +1387,9 @@ void SV_Init( void ) {
 	sv_maxPing = Cvar_Get( "sv_maxPing", "0", CVAR_ARCHIVE | CVAR_SERVERINFO );
 	sv_floodProtect = Cvar_Get( "sv_floodProtect", "1", CVAR_ARCHIVE | CVAR_SERVERINFO );
 	sv_allowAnonymous = Cvar_Get( "sv_allowAnonymous", "0", CVAR_SERVERINFO );
+	sv_snapshotSpeeds = Cvar_Get( "sv_snapshotSpeeds", "0", 0 );
+	sv_areaGrid = Cvar_Get( "sv_areaGrid", "0", CVAR_LATCH );
+	sv_queryRate = Cvar_Get( "sv_queryRate", "10", CVAR_ARCHIVE );
 
 #if !defined RTCW_SP
 	sv_friendlyFire = Cvar_Get( "g_friendlyFire", "1", CVAR_SERVERINFO | CVAR_ARCHIVE );           // NERVE - SMF
@@ -1700,6 +1704,9 @@ void SV_Shutdown( const char *finalmsg ) {
 
 	SV_RemoveOperatorCommands();
 	SV_MasterShutdown();
+	Sys_SetQueryResponse( "getstatus", NULL, NULL );
+	Sys_SetQueryResponse( "getinfo", NULL, NULL );
+	SV_InvalidateQueryCache();
 	SV_ShutdownGameProgs();
 
 	// free current level
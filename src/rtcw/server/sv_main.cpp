@@ -59,6 +59,9 @@ cvar_t  *sv_gametype;
 cvar_t  *sv_pure;
 cvar_t  *sv_floodProtect;
 cvar_t  *sv_allowAnonymous;
+cvar_t  *sv_snapshotSpeeds;
+cvar_t  *sv_areaGrid;
+cvar_t  *sv_queryRate;
 
 #if !defined RTCW_SP
 cvar_t  *sv_lanForceRate; // TTimo - dedicated 1 (LAN) server forces local client rates to 99999 (bug #491)
@@ -556,14 +559,13 @@ qboolean SV_VerifyChallenge( const char *challenge ) {
 
 /*
 ================
-SVC_Status
+SV_StatusResponse
 
-Responds with all the info that qplug or qspy can see about the server
-and all connected players.  Used for getting detailed information after
-the simple info query.
+Builds the statusResponse for a getstatus with the given challenge.
+Returns qfalse if getstatus isn't answered.
 ================
 */
-void SVC_Status( netadr_t from ) {
+static qboolean SV_StatusResponse( const char *challenge, char *response, int responseSize ) {
 	char player[1024];
 	char status[MAX_MSGLEN];
 	int i;
@@ -580,24 +582,16 @@ void SVC_Status( netadr_t from ) {
 #else
 	if ( SV_GameIsSinglePlayer() ) {
 #endif // RTCW_XX
-		return;
+		return qfalse;
 	}
 
 #if defined RTCW_MP
 	// DHM - Nerve
 #ifdef UPDATE_SERVER
-	return;
+	return qfalse;
 #endif
 #endif // RTCW_XX
 
-#if defined RTCW_ET
-	//bani - bugtraq 12534
-	if ( !SV_VerifyChallenge( Cmd_Argv( 1 ) ) ) {
-		return;
-	}
-#endif // RTCW_XX
-
-
 #if !defined RTCW_ET
 	strcpy( infostring, Cvar_InfoString( CVAR_SERVERINFO ) );
 #else
@@ -606,7 +600,7 @@ void SVC_Status( netadr_t from ) {
 
 	// echo back the parameter to status. so master servers can use it as a challenge
 	// to prevent timed spoofed reply packets that add ghost servers
-	Info_SetValueForKey( infostring, "challenge", Cmd_Argv( 1 ) );
+	Info_SetValueForKey( infostring, "challenge", challenge );
 
 	// add "demo" to the sv_keywords if restricted
 	if ( Cvar_VariableValue( "fs_restrict" ) ) {
@@ -640,7 +634,8 @@ void SVC_Status( netadr_t from ) {
 		}
 	}
 
-	NET_OutOfBandPrint( NS_SERVER, from, "statusResponse\n%s\n%s", infostring, status );
+	Com_sprintf( response, responseSize, "statusResponse\n%s\n%s", infostring, status );
+	return qtrue;
 }
 
 #if !defined RTCW_SP
@@ -729,13 +724,13 @@ void SVC_GameCompleteStatus( netadr_t from ) {
 
 /*
 ================
-SVC_Info
+SV_InfoResponse
 
-Responds with a short info message that should be enough to determine
-if a user is interested in a server to do a full status
+Builds the infoResponse for a getinfo with the given challenge.
+Returns qfalse if getinfo isn't answered.
 ================
 */
-void SVC_Info( netadr_t from ) {
+static qboolean SV_InfoResponse( const char *challenge, char *response, int responseSize ) {
 	int i, count;
 	const char    *gamedir;
 	char infostring[MAX_INFO_STRING];
@@ -745,7 +740,7 @@ void SVC_Info( netadr_t from ) {
 
 	// DHM - Nerve
 #ifdef UPDATE_SERVER
-	return;
+	return qfalse;
 #endif
 #endif // RTCW_XX
 
@@ -756,21 +751,14 @@ void SVC_Info( netadr_t from ) {
 
 	// ignore if we are in single player
 	if ( SV_GameIsSinglePlayer() ) {
-		return;
+		return qfalse;
 	}
 #endif // RTCW_XX
 
 #if !defined RTCW_ET
 	// ignore if we are in single player
 	if ( Cvar_VariableValue( "g_gametype" ) == GT_SINGLE_PLAYER ) {
-		return;
-	}
-#endif // RTCW_XX
-
-#if defined RTCW_ET
-	//bani - bugtraq 12534
-	if ( !SV_VerifyChallenge( Cmd_Argv( 1 ) ) ) {
-		return;
+		return qfalse;
 	}
 #endif // RTCW_XX
 
@@ -786,7 +774,7 @@ void SVC_Info( netadr_t from ) {
 
 	// echo back the parameter to status. so servers can use it as a challenge
 	// to prevent timed spoofed reply packets that add ghost servers
-	Info_SetValueForKey( infostring, "challenge", Cmd_Argv( 1 ) );
+	Info_SetValueForKey( infostring, "challenge", challenge );
 
 	Info_SetValueForKey( infostring, "protocol", va( "%i", PROTOCOL_VERSION ) );
 	Info_SetValueForKey( infostring, "hostname", sv_hostname->string );
@@ -863,7 +851,293 @@ void SVC_Info( netadr_t from ) {
 	}
 #endif // RTCW_XX
 
-	NET_OutOfBandPrint( NS_SERVER, from, "infoResponse\n%s", infostring );
+	Com_sprintf( response, responseSize, "infoResponse\n%s", infostring );
+	return qtrue;
+}
+
+/*
+==============================================================================
+
+QUERY RESPONSE CACHE
+
+getstatus and getinfo responses are built around a placeholder challenge and
+kept until the server info, the player list or a score or ping changes, so a
+flood of queries costs one build per server frame at most.  The network
+receive thread, when it runs, gets a copy of every build.
+==============================================================================
+*/
+
+#define QUERY_CHALLENGE_LENGTH  64      // longest challenge a cached response can take
+#define QUERY_CACHE_MSEC        5000    // for the few inputs that aren't serverinfo cvars
+
+typedef struct {
+	const char  *query;
+	qboolean ( *build )( const char *challenge, char *response, int responseSize );
+
+	qboolean valid;
+	qboolean answered;                  // qfalse if the server doesn't answer this query now
+	int buildTime;
+	char response[MAX_MSGLEN];          // head, '\0', placeholder, tail
+	int tailOffset;
+
+	int cached;
+	int rebuilt;
+	int limited;
+} queryCache_t;
+
+static queryCache_t sv_queryCaches[2] = {
+	{ "getstatus", SV_StatusResponse, qfalse, qfalse, 0, "", 0, 0, 0, 0 },
+	{ "getinfo", SV_InfoResponse, qfalse, qfalse, 0, "", 0, 0, 0, 0 }
+};
+
+#define QUERY_STATUS    ( &sv_queryCaches[0] )
+#define QUERY_INFO      ( &sv_queryCaches[1] )
+
+static int sv_queryClientsKey;
+static netRateLimit_t sv_queryLimit;
+
+/*
+================
+SV_InvalidateQueryCache
+================
+*/
+void SV_InvalidateQueryCache( void ) {
+	int i;
+
+	for ( i = 0 ; i < 2 ; i++ ) {
+		sv_queryCaches[i].valid = qfalse;
+	}
+}
+
+/*
+================
+SV_QueryClientsKey
+
+Changes when anything the responses show about the clients changes
+================
+*/
+static int SV_QueryClientsKey( void ) {
+	client_t        *cl;
+	playerState_t   *ps;
+	const char      *s;
+	int key;
+	int i;
+
+	key = sv_maxclients->integer;
+	for ( i = 0, cl = svs.clients ; i < sv_maxclients->integer ; i++, cl++ ) {
+		key = key * 31 + ( cl->state >= CS_CONNECTED );
+		if ( cl->state < CS_CONNECTED ) {
+			continue;
+		}
+
+		ps = SV_GameClientNum( i );
+		key = key * 31 + ps->persistant[PERS_SCORE];
+		key = key * 31 + cl->ping;
+		for ( s = cl->name ; *s ; s++ ) {
+			key = key * 31 + *s;
+		}
+	}
+
+	return key;
+}
+
+/*
+================
+SV_BuildQueryCache
+================
+*/
+static void SV_BuildQueryCache( queryCache_t *cache ) {
+	char challenge[QUERY_CHALLENGE_LENGTH + 1];
+	char marker[QUERY_CHALLENGE_LENGTH + 16];
+	char *head;
+
+	Com_Memset( challenge, '~', QUERY_CHALLENGE_LENGTH );
+	challenge[QUERY_CHALLENGE_LENGTH] = '\0';
+	Com_sprintf( marker, sizeof( marker ), "\\challenge\\%s", challenge );
+
+	cache->valid = qtrue;
+	cache->buildTime = Sys_Milliseconds();
+	cache->rebuilt++;
+
+	cache->answered = cache->build( challenge, cache->response, sizeof( cache->response ) );
+	if ( !cache->answered ) {
+		Sys_SetQueryResponse( cache->query, NULL, NULL );
+		return;
+	}
+
+	// keys and values can't hold a backslash, so this can only be the challenge
+	head = strstr( cache->response, marker );
+	if ( !head ) {
+		// the challenge didn't fit, build every response on its own
+		cache->valid = qfalse;
+		Sys_SetQueryResponse( cache->query, NULL, NULL );
+		return;
+	}
+
+	*head = '\0';
+	cache->tailOffset = head - cache->response + strlen( marker );
+
+	Sys_SetQueryResponse( cache->query, cache->response, cache->response + cache->tailOffset );
+}
+
+/*
+================
+SV_QueryCacheIsCurrent
+================
+*/
+static qboolean SV_QueryCacheIsCurrent( const queryCache_t *cache ) {
+	int flags;
+
+	if ( !cache->valid ) {
+		return qfalse;
+	}
+
+	// SV_Frame clears these once the configstrings are updated,
+	// and drops the cache at the same time
+	flags = CVAR_SERVERINFO | CVAR_SYSTEMINFO;
+
+#if defined RTCW_ET
+	flags |= CVAR_SERVERINFO_NOUPDATE;
+#endif // RTCW_XX
+
+	if ( cvar_modifiedFlags & flags ) {
+		return qfalse;
+	}
+
+	return Sys_Milliseconds() - cache->buildTime < QUERY_CACHE_MSEC;
+}
+
+/*
+================
+SV_AnswerQuery
+
+Answers a query from the cache, rebuilding it if needed
+================
+*/
+static void SV_AnswerQuery( queryCache_t *cache, netadr_t from ) {
+	char response[MAX_MSGLEN];
+	const char  *challenge;
+
+	if ( NET_RateLimit( &sv_queryLimit, from, sv_queryRate->integer, Sys_Milliseconds() ) ) {
+		cache->limited++;
+		return;
+	}
+
+	challenge = Cmd_Argv( 1 );
+
+	if ( strlen( challenge ) <= QUERY_CHALLENGE_LENGTH ) {
+		if ( SV_QueryCacheIsCurrent( cache ) ) {
+			cache->cached++;
+		} else {
+			SV_BuildQueryCache( cache );
+		}
+
+		if ( cache->valid ) {
+			if ( !cache->answered ) {
+				return;
+			}
+
+			// Info_SetValueForKey skips a challenge it can't store
+			if ( !challenge[0] || strchr( challenge, '\\' ) || strchr( challenge, ';' ) || strchr( challenge, '"' ) ) {
+				challenge = NULL;
+			}
+
+			NET_OutOfBandPrint( NS_SERVER, from, "%s%s%s%s", cache->response,
+								challenge ? "\\challenge\\" : "", challenge ? challenge : "",
+								cache->response + cache->tailOffset );
+			return;
+		}
+	}
+
+	if ( !cache->build( challenge, response, sizeof( response ) ) ) {
+		return;
+	}
+
+	NET_OutOfBandPrint( NS_SERVER, from, "%s", response );
+}
+
+/*
+================
+SV_UpdateQueryCache
+
+Called every server frame
+================
+*/
+static void SV_UpdateQueryCache( void ) {
+	int key;
+	int i;
+
+	key = SV_QueryClientsKey();
+	if ( key != sv_queryClientsKey ) {
+		sv_queryClientsKey = key;
+		SV_InvalidateQueryCache();
+	}
+
+	// keep the network thread's copy current
+	if ( !Sys_IsNetThreadRunning() ) {
+		return;
+	}
+
+	for ( i = 0 ; i < 2 ; i++ ) {
+		if ( !SV_QueryCacheIsCurrent( &sv_queryCaches[i] ) ) {
+			SV_BuildQueryCache( &sv_queryCaches[i] );
+		}
+	}
+}
+
+/*
+================
+SV_QueryStats_f
+================
+*/
+void SV_QueryStats_f( void ) {
+	const queryCache_t  *cache;
+	int i;
+
+	for ( i = 0 ; i < 2 ; i++ ) {
+		cache = &sv_queryCaches[i];
+		Com_Printf( "%-9s: %i cached, %i rebuilt, %i over sv_queryRate\n",
+					cache->query, cache->cached, cache->rebuilt, cache->limited );
+	}
+}
+
+/*
+================
+SVC_Status
+
+Responds with all the info that qplug or qspy can see about the server
+and all connected players.  Used for getting detailed information after
+the simple info query.
+================
+*/
+void SVC_Status( netadr_t from ) {
+#if defined RTCW_ET
+	//bani - bugtraq 12534
+	if ( !SV_VerifyChallenge( Cmd_Argv( 1 ) ) ) {
+		return;
+	}
+#endif // RTCW_XX
+
+	SV_AnswerQuery( QUERY_STATUS, from );
+}
+
+/*
+================
+SVC_Info
+
+Responds with a short info message that should be enough to determine
+if a user is interested in a server to do a full status
+================
+*/
+void SVC_Info( netadr_t from ) {
+#if defined RTCW_ET
+	//bani - bugtraq 12534
+	if ( !SV_VerifyChallenge( Cmd_Argv( 1 ) ) ) {
+		return;
+	}
+#endif // RTCW_XX
+
+	SV_AnswerQuery( QUERY_INFO, from );
 }
 
 #if defined RTCW_MP
@@ -1359,6 +1633,33 @@ qboolean SV_CheckPaused( void ) {
 	return qtrue;
 }
 
+/*
+==================
+SV_FrameMsec
+
+Returns the number of msec until the next server frame is due
+==================
+*/
+int SV_FrameMsec( void ) {
+	int frameMsec;
+
+	if ( !sv_fps || sv_fps->integer < 1 ) {
+		return 1;
+	}
+
+	frameMsec = 1000 / sv_fps->integer;
+
+	if ( !com_sv_running || !com_sv_running->integer ) {
+		return frameMsec;
+	}
+
+	if ( sv.timeResidual >= frameMsec ) {
+		return 1;
+	}
+
+	return frameMsec - sv.timeResidual;
+}
+
 /*
 ==================
 SV_Frame
@@ -1474,18 +1775,21 @@ void SV_Frame( int msec ) {
 #endif // RTCW_XX
 
 		cvar_modifiedFlags &= ~CVAR_SERVERINFO;
+		SV_InvalidateQueryCache();
 	}
 
 #if defined RTCW_ET
 	if ( cvar_modifiedFlags & CVAR_SERVERINFO_NOUPDATE ) {
 		SV_SetConfigstringNoUpdate( CS_SERVERINFO, Cvar_InfoString( CVAR_SERVERINFO | CVAR_SERVERINFO_NOUPDATE ) );
 		cvar_modifiedFlags &= ~CVAR_SERVERINFO_NOUPDATE;
+		SV_InvalidateQueryCache();
 	}
 #endif // RTCW_XX
 
 	if ( cvar_modifiedFlags & CVAR_SYSTEMINFO ) {
 		SV_SetConfigstring( CS_SYSTEMINFO, Cvar_InfoString_Big( CVAR_SYSTEMINFO ) );
 		cvar_modifiedFlags &= ~CVAR_SYSTEMINFO;
+		SV_InvalidateQueryCache();
 	}
 
 #if !defined RTCW_SP
@@ -1540,6 +1844,8 @@ void SV_Frame( int msec ) {
 	SV_MasterHeartbeat( HEARTBEAT_GAME );
 #endif // RTCW_XX
 
+	SV_UpdateQueryCache();
+
 #if defined RTCW_ET
 	if ( com_dedicated->integer ) {
 		frameEndTime = Sys_Milliseconds();
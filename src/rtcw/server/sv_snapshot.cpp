@@ -33,6 +33,146 @@ A normal server packet will look like:
 =============================================================================
 */
 
+/*
+=============================================================================
+
+Encoded entity delta cache
+
+Clients that are sent the same entity from the same state, like a new
+entity from its baseline, get the same bits. While the snapshots of a
+frame are transmitted, each delta is encoded once and copied into the
+messages of the other clients.
+
+=============================================================================
+*/
+
+#define MAX_ENTITY_DELTAS       2048
+#define MAX_ENTITY_DELTA_SIZE   1024        // a full delta and the MSG_WriteBits margin
+#define ENTITY_DELTA_DATA_SIZE  0x40000
+
+typedef struct entityDelta_s {
+	const entityState_t *from;
+	const entityState_t *to;
+	qboolean force;
+	msg_t msg;
+	struct entityDelta_s *next;
+} entityDelta_t;
+
+typedef struct {
+	qboolean active;
+	int numDeltas;
+	int dataSize;
+	int hits;
+	int misses;
+	entityDelta_t *entityDeltas[MAX_GENTITIES];
+	entityDelta_t deltas[MAX_ENTITY_DELTAS];
+	byte data[ENTITY_DELTA_DATA_SIZE];
+} entityDeltaCache_t;
+
+static entityDeltaCache_t sv_deltaCache;
+
+/*
+=============
+SV_BeginEntityDeltaCache
+
+The states a delta is made of must not change until SV_EndEntityDeltaCache
+=============
+*/
+static void SV_BeginEntityDeltaCache( void ) {
+	entityDeltaCache_t *cache = &sv_deltaCache;
+
+	memset( cache->entityDeltas, 0, sizeof( cache->entityDeltas ) );
+	cache->numDeltas = 0;
+	cache->dataSize = 0;
+	cache->hits = 0;
+	cache->misses = 0;
+	cache->active = qtrue;
+}
+
+/*
+=============
+SV_EndEntityDeltaCache
+=============
+*/
+static void SV_EndEntityDeltaCache( void ) {
+	entityDeltaCache_t *cache = &sv_deltaCache;
+
+	cache->active = qfalse;
+
+	if ( sv_snapshotSpeeds->integer && ( cache->hits || cache->misses ) ) {
+		Com_Printf( "entity deltas: %i hits, %i misses, %i bytes\n",
+					cache->hits, cache->misses, cache->dataSize );
+	}
+}
+
+/*
+=============
+SV_WriteDeltaEntity
+
+MSG_WriteDeltaEntity through the delta cache
+=============
+*/
+static void SV_WriteDeltaEntity( msg_t *msg, entityState_t *from, entityState_t *to, qboolean force ) {
+	entityDeltaCache_t *cache = &sv_deltaCache;
+	entityDelta_t *delta;
+
+	if ( !cache->active ) {
+		MSG_WriteDeltaEntity( msg, from, to, force );
+		return;
+	}
+
+	if ( !force && !memcmp( from, to, sizeof( *to ) ) ) {
+		return;     // nothing at all
+	}
+
+	for ( delta = cache->entityDeltas[to->number] ; delta ; delta = delta->next ) {
+		if ( delta->force != force ) {
+			continue;
+		}
+
+		if ( delta->from != from && memcmp( delta->from, from, sizeof( *from ) ) ) {
+			continue;
+		}
+
+		if ( delta->to != to && memcmp( delta->to, to, sizeof( *to ) ) ) {
+			continue;
+		}
+
+		cache->hits++;
+		MSG_AppendBits( msg, &delta->msg );
+		return;
+	}
+
+	cache->misses++;
+
+	if ( cache->numDeltas == MAX_ENTITY_DELTAS ||
+		 ENTITY_DELTA_DATA_SIZE - cache->dataSize < MAX_ENTITY_DELTA_SIZE ) {
+		MSG_WriteDeltaEntity( msg, from, to, force );
+		return;
+	}
+
+	delta = &cache->deltas[cache->numDeltas];
+
+	MSG_Init( &delta->msg, &cache->data[cache->dataSize], MAX_ENTITY_DELTA_SIZE );
+	MSG_WriteDeltaEntity( &delta->msg, from, to, force );
+
+	if ( delta->msg.overflowed ) {
+		MSG_WriteDeltaEntity( msg, from, to, force );
+		return;
+	}
+
+	cache->numDeltas++;
+	cache->dataSize += ( delta->msg.bit + 7 ) >> 3;
+
+	delta->from = from;
+	delta->to = to;
+	delta->force = force;
+	delta->next = cache->entityDeltas[to->number];
+	cache->entityDeltas[to->number] = delta;
+
+	MSG_AppendBits( msg, &delta->msg );
+}
+
 /*
 =============
 SV_EmitPacketEntities
@@ -76,7 +216,7 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 			// delta update from old position
 			// because the force parm is qfalse, this will not result
 			// in any bytes being emited if the entity has not changed at all
-			MSG_WriteDeltaEntity( msg, oldent, newent, qfalse );
+			SV_WriteDeltaEntity( msg, oldent, newent, qfalse );
 			oldindex++;
 			newindex++;
 			continue;
@@ -84,7 +224,7 @@ static void SV_EmitPacketEntities( clientSnapshot_t *from, clientSnapshot_t *to,
 
 		if ( newnum < oldnum ) {
 			// this is a new entity, send it from the baseline
-			MSG_WriteDeltaEntity( msg, &sv.svEntities[newnum].baseline, newent, qtrue );
+			SV_WriteDeltaEntity( msg, &sv.svEntities[newnum].baseline, newent, qtrue );
 			newindex++;
 			continue;
 		}
@@ -237,8 +377,31 @@ Build a client snapshot structure
 typedef struct {
 	int numSnapshotEntities;
 	int snapshotEntities[MAX_SNAPSHOT_ENTITIES];
+	byte addedEntities[MAX_GENTITIES / 8];      // used to prevent double adding from portal views
 } snapshotEntityNumbers_t;
 
+/*
+=======================
+SV_SnapshotHasEntity
+=======================
+*/
+static qboolean SV_SnapshotHasEntity( const snapshotEntityNumbers_t *eNums, const svEntity_t *svEnt ) {
+	const int num = (int)( svEnt - sv.svEntities );
+
+	return ( eNums->addedEntities[num >> 3] & ( 1 << ( num & 7 ) ) ) != 0;
+}
+
+/*
+=======================
+SV_SnapshotMarkEntity
+=======================
+*/
+static void SV_SnapshotMarkEntity( snapshotEntityNumbers_t *eNums, const svEntity_t *svEnt ) {
+	const int num = (int)( svEnt - sv.svEntities );
+
+	eNums->addedEntities[num >> 3] |= 1 << ( num & 7 );
+}
+
 /*
 =======================
 SV_QsortEntityNumbers
@@ -283,38 +446,211 @@ SV_AddEntToSnapshot
 ===============
 */
 
-#if !defined RTCW_ET
 static void SV_AddEntToSnapshot( svEntity_t *svEnt, sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
-#else
-static void SV_AddEntToSnapshot( sharedEntity_t* clientEnt, svEntity_t *svEnt, sharedEntity_t *gEnt, snapshotEntityNumbers_t *eNums ) {
-#endif // RTCW_XX
-
 	// if we have already added this entity to this snapshot, don't add again
-	if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+	if ( SV_SnapshotHasEntity( eNums, svEnt ) ) {
 		return;
 	}
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	SV_SnapshotMarkEntity( eNums, svEnt );
 
 	// if we are full, silently discard entities
 	if ( eNums->numSnapshotEntities == MAX_SNAPSHOT_ENTITIES ) {
 		return;
 	}
 
+	// game snapshot callbacks are run later, on the main thread, by SV_EndClientSnapshot
+
+	eNums->snapshotEntities[ eNums->numSnapshotEntities ] = gEnt->s.number;
+	eNums->numSnapshotEntities++;
+}
+
+/*
+=============================================================================
+
+Snapshot entity index
+
+Linked entities are bucketed by the PVS clusters they touch before the
+snapshots of a frame are built, so a visibility pass only has to look at
+the entities of the clusters its PVS can see.
+
+=============================================================================
+*/
+
+typedef struct {
+	int clusterEntities[MAX_GENTITIES * MAX_ENT_CLUSTERS];
+	int numAlwaysEntities;
+	int alwaysEntities[MAX_GENTITIES];                  // entities that can't be culled by cluster
+} snapshotEntityIndex_t;
+
+static snapshotEntityIndex_t sv_snapshotIndex;
+
+/*
+===============
+SV_InitSnapshotEntityIndex
+
+Called after a map is loaded
+===============
+*/
+void SV_InitSnapshotEntityIndex( void ) {
+	sv.numSnapshotClusters = CM_NumClusters();
+	sv.snapshotClusterFirst = static_cast<int*>( Hunk_Alloc( ( sv.numSnapshotClusters + 1 ) * sizeof( int ), h_high ) );
+	sv_snapshotIndex.numAlwaysEntities = 0;
+}
+
+/*
+===============
+SV_BuildSnapshotEntityIndex
+
+Also fixes entity numbers up front, so the visibility
+pass never has to write to the entities
+===============
+*/
+static void SV_BuildSnapshotEntityIndex( void ) {
+	snapshotEntityIndex_t *index = &sv_snapshotIndex;
+	int e, i;
+	int cluster;
+	int numClusters = sv.numSnapshotClusters;
+	int *clusterFirst = sv.snapshotClusterFirst;
+	sharedEntity_t *ent;
+	svEntity_t *svEnt;
+
+	index->numAlwaysEntities = 0;
+
+	if ( !clusterFirst ) {
+		return;
+	}
+
+	memset( clusterFirst, 0, ( numClusters + 1 ) * sizeof( int ) );
+
+	// count the entities of each cluster
+	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+		ent = SV_GentityNum( e );
+
+		if ( !ent->r.linked ) {
+			continue;
+		}
+
+		if ( ent->s.number != e ) {
+			Com_DPrintf( "FIXING ENT->S.NUMBER!!!\n" );
+			ent->s.number = e;
+		}
+
+		svEnt = &sv.svEntities[e];
+
 #if defined RTCW_ET
-	if ( gEnt->r.snapshotCallback ) {
-		if (!VM_Call(
-			gvm,
-			GAME_SNAPSHOT_CALLBACK,
-			rtcw::to_vm_arg(gEnt->s.number),
-			rtcw::to_vm_arg(clientEnt->s.number)))
-		{
-			return;
+		if ( ent->r.svFlags & ( SVF_BROADCAST | SVF_IGNOREBMODELEXTENTS ) || svEnt->lastCluster ) {
+#else
+		if ( ent->r.svFlags & SVF_BROADCAST || svEnt->lastCluster ) {
+#endif // RTCW_XX
+			index->alwaysEntities[index->numAlwaysEntities++] = e;
+			continue;
+		}
+
+		for ( i = 0 ; i < svEnt->numClusters ; i++ ) {
+			cluster = svEnt->clusternums[i];
+
+			if ( cluster >= 0 && cluster < numClusters ) {
+				clusterFirst[cluster + 1]++;
+			}
 		}
 	}
+
+	for ( i = 0 ; i < numClusters ; i++ ) {
+		clusterFirst[i + 1] += clusterFirst[i];
+	}
+
+	// fill the buckets, using the start of the next bucket as a cursor
+	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+		ent = SV_GentityNum( e );
+
+		if ( !ent->r.linked ) {
+			continue;
+		}
+
+		svEnt = &sv.svEntities[e];
+
+#if defined RTCW_ET
+		if ( ent->r.svFlags & ( SVF_BROADCAST | SVF_IGNOREBMODELEXTENTS ) || svEnt->lastCluster ) {
+#else
+		if ( ent->r.svFlags & SVF_BROADCAST || svEnt->lastCluster ) {
 #endif // RTCW_XX
+			continue;
+		}
 
-	eNums->snapshotEntities[ eNums->numSnapshotEntities ] = gEnt->s.number;
-	eNums->numSnapshotEntities++;
+		for ( i = 0 ; i < svEnt->numClusters ; i++ ) {
+			cluster = svEnt->clusternums[i];
+
+			if ( cluster >= 0 && cluster < numClusters ) {
+				index->clusterEntities[clusterFirst[cluster]++] = e;
+			}
+		}
+	}
+
+	// shift the cursors back to the bucket starts
+	for ( i = numClusters ; i > 0 ; i-- ) {
+		clusterFirst[i] = clusterFirst[i - 1];
+	}
+	clusterFirst[0] = 0;
+}
+
+/*
+===============
+SV_GatherSnapshotEntities
+
+Lists the entities that may be visible through the given PVS,
+in entity number order like a full scan would visit them.
+Entities touching no cluster of it can never pass the cluster
+check of SV_AddEntitiesVisibleFromPoint, so they are skipped.
+===============
+*/
+static int SV_GatherSnapshotEntities( const byte *pvs, int *entityNums ) {
+	const snapshotEntityIndex_t *index = &sv_snapshotIndex;
+	byte candidates[MAX_GENTITIES / 8];
+	int count;
+	int cluster;
+	int bits = 0;
+	int i, e;
+
+	memset( candidates, 0, sizeof( candidates ) );
+
+	for ( i = 0 ; i < index->numAlwaysEntities ; i++ ) {
+		e = index->alwaysEntities[i];
+		candidates[e >> 3] |= 1 << ( e & 7 );
+	}
+
+	for ( cluster = 0 ; cluster < sv.numSnapshotClusters ; cluster++ ) {
+		if ( !( cluster & 7 ) ) {
+			bits = pvs[cluster >> 3];
+
+			if ( !bits ) {
+				cluster += 7;
+				continue;
+			}
+		}
+
+		if ( !( bits & ( 1 << ( cluster & 7 ) ) ) ) {
+			continue;
+		}
+
+		for ( i = sv.snapshotClusterFirst[cluster] ; i < sv.snapshotClusterFirst[cluster + 1] ; i++ ) {
+			e = index->clusterEntities[i];
+			candidates[e >> 3] |= 1 << ( e & 7 );
+		}
+	}
+
+	count = 0;
+
+	for ( i = 0 ; i < ( sv.num_entities + 7 ) >> 3 ; i++ ) {
+		bits = candidates[i];
+
+		for ( e = i << 3 ; bits ; e++, bits >>= 1 ) {
+			if ( bits & 1 ) {
+				entityNums[count++] = e;
+			}
+		}
+	}
+
+	return count;
 }
 
 /*
@@ -344,6 +680,10 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 	int c_fullsend;
 	byte    *clientpvs;
 	byte    *bitvector;
+	int entityNums[MAX_GENTITIES];
+	int numEntityNums;
+	int n;
+	qboolean fullScan;
 
 	// during an error shutdown message we may need to transmit
 	// the shutdown message after the server has shutdown, so
@@ -371,7 +711,31 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 	}
 #endif // RTCW_XX
 
-	for ( e = 0 ; e < sv.num_entities ; e++ ) {
+	fullScan = (qboolean)( !sv.snapshotClusterFirst );
+
+#if !defined RTCW_ET
+	// a camera view and the local client's event hack below
+	// may add entities outside of the PVS
+	if ( ( playerEnt->s.eFlags & EF_VIEWING_CAMERA ) && !portal ) {
+		fullScan = qtrue;
+	}
+
+	if ( sv_gametype->integer == GT_SINGLE_PLAYER && localClient ) {
+		fullScan = qtrue;
+	}
+#endif // RTCW_XX
+
+	if ( fullScan ) {
+		numEntityNums = 0;
+		for ( e = 0 ; e < sv.num_entities ; e++ ) {
+			entityNums[numEntityNums++] = e;
+		}
+	} else {
+		numEntityNums = SV_GatherSnapshotEntities( clientpvs, entityNums );
+	}
+
+	for ( n = 0 ; n < numEntityNums ; n++ ) {
+		e = entityNums[n];
 		ent = SV_GentityNum( e );
 
 		// never send entities that aren't linked in
@@ -405,7 +769,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		svEnt = SV_SvEntityForGentity( ent );
 
 		// don't double add an entity through portals
-		if ( svEnt->snapshotCounter == sv.snapshotCounter ) {
+		if ( SV_SnapshotHasEntity( eNums, svEnt ) ) {
 			continue;
 		}
 
@@ -423,11 +787,9 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 
 		// broadcast entities are always sent
 		if ( ent->r.svFlags & SVF_BROADCAST ) {
-
-#if !defined RTCW_ET
 			SV_AddEntToSnapshot( svEnt, ent, eNums );
-#else
-			SV_AddEntToSnapshot( playerEnt, svEnt, ent, eNums );
+
+#if defined RTCW_ET
 			continue;
 		}
 
@@ -436,7 +798,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		// Gordon: just check origin for being in pvs, ignore bmodel extents
 		if ( ent->r.svFlags & SVF_IGNOREBMODELEXTENTS ) {
 			if ( bitvector[svEnt->originCluster >> 3] & ( 1 << ( svEnt->originCluster & 7 ) ) ) {
-				SV_AddEntToSnapshot( playerEnt, svEnt, ent, eNums );
+				SV_AddEntToSnapshot( svEnt, ent, eNums );
 			}
 #endif // RTCW_XX
 
@@ -521,7 +883,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 				svEntity_t *master = 0;
 				master = SV_SvEntityForGentity( ment );
 
-				if ( master->snapshotCounter == sv.snapshotCounter || !ment->r.linked ) {
+				if ( SV_SnapshotHasEntity( eNums, master ) || !ment->r.linked ) {
 
 #if !defined RTCW_ET
 					goto notVisible;
@@ -532,12 +894,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 
 				}
 
-#if !defined RTCW_ET
 				SV_AddEntToSnapshot( master, ment, eNums );
-#else
-				SV_AddEntToSnapshot( playerEnt, master, ment, eNums );
-#endif // RTCW_XX
-
 			}
 
 #if !defined RTCW_ET
@@ -582,18 +939,12 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 						continue;
 					}
 
-					if ( master->snapshotCounter == sv.snapshotCounter ) {
+					if ( SV_SnapshotHasEntity( eNums, master ) ) {
 						continue;
 					}
 
 					if ( ment->s.otherEntityNum == ent->s.number ) {
-
-#if !defined RTCW_ET
 						SV_AddEntToSnapshot( master, ment, eNums );
-#else
-						SV_AddEntToSnapshot( playerEnt, master, ment, eNums );
-#endif // RTCW_XX
-
 					}
 				}
 
@@ -607,12 +958,7 @@ static void SV_AddEntitiesVisibleFromPoint( vec3_t origin, clientSnapshot_t *fra
 		}
 
 		// add it
-
-#if !defined RTCW_ET
 		SV_AddEntToSnapshot( svEnt, ent, eNums );
-#else
-		SV_AddEntToSnapshot( playerEnt, svEnt, ent, eNums );
-#endif // RTCW_XX
 
 		// if its a portal entity, add everything visible from its camera position
 		if ( ent->r.svFlags & SVF_PORTAL ) {
@@ -652,32 +998,24 @@ notVisible:
 
 /*
 =============
-SV_BuildClientSnapshot
+SV_BeginClientSnapshot
 
-Decides which entities are going to be visible to the client, and
-copies off the playerstate and areabits.
-
-This properly handles multiple recursive portals, but the render
-currently doesn't.
+Copies off the playerstate and finds the client's viewpoint.
+Returns qfalse if no entities should be added to the snapshot.
 
 For viewing through other player's eyes, clent can be something other than client->gentity
 =============
 */
-static void SV_BuildClientSnapshot( client_t *client ) {
-	vec3_t org;
+static qboolean SV_BeginClientSnapshot( client_t *client, snapshotEntityNumbers_t *eNums, vec3_t org ) {
 //	clientSnapshot_t			*frame, *oldframe;
 	clientSnapshot_t            *frame;
-	snapshotEntityNumbers_t entityNumbers;
-	int i;
-	sharedEntity_t              *ent;
-	entityState_t               *state;
 	svEntity_t                  *svEnt;
 	sharedEntity_t              *clent;
 	int clientNum;
 	playerState_t               *ps;
 
-	// bump the counter used to prevent double adding
-	sv.snapshotCounter++;
+	// clear the marks used to prevent double adding
+	memset( eNums->addedEntities, 0, sizeof( eNums->addedEntities ) );
 
 	// this is the frame we are creating
 	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
@@ -705,7 +1043,7 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 #endif // RTCW_XX
 
 	// clear everything in this snapshot
-	entityNumbers.numSnapshotEntities = 0;
+	eNums->numSnapshotEntities = 0;
 	memset( frame->areabits, 0, sizeof( frame->areabits ) );
 
 #if !defined RTCW_SP
@@ -715,7 +1053,7 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 
 	clent = client->gentity;
 	if ( !clent || client->state == CS_ZOMBIE ) {
-		return;
+		return qfalse;
 	}
 
 	// grab the current playerState_t
@@ -730,7 +1068,7 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	}
 	svEnt = &sv.svEntities[ clientNum ];
 
-	svEnt->snapshotCounter = sv.snapshotCounter;
+	SV_SnapshotMarkEntity( eNums, svEnt );
 
 #if !defined RTCW_ET
 	// find the client's viewpoint
@@ -757,32 +1095,95 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	}
 //----(SA)	end
 
+	return qtrue;
+}
+
+/*
+=============
+SV_AddClientSnapshotEntities
+
+Decides which entities are going to be visible to the client.
+
+This properly handles multiple recursive portals, but the render
+currently doesn't.
+
+Only reads the world, so it may run for several clients at once.
+=============
+*/
+static void SV_AddClientSnapshotEntities( client_t *client, snapshotEntityNumbers_t *eNums, vec3_t org ) {
+	clientSnapshot_t *frame;
+
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
 	// add all the entities directly visible to the eye, which
 	// may include portal entities that merge other viewpoints
 
 #if !defined RTCW_ET
-	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers, qfalse, client->netchan.remoteAddress.type == NA_LOOPBACK );
+	SV_AddEntitiesVisibleFromPoint( org, frame, eNums, qfalse, client->netchan.remoteAddress.type == NA_LOOPBACK );
 #else
-	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers /*, qfalse, client->netchan.remoteAddress.type == NA_LOOPBACK*/ );
+	SV_AddEntitiesVisibleFromPoint( org, frame, eNums /*, qfalse, client->netchan.remoteAddress.type == NA_LOOPBACK*/ );
 #endif // RTCW_XX
 
 #if defined RTCW_SP
-//	SV_AddEntitiesVisibleFromPoint( org, frame, &entityNumbers, qfalse, oldframe, client->netchan.remoteAddress.type == NA_LOOPBACK );
+//	SV_AddEntitiesVisibleFromPoint( org, frame, eNums, qfalse, oldframe, client->netchan.remoteAddress.type == NA_LOOPBACK );
+#endif // RTCW_XX
+}
+
+/*
+=============
+SV_EndClientSnapshot
+
+Sorts the visible entities and copies their states out.
+=============
+*/
+static void SV_EndClientSnapshot( client_t *client, snapshotEntityNumbers_t *eNums ) {
+	clientSnapshot_t            *frame;
+	int i;
+	sharedEntity_t              *ent;
+	entityState_t               *state;
+
+	frame = &client->frames[ client->netchan.outgoingSequence & PACKET_MASK ];
+
+#if defined RTCW_ET
+	// let the game drop entities flagged for a snapshot callback
+	{
+		sharedEntity_t *clientEnt = SV_GentityNum( frame->ps.clientNum );
+		int count = 0;
+
+		for ( i = 0 ; i < eNums->numSnapshotEntities ; i++ ) {
+			ent = SV_GentityNum( eNums->snapshotEntities[i] );
+
+			if ( ent->r.snapshotCallback ) {
+				if (!VM_Call(
+					gvm,
+					GAME_SNAPSHOT_CALLBACK,
+					rtcw::to_vm_arg(ent->s.number),
+					rtcw::to_vm_arg(clientEnt->s.number)))
+				{
+					continue;
+				}
+			}
+
+			eNums->snapshotEntities[count++] = eNums->snapshotEntities[i];
+		}
+
+		eNums->numSnapshotEntities = count;
+	}
 #endif // RTCW_XX
 
 	// if there were portals visible, there may be out of order entities
 	// in the list which will need to be resorted for the delta compression
 	// to work correctly.  This also catches the error condition
 	// of an entity being included twice.
-	qsort( entityNumbers.snapshotEntities, entityNumbers.numSnapshotEntities,
-		   sizeof( entityNumbers.snapshotEntities[0] ), SV_QsortEntityNumbers );
+	qsort( eNums->snapshotEntities, eNums->numSnapshotEntities,
+		   sizeof( eNums->snapshotEntities[0] ), SV_QsortEntityNumbers );
 
 // { RTCW
 // The qsort implementation may compare for same values.
 // Check for duplicates after the sorting.
-	for (i = 1; i < entityNumbers.numSnapshotEntities; ++i)
+	for (i = 1; i < eNums->numSnapshotEntities; ++i)
 	{
-		if (entityNumbers.snapshotEntities[i] == entityNumbers.snapshotEntities[i - 1])
+		if (eNums->snapshotEntities[i] == eNums->snapshotEntities[i - 1])
 		{
 			Com_Error(ERR_DROP, "SV_QsortEntityStates: duplicated entity");
 		}
@@ -798,8 +1199,8 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	// copy the entity states out
 	frame->num_entities = 0;
 	frame->first_entity = svs.nextSnapshotEntities;
-	for ( i = 0 ; i < entityNumbers.numSnapshotEntities ; i++ ) {
-		ent = SV_GentityNum( entityNumbers.snapshotEntities[i] );
+	for ( i = 0 ; i < eNums->numSnapshotEntities ; i++ ) {
+		ent = SV_GentityNum( eNums->snapshotEntities[i] );
 		state = &svs.snapshotEntities[svs.nextSnapshotEntities % svs.numSnapshotEntities];
 		*state = ent->s;
 		svs.nextSnapshotEntities++;
@@ -811,6 +1212,118 @@ static void SV_BuildClientSnapshot( client_t *client ) {
 	}
 }
 
+/*
+=============
+SV_BuildClientSnapshot
+
+Decides which entities are going to be visible to the client, and
+copies off the playerstate and areabits.
+=============
+*/
+static void SV_BuildClientSnapshot( client_t *client ) {
+	snapshotEntityNumbers_t entityNumbers;
+	vec3_t org;
+
+	if ( !SV_BeginClientSnapshot( client, &entityNumbers, org ) ) {
+		return;
+	}
+
+	SV_BuildSnapshotEntityIndex();
+	SV_AddClientSnapshotEntities( client, &entityNumbers, org );
+	SV_EndClientSnapshot( client, &entityNumbers );
+}
+
+typedef struct {
+	client_t *client;
+	vec3_t org;
+	snapshotEntityNumbers_t entityNumbers;
+} snapshotJob_t;
+
+static snapshotJob_t sv_snapshotJobs[MAX_CLIENTS];
+
+/*
+=============
+SV_SnapshotJob
+=============
+*/
+static void SV_SnapshotJob( void *data, int index ) {
+	snapshotJob_t *job = &( (snapshotJob_t *)data )[index];
+
+	SV_AddClientSnapshotEntities( job->client, &job->entityNumbers, job->org );
+}
+
+/*
+=============
+SV_BuildClientSnapshots
+
+Builds the snapshots of several clients at once.
+The visibility pass of each client runs on the worker threads,
+everything that touches the game or the shared snapshot
+entity buffer stays on the main thread.
+=============
+*/
+static void SV_BuildClientSnapshots( client_t **clients, int numClients ) {
+	int i;
+	int numJobs;
+	qboolean parallel;
+	long long timeStart = 0, timeIndex = 0, timeVisible = 0, timeEnd;
+
+	numJobs = 0;
+	for ( i = 0 ; i < numClients ; i++ ) {
+		snapshotJob_t *job = &sv_snapshotJobs[numJobs];
+
+		job->client = clients[i];
+
+		if ( SV_BeginClientSnapshot( job->client, &job->entityNumbers, job->org ) ) {
+			numJobs++;
+		}
+	}
+
+	parallel = (qboolean)( numJobs > 1 && Sys_GetJobWorkerCount() > 0 );
+
+#if !defined RTCW_ET
+	// events of invisible entities are forced into the local client's snapshot
+	// by writing to the entity, see SV_AddEntitiesVisibleFromPoint
+	if ( sv_gametype->integer == GT_SINGLE_PLAYER ) {
+		parallel = qfalse;
+	}
+#endif // RTCW_XX
+
+	if ( sv_snapshotSpeeds->integer ) {
+		timeStart = Sys_Microseconds();
+	}
+
+	SV_BuildSnapshotEntityIndex();
+
+	if ( sv_snapshotSpeeds->integer ) {
+		timeIndex = Sys_Microseconds();
+	}
+
+	if ( parallel ) {
+		Sys_RunJobs( SV_SnapshotJob, sv_snapshotJobs, numJobs );
+	} else {
+		for ( i = 0 ; i < numJobs ; i++ ) {
+			SV_SnapshotJob( sv_snapshotJobs, i );
+		}
+	}
+
+	if ( sv_snapshotSpeeds->integer ) {
+		timeVisible = Sys_Microseconds();
+	}
+
+	for ( i = 0 ; i < numJobs ; i++ ) {
+		SV_EndClientSnapshot( sv_snapshotJobs[i].client, &sv_snapshotJobs[i].entityNumbers );
+	}
+
+	if ( sv_snapshotSpeeds->integer && numJobs > 0 ) {
+		timeEnd = Sys_Microseconds();
+
+		Com_Printf( "snapshots: %i clients, %i entities, index %i usec, visibility %i usec, build %i usec\n",
+					numJobs, sv.num_entities, (int)( timeIndex - timeStart ),
+					(int)( timeVisible - timeIndex ), (int)( timeEnd - timeVisible ) );
+	}
+}
+
 
 #if defined RTCW_SP
 /*
@@ -1002,34 +1515,18 @@ void SV_SendClientIdle( client_t *client ) {
 }
 #endif // RTCW_XX
 
-#if !defined RTCW_ET
 /*
 =======================
-SV_SendClientSnapshot
-
-Also called by SV_FinalMessage
+SV_PrepareClientSnapshot
 
+Returns qfalse if the client doesn't get a snapshot this time
 =======================
 */
-#else
-/*
-=======================
-SV_SendClientSnapshot
-
-Also called by SV_FinalCommand
-
-=======================
-*/
-#endif // RTCW_XX
-
-void SV_SendClientSnapshot( client_t *client ) {
-	byte msg_buf[MAX_MSGLEN];
-	msg_t msg;
-
+static qboolean SV_PrepareClientSnapshot( client_t *client ) {
 #if defined RTCW_SP
 	//RF, AI don't need snapshots built
 	if ( client->gentity && client->gentity->r.svFlags & SVF_CASTAI ) {
-		return;
+		return qfalse;
 	}
 #endif // RTCW_XX
 
@@ -1040,13 +1537,24 @@ void SV_SendClientSnapshot( client_t *client ) {
 		// (eg so they can pick up the disconnect reason)
 		if ( client->state != CS_ZOMBIE ) {
 			SV_SendClientIdle( client );
-			return;
+			return qfalse;
 		}
 	}
 #endif // RTCW_XX
 
-	// build the snapshot
-	SV_BuildClientSnapshot( client );
+	return qtrue;
+}
+
+/*
+=======================
+SV_TransmitClientSnapshot
+
+Writes the built snapshot to the client
+=======================
+*/
+static void SV_TransmitClientSnapshot( client_t *client ) {
+	byte msg_buf[MAX_MSGLEN];
+	msg_t msg;
 
 	// bots need to have their snapshots build, but
 	// the query them directly without needing to be sent
@@ -1093,6 +1601,38 @@ void SV_SendClientSnapshot( client_t *client ) {
 }
 
 
+#if !defined RTCW_ET
+/*
+=======================
+SV_SendClientSnapshot
+
+Also called by SV_FinalMessage
+
+=======================
+*/
+#else
+/*
+=======================
+SV_SendClientSnapshot
+
+Also called by SV_FinalCommand
+
+=======================
+*/
+#endif // RTCW_XX
+
+void SV_SendClientSnapshot( client_t *client ) {
+	if ( !SV_PrepareClientSnapshot( client ) ) {
+		return;
+	}
+
+	// build the snapshot
+	SV_BuildClientSnapshot( client );
+
+	SV_TransmitClientSnapshot( client );
+}
+
+
 /*
 =======================
 SV_SendClientMessages
@@ -1102,6 +1642,8 @@ SV_SendClientMessages
 void SV_SendClientMessages( void ) {
 	int i;
 	client_t    *c;
+	client_t    *snapshotClients[MAX_CLIENTS];
+	int numSnapshotClients = 0;
 
 #if !defined RTCW_SP
 	int numclients = 0;         // NERVE - SMF - net debugging
@@ -1115,6 +1657,9 @@ void SV_SendClientMessages( void ) {
 	SV_UpdateConfigStrings();
 #endif // RTCW_XX
 
+	// queue this frame's snapshots and hand them to the network layer in bulk
+	Sys_BeginPacketBatch();
+
 	// send a message to each connected client
 
 #if !defined RTCW_ET
@@ -1169,9 +1714,26 @@ void SV_SendClientMessages( void ) {
 		}
 
 		// generate and send a new message
-		SV_SendClientSnapshot( c );
+		if ( SV_PrepareClientSnapshot( c ) ) {
+			snapshotClients[numSnapshotClients++] = c;
+		}
+	}
+
+	// build all snapshots of this frame, then send them
+	SV_BuildClientSnapshots( snapshotClients, numSnapshotClients );
+
+	if ( numSnapshotClients > 1 ) {
+		SV_BeginEntityDeltaCache();
+	}
+
+	for ( i = 0 ; i < numSnapshotClients ; i++ ) {
+		SV_TransmitClientSnapshot( snapshotClients[i] );
 	}
 
+	SV_EndEntityDeltaCache();
+
+	Sys_EndPacketBatch();
+
 #if !defined RTCW_SP
 	// NERVE - SMF - net debugging
 	if ( sv_showAverageBPS->integer && numclients > 0 ) {
@@ -60,6 +60,137 @@ typedef struct worldSector_s {
 worldSector_t sv_worldSectors[AREA_NODES];
 int sv_numworldSectors;
 
+/*
+===============================================================================
+
+AREA GRID
+
+With sv_areaGrid set, entities are kept in a grid instead of the sector tree.
+Each level of the grid splits the world into square columns twice as wide
+as the level below it. An entity is linked into the column that holds its
+center, on the lowest level with columns at least as wide as the entity,
+so it never sticks out of its column by more than half a column width.
+A query looks at the columns of each level within that distance of its bounds.
+
+===============================================================================
+*/
+
+#define AREA_GRID_LEVELS    8
+#define AREA_GRID_COLUMNS   64      // along each axis of the lowest level
+#define AREA_GRID_MIN_SIZE  128     // smallest column width
+#define AREA_GRID_CELLS     ( AREA_GRID_COLUMNS * AREA_GRID_COLUMNS * 4 / 3 + AREA_GRID_LEVELS )
+
+typedef struct {
+	float size;             // column width
+	int width, height;      // columns along x and y
+	worldSector_t   *cells;
+} areaGridLevel_t;
+
+typedef struct {
+	qboolean active;
+	vec3_t mins;
+	int numLevels;
+	areaGridLevel_t levels[AREA_GRID_LEVELS];
+	int numCells;
+	worldSector_t cells[AREA_GRID_CELLS];
+} areaGrid_t;
+
+static areaGrid_t sv_worldGrid;
+
+/*
+===============
+SV_CreateAreaGrid
+
+Sizes the grid levels for the given world size
+===============
+*/
+static void SV_CreateAreaGrid( const vec3_t mins, const vec3_t maxs ) {
+	areaGridLevel_t *level;
+	float size, worldSize;
+
+	VectorCopy( mins, sv_worldGrid.mins );
+	sv_worldGrid.numLevels = 0;
+	sv_worldGrid.numCells = 0;
+
+	worldSize = maxs[0] - mins[0];
+	if ( maxs[1] - mins[1] > worldSize ) {
+		worldSize = maxs[1] - mins[1];
+	}
+
+	size = worldSize / AREA_GRID_COLUMNS;
+	if ( size < AREA_GRID_MIN_SIZE ) {
+		size = AREA_GRID_MIN_SIZE;
+	}
+
+	while ( sv_worldGrid.numLevels < AREA_GRID_LEVELS ) {
+		level = &sv_worldGrid.levels[sv_worldGrid.numLevels++];
+
+		level->size = size;
+		level->width = (int)Com_Clamp( 1, AREA_GRID_COLUMNS, c::ceil( ( maxs[0] - mins[0] ) / size ) );
+		level->height = (int)Com_Clamp( 1, AREA_GRID_COLUMNS, c::ceil( ( maxs[1] - mins[1] ) / size ) );
+
+		// the last level has a single column that takes anything
+		if ( sv_worldGrid.numLevels == AREA_GRID_LEVELS ) {
+			level->width = level->height = 1;
+		}
+
+		level->cells = &sv_worldGrid.cells[sv_worldGrid.numCells];
+		sv_worldGrid.numCells += level->width * level->height;
+
+		if ( level->width == 1 && level->height == 1 ) {
+			level->size = worldSize;
+			break;
+		}
+
+		size *= 2.0f;
+	}
+}
+
+/*
+===============
+SV_AreaGridColumn
+===============
+*/
+static int SV_AreaGridColumn( const areaGridLevel_t *level, int axis, float value ) {
+	int column;
+
+	column = (int)( ( value - sv_worldGrid.mins[axis] ) / level->size );
+
+	if ( column < 0 ) {
+		return 0;
+	}
+	if ( axis ) {
+		return column < level->height ? column : level->height - 1;
+	}
+	return column < level->width ? column : level->width - 1;
+}
+
+/*
+===============
+SV_AreaGridCellForBox
+===============
+*/
+static worldSector_t *SV_AreaGridCellForBox( const vec3_t absmin, const vec3_t absmax ) {
+	areaGridLevel_t *level;
+	float size;
+	int i;
+
+	size = absmax[0] - absmin[0];
+	if ( absmax[1] - absmin[1] > size ) {
+		size = absmax[1] - absmin[1];
+	}
+
+	level = sv_worldGrid.levels;
+	for ( i = 0 ; i < sv_worldGrid.numLevels - 1 ; i++, level++ ) {
+		if ( size <= level->size ) {
+			break;
+		}
+	}
+
+	return &level->cells[
+		SV_AreaGridColumn( level, 1, 0.5f * ( absmin[1] + absmax[1] ) ) * level->width +
+		SV_AreaGridColumn( level, 0, 0.5f * ( absmin[0] + absmax[0] ) )];
+}
 
 /*
 ===============
@@ -67,9 +198,29 @@ SV_SectorList_f
 ===============
 */
 void SV_SectorList_f( void ) {
-	int i, c;
+	int i, j, c, total, fullest;
 	worldSector_t   *sec;
 	svEntity_t      *ent;
+	areaGridLevel_t *level;
+
+	if ( sv_worldGrid.active ) {
+		for ( i = 0, level = sv_worldGrid.levels ; i < sv_worldGrid.numLevels ; i++, level++ ) {
+			total = fullest = 0;
+			for ( j = 0 ; j < level->width * level->height ; j++ ) {
+				c = 0;
+				for ( ent = level->cells[j].entities ; ent ; ent = ent->nextEntityInWorldSector ) {
+					c++;
+				}
+				total += c;
+				if ( c > fullest ) {
+					fullest = c;
+				}
+			}
+			Com_Printf( "level %i: %ix%i columns of %i units, %i entities, %i in the fullest column\n",
+						i, level->width, level->height, (int)level->size, total, fullest );
+		}
+		return;
+	}
 
 	for ( i = 0 ; i < AREA_NODES ; i++ ) {
 		sec = &sv_worldSectors[i];
@@ -137,10 +288,20 @@ void SV_ClearWorld( void ) {
 	memset( sv_worldSectors, 0, sizeof( sv_worldSectors ) );
 	sv_numworldSectors = 0;
 
+	memset( &sv_worldGrid, 0, sizeof( sv_worldGrid ) );
+
 	// get world map bounds
 	h = CM_InlineModel( 0 );
 	CM_ModelBounds( h, mins, maxs );
 	SV_CreateworldSector( 0, mins, maxs );
+
+	// grab a latched sv_areaGrid
+	sv_areaGrid = Cvar_Get( "sv_areaGrid", "0", CVAR_LATCH );
+
+	if ( sv_areaGrid->integer ) {
+		sv_worldGrid.active = qtrue;
+		SV_CreateAreaGrid( mins, maxs );
+	}
 }
 
 
@@ -211,10 +372,6 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 		Com_DPrintf( "WARNING: BBOX entity is being linked at world origin, this is probably a bug\n" );
 	}
 
-	if ( ent->worldSector ) {
-		SV_UnlinkEntity( gEnt );    // unlink from old position
-	}
-
 	// encode the size into the entityState_t for client prediction
 	if ( gEnt->r.bmodel ) {
 		gEnt->s.solid = SOLID_BMODEL;       // a solid_box will never create this value
@@ -300,6 +457,9 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 	// if none of the leafs were inside the map, the
 	// entity is outside the world and can be considered unlinked
 	if ( !num_leafs ) {
+		if ( ent->worldSector ) {
+			SV_UnlinkEntity( gEnt );    // unlink from old position
+		}
 		return;
 	}
 
@@ -341,26 +501,37 @@ void SV_LinkEntity( sharedEntity_t *gEnt ) {
 
 	gEnt->r.linkcount++;
 
-	// find the first world sector node that the ent's box crosses
-	node = sv_worldSectors;
-	while ( 1 )
-	{
-		if ( node->axis == -1 ) {
-			break;
-		}
-		if ( gEnt->r.absmin[node->axis] > node->dist ) {
-			node = node->children[0];
-		} else if ( gEnt->r.absmax[node->axis] < node->dist ) {
-			node = node->children[1];
-		} else {
-			break;      // crosses the node
+	if ( sv_worldGrid.active ) {
+		node = SV_AreaGridCellForBox( gEnt->r.absmin, gEnt->r.absmax );
+	} else {
+		// find the first world sector node that the ent's box crosses
+		node = sv_worldSectors;
+		while ( 1 )
+		{
+			if ( node->axis == -1 ) {
+				break;
+			}
+			if ( gEnt->r.absmin[node->axis] > node->dist ) {
+				node = node->children[0];
+			} else if ( gEnt->r.absmax[node->axis] < node->dist ) {
+				node = node->children[1];
+			} else {
+				break;      // crosses the node
+			}
 		}
 	}
 
-	// link it in
-	ent->worldSector = node;
-	ent->nextEntityInWorldSector = node->entities;
-	node->entities = ent;
+	// an entity that stays in its sector doesn't need to be relinked
+	if ( ent->worldSector != node ) {
+		if ( ent->worldSector ) {
+			SV_UnlinkEntity( gEnt );    // unlink from old position
+		}
+
+		// link it in
+		ent->worldSector = node;
+		ent->nextEntityInWorldSector = node->entities;
+		node->entities = ent;
+	}
 
 	gEnt->r.linked = qtrue;
 }
@@ -385,16 +556,13 @@ typedef struct {
 
 /*
 ====================
-SV_AreaEntities_r
+SV_AreaSectorEntities
 
 ====================
 */
-void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
+static void SV_AreaSectorEntities( worldSector_t *node, areaParms_t *ap ) {
 	svEntity_t  *check, *next;
 	sharedEntity_t *gcheck;
-	int count;
-
-	count = 0;
 
 	for ( check = node->entities  ; check ; check = next ) {
 		next = check->nextEntityInWorldSector;
@@ -430,6 +598,16 @@ void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
 		ap->list[ap->count] = check - sv.svEntities;
 		ap->count++;
 	}
+}
+
+/*
+====================
+SV_AreaEntities_r
+
+====================
+*/
+void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
+	SV_AreaSectorEntities( node, ap );
 
 	if ( node->axis == -1 ) {
 		return;     // terminal node
@@ -444,6 +622,32 @@ void SV_AreaEntities_r( worldSector_t *node, areaParms_t *ap ) {
 	}
 }
 
+/*
+====================
+SV_AreaGridEntities
+
+====================
+*/
+static void SV_AreaGridEntities( areaParms_t *ap ) {
+	areaGridLevel_t *level;
+	int i, x, y;
+	int x0, x1, y0, y1;
+
+	for ( i = 0, level = sv_worldGrid.levels ; i < sv_worldGrid.numLevels ; i++, level++ ) {
+		// entities stick out of their columns by up to half a column
+		x0 = SV_AreaGridColumn( level, 0, ap->mins[0] - level->size );
+		x1 = SV_AreaGridColumn( level, 0, ap->maxs[0] + level->size );
+		y0 = SV_AreaGridColumn( level, 1, ap->mins[1] - level->size );
+		y1 = SV_AreaGridColumn( level, 1, ap->maxs[1] + level->size );
+
+		for ( y = y0 ; y <= y1 ; y++ ) {
+			for ( x = x0 ; x <= x1 ; x++ ) {
+				SV_AreaSectorEntities( &level->cells[y * level->width + x], ap );
+			}
+		}
+	}
+}
+
 /*
 ================
 SV_AreaEntities
@@ -458,11 +662,76 @@ int SV_AreaEntities( const vec3_t mins, const vec3_t maxs, int *entityList, int
 	ap.count = 0;
 	ap.maxcount = maxcount;
 
-	SV_AreaEntities_r( sv_worldSectors, &ap );
+	if ( sv_worldGrid.active ) {
+		SV_AreaGridEntities( &ap );
+	} else {
+		SV_AreaEntities_r( sv_worldSectors, &ap );
+	}
 
 	return ap.count;
 }
 
+/*
+================
+SV_AreaBench_f
+
+Times SV_AreaEntities for the bounds of every linked entity,
+expanded by 64 units like a touch or splash query
+================
+*/
+void SV_AreaBench_f( void ) {
+	int touchlist[MAX_GENTITIES];
+	sharedEntity_t *gEnt;
+	vec3_t mins, maxs;
+	int i, pass, passes;
+	int queries, found;
+	long long start, usec;
+
+	// make sure server is running
+	if ( !com_sv_running->integer ) {
+		Com_Printf( "Server is not running.\n" );
+		return;
+	}
+
+	passes = Cmd_Argc() > 1 ? atoi( Cmd_Argv( 1 ) ) : 100;
+	if ( passes < 1 ) {
+		passes = 1;
+	}
+
+	queries = found = 0;
+
+	start = Sys_Microseconds();
+
+	for ( pass = 0 ; pass < passes ; pass++ ) {
+		for ( i = 0 ; i < sv.num_entities ; i++ ) {
+			gEnt = SV_GentityNum( i );
+			if ( !gEnt->r.linked ) {
+				continue;
+			}
+
+			VectorSet( mins, -64, -64, -64 );
+			VectorSet( maxs, 64, 64, 64 );
+			VectorAdd( gEnt->r.absmin, mins, mins );
+			VectorAdd( gEnt->r.absmax, maxs, maxs );
+
+			found += SV_AreaEntities( mins, maxs, touchlist, MAX_GENTITIES );
+			queries++;
+		}
+	}
+
+	usec = Sys_Microseconds() - start;
+
+	if ( !queries ) {
+		Com_Printf( "No linked entities.\n" );
+		return;
+	}
+
+	Com_Printf( "%s: %i queries, %.1f entities per query, %.3f usec per query, %.0f queries per second\n",
+				sv_worldGrid.active ? "area grid" : "sector tree",
+				queries, (float)found / queries, (float)usec / queries,
+				usec ? queries * 1000000.0 / usec : 0.0 );
+}
+
 
 
 //===========================================================================
@@ -530,21 +799,19 @@ void SV_ClipToEntity( trace_t *trace, const vec3_t start, const vec3_t mins, con
 
 /*
 ====================
-SV_ClipMoveToEntities
+SV_ClipMoveToEntityList
 
+Clips the move against the listed entities that touch its bounding box.
 ====================
 */
-void SV_ClipMoveToEntities( moveclip_t *clip ) {
-	int i, num;
-	int touchlist[MAX_GENTITIES];
+static void SV_ClipMoveToEntityList( moveclip_t *clip, const int *touchlist, int num ) {
+	int i;
 	sharedEntity_t *touch;
 	int passOwnerNum;
 	trace_t trace;
 	clipHandle_t clipHandle;
 	float       *origin, *angles;
 
-	num = SV_AreaEntities( clip->boxmins, clip->boxmaxs, touchlist, MAX_GENTITIES );
-
 	if ( clip->passEntityNum != ENTITYNUM_NONE ) {
 		passOwnerNum = ( SV_GentityNum( clip->passEntityNum ) )->r.ownerNum;
 		if ( passOwnerNum == ENTITYNUM_NONE ) {
@@ -560,6 +827,16 @@ void SV_ClipMoveToEntities( moveclip_t *clip ) {
 		}
 		touch = SV_GentityNum( touchlist[i] );
 
+		// the list may come from the bounds of several moves
+		if ( touch->r.absmin[0] > clip->boxmaxs[0]
+			 || touch->r.absmin[1] > clip->boxmaxs[1]
+			 || touch->r.absmin[2] > clip->boxmaxs[2]
+			 || touch->r.absmax[0] < clip->boxmins[0]
+			 || touch->r.absmax[1] < clip->boxmins[1]
+			 || touch->r.absmax[2] < clip->boxmins[2] ) {
+			continue;
+		}
+
 		// see if we should ignore this entity
 		if ( clip->passEntityNum != ENTITYNUM_NONE ) {
 			if ( touchlist[i] == clip->passEntityNum ) {
@@ -645,6 +922,43 @@ void SV_ClipMoveToEntities( moveclip_t *clip ) {
 }
 
 
+/*
+====================
+SV_ClipMoveToEntities
+
+====================
+*/
+void SV_ClipMoveToEntities( moveclip_t *clip ) {
+	int num;
+	int touchlist[MAX_GENTITIES];
+
+	num = SV_AreaEntities( clip->boxmins, clip->boxmaxs, touchlist, MAX_GENTITIES );
+
+	SV_ClipMoveToEntityList( clip, touchlist, num );
+}
+
+/*
+====================
+SV_SetMoveClipBounds
+
+Creates the bounding box of the entire move.
+====================
+*/
+static void SV_SetMoveClipBounds( moveclip_t *clip ) {
+	int i;
+
+	for ( i = 0 ; i < 3 ; i++ ) {
+		if ( clip->end[i] > clip->start[i] ) {
+			clip->boxmins[i] = clip->start[i] + clip->mins[i] - 1;
+			clip->boxmaxs[i] = clip->end[i] + clip->maxs[i] + 1;
+		} else {
+			clip->boxmins[i] = clip->end[i] + clip->mins[i] - 1;
+			clip->boxmaxs[i] = clip->start[i] + clip->maxs[i] + 1;
+		}
+	}
+}
+
+
 /*
 ==================
 SV_Trace
@@ -655,7 +969,6 @@ passEntityNum and entities owned by passEntityNum are explicitly not checked.
 */
 void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const vec3_t maxs, const vec3_t end, int passEntityNum, int contentmask, int capsule ) {
 	moveclip_t clip;
-	int i;
 
 	if ( !mins ) {
 		mins = vec3_origin;
@@ -693,15 +1006,7 @@ void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const ve
 	// we can limit it to the part of the move not
 	// already clipped off by the world, which can be
 	// a significant savings for line of sight and shot traces
-	for ( i = 0 ; i < 3 ; i++ ) {
-		if ( end[i] > start[i] ) {
-			clip.boxmins[i] = clip.start[i] + clip.mins[i] - 1;
-			clip.boxmaxs[i] = clip.end[i] + clip.maxs[i] + 1;
-		} else {
-			clip.boxmins[i] = clip.end[i] + clip.mins[i] - 1;
-			clip.boxmaxs[i] = clip.start[i] + clip.maxs[i] + 1;
-		}
-	}
+	SV_SetMoveClipBounds( &clip );
 
 	// clip to other solid entities
 	SV_ClipMoveToEntities( &clip );
@@ -709,6 +1014,106 @@ void SV_Trace( trace_t *results, const vec3_t start, const vec3_t mins, const ve
 	*results = clip.trace;
 }
 
+/*
+==================
+SV_TraceBatch
+
+Moves the given mins/maxs volume through the world along each of the rays.
+The world is traced with a shared setup, and the entities that may block
+any of the moves are gathered once for the whole batch.
+The results match SV_Trace for each ray.
+==================
+*/
+void SV_TraceBatch( trace_t *results, const traceRay_t *rays, int numRays, const vec3_t mins, const vec3_t maxs, int passEntityNum, int contentmask, int capsule ) {
+	moveclip_t clip;
+	vec3_t boxmins, boxmaxs;
+	int touchlist[MAX_GENTITIES];
+	int num;
+	int i, j;
+	qboolean clipEntities;
+
+	if ( numRays <= 0 ) {
+		return;
+	}
+
+	if ( !mins ) {
+		mins = vec3_origin;
+	}
+	if ( !maxs ) {
+		maxs = vec3_origin;
+	}
+
+	// clip to world
+	CM_TraceBatch( results, rays, numRays, mins, maxs, 0, contentmask, capsule );
+
+	memset( &clip, 0, sizeof( moveclip_t ) );
+
+	clip.contentmask = contentmask;
+	clip.mins = mins;
+	clip.maxs = maxs;
+	clip.passEntityNum = passEntityNum;
+	clip.capsule = capsule;
+
+	// create the bounding box of all the moves not blocked by the world
+	ClearBounds( boxmins, boxmaxs );
+	clipEntities = qfalse;
+
+	for ( i = 0 ; i < numRays ; i++ ) {
+		results[i].entityNum = results[i].fraction != 1.0 ? ENTITYNUM_WORLD : ENTITYNUM_NONE;
+
+#if !defined RTCW_ET
+		if ( results[i].fraction == 0 ) {
+#else
+		if ( results[i].fraction == 0 || passEntityNum == -2 ) {
+#endif // RTCW_XX
+
+			continue;   // blocked immediately by the world
+		}
+
+		clip.start = rays[i].start;
+		VectorCopy( rays[i].end, clip.end );
+		SV_SetMoveClipBounds( &clip );
+
+		for ( j = 0 ; j < 3 ; j++ ) {
+			if ( clip.boxmins[j] < boxmins[j] ) {
+				boxmins[j] = clip.boxmins[j];
+			}
+			if ( clip.boxmaxs[j] > boxmaxs[j] ) {
+				boxmaxs[j] = clip.boxmaxs[j];
+			}
+		}
+
+		clipEntities = qtrue;
+	}
+
+	if ( !clipEntities ) {
+		return;
+	}
+
+	num = SV_AreaEntities( boxmins, boxmaxs, touchlist, MAX_GENTITIES );
+
+	// clip to other solid entities
+	for ( i = 0 ; i < numRays ; i++ ) {
+#if !defined RTCW_ET
+		if ( results[i].fraction == 0 ) {
+#else
+		if ( results[i].fraction == 0 || passEntityNum == -2 ) {
+#endif // RTCW_XX
+
+			continue;
+		}
+
+		clip.trace = results[i];
+		clip.start = rays[i].start;
+		VectorCopy( rays[i].end, clip.end );
+		SV_SetMoveClipBounds( &clip );
+
+		SV_ClipMoveToEntityList( &clip, touchlist, num );
+
+		results[i] = clip.trace;
+	}
+}
+
 
 
 /*
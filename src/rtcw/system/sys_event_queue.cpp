@@ -0,0 +1,287 @@
+/*
+RTCW: Unofficial source port of Return to Castle Wolfenstein and Wolfenstein: Enemy Territory
+Copyright (c) 2012-2025 Boris I. Bendovsky bibendovsky@hotmail.com and Contributors
+SPDX-License-Identifier: GPL-3.0
+*/
+
+// System event queue.
+//
+// Any thread may post events; only the main thread takes them.
+// Event payloads come from a pool of fixed-size blocks, so posting never touches the zone.
+
+
+#include "SDL.h"
+#include "q_shared.h"
+#include "qcommon.h"
+#include "sys_local.h"
+#include "rtcw_memory.h"
+
+
+extern int Sys_Milliseconds();
+
+
+namespace {
+
+
+// Bounded multi-producer single-consumer queue.
+// Every slot carries a sequence number: a producer may fill the slot when it equals the
+// enqueue position, the consumer may take it when it equals the position plus one.
+
+const int MAX_QUED_EVENTS = 256;
+const int MASK_QUED_EVENTS = MAX_QUED_EVENTS - 1;
+
+struct SysEventSlot
+{
+	SDL_atomic_t sequence;
+	sysEvent_t event;
+};
+
+SysEventSlot event_slots[MAX_QUED_EVENTS];
+SDL_atomic_t event_enqueue_pos;
+int event_dequeue_pos;
+SDL_atomic_t event_dropped;
+
+
+// Payload pool.
+// Free blocks form a stack; the head packs the block index with a tag that changes on
+// every pop, so a stale compare-and-swap can't succeed.
+
+const int EVENT_DATA_BLOCK_SIZE = 2048; // a netadr_t and a full sized packet, or a console line
+const int EVENT_DATA_BLOCKS = 512;
+const int EVENT_DATA_HEAP = -1;
+
+const int EVENT_DATA_INDEX_BITS = 16;
+const int EVENT_DATA_INDEX_MASK = (1 << EVENT_DATA_INDEX_BITS) - 1;
+const int EVENT_DATA_NONE = EVENT_DATA_INDEX_MASK;
+
+struct SysEventDataHeader
+{
+	int index;
+	int padding[3];
+};
+
+struct SysEventDataBlock
+{
+	SysEventDataHeader header;
+	byte data[EVENT_DATA_BLOCK_SIZE];
+};
+
+SysEventDataBlock event_data_blocks[EVENT_DATA_BLOCKS];
+SDL_atomic_t event_data_next[EVENT_DATA_BLOCKS];
+SDL_atomic_t event_data_head;
+
+
+int sys_difference(
+	int a,
+	int b)
+{
+	return static_cast<int>(static_cast<unsigned int>(a) - static_cast<unsigned int>(b));
+}
+
+SysEventDataHeader* sys_pop_event_data()
+{
+	while (true)
+	{
+		const int head = SDL_AtomicGet(&event_data_head);
+		const int index = head & EVENT_DATA_INDEX_MASK;
+
+		if (index == EVENT_DATA_NONE)
+		{
+			return NULL;
+		}
+
+		const int tag = static_cast<int>(static_cast<unsigned int>(head) >> EVENT_DATA_INDEX_BITS) + 1;
+		const int next = SDL_AtomicGet(&event_data_next[index]);
+		const int new_head = static_cast<int>((static_cast<unsigned int>(tag) << EVENT_DATA_INDEX_BITS) | next);
+
+		if (SDL_AtomicCAS(&event_data_head, head, new_head))
+		{
+			return &event_data_blocks[index].header;
+		}
+	}
+}
+
+void sys_push_event_data(
+	int index)
+{
+	while (true)
+	{
+		const int head = SDL_AtomicGet(&event_data_head);
+
+		SDL_AtomicSet(&event_data_next[index], head & EVENT_DATA_INDEX_MASK);
+
+		const int new_head = (head & ~EVENT_DATA_INDEX_MASK) | index;
+
+		if (SDL_AtomicCAS(&event_data_head, head, new_head))
+		{
+			return;
+		}
+	}
+}
+
+
+} // namespace
+
+
+// Sets up the queue and the payload pool.
+// Main thread only, before any thread that posts events is started.
+void Sys_InitEventQueue()
+{
+	for (int i = 0; i < MAX_QUED_EVENTS; ++i)
+	{
+		SDL_AtomicSet(&event_slots[i].sequence, i);
+	}
+
+	SDL_AtomicSet(&event_enqueue_pos, 0);
+	event_dequeue_pos = 0;
+
+	for (int i = 0; i < EVENT_DATA_BLOCKS; ++i)
+	{
+		event_data_blocks[i].header.index = i;
+		SDL_AtomicSet(&event_data_next[i], i + 1 < EVENT_DATA_BLOCKS ? i + 1 : EVENT_DATA_NONE);
+	}
+
+	SDL_AtomicSet(&event_data_head, 0);
+}
+
+// Allocates an event payload.
+// Safe on any thread. Payloads that don't fit a pool block, or arrive when the pool is empty,
+// come from the heap.
+void* Sys_AllocEventData(
+	int size)
+{
+	SysEventDataHeader* header = NULL;
+
+	if (size <= EVENT_DATA_BLOCK_SIZE)
+	{
+		header = sys_pop_event_data();
+	}
+
+	if (!header)
+	{
+		header = static_cast<SysEventDataHeader*>(rtcw::mem::allocate(static_cast<int>(sizeof(SysEventDataHeader)) + size));
+
+		if (!header)
+		{
+			return NULL;
+		}
+
+		header->index = EVENT_DATA_HEAP;
+	}
+
+	return header + 1;
+}
+
+// Releases a payload from Sys_AllocEventData. Safe on any thread.
+void Sys_FreeEventData(
+	void* ptr)
+{
+	if (!ptr)
+	{
+		return;
+	}
+
+	SysEventDataHeader* const header = static_cast<SysEventDataHeader*>(ptr) - 1;
+
+	if (header->index == EVENT_DATA_HEAP)
+	{
+		rtcw::mem::deallocate(header);
+		return;
+	}
+
+	if (header->index < 0 || header->index >= EVENT_DATA_BLOCKS)
+	{
+		Com_Error(ERR_FATAL, "Sys_FreeEventData: bad pointer");
+	}
+
+	sys_push_event_data(header->index);
+}
+
+//
+// A time of 0 will get the current time
+// Ptr should either be null, or come from Sys_AllocEventData.
+// Safe on any thread. When the queue is full the new event is dropped.
+//
+void Sys_QueEvent(
+	int time,
+	sysEventType_t type,
+	int value,
+	int value2,
+	int ptrLength,
+	void* ptr)
+{
+	if (time == 0)
+	{
+		time = Sys_Milliseconds();
+	}
+
+	SysEventSlot* slot;
+	int pos = SDL_AtomicGet(&event_enqueue_pos);
+
+	while (true)
+	{
+		slot = &event_slots[pos & MASK_QUED_EVENTS];
+
+		const int difference = sys_difference(SDL_AtomicGet(&slot->sequence), pos);
+
+		if (difference == 0)
+		{
+			if (SDL_AtomicCAS(&event_enqueue_pos, pos, pos + 1))
+			{
+				break;
+			}
+		}
+		else if (difference < 0)
+		{
+			// full; we are discarding an event, but don't leak memory
+			Sys_FreeEventData(ptr);
+			SDL_AtomicIncRef(&event_dropped);
+
+			return;
+		}
+
+		pos = SDL_AtomicGet(&event_enqueue_pos);
+	}
+
+	sysEvent_t& ev = slot->event;
+	ev.evTime = time;
+	ev.evType = type;
+	ev.evValue = value;
+	ev.evValue2 = value2;
+	ev.evPtrLength = ptrLength;
+	ev.evPtr = ptr;
+
+	SDL_AtomicSet(&slot->sequence, pos + 1);
+}
+
+// Takes the oldest event. Main thread only.
+bool Sys_GetQueuedEvent(
+	sysEvent_t* ev)
+{
+	const int dropped = SDL_AtomicSet(&event_dropped, 0);
+
+	if (dropped > 0)
+	{
+		Com_Printf("Sys_QueEvent: overflow, %i events dropped\n", dropped);
+	}
+
+	SysEventSlot& slot = event_slots[event_dequeue_pos & MASK_QUED_EVENTS];
+
+	if (SDL_AtomicGet(&slot.sequence) != event_dequeue_pos + 1)
+	{
+		return false;
+	}
+
+	*ev = slot.event;
+
+	SDL_AtomicSet(&slot.sequence, event_dequeue_pos + MAX_QUED_EVENTS);
+	event_dequeue_pos += 1;
+
+	return true;
+}
+
+// Free slots in the queue. Main thread only.
+int Sys_GetQueuedEventRoom()
+{
+	return MAX_QUED_EVENTS - sys_difference(SDL_AtomicGet(&event_enqueue_pos), event_dequeue_pos);
+}
@@ -0,0 +1,226 @@
+/*
+RTCW: Unofficial source port of Return to Castle Wolfenstein and Wolfenstein: Enemy Territory
+Copyright (c) 2012-2025 Boris I. Bendovsky bibendovsky@hotmail.com and Contributors
+SPDX-License-Identifier: GPL-3.0
+*/
+
+// Worker thread pool for data-parallel engine stages
+
+
+#include "SDL.h"
+#include "q_shared.h"
+#include "qcommon.h"
+
+
+namespace {
+
+
+const int MAX_JOB_WORKERS = 16;
+
+struct SysJobBatch
+{
+	sysJobFunc_t func;
+	void* data;
+	int count;
+	SDL_atomic_t next_index;
+};
+
+cvar_t* sys_jobWorkers;
+
+int job_worker_count;
+SDL_Thread* job_threads[MAX_JOB_WORKERS];
+SDL_sem* job_start_sem;
+SDL_sem* job_done_sem;
+SDL_atomic_t job_quit;
+
+SysJobBatch job_batch;
+bool job_batch_active = false;
+
+
+void sys_run_job_batch()
+{
+	while (true)
+	{
+		const int index = SDL_AtomicAdd(&job_batch.next_index, 1);
+
+		if (index >= job_batch.count)
+		{
+			break;
+		}
+
+		job_batch.func(job_batch.data, index);
+	}
+}
+
+int SDLCALL sys_job_worker(
+	void* data)
+{
+	static_cast<void>(data);
+
+	while (true)
+	{
+		SDL_SemWait(job_start_sem);
+
+		if (SDL_AtomicGet(&job_quit) != 0)
+		{
+			break;
+		}
+
+		sys_run_job_batch();
+
+		SDL_SemPost(job_done_sem);
+	}
+
+	return 0;
+}
+
+
+} // namespace
+
+
+// Starts the worker threads, or restarts them if "sys_jobWorkers" asks for another count.
+// "sys_jobWorkers" of -1 selects one worker per extra CPU core.
+void Sys_InitJobs()
+{
+	sys_jobWorkers = Cvar_Get("sys_jobWorkers", "-1", CVAR_ARCHIVE | CVAR_LATCH);
+
+	int worker_count = sys_jobWorkers->integer;
+
+	if (worker_count < 0)
+	{
+		worker_count = SDL_GetCPUCount() - 1;
+	}
+
+	if (worker_count > MAX_JOB_WORKERS)
+	{
+		worker_count = MAX_JOB_WORKERS;
+	}
+
+	if (worker_count < 0)
+	{
+		worker_count = 0;
+	}
+
+	if (worker_count == job_worker_count)
+	{
+		return;
+	}
+
+	Sys_ShutdownJobs();
+
+	if (worker_count == 0)
+	{
+		return;
+	}
+
+	job_start_sem = SDL_CreateSemaphore(0);
+	job_done_sem = SDL_CreateSemaphore(0);
+
+	if (!job_start_sem || !job_done_sem)
+	{
+		Com_Printf("WARNING: Sys_InitJobs: %s\n", SDL_GetError());
+		Sys_ShutdownJobs();
+
+		return;
+	}
+
+	SDL_AtomicSet(&job_quit, 0);
+
+	for (int i = 0; i < worker_count; ++i)
+	{
+		SDL_Thread* const thread = SDL_CreateThread(sys_job_worker, "rtcw_job", NULL);
+
+		if (!thread)
+		{
+			Com_Printf("WARNING: Sys_InitJobs: %s\n", SDL_GetError());
+			break;
+		}
+
+		job_threads[job_worker_count] = thread;
+		job_worker_count += 1;
+	}
+
+	Com_Printf("Job workers: %i\n", job_worker_count);
+}
+
+void Sys_ShutdownJobs()
+{
+	SDL_AtomicSet(&job_quit, 1);
+
+	for (int i = 0; i < job_worker_count; ++i)
+	{
+		SDL_SemPost(job_start_sem);
+	}
+
+	for (int i = 0; i < job_worker_count; ++i)
+	{
+		SDL_WaitThread(job_threads[i], NULL);
+		job_threads[i] = NULL;
+	}
+
+	job_worker_count = 0;
+
+	if (job_start_sem)
+	{
+		SDL_DestroySemaphore(job_start_sem);
+		job_start_sem = NULL;
+	}
+
+	if (job_done_sem)
+	{
+		SDL_DestroySemaphore(job_done_sem);
+		job_done_sem = NULL;
+	}
+}
+
+int Sys_GetJobWorkerCount()
+{
+	return job_worker_count;
+}
+
+// Calls func(data, index) for every index in [0, count) and returns when all of them are done.
+// The calling thread takes jobs too. Jobs must not call Com_Error or touch the VMs.
+// Nested calls run on the calling thread.
+void Sys_RunJobs(
+	sysJobFunc_t func,
+	void* data,
+	int count)
+{
+	if (count <= 0)
+	{
+		return;
+	}
+
+	if (job_worker_count == 0 || count == 1 || job_batch_active)
+	{
+		for (int i = 0; i < count; ++i)
+		{
+			func(data, i);
+		}
+
+		return;
+	}
+
+	job_batch_active = true;
+
+	job_batch.func = func;
+	job_batch.data = data;
+	job_batch.count = count;
+	SDL_AtomicSet(&job_batch.next_index, 0);
+
+	const int wake_count = (count - 1 < job_worker_count ? count - 1 : job_worker_count);
+
+	for (int i = 0; i < wake_count; ++i)
+	{
+		SDL_SemPost(job_start_sem);
+	}
+
+	sys_run_job_batch();
+
+	for (int i = 0; i < wake_count; ++i)
+	{
+		SDL_SemWait(job_done_sem);
+	}
+
+	job_batch_active = false;
+}
@@ -13,7 +13,10 @@ SPDX-License-Identifier: GPL-3.0
 
 void IN_MouseEvent(int mstate);
 
+void Sys_InitEventQueue();
 void Sys_QueEvent(int time, sysEventType_t type, int value, int value2, int ptrLength, void* ptr);
+bool Sys_GetQueuedEvent(sysEvent_t* ev);
+int Sys_GetQueuedEventRoom();
 
 void Sys_CreateConsole(void);
 void Sys_DestroyConsole(void);
@@ -21,6 +24,7 @@ void Sys_DestroyConsole(void);
 char* Sys_ConsoleInput(void);
 
 bool Sys_GetPacket(netadr_t* net_from, msg_t* net_message);
+void NET_PrintStats();
 
 // Input subsystem
 
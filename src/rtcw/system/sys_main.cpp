@@ -72,6 +72,9 @@ int main(
 	}
 
 
+	// before anything can post an event
+	Sys_InitEventQueue();
+
 	// done before Com/Sys_Init since we need this for error output
 	Sys_CreateConsole();
 
@@ -119,12 +122,8 @@ int main(
 	// main game loop
 	while (true)
 	{
-		// if not running as a game client, sleep a bit
-		if (com_dedicated && com_dedicated->integer)
-		{
-			SDL_Delay(5);
-		}
-
+		// a dedicated server waits inside Com_Frame on the network socket
+		// until a packet arrives or the next server frame is due
 		const int startTime = Sys_Milliseconds();
 
 		// make sure mouse and joystick are only called once a frame
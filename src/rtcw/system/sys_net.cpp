@@ -12,6 +12,15 @@ SPDX-License-Identifier: GPL-3.0
 #include "SDL_net.h"
 #include "q_shared.h"
 #include "qcommon.h"
+#include "sys_local.h"
+
+#ifdef __linux__
+#include <errno.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif // __linux__
 
 
 namespace {
@@ -29,13 +38,87 @@ cvar_t* net_socksPort;
 cvar_t* net_socksUsername;
 cvar_t* net_socksPassword;
 
+// The server port.
+// On Linux it is a native socket, so a batch of datagrams moves with one recvmmsg or sendmmsg;
+// elsewhere every datagram takes its own SDL_net call.
+#ifdef __linux__
+int ip_socket = -1;
+#else
 UDPsocket ip_socket;
+SDLNet_SocketSet ip_socket_set;
+#endif // __linux__
 
 const int MAX_IPS = 16;
 int numIP;
 byte localIP[MAX_IPS][4];
 UDPpacket udp_packet;
 
+// max datagrams moved by a single receive or send
+const int MAX_PACKET_BATCH = 16;
+
+// inbound datagrams drained in bulk and handed out one by one
+UDPpacket recv_packets[MAX_PACKET_BATCH];
+byte recv_buffers[MAX_PACKET_BATCH][MAX_MSGLEN];
+int recv_count;
+int recv_index;
+
+// outbound datagrams queued between Sys_BeginPacketBatch and Sys_EndPacketBatch
+const int MAX_BATCH_PACKETLEN = 1400;
+
+UDPpacket send_packets[MAX_PACKET_BATCH];
+byte send_buffers[MAX_PACKET_BATCH][MAX_BATCH_PACKETLEN];
+int send_count;
+bool send_batching = false;
+
+// packets per system call, for both threads; calls that moved nothing are not counted
+SDL_atomic_t net_recv_calls;
+SDL_atomic_t net_recv_packets;
+SDL_atomic_t net_send_calls;
+SDL_atomic_t net_send_packets;
+
+// optional receive thread
+// It owns the socket reads, answers the queries the server has published a response for,
+// and queues everything else as SE_PACKET events.
+cvar_t* net_recvThread;
+cvar_t* net_queryRate;
+cvar_t* query_address_rate; // sv_queryRate, per address, shared with the server
+
+SDL_Thread* recv_thread;
+SDL_atomic_t recv_thread_quit;
+SDL_sem* recv_thread_sem; // posted when a packet is queued, so NET_Sleep wakes up
+
+UDPpacket thread_packets[MAX_PACKET_BATCH];
+byte thread_buffers[MAX_PACKET_BATCH][MAX_MSGLEN];
+UDPpacket thread_reply;
+byte thread_reply_buffer[MAX_MSGLEN];
+
+SDL_atomic_t thread_queries_answered;
+SDL_atomic_t thread_queries_dropped;
+SDL_atomic_t thread_queries_limited;
+
+// published query responses: head, then "\\challenge\\<challenge>" if there is one, then tail
+const int MAX_QUERY_RESPONSES = 4;
+const int MAX_QUERY_CHALLENGE = 64;
+
+struct NetQueryResponse
+{
+	char query[32];
+	char head[MAX_MSGLEN];
+	char tail[MAX_MSGLEN];
+	int head_length;
+	int tail_length;
+	bool is_valid;
+};
+
+NetQueryResponse query_responses[MAX_QUERY_RESPONSES];
+SDL_mutex* query_mutex;
+
+// global token bucket for the answered queries, in milliseconds of credit
+int query_credit;
+int query_last_time;
+
+netRateLimit_t query_address_limit;
+
 
 void NetadrToSockadr(
 	const netadr_t& a,
@@ -75,6 +158,609 @@ void SockadrToNetadr(
 	}
 }
 
+bool NET_IsSocketOpen()
+{
+#ifdef __linux__
+	return ip_socket >= 0;
+#else
+	return ip_socket != NULL;
+#endif // __linux__
+}
+
+// The reason of the last failed socket call
+const char* NET_GetSocketError()
+{
+#ifdef __linux__
+	return strerror(errno);
+#else
+	return SDLNet_GetError();
+#endif // __linux__
+}
+
+bool NET_OpenSocket(
+	int port)
+{
+#ifdef __linux__
+	const int native_socket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+
+	if (native_socket < 0) {
+		Com_Printf(
+			"WARNING: UDP_OpenSocket: socket: %s\n",
+			strerror(errno));
+
+		return false;
+	}
+
+	// allow LAN broadcasts, as SDL_net does
+	const int yes = 1;
+
+	setsockopt(native_socket, SOL_SOCKET, SO_BROADCAST, &yes, sizeof(yes));
+
+	sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = INADDR_ANY;
+	address.sin_port = htons(static_cast<Uint16>(port));
+
+	if (bind(native_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0) {
+		Com_Printf(
+			"WARNING: UDP_OpenSocket: bind: %s\n",
+			strerror(errno));
+
+		close(native_socket);
+
+		return false;
+	}
+
+	ip_socket = native_socket;
+#else
+	ip_socket = SDLNet_UDP_Open(
+		static_cast<Uint16>(port));
+
+	if (!ip_socket) {
+		Com_Printf(
+			"WARNING: UDP_OpenSocket: socket: %s\n",
+			SDLNet_GetError());
+
+		return false;
+	}
+
+	ip_socket_set = SDLNet_AllocSocketSet(1);
+
+	if (!ip_socket_set) {
+		Com_Printf(
+			"WARNING: NET_OpenIP: socket set: %s\n",
+			SDLNet_GetError());
+
+		SDLNet_UDP_Close(ip_socket);
+		ip_socket = NULL;
+
+		return false;
+	}
+
+	SDLNet_UDP_AddSocket(
+		ip_socket_set,
+		ip_socket);
+#endif // __linux__
+
+	return true;
+}
+
+void NET_CloseSocket()
+{
+#ifdef __linux__
+	if (ip_socket >= 0) {
+		close(ip_socket);
+		ip_socket = -1;
+	}
+#else
+	if (ip_socket_set) {
+		SDLNet_FreeSocketSet(
+			ip_socket_set);
+
+		ip_socket_set = NULL;
+	}
+
+	if (ip_socket) {
+		SDLNet_UDP_Close(
+			ip_socket);
+
+		ip_socket = NULL;
+	}
+#endif // __linux__
+}
+
+// Returns a positive value if a datagram is waiting, zero on timeout, or -1 on error
+int NET_WaitSocket(
+	int msec)
+{
+#ifdef __linux__
+	pollfd descriptor;
+	descriptor.fd = ip_socket;
+	descriptor.events = POLLIN;
+	descriptor.revents = 0;
+
+	const int result = poll(&descriptor, 1, msec);
+
+	if (result < 0) {
+		return errno == EINTR ? 0 : -1;
+	}
+
+	return result;
+#else
+	return SDLNet_CheckSockets(
+		ip_socket_set,
+		static_cast<Uint32>(msec));
+#endif // __linux__
+}
+
+// Receives up to count datagrams without blocking.
+// Returns the number received, or -1 on error.
+int NET_RecvPackets(
+	UDPpacket* packets,
+	int count)
+{
+#ifdef __linux__
+	mmsghdr headers[MAX_PACKET_BATCH];
+	iovec vectors[MAX_PACKET_BATCH];
+	sockaddr_in addresses[MAX_PACKET_BATCH];
+
+	if (count > MAX_PACKET_BATCH) {
+		count = MAX_PACKET_BATCH;
+	}
+
+	memset(headers, 0, count * sizeof(mmsghdr));
+
+	for (int i = 0; i < count; ++i) {
+		vectors[i].iov_base = packets[i].data;
+		vectors[i].iov_len = packets[i].maxlen;
+
+		msghdr& header = headers[i].msg_hdr;
+		header.msg_name = &addresses[i];
+		header.msg_namelen = sizeof(sockaddr_in);
+		header.msg_iov = &vectors[i];
+		header.msg_iovlen = 1;
+	}
+
+	const int result = recvmmsg(ip_socket, headers, count, MSG_DONTWAIT, NULL);
+
+	if (result < 0) {
+		return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0 : -1;
+	}
+
+	for (int i = 0; i < result; ++i) {
+		UDPpacket& packet = packets[i];
+		packet.channel = -1;
+		packet.len = static_cast<int>(headers[i].msg_len);
+		packet.status = packet.len;
+		packet.address.host = addresses[i].sin_addr.s_addr;
+		packet.address.port = addresses[i].sin_port;
+	}
+
+	if (result > 0) {
+		SDL_AtomicAdd(&net_recv_calls, 1);
+		SDL_AtomicAdd(&net_recv_packets, result);
+	}
+
+	return result;
+#else
+	int result = 0;
+
+	while (result < count) {
+		const int sdl_result = SDLNet_UDP_Recv(
+			ip_socket,
+			&packets[result]);
+
+		if (sdl_result < 0) {
+			if (result == 0) {
+				return -1;
+			}
+
+			break;
+		}
+
+		if (sdl_result == 0) {
+			break;
+		}
+
+		result += 1;
+	}
+
+	SDL_AtomicAdd(&net_recv_calls, result);
+	SDL_AtomicAdd(&net_recv_packets, result);
+
+	return result;
+#endif // __linux__
+}
+
+// Sends count datagrams.
+// Returns the number sent; a datagram that failed does not stop the rest.
+int NET_SendPackets(
+	UDPpacket* packets,
+	int count)
+{
+#ifdef __linux__
+	mmsghdr headers[MAX_PACKET_BATCH];
+	iovec vectors[MAX_PACKET_BATCH];
+	sockaddr_in addresses[MAX_PACKET_BATCH];
+
+	int result = 0;
+
+	while (count > 0) {
+		const int batch_count = count < MAX_PACKET_BATCH ? count : MAX_PACKET_BATCH;
+
+		memset(headers, 0, batch_count * sizeof(mmsghdr));
+		memset(addresses, 0, batch_count * sizeof(sockaddr_in));
+
+		for (int i = 0; i < batch_count; ++i) {
+			vectors[i].iov_base = packets[i].data;
+			vectors[i].iov_len = packets[i].len;
+
+			addresses[i].sin_family = AF_INET;
+			addresses[i].sin_addr.s_addr = packets[i].address.host;
+			addresses[i].sin_port = packets[i].address.port;
+
+			msghdr& header = headers[i].msg_hdr;
+			header.msg_name = &addresses[i];
+			header.msg_namelen = sizeof(sockaddr_in);
+			header.msg_iov = &vectors[i];
+			header.msg_iovlen = 1;
+		}
+
+		const int sent = sendmmsg(ip_socket, headers, batch_count, 0);
+
+		if (sent < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			// sendmmsg only fails when the first datagram does, skip it
+			packets += 1;
+			count -= 1;
+
+			continue;
+		}
+
+		SDL_AtomicAdd(&net_send_calls, 1);
+		SDL_AtomicAdd(&net_send_packets, sent);
+
+		packets += sent;
+		count -= sent;
+		result += sent;
+	}
+
+	return result;
+#else
+	int result = 0;
+
+	for (int i = 0; i < count; ++i) {
+		result += SDLNet_UDP_Send(
+			ip_socket,
+			-1,
+			&packets[i]);
+	}
+
+	SDL_AtomicAdd(&net_send_calls, count);
+	SDL_AtomicAdd(&net_send_packets, result);
+
+	return result;
+#endif // __linux__
+}
+
+void NET_FlushSendBatch()
+{
+	if (send_count == 0) {
+		return;
+	}
+
+	const int packet_count = send_count;
+
+	send_count = 0;
+
+	if (!NET_IsSocketOpen()) {
+		return;
+	}
+
+	if (NET_SendPackets(send_packets, packet_count) != packet_count) {
+		Com_Printf(
+			"NET_SendPacket: %s\n",
+			NET_GetSocketError());
+	}
+}
+
+// Token bucket refilled at net_queryRate answers per second, holding up to one second of them
+bool NET_TakeQueryCredit()
+{
+	const int rate = net_queryRate->integer;
+
+	if (rate <= 0) {
+		return true;
+	}
+
+	const int now = Sys_Milliseconds();
+
+	query_credit += now - query_last_time;
+	query_last_time = now;
+
+	if (query_credit > 1000) {
+		query_credit = 1000;
+	}
+
+	const int cost = 1000 / rate > 0 ? 1000 / rate : 1;
+
+	if (query_credit < cost) {
+		return false;
+	}
+
+	query_credit -= cost;
+
+	return true;
+}
+
+// Mirrors what SV_ConnectionlessPacket would see for "<query> <challenge>" and checks
+// the challenge can go into an infostring as is; anything unusual is left to the main thread.
+bool NET_ParseQuery(
+	const UDPpacket& packet,
+	const char*& query,
+	int& query_length,
+	const char*& challenge,
+	int& challenge_length)
+{
+	if (packet.len < 4 || *reinterpret_cast<const int*>(packet.data) != -1) {
+		return false;
+	}
+
+	const char* const begin = reinterpret_cast<const char*>(packet.data) + 4;
+	const char* end = begin;
+
+	// the tokenizer would treat quotes and comments specially, and the message reader
+	// rewrites non-ascii bytes
+	for (; end < reinterpret_cast<const char*>(packet.data) + packet.len; ++end) {
+		const unsigned char c = static_cast<unsigned char>(*end);
+
+		if (c == '\0' || c == '\n') {
+			break;
+		}
+
+		if (c > 126 || c == '"' || c == '/') {
+			return false;
+		}
+	}
+
+	const char* s = begin;
+
+	while (s < end && *s <= ' ') {
+		s += 1;
+	}
+
+	query = s;
+
+	while (s < end && *s > ' ') {
+		s += 1;
+	}
+
+	query_length = static_cast<int>(s - query);
+
+	while (s < end && *s <= ' ') {
+		s += 1;
+	}
+
+	challenge = s;
+
+	while (s < end && *s > ' ') {
+		if (*s == '\\' || *s == '%' || *s == ';') {
+			return false;
+		}
+
+		s += 1;
+	}
+
+	challenge_length = static_cast<int>(s - challenge);
+
+	return query_length > 0 && challenge_length <= MAX_QUERY_CHALLENGE;
+}
+
+// Returns true if the packet was a query handled here
+bool NET_AnswerQuery(
+	const UDPpacket& packet)
+{
+	const char* query;
+	int query_length;
+	const char* challenge;
+	int challenge_length;
+
+	if (!NET_ParseQuery(packet, query, query_length, challenge, challenge_length)) {
+		return false;
+	}
+
+	SDL_LockMutex(query_mutex);
+
+	const NetQueryResponse* response = NULL;
+
+	for (int i = 0; i < MAX_QUERY_RESPONSES; ++i) {
+		const NetQueryResponse& candidate = query_responses[i];
+
+		if (candidate.is_valid &&
+			static_cast<int>(strlen(candidate.query)) == query_length &&
+			!Q_stricmpn(candidate.query, query, query_length))
+		{
+			response = &candidate;
+			break;
+		}
+	}
+
+	if (!response) {
+		SDL_UnlockMutex(query_mutex);
+
+		return false;
+	}
+
+	netadr_t from;
+	SockadrToNetadr(packet.address, from);
+
+	if (NET_RateLimit(&query_address_limit, from, query_address_rate->integer, Sys_Milliseconds())) {
+		SDL_UnlockMutex(query_mutex);
+		SDL_AtomicIncRef(&thread_queries_limited);
+
+		return true;
+	}
+
+	if (!NET_TakeQueryCredit()) {
+		SDL_UnlockMutex(query_mutex);
+		SDL_AtomicIncRef(&thread_queries_dropped);
+
+		return true;
+	}
+
+	byte* reply = thread_reply_buffer;
+
+	*reinterpret_cast<int*>(reply) = -1;
+	reply += 4;
+
+	memcpy(reply, response->head, response->head_length);
+	reply += response->head_length;
+
+	if (challenge_length > 0) {
+		memcpy(reply, "\\challenge\\", 11);
+		reply += 11;
+		memcpy(reply, challenge, challenge_length);
+		reply += challenge_length;
+	}
+
+	memcpy(reply, response->tail, response->tail_length);
+	reply += response->tail_length;
+
+	SDL_UnlockMutex(query_mutex);
+
+	thread_reply.channel = -1;
+	thread_reply.address = packet.address;
+	thread_reply.len = static_cast<int>(reply - thread_reply_buffer);
+
+	NET_SendPackets(&thread_reply, 1);
+
+	SDL_AtomicIncRef(&thread_queries_answered);
+
+	return true;
+}
+
+int SDLCALL NET_ReceiveThread(
+	void* data)
+{
+	static_cast<void>(data);
+
+	while (SDL_AtomicGet(&recv_thread_quit) == 0) {
+		const int ready = NET_WaitSocket(100);
+
+		if (ready < 0) {
+			SDL_Delay(10);
+			continue;
+		}
+
+		if (ready == 0) {
+			continue;
+		}
+
+		const int packet_count = NET_RecvPackets(thread_packets, MAX_PACKET_BATCH);
+
+		if (packet_count <= 0) {
+			continue;
+		}
+
+		bool is_queued = false;
+
+		for (int i = 0; i < packet_count; ++i) {
+			const UDPpacket& packet = thread_packets[i];
+
+			if (NET_AnswerQuery(packet)) {
+				continue;
+			}
+
+			// a netadr_t followed by the data, as Sys_GetEvent queues it
+			const int length = static_cast<int>(sizeof(netadr_t)) + packet.len;
+			netadr_t* const buffer = static_cast<netadr_t*>(Sys_AllocEventData(length));
+
+			if (!buffer) {
+				continue;
+			}
+
+			SockadrToNetadr(packet.address, *buffer);
+			memcpy(buffer + 1, packet.data, packet.len);
+
+			Sys_QueEvent(0, SE_PACKET, 0, 0, length, buffer);
+
+			is_queued = true;
+		}
+
+		if (is_queued && SDL_SemValue(recv_thread_sem) == 0) {
+			SDL_SemPost(recv_thread_sem);
+		}
+	}
+
+	return 0;
+}
+
+void NET_StopReceiveThread()
+{
+	if (!recv_thread) {
+		return;
+	}
+
+	SDL_AtomicSet(&recv_thread_quit, 1);
+	SDL_WaitThread(recv_thread, NULL);
+	recv_thread = NULL;
+
+	SDL_DestroySemaphore(recv_thread_sem);
+	recv_thread_sem = NULL;
+}
+
+void NET_StartReceiveThread()
+{
+	if (!NET_IsSocketOpen()) {
+		return;
+	}
+
+	for (int i = 0; i < MAX_PACKET_BATCH; ++i) {
+		UDPpacket& packet = thread_packets[i];
+		packet.channel = -1;
+		packet.data = thread_buffers[i];
+		packet.len = 0;
+		packet.maxlen = MAX_MSGLEN;
+		packet.status = 0;
+	}
+
+	thread_reply.data = thread_reply_buffer;
+	thread_reply.maxlen = MAX_MSGLEN;
+
+	if (!query_mutex) {
+		query_mutex = SDL_CreateMutex();
+	}
+
+	recv_thread_sem = SDL_CreateSemaphore(0);
+
+	if (!query_mutex || !recv_thread_sem) {
+		Com_Printf("WARNING: NET_StartReceiveThread: %s\n", SDL_GetError());
+		NET_StopReceiveThread();
+
+		return;
+	}
+
+	query_credit = 1000;
+	query_last_time = Sys_Milliseconds();
+
+	SDL_AtomicSet(&recv_thread_quit, 0);
+
+	recv_thread = SDL_CreateThread(NET_ReceiveThread, "rtcw_net", NULL);
+
+	if (!recv_thread) {
+		Com_Printf("WARNING: NET_StartReceiveThread: %s\n", SDL_GetError());
+		NET_StopReceiveThread();
+
+		return;
+	}
+
+	Com_Printf("Network receive thread started.\n");
+}
+
 // idnewt
 // 192.246.40.70
 // 12121212.121212121212
@@ -97,7 +783,7 @@ bool Sys_StringToSockaddr(
 	}
 }
 
-UDPsocket NET_IPSocket(
+bool NET_IPSocket(
 	const char* net_interface,
 	int port)
 {
@@ -111,56 +797,7 @@ UDPsocket NET_IPSocket(
 			port);
 	}
 
-	bool is_succeed = true;
-	UDPsocket udp_socket = NULL;
-
-	if (is_succeed) {
-		udp_socket = SDLNet_UDP_Open(
-			static_cast<Uint16>(port));
-
-		if (!udp_socket) {
-			is_succeed = false;
-
-			Com_Printf(
-				"WARNING: UDP_OpenSocket: socket: %s\n",
-				SDLNet_GetError());
-		}
-	}
-
-	IPaddress ip_address;
-
-	if (is_succeed) {
-		if (!net_interface ||
-			net_interface[0] == '\0' ||
-			!::Q_stricmp(net_interface, "localhost"))
-		{
-			ip_address.host = INADDR_ANY;
-		} else {
-			Sys_StringToSockaddr(
-				net_interface,
-				ip_address);
-		}
-
-		if (port == PORT_ANY) {
-			ip_address.port = 0;
-		} else {
-			SDLNet_Write16(
-				static_cast<Uint16>(port),
-				&ip_address.port);
-		}
-	}
-
-	if (is_succeed) {
-	} else {
-		if (udp_socket) {
-			SDLNet_UDP_Close(
-				udp_socket);
-
-			udp_socket = NULL;
-		}
-	}
-
-	return udp_socket;
+	return NET_OpenSocket(port);
 }
 
 void NET_GetLocalAddress()
@@ -223,11 +860,10 @@ void NET_OpenIP()
 	// dedicated servers can be started without requiring
 	// a different net_port for each one
 	for (int i = 0; i < 10; ++i) {
-		ip_socket = NET_IPSocket(
+		if (NET_IPSocket(
 			ip->string,
-			port + i);
-
-		if (ip_socket) {
+			port + i))
+		{
 			Cvar_SetValue(
 				"net_port",
 				static_cast<float>(port + i));
@@ -249,11 +885,30 @@ bool NET_GetCvars()
 		modified = true;
 	}
 
+	if (net_recvThread && net_recvThread->modified) {
+		modified = true;
+	}
+
 	net_noudp = Cvar_Get(
 		"net_noudp",
 		"0",
 		CVAR_LATCH | CVAR_ARCHIVE);
 
+	net_recvThread = Cvar_Get(
+		"net_recvThread",
+		"0",
+		CVAR_LATCH | CVAR_ARCHIVE);
+
+	net_queryRate = Cvar_Get(
+		"net_queryRate",
+		"200",
+		CVAR_ARCHIVE);
+
+	query_address_rate = Cvar_Get(
+		"sv_queryRate",
+		"10",
+		CVAR_ARCHIVE);
+
 	return modified;
 }
 
@@ -296,17 +951,23 @@ void NET_Config(
 	}
 
 	if (stop) {
-		if (ip_socket) {
-			SDLNet_UDP_Close(
-				ip_socket);
+		NET_StopReceiveThread();
 
-			ip_socket = NULL;
-		}
+		// drop anything batched for the old socket
+		recv_count = 0;
+		recv_index = 0;
+		send_count = 0;
+
+		NET_CloseSocket();
 	}
 
 	if (start) {
 		if (net_noudp->integer == 0) {
 			NET_OpenIP();
+
+			if (net_recvThread->integer != 0) {
+				NET_StartReceiveThread();
+			}
 		}
 	}
 }
@@ -332,6 +993,22 @@ void NET_Init()
 	udp_packet.status = 0;
 	udp_packet.maxlen = MAX_MSGLEN;
 
+	for (int i = 0; i < MAX_PACKET_BATCH; ++i) {
+		UDPpacket& recv_packet = recv_packets[i];
+		recv_packet.channel = -1;
+		recv_packet.data = recv_buffers[i];
+		recv_packet.len = 0;
+		recv_packet.maxlen = MAX_MSGLEN;
+		recv_packet.status = 0;
+
+		UDPpacket& send_packet = send_packets[i];
+		send_packet.channel = -1;
+		send_packet.data = send_buffers[i];
+		send_packet.len = 0;
+		send_packet.maxlen = MAX_BATCH_PACKETLEN;
+		send_packet.status = 0;
+	}
+
 	sockInitialized = true;
 
 	Com_Printf("SDL_net initialized.\n");
@@ -363,7 +1040,31 @@ void NET_Shutdown()
 void NET_Sleep(
 	int msec)
 {
-	static_cast<void>(msec);
+	if (msec <= 0) {
+		return;
+	}
+
+	if (!NET_IsSocketOpen()) {
+		SDL_Delay(static_cast<Uint32>(msec));
+
+		return;
+	}
+
+	// packets already drained from the socket are waiting
+	if (recv_index < recv_count) {
+		return;
+	}
+
+	if (recv_thread) {
+		SDL_SemWaitTimeout(recv_thread_sem, static_cast<Uint32>(msec));
+
+		return;
+	}
+
+	if (NET_WaitSocket(msec) < 0) {
+		// don't spin if the wait itself has failed
+		SDL_Delay(static_cast<Uint32>(msec));
+	}
 }
 
 void NET_Restart()
@@ -394,42 +1095,56 @@ bool Sys_GetPacket(
 	netadr_t* net_from,
 	msg_t* net_message)
 {
-	if (!::ip_socket) {
+	// the receive thread queues the packets itself
+	if (!NET_IsSocketOpen() || recv_thread) {
 		return false;
 	}
 
-	udp_packet.data = net_message->data;
+	while (true) {
+		if (recv_index >= recv_count) {
+			// drain what is pending on the socket in one call
+			recv_index = 0;
+			recv_count = 0;
+
+			const int packet_count = NET_RecvPackets(recv_packets, MAX_PACKET_BATCH);
+
+			if (packet_count < 0) {
+				Com_Printf(
+					"NET_GetPacket: %s\n",
+					NET_GetSocketError());
+
+				return false;
+			}
+
+			if (packet_count == 0) {
+				return false;
+			}
+
+			recv_count = packet_count;
+		}
+
+		const UDPpacket& packet = recv_packets[recv_index];
 
-	int sdl_result = SDLNet_UDP_Recv(
-		ip_socket,
-		&::udp_packet);
+		recv_index += 1;
 
-	if (sdl_result == 1) {
 		SockadrToNetadr(
-			udp_packet.address,
+			packet.address,
 			*net_from);
 
 		net_message->readcount = 0;
 
-		if (udp_packet.len > net_message->maxsize) {
+		if (packet.len > net_message->maxsize) {
 			Com_Printf(
 				"Oversize packet from %s\n",
 				NET_AdrToString(*net_from));
 
-			return false;
+			continue;
 		}
 
-		net_message->cursize = udp_packet.len;
+		memcpy(net_message->data, packet.data, packet.len);
+		net_message->cursize = packet.len;
 
 		return true;
-	} else if (sdl_result == -1) {
-		Com_Printf(
-			"NET_GetPacket: %s\n",
-			SDLNet_GetError());
-
-		return false;
-	} else {
-		return false;
 	}
 }
 
@@ -449,7 +1164,7 @@ void Sys_SendPacket(
 		return;
 	}
 
-	if (!::ip_socket) {
+	if (!NET_IsSocketOpen()) {
 		return;
 	}
 
@@ -459,22 +1174,141 @@ void Sys_SendPacket(
 		to,
 		addr);
 
+	if (send_batching && length <= MAX_BATCH_PACKETLEN) {
+		if (send_count == MAX_PACKET_BATCH) {
+			NET_FlushSendBatch();
+		}
+
+		UDPpacket& packet = send_packets[send_count];
+		packet.address = addr;
+		packet.len = length;
+		memcpy(packet.data, data, length);
+
+		send_count += 1;
+
+		return;
+	}
+
+	// keep the send order for packets too big to be batched
+	NET_FlushSendBatch();
+
 	udp_packet.address = addr;
 	udp_packet.len = length;
 	udp_packet.data = static_cast<Uint8*>(const_cast<void*>(data));
 
-	int sdl_result = SDLNet_UDP_Send(
-		ip_socket,
-		-1,
-		&::udp_packet);
-
-	if (sdl_result != 1) {
+	if (NET_SendPackets(&::udp_packet, 1) != 1) {
 		Com_Printf(
 			"NET_SendPacket: %s\n",
-			SDLNet_GetError());
+			NET_GetSocketError());
 	}
 }
 
+// Queues outgoing packets until Sys_EndPacketBatch
+void Sys_BeginPacketBatch()
+{
+	send_batching = true;
+}
+
+// Sends all queued packets with as few system calls as the backend allows
+void Sys_EndPacketBatch()
+{
+	NET_FlushSendBatch();
+
+	send_batching = false;
+}
+
+void NET_PrintStats()
+{
+	const int recv_calls = SDL_AtomicGet(&net_recv_calls);
+	const int recv_packets = SDL_AtomicGet(&net_recv_packets);
+	const int send_calls = SDL_AtomicGet(&net_send_calls);
+	const int send_packets = SDL_AtomicGet(&net_send_packets);
+
+	Com_Printf(
+		"recv: %i packets in %i calls (%.2f per call)\n",
+		recv_packets,
+		recv_calls,
+		recv_calls > 0 ? static_cast<float>(recv_packets) / recv_calls : 0.0F);
+
+	Com_Printf(
+		"send: %i packets in %i calls (%.2f per call)\n",
+		send_packets,
+		send_calls,
+		send_calls > 0 ? static_cast<float>(send_packets) / send_calls : 0.0F);
+
+	if (!recv_thread) {
+		return;
+	}
+
+	Com_Printf(
+		"thread queries: %i answered, %i over net_queryRate, %i over sv_queryRate\n",
+		SDL_AtomicGet(&thread_queries_answered),
+		SDL_AtomicGet(&thread_queries_dropped),
+		SDL_AtomicGet(&thread_queries_limited));
+}
+
+bool Sys_IsNetThreadRunning()
+{
+	return recv_thread != NULL;
+}
+
+// Publishes the response the receive thread sends for "<query> <challenge>".
+// The challenge goes between head and tail as a "challenge" key; a null head withdraws it.
+void Sys_SetQueryResponse(
+	const char* query,
+	const char* head,
+	const char* tail)
+{
+	if (!query_mutex) {
+		return;
+	}
+
+	SDL_LockMutex(query_mutex);
+
+	NetQueryResponse* response = NULL;
+	NetQueryResponse* free_response = NULL;
+
+	for (int i = 0; i < MAX_QUERY_RESPONSES; ++i) {
+		NetQueryResponse& candidate = query_responses[i];
+
+		if (candidate.is_valid && !Q_stricmp(candidate.query, query)) {
+			response = &candidate;
+			break;
+		}
+
+		if (!candidate.is_valid && !free_response) {
+			free_response = &candidate;
+		}
+	}
+
+	if (!response) {
+		response = free_response;
+	}
+
+	if (!head) {
+		if (response) {
+			response->is_valid = false;
+		}
+	} else if (response) {
+		const int head_length = static_cast<int>(strlen(head));
+		const int tail_length = static_cast<int>(strlen(tail));
+
+		// room for the marker, the challenge and the key
+		if (4 + head_length + 11 + MAX_QUERY_CHALLENGE + tail_length <= MAX_MSGLEN) {
+			Q_strncpyz(response->query, query, sizeof(response->query));
+			memcpy(response->head, head, head_length);
+			memcpy(response->tail, tail, tail_length);
+			response->head_length = head_length;
+			response->tail_length = tail_length;
+			response->is_valid = true;
+		} else {
+			response->is_valid = false;
+		}
+	}
+
+	SDL_UnlockMutex(query_mutex);
+}
+
 // LAN clients will have their rate var ignored
 bool Sys_IsLANAddress(
 	netadr_t adr)
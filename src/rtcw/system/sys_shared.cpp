@@ -79,6 +79,24 @@ void Sys_BeginProfiling()
 	// this is just used on the mac build
 }
 
+// Microseconds since the first call; for profiling only.
+long long Sys_Microseconds()
+{
+	static Uint64 time_base = 0;
+
+	const Uint64 counter = SDL_GetPerformanceCounter();
+
+	if (time_base == 0)
+	{
+		time_base = counter;
+	}
+
+	const Uint64 frequency = SDL_GetPerformanceFrequency();
+	const Uint64 ticks = counter - time_base;
+
+	return static_cast<long long>((ticks / frequency) * 1000000 + ((ticks % frequency) * 1000000) / frequency);
+}
+
 // Show the early console as an error dialog
 void QDECL Sys_Error(
 	const char* error,
@@ -114,6 +132,7 @@ void QDECL Sys_Error(
 
 void Sys_Quit()
 {
+	Sys_ShutdownJobs();
 	IN_Shutdown();
 	Sys_DestroyConsole();
 
@@ -564,59 +583,8 @@ void* QDECL Sys_LoadDll(
 	return libHandle;
 }
 
-const int MAX_QUED_EVENTS = 256;
-const int MASK_QUED_EVENTS = MAX_QUED_EVENTS - 1;
-
-sysEvent_t eventQue[MAX_QUED_EVENTS];
-int eventHead;
-int eventTail;
 byte sys_packetReceived[MAX_MSGLEN];
 
-//
-// A time of 0 will get the current time
-// Ptr should either be null, or point to a block of data that can
-// be freed by the game later.
-//
-void Sys_QueEvent(
-	int time,
-	sysEventType_t type,
-	int value,
-	int value2,
-	int ptrLength,
-	void* ptr)
-{
-	sysEvent_t* ev;
-
-	ev = &eventQue[eventHead & MASK_QUED_EVENTS];
-
-	if ((eventHead - eventTail) >= MAX_QUED_EVENTS)
-	{
-		Com_Printf("Sys_QueEvent: overflow\n");
-
-		// we are discarding an event, but don't leak memory
-		if (ev->evPtr)
-		{
-			Z_Free(ev->evPtr);
-		}
-
-		eventTail += 1;
-	}
-
-	eventHead += 1;
-
-	if (time == 0)
-	{
-		time = Sys_Milliseconds();
-	}
-
-	ev->evTime = time;
-	ev->evType = type;
-	ev->evValue = value;
-	ev->evValue2 = value2;
-	ev->evPtrLength = ptrLength;
-	ev->evPtr = ptr;
-}
-
 sysEvent_t Sys_GetEvent()
 {
 	sysEvent_t ev;
@@ -624,10 +592,9 @@ sysEvent_t Sys_GetEvent()
 	netadr_t adr;
 
 	// return if we have data
-	if (eventHead > eventTail)
+	if (Sys_GetQueuedEvent(&ev))
 	{
-		eventTail += 1;
-		return eventQue[(eventTail - 1) & MASK_QUED_EVENTS];
+		return ev;
 	}
 
 	// pump the message loop
@@ -639,21 +606,29 @@ sysEvent_t Sys_GetEvent()
 	if (s != NULL)
 	{
 		const int len = static_cast<int>(strlen(s)) + 1;
-		char* b = static_cast<char*> (Z_Malloc(len));
+		char* b = static_cast<char*>(Sys_AllocEventData(len));
 
 		Q_strncpyz(b, s, len - 1);
 		Sys_QueEvent(0, SE_CONSOLE, 0, 0, len, b);
 	}
 
 	// check for network packets
-	MSG_Init(&netmsg, sys_packetReceived, sizeof(sys_packetReceived));
+	// (drain everything already received, but leave room in the queue for other events)
+	const int max_packets = Sys_GetQueuedEventRoom() / 2;
 
-	if (Sys_GetPacket(&adr, &netmsg))
+	for (int i = 0; i < max_packets; ++i)
 	{
+		MSG_Init(&netmsg, sys_packetReceived, sizeof(sys_packetReceived));
+
+		if (!Sys_GetPacket(&adr, &netmsg))
+		{
+			break;
+		}
+
 		// copy out to a seperate buffer for qeueing
 		// the readcount stepahead is for SOCKS support
 		const int len = static_cast<int>(sizeof(netadr_t)) + netmsg.cursize - netmsg.readcount;
-		netadr_t* buf = static_cast<netadr_t*>(Z_Malloc(len));
+		netadr_t* buf = static_cast<netadr_t*>(Sys_AllocEventData(len));
 
 		*buf = adr;
 		memcpy(buf + 1, &netmsg.data[netmsg.readcount], netmsg.cursize - netmsg.readcount);
@@ -662,10 +637,9 @@ sysEvent_t Sys_GetEvent()
 	}
 
 	// return if we have data
-	if (eventHead > eventTail)
+	if (Sys_GetQueuedEvent(&ev))
 	{
-		eventTail += 1;
-		return eventQue[(eventTail - 1) & MASK_QUED_EVENTS];
+		return ev;
 	}
 
 	// create an empty event to return
@@ -690,6 +664,12 @@ void Sys_Net_Restart_f()
 	NET_Restart();
 }
 
+// Show the packets-per-syscall statistics of the network subsystem
+void Sys_Net_Stats_f()
+{
+	NET_PrintStats();
+}
+
 
 extern void Sys_ClearViewlog_f(); // fretn
 
@@ -699,6 +679,7 @@ void Sys_Init()
 {
 	Cmd_AddCommand("in_restart", Sys_In_Restart_f);
 	Cmd_AddCommand("net_restart", Sys_Net_Restart_f);
+	Cmd_AddCommand("net_stats", Sys_Net_Stats_f);
 	Cmd_AddCommand("clearviewlog", Sys_ClearViewlog_f);
 
 	// FIXME
@@ -720,6 +701,10 @@ void Sys_Init()
 
 	Cvar_Set("username", Sys_GetCurrentUser());
 
+	// the workers were started before the file system, this picks up
+	// a worker count from the config files
+	Sys_InitJobs();
+
 #if !defined RTCW_ET
 	IN_Init(); // FIXME: not in dedicated?
 #endif // RTCW_XX
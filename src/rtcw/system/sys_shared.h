@@ -21,6 +21,16 @@ SysDirHandle sys_open_dir(const char* path);
 const SysDirEntry* sys_read_dir(SysDirHandle handle);
 void sys_close_dir(SysDirHandle& handle);
 
+struct SysFileMappingHandle_ {};
+typedef SysFileMappingHandle_* SysFileMappingHandle;
+
+// Maps a whole file read-only into memory.
+// Returns NULL if the file can't be opened, is empty or can't be mapped.
+SysFileMappingHandle sys_map_file(const char* path);
+const void* sys_get_file_mapping_data(SysFileMappingHandle handle);
+long long sys_get_file_mapping_size(SysFileMappingHandle handle);
+void sys_unmap_file(SysFileMappingHandle& handle);
+
 void Sys_Mkdir(const char* path);
 char* Sys_Cwd();
 int Sys_Milliseconds();
@@ -16,7 +16,9 @@ SPDX-License-Identifier: GPL-3.0
 #include <errno.h>
 #include <dirent.h>
 #include <time.h>
+#include <fcntl.h>
 #include <unistd.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 
 namespace {
@@ -180,6 +182,103 @@ bool SysDirPosix::update_entry()
 	return true;
 }
 
+// =====================================
+
+class SysFileMappingPosix
+{
+public:
+	SysFileMappingPosix(const char* path);
+	~SysFileMappingPosix();
+
+	static SysFileMappingPosix* create(const char* path);
+	static void destroy(SysFileMappingPosix* sys_mapping);
+
+	const void* get_data() const;
+	long long get_size() const;
+
+private:
+	void* data_;
+	long long size_;
+
+	SysFileMappingPosix(const SysFileMappingPosix&);
+	SysFileMappingPosix& operator=(const SysFileMappingPosix&);
+
+	bool is_open() const;
+	void close();
+};
+
+// -------------------------------------
+
+SysFileMappingPosix::SysFileMappingPosix(const char* path)
+	:
+	data_(MAP_FAILED),
+	size_()
+{
+	const int fd = open(path, O_RDONLY);
+	if (fd < 0)
+	{
+		return;
+	}
+	struct stat posix_stat;
+	if (fstat(fd, &posix_stat) == 0 && S_ISREG(posix_stat.st_mode) && posix_stat.st_size > 0)
+	{
+		size_ = static_cast<long long>(posix_stat.st_size);
+		data_ = mmap(NULL, static_cast<size_t>(size_), PROT_READ, MAP_PRIVATE, fd, 0);
+	}
+	// The mapping stays valid without the descriptor.
+	::close(fd);
+}
+
+SysFileMappingPosix::~SysFileMappingPosix()
+{
+	close();
+}
+
+SysFileMappingPosix* SysFileMappingPosix::create(const char* path)
+{
+	SysFileMappingPosix* const sys_mapping = rtcw::mem::new_object_1<SysFileMappingPosix>(path);
+	if (sys_mapping == NULL || !sys_mapping->is_open())
+	{
+		SysFileMappingPosix::destroy(sys_mapping);
+		return NULL;
+	}
+	return sys_mapping;
+}
+
+void SysFileMappingPosix::destroy(SysFileMappingPosix* sys_mapping)
+{
+	rtcw::mem::delete_object(sys_mapping);
+}
+
+const void* SysFileMappingPosix::get_data() const
+{
+	return data_;
+}
+
+long long SysFileMappingPosix::get_size() const
+{
+	return size_;
+}
+
+bool SysFileMappingPosix::is_open() const
+{
+	return data_ != MAP_FAILED;
+}
+
+void SysFileMappingPosix::close()
+{
+	if (!is_open())
+	{
+		return;
+	}
+
+	const int int_result = munmap(data_, static_cast<size_t>(size_));
+	assert(int_result == 0);
+	maybe_unused(int_result);
+	data_ = MAP_FAILED;
+	size_ = 0;
+}
+
 } // namespace
 
 // =====================================
@@ -201,6 +300,29 @@ void sys_close_dir(SysDirHandle& handle)
 
 // =====================================
 
+SysFileMappingHandle sys_map_file(const char* path)
+{
+	return reinterpret_cast<SysFileMappingHandle>(SysFileMappingPosix::create(path));
+}
+
+const void* sys_get_file_mapping_data(SysFileMappingHandle handle)
+{
+	return reinterpret_cast<SysFileMappingPosix*>(handle)->get_data();
+}
+
+long long sys_get_file_mapping_size(SysFileMappingHandle handle)
+{
+	return reinterpret_cast<SysFileMappingPosix*>(handle)->get_size();
+}
+
+void sys_unmap_file(SysFileMappingHandle& handle)
+{
+	SysFileMappingPosix::destroy(reinterpret_cast<SysFileMappingPosix*>(handle));
+	handle = NULL;
+}
+
+// =====================================
+
 void Sys_Mkdir(const char* path)
 {
 	const int posix_result = mkdir(path, 0777);
@@ -182,6 +182,119 @@ bool SysDirWin32::update_entry()
 	return true;
 }
 
+// =====================================
+
+class SysFileMappingWin32
+{
+public:
+	SysFileMappingWin32(const char* path);
+	~SysFileMappingWin32();
+
+	static SysFileMappingWin32* create(const char* path);
+	static void destroy(SysFileMappingWin32* sys_mapping);
+
+	const void* get_data() const;
+	long long get_size() const;
+
+private:
+	static const int max_path_size = 1024;
+
+	void* data_;
+	long long size_;
+
+	SysFileMappingWin32(const SysFileMappingWin32&);
+	SysFileMappingWin32& operator=(const SysFileMappingWin32&);
+
+	bool is_open() const;
+	void close();
+};
+
+// -------------------------------------
+
+SysFileMappingWin32::SysFileMappingWin32(const char* path)
+	:
+	data_(),
+	size_()
+{
+	wchar_t u16_path[max_path_size];
+	// Convert the path to UTF-16.
+	const int u16_path_size = MultiByteToWideChar(CP_UTF8, 0, path, -1, u16_path, max_path_size);
+	if (u16_path_size == 0)
+	{
+		assert(false && "MultiByteToWideChar");
+		return;
+	}
+	const HANDLE win32_file = CreateFileW(u16_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (win32_file == INVALID_HANDLE_VALUE)
+	{
+		return;
+	}
+	LARGE_INTEGER win32_size;
+	if (GetFileSizeEx(win32_file, &win32_size) && win32_size.QuadPart > 0 &&
+		static_cast<unsigned long long>(win32_size.QuadPart) <= static_cast<SIZE_T>(-1))
+	{
+		const HANDLE win32_mapping = CreateFileMappingW(win32_file, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (win32_mapping != NULL)
+		{
+			data_ = MapViewOfFile(win32_mapping, FILE_MAP_READ, 0, 0, 0);
+			size_ = win32_size.QuadPart;
+			// The view keeps the mapping alive.
+			CloseHandle(win32_mapping);
+		}
+	}
+	CloseHandle(win32_file);
+}
+
+SysFileMappingWin32::~SysFileMappingWin32()
+{
+	close();
+}
+
+SysFileMappingWin32* SysFileMappingWin32::create(const char* path)
+{
+	SysFileMappingWin32* const sys_mapping = rtcw::mem::new_object_1<SysFileMappingWin32>(path);
+	if (sys_mapping == NULL || !sys_mapping->is_open())
+	{
+		SysFileMappingWin32::destroy(sys_mapping);
+		return NULL;
+	}
+	return sys_mapping;
+}
+
+void SysFileMappingWin32::destroy(SysFileMappingWin32* sys_mapping)
+{
+	rtcw::mem::delete_object(sys_mapping);
+}
+
+const void* SysFileMappingWin32::get_data() const
+{
+	return data_;
+}
+
+long long SysFileMappingWin32::get_size() const
+{
+	return size_;
+}
+
+bool SysFileMappingWin32::is_open() const
+{
+	return data_ != NULL;
+}
+
+void SysFileMappingWin32::close()
+{
+	if (!is_open())
+	{
+		return;
+	}
+
+	const BOOL win32_result = UnmapViewOfFile(data_);
+	assert(win32_result != FALSE);
+	maybe_unused(win32_result);
+	data_ = NULL;
+	size_ = 0;
+}
+
 } // namespace
 
 // =====================================
@@ -201,6 +314,29 @@ void sys_close_dir(SysDirHandle& handle)
 	SysDirWin32::destroy(reinterpret_cast<SysDirWin32*>(handle));
 }
 
+// =====================================
+
+SysFileMappingHandle sys_map_file(const char* path)
+{
+	return reinterpret_cast<SysFileMappingHandle>(SysFileMappingWin32::create(path));
+}
+
+const void* sys_get_file_mapping_data(SysFileMappingHandle handle)
+{
+	return reinterpret_cast<SysFileMappingWin32*>(handle)->get_data();
+}
+
+long long sys_get_file_mapping_size(SysFileMappingHandle handle)
+{
+	return reinterpret_cast<SysFileMappingWin32*>(handle)->get_size();
+}
+
+void sys_unmap_file(SysFileMappingHandle& handle)
+{
+	SysFileMappingWin32::destroy(reinterpret_cast<SysFileMappingWin32*>(handle));
+	handle = NULL;
+}
+
 // ==========================================================================
 
 void Sys_Mkdir(const char* path)
@@ -88,8 +88,9 @@ void syscon_quit_callback()
 {
 	if (com_dedicated != NULL && com_dedicated->integer != 0)
 	{
-		char* cmd_string = CopyString("quit");
-		Sys_QueEvent(0, SE_CONSOLE, 0, 0, static_cast<int>(strlen(cmd_string)) + 1, cmd_string);
+		char* cmd_string = static_cast<char*>(Sys_AllocEventData(5));
+		strcpy(cmd_string, "quit");
+		Sys_QueEvent(0, SE_CONSOLE, 0, 0, 5, cmd_string);
 	}
 	else if (syscon_quit_on_close)
 	{}